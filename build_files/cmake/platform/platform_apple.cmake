@@ -73,6 +73,13 @@ if(WITH_OPENSUBDIV)
   list(APPEND OPENSUBDIV_LIBRARIES ${OSD_LIB_CPU} ${OSD_LIB_GPU})
 endif()
 
+if(WITH_ZSTD)
+  find_package(Zstd)
+  if(NOT ZSTD_FOUND)
+    set(WITH_ZSTD OFF)
+  endif()
+endif()
+
 if(WITH_JACK)
   find_library(JACK_FRAMEWORK
     NAMES jackmp
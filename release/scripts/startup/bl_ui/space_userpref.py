@@ -1293,6 +1293,9 @@ class USERPREF_PT_saveload_blend(SaveLoadPanel, CenterAlignMixIn, Panel):
 
         flow.prop(paths, "use_relative_paths")
         flow.prop(paths, "use_file_compression")
+        sub = flow.column()
+        sub.active = paths.use_file_compression
+        sub.prop(paths, "use_file_compression_zstd")
         flow.prop(paths, "use_load_ui")
         flow.prop(paths, "use_save_preview_images")
         flow.prop(paths, "use_tabs_as_spaces")
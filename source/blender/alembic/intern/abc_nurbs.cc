@@ -34,6 +34,7 @@ extern "C" {
 #include "BLI_string.h"
 
 #include "BKE_curve.h"
+#include "BKE_lib_id.h"
 #include "BKE_object.h"
 }
 
@@ -328,7 +329,7 @@ void AbcNurbsReader::readObjectData(Main *bmain, const Alembic::Abc::ISampleSele
     BLI_addtail(BKE_curve_nurbs_get(cu), nu);
   }
 
-  BLI_strncpy(cu->id.name + 2, m_data_name.c_str(), m_data_name.size() + 1);
+  BKE_libblock_rename(bmain, &cu->id, m_data_name.c_str());
 
   m_object = BKE_object_add_only_object(bmain, OB_SURF, m_object_name.c_str());
   m_object->data = cu;
@@ -96,8 +96,12 @@ IFACEMETHODIMP CBlendThumb::Initialize(IStream *pStream, DWORD)
 
 #include <math.h>
 #include <zlib.h>
+#ifdef WITH_ZSTD
+#  include <zstd.h>
+#endif
 #include "Wincodec.h"
 const unsigned char gzip_magic[3] = {0x1f, 0x8b, 0x08};
+const unsigned char zstd_magic[4] = {0x28, 0xb5, 0x2f, 0xfd};
 
 // IThumbnailProvider
 IFACEMETHODIMP CBlendThumb::GetThumbnail(UINT cx, HBITMAP *phbmp, WTS_ALPHATYPE *pdwAlpha)
@@ -107,14 +111,15 @@ IFACEMETHODIMP CBlendThumb::GetThumbnail(UINT cx, HBITMAP *phbmp, WTS_ALPHATYPE
   LARGE_INTEGER SeekPos;
 
   // Compressed?
-  unsigned char in_magic[3];
-  _pStream->Read(&in_magic, 3, &BytesRead);
+  unsigned char in_magic[4];
+  _pStream->Read(&in_magic, 4, &BytesRead);
   bool gzipped = true;
   for (int i = 0; i < 3; i++)
     if (in_magic[i] != gzip_magic[i]) {
       gzipped = false;
       break;
     }
+  bool zstd_compressed = (memcmp(in_magic, zstd_magic, 4) == 0);
 
   if (gzipped) {
     // Zlib inflate
@@ -167,6 +172,47 @@ IFACEMETHODIMP CBlendThumb::GetThumbnail(UINT cx, HBITMAP *phbmp, WTS_ALPHATYPE
     delete[] src;
     delete[] dest;
   }
+  else if (zstd_compressed) {
+#ifdef WITH_ZSTD
+    // Get compressed file length
+    SeekPos.QuadPart = 0;
+    ULARGE_INTEGER FileSize;
+    _pStream->Seek(SeekPos, STREAM_SEEK_END, &FileSize);
+
+    // Same bound as above: the thumbnail lives in the first 65KB of the uncompressed file.
+    // Blender writes independent frames of 1MB, so reading the worst case compressed size of
+    // one frame is enough; decompression stops once the output buffer is full.
+    size_t dest_size = 1024 * 70;
+    size_t source_size = (size_t)min(FileSize.QuadPart,
+                                     (ULONGLONG)ZSTD_compressBound(1024 * 1024));
+
+    Bytef *src = new Bytef[source_size];
+    Bytef *dest = new Bytef[dest_size];
+
+    SeekPos.QuadPart = 0;
+    _pStream->Seek(SeekPos, STREAM_SEEK_SET, NULL);
+    _pStream->Read(src, (ULONG)source_size, &BytesRead);
+
+    ZSTD_inBuffer input = {src, BytesRead, 0};
+    ZSTD_outBuffer output = {dest, dest_size, 0};
+    ZSTD_DCtx *ctx = ZSTD_createDCtx();
+    while (output.pos < output.size && input.pos < input.size) {
+      if (ZSTD_isError(ZSTD_decompressStream(ctx, &output, &input))) {
+        break;
+      }
+    }
+    ZSTD_freeDCtx(ctx);
+
+    // Replace the IStream, which is read-only
+    _pStream->Release();
+    _pStream = SHCreateMemStream(dest, (UINT)output.pos);
+
+    delete[] src;
+    delete[] dest;
+#else
+    return E_NOTIMPL;
+#endif
+  }
 
   // Blender version, early out if sub 2.5
   SeekPos.QuadPart = 9;
@@ -68,6 +68,7 @@ struct ListBase *object_duplilist(struct Depsgraph *depsgraph,
                                   struct Scene *sce,
                                   struct Object *ob);
 void free_object_duplilist(struct ListBase *lb);
+struct DupliObject *object_duplilist_array(struct ListBase *lb, int *r_len);
 
 typedef struct DupliObject {
   struct DupliObject *next, *prev;
@@ -79,6 +79,11 @@ typedef struct BVHTreeFromMesh {
   /* Private data */
   bool cached;
 
+  /* Private data for #BKE_bvhtree_from_mesh_get_deformed. */
+  int deformed_type;
+  unsigned int deformed_topology_hash;
+  float deformed_area_ratio;
+
 } BVHTreeFromMesh;
 
 /**
@@ -192,6 +197,11 @@ BVHTree *BKE_bvhtree_from_mesh_get(struct BVHTreeFromMesh *data,
                                    const int type,
                                    const int tree_type);
 
+BVHTree *BKE_bvhtree_from_mesh_get_deformed(struct BVHTreeFromMesh *data,
+                                            struct Mesh *mesh,
+                                            const int bvh_cache_type,
+                                            const int tree_type);
+
 BVHTree *BKE_bvhtree_from_editmesh_get(BVHTreeFromEditMesh *data,
                                        struct BMEditMesh *em,
                                        const int tree_type,
@@ -230,6 +240,9 @@ enum {
   BVHTREE_FROM_FACES,
   BVHTREE_FROM_LOOPTRI,
   BVHTREE_FROM_LOOPTRI_NO_HIDDEN,
+  /* Same as #BVHTREE_FROM_LOOPTRI, built for faster ray-casts (at the cost of nearest queries
+   * and build time). */
+  BVHTREE_FROM_LOOPTRI_SAH,
 
   BVHTREE_FROM_LOOSEVERTS,
   BVHTREE_FROM_LOOSEEDGES,
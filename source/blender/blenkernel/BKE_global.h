@@ -165,6 +165,9 @@ enum {
 enum {
   G_FILE_AUTOPACK = (1 << 0),
   G_FILE_COMPRESS = (1 << 1),
+  /** On write, compress with Zstandard instead of gzip (used with #G_FILE_COMPRESS).
+   * Such files can't be opened by Blender versions without Zstandard support. */
+  G_FILE_COMPRESS_ZSTD = (1 << 2),
 
   G_FILE_USERPREFS = (1 << 9),
   G_FILE_NO_UI = (1 << 10),
@@ -186,7 +189,8 @@ enum {
 };
 
 /** Don't overwrite these flags when reading a file. */
-#define G_FILE_FLAG_ALL_RUNTIME (G_FILE_NO_UI | G_FILE_RELATIVE_REMAP | G_FILE_SAVE_COPY)
+#define G_FILE_FLAG_ALL_RUNTIME \
+  (G_FILE_NO_UI | G_FILE_RELATIVE_REMAP | G_FILE_SAVE_COPY | G_FILE_COMPRESS_ZSTD)
 
 /** ENDIAN_ORDER: indicates what endianness the platform where the file was written had. */
 #if !defined(__BIG_ENDIAN__) && !defined(__LITTLE_ENDIAN__)
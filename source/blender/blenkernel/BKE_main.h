@@ -52,6 +52,7 @@ struct GSet;
 struct ImBuf;
 struct Library;
 struct MainLock;
+struct UniqueName_Map;
 
 /* Blender thumbnail, as written on file (width, height, and data as char RGBA). */
 /* We pack pixel data after that struct. */
@@ -140,6 +141,12 @@ typedef struct Main {
    */
   struct MainIDRelations *relations;
 
+  /**
+   * Names used by local IDs, created on demand and kept up to date by the ID management code,
+   * see BKE_main_namemap.h.
+   */
+  struct UniqueName_Map *name_map;
+
   struct MainLock *lock;
 } Main;
 
@@ -0,0 +1,58 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef __BKE_MAIN_NAMEMAP_H__
+#define __BKE_MAIN_NAMEMAP_H__
+
+/** \file
+ * \ingroup bke
+ *
+ * API to keep track of the names used by the local data-blocks of a Main database, so that
+ * unique names can be generated without going over all data-blocks of a type.
+ *
+ * It also serves name lookups of local and linked data-blocks, see #BKE_main_namemap_find_id.
+ * Lookups may run on several threads at once.
+ *
+ * Unlike #BKE_main_idmap_create, the map is stored in the Main database and kept up to date as
+ * data-blocks are added, renamed and removed. It is created on demand, code changing the Main
+ * lists directly (file reading, swapping lists between databases, ...) clears it.
+ *
+ * \section Function Names
+ *
+ * - `BKE_main_namemap_` Should be used for functions in that file.
+ */
+
+#include "BLI_compiler_attrs.h"
+
+struct ID;
+struct Main;
+struct UniqueName_Map;
+
+void BKE_main_namemap_destroy(struct UniqueName_Map **r_name_map) ATTR_NONNULL();
+void BKE_main_namemap_clear(struct Main *bmain) ATTR_NONNULL();
+
+bool BKE_main_namemap_get_name(struct Main *bmain,
+                               struct ID *id,
+                               char *name,
+                               struct ID **r_id_sorting_hint) ATTR_NONNULL();
+void BKE_main_namemap_add_name(struct Main *bmain, struct ID *id, const char *name)
+    ATTR_NONNULL();
+void BKE_main_namemap_remove_name(struct Main *bmain, struct ID *id, const char *name)
+    ATTR_NONNULL();
+
+struct ID *BKE_main_namemap_find_id(struct Main *bmain, const short id_type, const char *name)
+    ATTR_NONNULL() ATTR_WARN_UNUSED_RESULT;
+
+#endif /* __BKE_MAIN_NAMEMAP_H__ */
@@ -45,6 +45,8 @@
 
 /* Add the blendfile name after blendcache_ */
 #define PTCACHE_EXT ".bphys"
+/* Extension of the file holding all frames, see #PTCACHE_SINGLE_FILE. */
+#define PTCACHE_PACK_EXT ".bpack"
 #define PTCACHE_PATH "blendcache_"
 
 /* File open options, for BKE_ptcache_file_open */
@@ -105,6 +107,14 @@ typedef struct PTCacheData {
 typedef struct PTCacheFile {
   FILE *fp;
 
+  /* Frame data in memory, used instead of #fp by single file caches. */
+  unsigned char *mem;
+  size_t mem_len, mem_pos;
+  /* Mapping that #mem points into when reading, owned by the cache file. */
+  struct PTCachePackMap *pack_map;
+  /* File that #mem is appended to when closing, after writing. */
+  struct PTCachePackInfo *pack_info;
+
   int frame, old_format;
   unsigned int totpoint, type;
   unsigned int data_types, flag;
@@ -358,6 +368,10 @@ void BKE_ptcache_quick_cache_all(struct Main *bmain,
 /* Bake cache or simulate to current frame with settings defined in the baker. */
 void BKE_ptcache_bake(struct PTCacheBaker *baker);
 
+/* Background writing of disk cache frames. */
+void BKE_ptcache_disk_write_flush(void);
+void BKE_ptcache_disk_write_exit(void);
+
 /* Convert disk cache to memory cache. */
 void BKE_ptcache_disk_to_mem(struct PTCacheID *pid);
 
@@ -367,6 +381,9 @@ void BKE_ptcache_mem_to_disk(struct PTCacheID *pid);
 /* Convert disk cache to memory cache and vice versa. Clears the cache that was converted. */
 void BKE_ptcache_toggle_disk_cache(struct PTCacheID *pid);
 
+/* Convert disk cache between one file per frame and a single file, after toggling the flag. */
+void BKE_ptcache_toggle_single_file(struct PTCacheID *pid);
+
 /* Rename all disk cache files with a new name. Doesn't touch the actual content of the files. */
 void BKE_ptcache_disk_cache_rename(struct PTCacheID *pid,
                                    const char *name_src,
@@ -1768,6 +1768,109 @@ static void mesh_build_extra_data(struct Depsgraph *depsgraph, Object *ob)
   }
 }
 
+/* Layers computed again on every evaluation, from data which is otherwise unchanged. */
+#define DEFORM_REUSE_CD_MASK_SKIP (CD_MASK_NORMAL | CD_MASK_ORIGINDEX)
+#define DEFORM_REUSE_CD_MASK_SKIP_VERT \
+  (DEFORM_REUSE_CD_MASK_SKIP | CD_MASK_MVERT | CD_MASK_ORCO | CD_MASK_CLOTH_ORCO)
+
+/* Check whether all layers of both custom data, skipping the types of \a skip_mask,
+ * point to the same arrays. */
+static bool mesh_customdata_layers_shared(const CustomData *data_a,
+                                          const CustomData *data_b,
+                                          const CustomDataMask skip_mask)
+{
+  int i_a = 0, i_b = 0;
+  while (true) {
+    while (i_a < data_a->totlayer &&
+           (CD_TYPE_AS_MASK(data_a->layers[i_a].type) & skip_mask) != 0) {
+      i_a++;
+    }
+    while (i_b < data_b->totlayer &&
+           (CD_TYPE_AS_MASK(data_b->layers[i_b].type) & skip_mask) != 0) {
+      i_b++;
+    }
+    if (i_a == data_a->totlayer || i_b == data_b->totlayer) {
+      return (i_a == data_a->totlayer) && (i_b == data_b->totlayer);
+    }
+    const CustomDataLayer *layer_a = &data_a->layers[i_a++];
+    const CustomDataLayer *layer_b = &data_b->layers[i_b++];
+    if (layer_a->type != layer_b->type || layer_a->data != layer_b->data) {
+      return false;
+    }
+  }
+}
+
+/* Check whether both meshes of the same topology are tessellated the same way. The tessellation
+ * of quads (which may flip) and ngons depends on the vertex positions. */
+static bool mesh_looptri_equal(Mesh *mesh_a, Mesh *mesh_b)
+{
+  if (mesh_a->totloop == mesh_a->totpoly * 3) {
+    /* Only triangles. */
+    return true;
+  }
+  const MLoopTri *looptri_a = mesh_a->runtime.looptris.array;
+  if (looptri_a == NULL) {
+    return false;
+  }
+  const MLoopTri *looptri_b = BKE_mesh_runtime_looptri_ensure(mesh_b);
+  const int looptri_len = BKE_mesh_runtime_looptri_len(mesh_b);
+  return (mesh_a->runtime.looptris.len == looptri_len) &&
+         (memcmp(looptri_a, looptri_b, sizeof(*looptri_b) * (size_t)looptri_len) == 0);
+}
+
+/**
+ * Hand the GPU batch cache of the previous evaluated mesh over to the new one when only vertex
+ * positions changed, so topology buffers (index buffers, UVs, edit flags...) are kept.
+ *
+ * This is the case when the modifier stack only deforms (armature, shape keys...): both
+ * evaluated meshes then reference all other layers of the same input mesh.
+ *
+ * \return true when the batch cache was handed over.
+ */
+static bool mesh_batch_cache_reuse_deformed(const Mesh *mesh_input,
+                                            Mesh *mesh_eval_prev,
+                                            Mesh *mesh_eval)
+{
+  if (mesh_eval == NULL || mesh_eval->runtime.batch_cache != NULL) {
+    return false;
+  }
+  /* Not owned by the object, it may be shared with other objects. */
+  if (mesh_eval == mesh_input->runtime.mesh_eval) {
+    return false;
+  }
+  /* The input mesh was copied again from the original, its new arrays could have been allocated
+   * at the same addresses as the previous ones. */
+  if (mesh_input->id.recalc & ID_RECALC_COPY_ON_WRITE) {
+    return false;
+  }
+  if (mesh_eval->totvert != mesh_eval_prev->totvert ||
+      mesh_eval->totedge != mesh_eval_prev->totedge ||
+      mesh_eval->totloop != mesh_eval_prev->totloop ||
+      mesh_eval->totpoly != mesh_eval_prev->totpoly ||
+      mesh_eval->totcol != mesh_eval_prev->totcol) {
+    return false;
+  }
+  if (!mesh_customdata_layers_shared(
+          &mesh_eval->vdata, &mesh_eval_prev->vdata, DEFORM_REUSE_CD_MASK_SKIP_VERT) ||
+      !mesh_customdata_layers_shared(
+          &mesh_eval->edata, &mesh_eval_prev->edata, DEFORM_REUSE_CD_MASK_SKIP) ||
+      !mesh_customdata_layers_shared(
+          &mesh_eval->ldata, &mesh_eval_prev->ldata, DEFORM_REUSE_CD_MASK_SKIP) ||
+      !mesh_customdata_layers_shared(
+          &mesh_eval->pdata, &mesh_eval_prev->pdata, DEFORM_REUSE_CD_MASK_SKIP)) {
+    return false;
+  }
+  /* The triangles index buffer is kept. */
+  if (!mesh_looptri_equal(mesh_eval_prev, mesh_eval)) {
+    return false;
+  }
+
+  mesh_eval->runtime.batch_cache = mesh_eval_prev->runtime.batch_cache;
+  mesh_eval_prev->runtime.batch_cache = NULL;
+  BKE_mesh_batch_cache_dirty_tag(mesh_eval, BKE_MESH_BATCH_DIRTY_DEFORM);
+  return true;
+}
+
 static void mesh_runtime_check_normals_valid(const Mesh *mesh)
 {
   UNUSED_VARS_NDEBUG(mesh);
@@ -1788,6 +1891,16 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
    * they aren't cleaned up properly on mode switch, causing crashes, e.g T58150. */
   BLI_assert(ob->id.tag & LIB_TAG_COPIED_ON_WRITE);
 
+  /* Keep the previous evaluated mesh until the new one is computed, to reuse its GPU batch cache
+   * (meshes with a subdivision CCG are skipped, they need to be synced when freed). */
+  Mesh *mesh_eval_prev = NULL;
+  if (ob->runtime.mesh_eval != NULL && ob->runtime.is_mesh_eval_owned &&
+      ob->runtime.mesh_eval->runtime.batch_cache != NULL &&
+      ob->runtime.mesh_eval->runtime.subdiv_ccg == NULL) {
+    mesh_eval_prev = ob->runtime.mesh_eval;
+    ob->runtime.mesh_eval = NULL;
+  }
+
   BKE_object_free_derived_caches(ob);
   if (DEG_is_active(depsgraph)) {
     BKE_sculpt_update_object_before_eval(ob);
@@ -1814,6 +1927,14 @@ static void mesh_build_data(struct Depsgraph *depsgraph,
                       &ob->runtime.mesh_deform_eval,
                       &ob->runtime.mesh_eval);
 
+  bool is_batch_cache_deformed = false;
+  if (mesh_eval_prev != NULL) {
+    is_batch_cache_deformed = mesh_batch_cache_reuse_deformed(
+        ob->data, mesh_eval_prev, ob->runtime.mesh_eval);
+    BKE_mesh_eval_delete(mesh_eval_prev);
+  }
+  ob->runtime.is_mesh_batch_cache_deformed = is_batch_cache_deformed;
+
   BKE_object_boundbox_calc_from_mesh(ob, ob->runtime.mesh_eval);
 
   assign_object_mesh_eval(ob);
@@ -32,6 +32,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_blenlib.h"
 #include "BLI_alloca.h"
+#include "BLI_buffer.h"
 #include "BLI_dynstr.h"
 #include "BLI_listbase.h"
 #include "BLI_string_utils.h"
@@ -239,6 +240,67 @@ bool BKE_animdata_set_action(ReportList *reports, ID *id, bAction *act)
   return ok;
 }
 
+/* F-Curve Bindings ----------------------------------- */
+
+/* Resolving the RNA path of an F-Curve costs more than evaluating the curve itself, so the
+ * depsgraph keeps the resolved settings of the active action around between evaluations.
+ *
+ * The bindings only exist on the AnimData of evaluated copies, which are freed whenever the
+ * data-block is copied from the original again, so the resolved pointers can't outlive the data
+ * they point to. Paths leading into other data-blocks are not cached, since those can be copied
+ * again independently. */
+
+typedef struct AnimFCurveBinding {
+  /** Copy of the path the binding was resolved for, NULL when nothing is cached. */
+  char *rna_path;
+  int array_index;
+  /** The setting in the original data-block is cached as well. */
+  bool has_orig;
+  PathResolvedRNA anim_rna;
+  PathResolvedRNA orig_anim_rna;
+} AnimFCurveBinding;
+
+typedef struct AnimFCurveBindings {
+  /** One binding for every F-Curve of the action, in the same order. */
+  AnimFCurveBinding *bindings;
+  int totbinding;
+} AnimFCurveBindings;
+
+static void animdata_fcurve_bindings_free(AnimData *adt)
+{
+  AnimFCurveBindings *fcurve_bindings = adt->fcurve_bindings;
+  if (fcurve_bindings == NULL) {
+    return;
+  }
+
+  for (int i = 0; i < fcurve_bindings->totbinding; i++) {
+    MEM_SAFE_FREE(fcurve_bindings->bindings[i].rna_path);
+  }
+  MEM_freeN(fcurve_bindings->bindings);
+  MEM_freeN(fcurve_bindings);
+  adt->fcurve_bindings = NULL;
+}
+
+/* Get the bindings for the given F-Curves, NULL when there is nothing to bind. */
+static AnimFCurveBinding *animdata_fcurve_bindings_ensure(AnimData *adt, ListBase *fcurves)
+{
+  const int totbinding = BLI_listbase_count(fcurves);
+
+  if (adt->fcurve_bindings && adt->fcurve_bindings->totbinding != totbinding) {
+    animdata_fcurve_bindings_free(adt);
+  }
+  if (totbinding == 0) {
+    return NULL;
+  }
+  if (adt->fcurve_bindings == NULL) {
+    adt->fcurve_bindings = MEM_callocN(sizeof(AnimFCurveBindings), "AnimFCurveBindings");
+    adt->fcurve_bindings->bindings = MEM_calloc_arrayN(
+        totbinding, sizeof(AnimFCurveBinding), "AnimFCurveBinding");
+    adt->fcurve_bindings->totbinding = totbinding;
+  }
+  return adt->fcurve_bindings->bindings;
+}
+
 /* Freeing -------------------------------------------- */
 
 /* Free AnimData used by the nominated ID-block, and clear ID-block's AnimData pointer */
@@ -273,6 +335,9 @@ void BKE_animdata_free(ID *id, const bool do_id_user)
       /* free driver array cache */
       MEM_SAFE_FREE(adt->driver_array);
 
+      /* free resolved F-Curve paths */
+      animdata_fcurve_bindings_free(adt);
+
       /* free overrides */
       /* TODO... */
 
@@ -341,6 +406,7 @@ AnimData *BKE_animdata_copy(Main *bmain, AnimData *adt, const int flag)
   /* duplicate drivers (F-Curves) */
   copy_fcurves(&dadt->drivers, &adt->drivers);
   dadt->driver_array = NULL;
+  dadt->fcurve_bindings = NULL;
 
   /* don't copy overrides */
   BLI_listbase_clear(&dadt->overrides);
@@ -1869,22 +1935,95 @@ static bool animsys_construct_orig_pointer_rna(const PointerRNA *ptr, PointerRNA
   return true;
 }
 
+/**
+ * \param binding: Optional, when given the resolved setting is looked up in and added to it.
+ */
 static void animsys_write_orig_anim_rna(PointerRNA *ptr,
                                         const char *rna_path,
                                         int array_index,
+                                        AnimFCurveBinding *binding,
                                         float value)
 {
+  if (binding && binding->has_orig) {
+    BKE_animsys_write_rna_setting(&binding->orig_anim_rna, value);
+    return;
+  }
+
   PointerRNA ptr_orig;
   if (!animsys_construct_orig_pointer_rna(ptr, &ptr_orig)) {
     return;
   }
   PathResolvedRNA orig_anim_rna;
-  /* TODO(sergey): Should be possible to cache resolved path in dependency graph somehow. */
   if (BKE_animsys_store_rna_setting(&ptr_orig, rna_path, array_index, &orig_anim_rna)) {
     BKE_animsys_write_rna_setting(&orig_anim_rna, value);
+
+    /* Only cache the original setting along with a cached evaluated one. */
+    if (binding && binding->rna_path && orig_anim_rna.ptr.owner_id == ptr_orig.owner_id) {
+      binding->orig_anim_rna = orig_anim_rna;
+      binding->has_orig = true;
+    }
   }
 }
 
+/**
+ * Resolve the setting an F-Curve writes to, using the binding when it's still valid for the
+ * F-Curve's path.
+ *
+ * \param binding: Optional, see #AnimFCurveBinding.
+ */
+static bool animsys_fcurve_binding_resolve(PointerRNA *ptr,
+                                           FCurve *fcu,
+                                           AnimFCurveBinding *binding,
+                                           PathResolvedRNA *r_anim_rna)
+{
+  if (binding == NULL) {
+    return BKE_animsys_store_rna_setting(ptr, fcu->rna_path, fcu->array_index, r_anim_rna);
+  }
+
+  if (binding->rna_path && fcu->rna_path && binding->array_index == fcu->array_index &&
+      STREQ(binding->rna_path, fcu->rna_path)) {
+    *r_anim_rna = binding->anim_rna;
+    return true;
+  }
+
+  MEM_SAFE_FREE(binding->rna_path);
+  binding->has_orig = false;
+
+  if (!BKE_animsys_store_rna_setting(ptr, fcu->rna_path, fcu->array_index, r_anim_rna)) {
+    return false;
+  }
+  if (r_anim_rna->ptr.owner_id == ptr->owner_id) {
+    binding->rna_path = BLI_strdup(fcu->rna_path);
+    binding->array_index = fcu->array_index;
+    binding->anim_rna = *r_anim_rna;
+  }
+  return true;
+}
+
+/* Check if the F-Curve is skipped during evaluation. */
+static bool animsys_fcurve_is_skipped(FCurve *fcu)
+{
+  /* Check if this F-Curve belongs to a muted group. */
+  if ((fcu->grp != NULL) && (fcu->grp->flag & AGRP_MUTED)) {
+    return true;
+  }
+  /* Check if this curve should be skipped. */
+  if ((fcu->flag & (FCURVE_MUTED | FCURVE_DISABLED))) {
+    return true;
+  }
+  /* Skip empty curves, as if muted. */
+  return BKE_fcurve_is_empty(fcu);
+}
+
+/* Number of curves the buffers of animsys_evaluate_fcurves() hold on the stack. */
+#define ANIMSYS_FCURVES_STACK_SIZE 32
+
+/* An F-Curve along with the setting it writes to. */
+typedef struct AnimFCurveTarget {
+  AnimFCurveBinding *binding;
+  PathResolvedRNA anim_rna;
+} AnimFCurveTarget;
+
 /**
  * Evaluate all the F-Curves in the given list
  * This performs a set of standard checks. If extra checks are required,
@@ -1892,32 +2031,57 @@ static void animsys_write_orig_anim_rna(PointerRNA *ptr,
  */
 static void animsys_evaluate_fcurves(PointerRNA *ptr,
                                      ListBase *list,
+                                     AnimFCurveBinding *bindings,
                                      float ctime,
                                      bool flush_to_original)
 {
-  /* Calculate then execute each curve. */
-  for (FCurve *fcu = list->first; fcu; fcu = fcu->next) {
-    /* Check if this F-Curve doesn't belong to a muted group. */
-    if ((fcu->grp != NULL) && (fcu->grp->flag & AGRP_MUTED)) {
+  const int totfcurve = BLI_listbase_count(list);
+  BLI_buffer_declare_static(FCurve *, fcurves_buf, BLI_BUFFER_NOP, ANIMSYS_FCURVES_STACK_SIZE);
+  BLI_buffer_declare_static(
+      AnimFCurveTarget, targets_buf, BLI_BUFFER_NOP, ANIMSYS_FCURVES_STACK_SIZE);
+  BLI_buffer_declare_static(float, values_buf, BLI_BUFFER_NOP, ANIMSYS_FCURVES_STACK_SIZE);
+  FCurve **fcurves = BLI_buffer_reinit_data(&fcurves_buf, FCurve *, totfcurve);
+  AnimFCurveTarget *targets = BLI_buffer_reinit_data(&targets_buf, AnimFCurveTarget, totfcurve);
+  float *values = BLI_buffer_reinit_data(&values_buf, float, totfcurve);
+
+  /* Resolve the settings of all curves first. */
+  int tot_eval = 0;
+  int index = 0;
+  for (FCurve *fcu = list->first; fcu; fcu = fcu->next, index++) {
+    if (animsys_fcurve_is_skipped(fcu)) {
       continue;
     }
-    /* Check if this curve should be skipped. */
-    if ((fcu->flag & (FCURVE_MUTED | FCURVE_DISABLED))) {
-      continue;
+    AnimFCurveTarget *target = &targets[tot_eval];
+    target->binding = bindings ? &bindings[index] : NULL;
+    if (animsys_fcurve_binding_resolve(ptr, fcu, target->binding, &target->anim_rna)) {
+      fcurves[tot_eval++] = fcu;
     }
-    /* Skip empty curves, as if muted. */
-    if (BKE_fcurve_is_empty(fcu)) {
-      continue;
+  }
+
+  /* Calculate all curves at once, in parallel for large actions. */
+  evaluate_fcurves(fcurves, tot_eval, ctime, values);
+
+  /* Then execute each curve, writing to RNA is not thread-safe. */
+  for (int i = 0; i < tot_eval; i++) {
+    FCurve *fcu = fcurves[i];
+    AnimFCurveTarget *target = &targets[i];
+    float curval = values[i];
+    if (fcu->driver) {
+      /* Drivers may read settings written by the curves before them. */
+      curval = calculate_fcurve(&target->anim_rna, fcu, ctime);
     }
-    PathResolvedRNA anim_rna;
-    if (BKE_animsys_store_rna_setting(ptr, fcu->rna_path, fcu->array_index, &anim_rna)) {
-      const float curval = calculate_fcurve(&anim_rna, fcu, ctime);
-      BKE_animsys_write_rna_setting(&anim_rna, curval);
-      if (flush_to_original) {
-        animsys_write_orig_anim_rna(ptr, fcu->rna_path, fcu->array_index, curval);
-      }
+    else {
+      fcu->curval = curval; /* debug display only */
+    }
+    BKE_animsys_write_rna_setting(&target->anim_rna, curval);
+    if (flush_to_original) {
+      animsys_write_orig_anim_rna(ptr, fcu->rna_path, fcu->array_index, target->binding, curval);
     }
   }
+
+  BLI_buffer_free(&values_buf);
+  BLI_buffer_free(&targets_buf);
+  BLI_buffer_free(&fcurves_buf);
 }
 
 /* ***************************************** */
@@ -2034,6 +2198,7 @@ void animsys_evaluate_action_group(PointerRNA *ptr, bAction *act, bActionGroup *
 /* Evaluate Action (F-Curve Bag) */
 static void animsys_evaluate_action_ex(PointerRNA *ptr,
                                        bAction *act,
+                                       AnimFCurveBinding *bindings,
                                        float ctime,
                                        const bool flush_to_original)
 {
@@ -2045,7 +2210,7 @@ static void animsys_evaluate_action_ex(PointerRNA *ptr,
   action_idcode_patch_check(ptr->owner_id, act);
 
   /* calculate then execute each curve */
-  animsys_evaluate_fcurves(ptr, &act->curves, ctime, flush_to_original);
+  animsys_evaluate_fcurves(ptr, &act->curves, bindings, ctime, flush_to_original);
 }
 
 void animsys_evaluate_action(PointerRNA *ptr,
@@ -2053,7 +2218,7 @@ void animsys_evaluate_action(PointerRNA *ptr,
                              float ctime,
                              const bool flush_to_original)
 {
-  animsys_evaluate_action_ex(ptr, act, ctime, flush_to_original);
+  animsys_evaluate_action_ex(ptr, act, NULL, ctime, flush_to_original);
 }
 
 /* ***************************************** */
@@ -2092,7 +2257,7 @@ static void nlastrip_evaluate_controls(NlaStrip *strip, float ctime, const bool
     RNA_pointer_create(NULL, &RNA_NlaStrip, strip, &strip_ptr);
 
     /* execute these settings as per normal */
-    animsys_evaluate_fcurves(&strip_ptr, &strip->fcurves, ctime, flush_to_original);
+    animsys_evaluate_fcurves(&strip_ptr, &strip->fcurves, NULL, ctime, flush_to_original);
   }
 
   /* analytically generate values for influence and time (if applicable)
@@ -3108,27 +3273,29 @@ static void nlastrip_evaluate_actionclip(PointerRNA *ptr,
       .influence = strip->influence,
   };
 
-  /* Evaluate all the F-Curves in the action,
-   * saving the relevant pointers to data that will need to be used. */
-  for (fcu = strip->act->curves.first; fcu; fcu = fcu->next) {
-    float value = 0.0f;
+  /* Evaluate all the F-Curves in the action at once, in parallel for large actions.
+   * NOTE: we use the modified time here, since strip's F-Curve Modifiers
+   * are applied on top of this.
+   */
+  const int totfcurve = BLI_listbase_count(&strip->act->curves);
+  BLI_buffer_declare_static(FCurve *, fcurves_buf, BLI_BUFFER_NOP, ANIMSYS_FCURVES_STACK_SIZE);
+  BLI_buffer_declare_static(float, values_buf, BLI_BUFFER_NOP, ANIMSYS_FCURVES_STACK_SIZE);
+  FCurve **fcurves = BLI_buffer_reinit_data(&fcurves_buf, FCurve *, totfcurve);
+  float *values = BLI_buffer_reinit_data(&values_buf, float, totfcurve);
 
-    /* check if this curve should be skipped */
-    if (fcu->flag & (FCURVE_MUTED | FCURVE_DISABLED)) {
-      continue;
-    }
-    if ((fcu->grp) && (fcu->grp->flag & AGRP_MUTED)) {
-      continue;
-    }
-    if (BKE_fcurve_is_empty(fcu)) {
-      continue;
+  int tot_eval = 0;
+  for (fcu = strip->act->curves.first; fcu; fcu = fcu->next) {
+    if (!animsys_fcurve_is_skipped(fcu)) {
+      fcurves[tot_eval++] = fcu;
     }
+  }
+  evaluate_fcurves(fcurves, tot_eval, evaltime, values);
 
-    /* evaluate the F-Curve's value for the time given in the strip
-     * NOTE: we use the modified time here, since strip's F-Curve Modifiers
-     * are applied on top of this.
-     */
-    value = evaluate_fcurve(fcu, evaltime);
+  /* Blend the values of the F-Curves,
+   * saving the relevant pointers to data that will need to be used. */
+  for (int i = 0; i < tot_eval; i++) {
+    float value = values[i];
+    fcu = fcurves[i];
 
     /* apply strip's F-Curve Modifiers on this value
      * NOTE: we apply the strip's original evaluation time not the modified one
@@ -3144,6 +3311,9 @@ static void nlastrip_evaluate_actionclip(PointerRNA *ptr,
     nlaeval_blend_value(&blend, nec, fcu->array_index, value);
   }
 
+  BLI_buffer_free(&values_buf);
+  BLI_buffer_free(&fcurves_buf);
+
   nlaeval_blend_flush(&blend);
 
   /* unlink this strip's modifiers from the parent's modifiers again */
@@ -3321,7 +3491,7 @@ void nladata_flush_channels(PointerRNA *ptr,
         }
         BKE_animsys_write_rna_setting(&rna, value);
         if (flush_to_original) {
-          animsys_write_orig_anim_rna(ptr, nec->rna_path, rna.prop_index, value);
+          animsys_write_orig_anim_rna(ptr, nec->rna_path, rna.prop_index, NULL, value);
         }
       }
     }
@@ -3852,9 +4022,17 @@ static void animsys_evaluate_overrides(PointerRNA *ptr, AnimData *adt)
  * This assumes that the animation-data provided belongs to the ID block in question,
  * and that the flags for which parts of the anim-data settings need to be recalculated
  * have been set already by the depsgraph. Now, we use the recalc
+ *
+ * \param use_fcurve_bindings: Keep the resolved paths of the active action on the AnimData,
+ * only allowed for evaluated copies which are not evaluated from multiple threads.
  */
-void BKE_animsys_evaluate_animdata(
-    Scene *scene, ID *id, AnimData *adt, float ctime, short recalc, const bool flush_to_original)
+static void animsys_evaluate_animdata_ex(Scene *scene,
+                                         ID *id,
+                                         AnimData *adt,
+                                         float ctime,
+                                         short recalc,
+                                         const bool flush_to_original,
+                                         const bool use_fcurve_bindings)
 {
   PointerRNA id_ptr;
 
@@ -3881,7 +4059,10 @@ void BKE_animsys_evaluate_animdata(
     }
     /* evaluate Active Action only */
     else if (adt->action) {
-      animsys_evaluate_action_ex(&id_ptr, adt->action, ctime, flush_to_original);
+      AnimFCurveBinding *bindings = use_fcurve_bindings ?
+                                        animdata_fcurve_bindings_ensure(adt, &adt->action->curves) :
+                                        NULL;
+      animsys_evaluate_action_ex(&id_ptr, adt->action, bindings, ctime, flush_to_original);
     }
   }
 
@@ -3910,6 +4091,12 @@ void BKE_animsys_evaluate_animdata(
   }
 }
 
+void BKE_animsys_evaluate_animdata(
+    Scene *scene, ID *id, AnimData *adt, float ctime, short recalc, const bool flush_to_original)
+{
+  animsys_evaluate_animdata_ex(scene, id, adt, ctime, recalc, flush_to_original, false);
+}
+
 /* Evaluation of all ID-blocks with Animation Data blocks - Animation Data Only
  *
  * This will evaluate only the animation info available in the animation data-blocks
@@ -4066,7 +4253,9 @@ void BKE_animsys_eval_animdata(Depsgraph *depsgraph, ID *id)
   Scene *scene = NULL;
   DEG_debug_print_eval_time(depsgraph, __func__, id->name, id, ctime);
   const bool flush_to_original = DEG_is_active(depsgraph);
-  BKE_animsys_evaluate_animdata(scene, id, adt, ctime, ADT_RECALC_ANIM, flush_to_original);
+  /* The depsgraph evaluates the animation of a data-block from a single thread, and only ever
+   * does so on evaluated copies, so the resolved paths can be kept. */
+  animsys_evaluate_animdata_ex(scene, id, adt, ctime, ADT_RECALC_ANIM, flush_to_original, true);
 }
 
 void BKE_animsys_update_driver_array(ID *id)
@@ -4133,7 +4322,7 @@ void BKE_animsys_eval_driver(Depsgraph *depsgraph, ID *id, int driver_index, FCu
 
         /* Flush results & status codes to original data for UI (T59984) */
         if (ok && DEG_is_active(depsgraph)) {
-          animsys_write_orig_anim_rna(&id_ptr, fcu->rna_path, fcu->array_index, curval);
+          animsys_write_orig_anim_rna(&id_ptr, fcu->rna_path, fcu->array_index, NULL, curval);
 
           /* curval is displayed in the UI, and flag contains error-status codes */
           fcu_orig->curval = fcu->curval;
@@ -38,15 +38,19 @@
 
 #include "DNA_scene_types.h"
 
+#include "BLI_utildefines.h"
+
+#include "BLI_ghash.h"
+#include "BLI_listbase.h"
 #include "BLI_path_util.h"
 #include "BLI_string.h"
-#include "BLI_utildefines.h"
 
 #include "BKE_appdir.h"
 #include "BKE_blender_undo.h" /* own include */
 #include "BKE_blendfile.h"
 #include "BKE_context.h"
 #include "BKE_global.h"
+#include "BKE_lib_id.h"
 #include "BKE_main.h"
 
 #include "BLO_undofile.h"
@@ -54,6 +58,8 @@
 #include "BLO_writefile.h"
 
 #include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
 
 /* -------------------------------------------------------------------- */
 /** \name Global Undo
@@ -61,6 +67,41 @@
 
 #define UNDO_DISK 0
 
+/**
+ * Scenes unchanged by undo keep their dependency graphs,
+ * hand them over to the new main and tag the data-blocks which were read again.
+ */
+static void memfile_undo_depsgraphs_update(Main *bmain)
+{
+  bool has_depsgraph = false;
+  LISTBASE_FOREACH (Scene *, scene, &bmain->scenes) {
+    if ((scene->id.tag & LIB_TAG_UNDO_OLD_ID_REUSED) && scene->depsgraph_hash != NULL) {
+      GHASH_FOREACH_BEGIN (Depsgraph *, depsgraph, scene->depsgraph_hash) {
+        DEG_graph_replace_owners(depsgraph, bmain, scene, DEG_get_input_view_layer(depsgraph));
+      }
+      GHASH_FOREACH_END();
+      has_depsgraph = true;
+    }
+  }
+
+  if (has_depsgraph) {
+    ID *id;
+    FOREACH_MAIN_ID_BEGIN (bmain, id) {
+      /* The UI is kept, linked data-blocks are never read again. */
+      if ((id->tag & LIB_TAG_UNDO_OLD_ID_REUSED) || ID_IS_LINKED(id) ||
+          ELEM(GS(id->name), ID_WM, ID_WS, ID_SCR)) {
+        continue;
+      }
+      DEG_id_tag_update_ex(bmain, id, 0);
+      /* Only re-builds the relations of the changed IDs when possible. */
+      DEG_relations_tag_update_id(bmain, id);
+    }
+    FOREACH_MAIN_ID_END;
+  }
+
+  BKE_main_id_tag_all(bmain, LIB_TAG_UNDO_OLD_ID_REUSED, false);
+}
+
 bool BKE_memfile_undo_decode(MemFileUndoData *mfu, bContext *C)
 {
   Main *bmain = CTX_data_main(C);
@@ -70,14 +111,24 @@ bool BKE_memfile_undo_decode(MemFileUndoData *mfu, bContext *C)
   BLI_strncpy(mainstr, BKE_main_blendfile_path(bmain), sizeof(mainstr)); /* temporal store */
 
   fileflags = G.fileflags;
-  G.fileflags |= G_FILE_NO_UI;
 
   if (UNDO_DISK) {
+    G.fileflags |= G_FILE_NO_UI;
     success = BKE_blendfile_read(C, mfu->filename, &(const struct BlendFileReadParams){0}, NULL);
   }
   else {
+    /* Write the current state like an undo step, sharing the chunks of the step being read:
+     * data-blocks stored identically in both are unchanged and kept as they are.
+     * The last undo step can't be used instead, not every change since is tagged for update
+     * (selection, UI properties...), and a change missed here wouldn't be undone. */
+    MemFile memfile_current = {{NULL}};
+    BLO_write_file_mem(bmain, &mfu->memfile, &memfile_current, fileflags);
+
+    G.fileflags |= G_FILE_NO_UI;
     success = BKE_blendfile_read_from_memfile(
-        C, &mfu->memfile, &(const struct BlendFileReadParams){0}, NULL);
+        C, &mfu->memfile, &memfile_current, &(const struct BlendFileReadParams){0}, NULL);
+
+    BLO_memfile_free(&memfile_current);
   }
 
   /* Restore, bmain has been re-allocated. */
@@ -86,6 +137,8 @@ bool BKE_memfile_undo_decode(MemFileUndoData *mfu, bContext *C)
   G.fileflags = fileflags;
 
   if (success) {
+    memfile_undo_depsgraphs_update(bmain);
+
     /* important not to update time here, else non keyed transforms are lost */
     DEG_on_visible_update(bmain, false);
   }
@@ -52,6 +52,7 @@
 #include "BKE_layer.h"
 #include "BKE_lib_id.h"
 #include "BKE_main.h"
+#include "BKE_main_namemap.h"
 #include "BKE_report.h"
 #include "BKE_scene.h"
 #include "BKE_screen.h"
@@ -197,6 +198,7 @@ static void setup_app_data(bContext *C,
     SWAP(ListBase, bmain->wm, bfd->main->wm);
     SWAP(ListBase, bmain->workspaces, bfd->main->workspaces);
     SWAP(ListBase, bmain->screens, bfd->main->screens);
+    BKE_main_namemap_clear(bfd->main);
 
     /* we re-use current window and screen */
     win = CTX_wm_window(C);
@@ -370,9 +372,10 @@ static void setup_app_data(bContext *C,
      * data-blocks from libraries (since those are not supposed to change). Unfortunately, that
      * means that we do not reset their user count, however we do increase that one when doing
      * lib_link on local IDs using linked ones.
+     * Local data-blocks unchanged by undo are kept as is too, without being lib-linked.
      * There is no real way to predict amount of changes here, so we have to fully redo
      * refcounting . */
-    BKE_main_id_refcount_recompute(bmain, true);
+    BKE_main_id_refcount_recompute(bmain, false);
   }
 }
 
@@ -464,17 +467,26 @@ bool BKE_blendfile_read_from_memory(bContext *C,
   return (bfd != NULL);
 }
 
-/* memfile is the undo buffer */
+/**
+ * \param memfile: The undo buffer.
+ * \param oldmain_memfile: The current main written using \a memfile as reference (can be NULL),
+ * data-blocks which are unchanged are kept, see #BLO_read_from_memfile.
+ */
 bool BKE_blendfile_read_from_memfile(bContext *C,
                                      struct MemFile *memfile,
+                                     const struct MemFile *oldmain_memfile,
                                      const struct BlendFileReadParams *params,
                                      ReportList *reports)
 {
   Main *bmain = CTX_data_main(C);
   BlendFileData *bfd;
 
-  bfd = BLO_read_from_memfile(
-      bmain, BKE_main_blendfile_path(bmain), memfile, params->skip_flags, reports);
+  bfd = BLO_read_from_memfile(bmain,
+                              BKE_main_blendfile_path(bmain),
+                              memfile,
+                              oldmain_memfile,
+                              params->skip_flags,
+                              reports);
   if (bfd) {
     /* remove the unused screens and wm */
     while (bfd->main->wm.first) {
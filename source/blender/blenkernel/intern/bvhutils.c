@@ -30,8 +30,10 @@
 #include "DNA_meshdata_types.h"
 
 #include "BLI_utildefines.h"
+#include "BLI_hash_mm2a.h"
 #include "BLI_linklist.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BKE_bvhutils.h"
@@ -417,6 +419,36 @@ static void mesh_edges_spherecast(void *userdata,
  * BVH builders
  */
 
+/**
+ * Indices of the elements enabled in \a mask, to insert them with #BLI_bvhtree_insert_bulk.
+ * Returns NULL when there is no mask (all elements are used).
+ */
+static int *bvhtree_mask_indices(const BLI_bitmap *mask, const int elem_num, const int elem_active)
+{
+  if (mask == NULL) {
+    return NULL;
+  }
+
+  int *indices = MEM_mallocN(sizeof(*indices) * (size_t)max_ii(elem_active, 1), __func__);
+  int indices_len = 0;
+  for (int i = 0; i < elem_num; i++) {
+    if (BLI_BITMAP_TEST_BOOL(mask, i)) {
+      indices[indices_len++] = i;
+    }
+  }
+  BLI_assert(indices_len == elem_active);
+  UNUSED_VARS_NDEBUG(indices_len);
+  return indices;
+}
+
+/* Userdata of the #BLI_bvhtree_insert_bulk callbacks of mesh elements. */
+typedef struct BVHTreeInsertBulkMeshData {
+  const MVert *vert;
+  const MEdge *edge;
+  const MLoop *mloop;
+  const MLoopTri *looptri;
+} BVHTreeInsertBulkMeshData;
+
 /* -------------------------------------------------------------------- */
 /** \name Vertex Builder
  * \{ */
@@ -454,6 +486,15 @@ static BVHTree *bvhtree_from_editmesh_verts_create_tree(float epsilon,
   return tree;
 }
 
+static int bvhtree_insert_bulk_mesh_vert_cb(void *userdata,
+                                            int index,
+                                            float r_co[BVH_BULK_INSERT_POINTS_MAX][3])
+{
+  const BVHTreeInsertBulkMeshData *data = userdata;
+  copy_v3_v3(r_co[0], data->vert[index].co);
+  return 1;
+}
+
 static BVHTree *bvhtree_from_mesh_verts_create_tree(float epsilon,
                                                     int tree_type,
                                                     int axis,
@@ -475,12 +516,12 @@ static BVHTree *bvhtree_from_mesh_verts_create_tree(float epsilon,
     tree = BLI_bvhtree_new(verts_num_active, epsilon, tree_type, axis);
 
     if (tree) {
-      for (int i = 0; i < verts_num; i++) {
-        if (verts_mask && !BLI_BITMAP_TEST_BOOL(verts_mask, i)) {
-          continue;
-        }
-        BLI_bvhtree_insert(tree, i, vert[i].co, 1);
-      }
+      BVHTreeInsertBulkMeshData data = {.vert = vert};
+      int *indices = bvhtree_mask_indices(verts_mask, verts_num, verts_num_active);
+      BLI_bvhtree_insert_bulk(
+          tree, indices, verts_num_active, bvhtree_insert_bulk_mesh_vert_cb, &data);
+      MEM_SAFE_FREE(indices);
+
       BLI_assert(BLI_bvhtree_get_len(tree) == verts_num_active);
       BLI_bvhtree_balance(tree);
     }
@@ -664,6 +705,16 @@ static BVHTree *bvhtree_from_editmesh_edges_create_tree(float epsilon,
   return tree;
 }
 
+static int bvhtree_insert_bulk_mesh_edge_cb(void *userdata,
+                                            int index,
+                                            float r_co[BVH_BULK_INSERT_POINTS_MAX][3])
+{
+  const BVHTreeInsertBulkMeshData *data = userdata;
+  copy_v3_v3(r_co[0], data->vert[data->edge[index].v1].co);
+  copy_v3_v3(r_co[1], data->vert[data->edge[index].v2].co);
+  return 2;
+}
+
 static BVHTree *bvhtree_from_mesh_edges_create_tree(const MVert *vert,
                                                     const MEdge *edge,
                                                     const int edge_num,
@@ -686,16 +737,12 @@ static BVHTree *bvhtree_from_mesh_edges_create_tree(const MVert *vert,
     /* Create a bvh-tree of the given target */
     tree = BLI_bvhtree_new(edges_num_active, epsilon, tree_type, axis);
     if (tree) {
-      for (int i = 0; i < edge_num; i++) {
-        if (edges_mask && !BLI_BITMAP_TEST_BOOL(edges_mask, i)) {
-          continue;
-        }
-        float co[2][3];
-        copy_v3_v3(co[0], vert[edge[i].v1].co);
-        copy_v3_v3(co[1], vert[edge[i].v2].co);
+      BVHTreeInsertBulkMeshData data = {.vert = vert, .edge = edge};
+      int *indices = bvhtree_mask_indices(edges_mask, edge_num, edges_num_active);
+      BLI_bvhtree_insert_bulk(
+          tree, indices, edges_num_active, bvhtree_insert_bulk_mesh_edge_cb, &data);
+      MEM_SAFE_FREE(indices);
 
-        BLI_bvhtree_insert(tree, i, co[0], 2);
-      }
       BLI_bvhtree_balance(tree);
     }
   }
@@ -1030,6 +1077,18 @@ static BVHTree *bvhtree_from_editmesh_looptri_create_tree(float epsilon,
   return tree;
 }
 
+static int bvhtree_insert_bulk_mesh_looptri_cb(void *userdata,
+                                               int index,
+                                               float r_co[BVH_BULK_INSERT_POINTS_MAX][3])
+{
+  const BVHTreeInsertBulkMeshData *data = userdata;
+  const MLoopTri *lt = &data->looptri[index];
+  copy_v3_v3(r_co[0], data->vert[data->mloop[lt->tri[0]].v].co);
+  copy_v3_v3(r_co[1], data->vert[data->mloop[lt->tri[1]].v].co);
+  copy_v3_v3(r_co[2], data->vert[data->mloop[lt->tri[2]].v].co);
+  return 3;
+}
+
 static BVHTree *bvhtree_from_mesh_looptri_create_tree(float epsilon,
                                                       int tree_type,
                                                       int axis,
@@ -1038,7 +1097,8 @@ static BVHTree *bvhtree_from_mesh_looptri_create_tree(float epsilon,
                                                       const MLoopTri *looptri,
                                                       const int looptri_num,
                                                       const BLI_bitmap *looptri_mask,
-                                                      int looptri_num_active)
+                                                      int looptri_num_active,
+                                                      const eBVHTreeBuildMode build_mode)
 {
   BVHTree *tree = NULL;
 
@@ -1052,21 +1112,14 @@ static BVHTree *bvhtree_from_mesh_looptri_create_tree(float epsilon,
   if (looptri_num_active) {
     /* Create a bvh-tree of the given target */
     /* printf("%s: building BVH, total=%d\n", __func__, numFaces); */
-    tree = BLI_bvhtree_new(looptri_num_active, epsilon, tree_type, axis);
+    tree = BLI_bvhtree_new_ex(looptri_num_active, epsilon, tree_type, axis, build_mode);
     if (tree) {
       if (vert && looptri) {
-        for (int i = 0; i < looptri_num; i++) {
-          float co[3][3];
-          if (looptri_mask && !BLI_BITMAP_TEST_BOOL(looptri_mask, i)) {
-            continue;
-          }
-
-          copy_v3_v3(co[0], vert[mloop[looptri[i].tri[0]].v].co);
-          copy_v3_v3(co[1], vert[mloop[looptri[i].tri[1]].v].co);
-          copy_v3_v3(co[2], vert[mloop[looptri[i].tri[2]].v].co);
-
-          BLI_bvhtree_insert(tree, i, co[0], 3);
-        }
+        BVHTreeInsertBulkMeshData data = {.vert = vert, .mloop = mloop, .looptri = looptri};
+        int *indices = bvhtree_mask_indices(looptri_mask, looptri_num, looptri_num_active);
+        BLI_bvhtree_insert_bulk(
+            tree, indices, looptri_num_active, bvhtree_insert_bulk_mesh_looptri_cb, &data);
+        MEM_SAFE_FREE(indices);
       }
       BLI_assert(BLI_bvhtree_get_len(tree) == looptri_num_active);
       BLI_bvhtree_balance(tree);
@@ -1195,6 +1248,12 @@ BVHTree *bvhtree_from_mesh_looptri_ex(BVHTreeFromMesh *data,
   }
 
   if (in_cache == false) {
+    /* Triangles are usually not uniformly distributed (nor sized), SAH gives faster ray-casts
+     * for these, but slower nearest queries and builds. So it's only used when asked for. */
+    const eBVHTreeBuildMode build_mode = (bvh_cache_type == BVHTREE_FROM_LOOPTRI_SAH) ?
+                                             BVH_BUILD_SAH :
+                                             BVH_BUILD_MEDIAN;
+
     /* Setup BVHTreeFromMesh */
     tree = bvhtree_from_mesh_looptri_create_tree(epsilon,
                                                  tree_type,
@@ -1204,7 +1263,8 @@ BVHTree *bvhtree_from_mesh_looptri_ex(BVHTreeFromMesh *data,
                                                  looptri,
                                                  looptri_num,
                                                  looptri_mask,
-                                                 looptri_num_active);
+                                                 looptri_num_active,
+                                                 build_mode);
 
     if (bvh_cache) {
       bvhcache_insert(bvh_cache, tree, bvh_cache_type);
@@ -1427,6 +1487,7 @@ BVHTree *BKE_bvhtree_from_mesh_get(struct BVHTreeFromMesh *data,
 
     case BVHTREE_FROM_LOOPTRI:
     case BVHTREE_FROM_LOOPTRI_NO_HIDDEN:
+    case BVHTREE_FROM_LOOPTRI_SAH:
       if (is_cached == false) {
         const MLoopTri *mlooptri = BKE_mesh_runtime_looptri_ensure(mesh);
         int looptri_len = BKE_mesh_runtime_looptri_len(mesh);
@@ -1553,6 +1614,7 @@ BVHTree *BKE_bvhtree_from_editmesh_get(BVHTreeFromEditMesh *data,
     case BVHTREE_FROM_FACES:
     case BVHTREE_FROM_LOOPTRI:
     case BVHTREE_FROM_LOOPTRI_NO_HIDDEN:
+    case BVHTREE_FROM_LOOPTRI_SAH:
     case BVHTREE_FROM_LOOSEVERTS:
     case BVHTREE_FROM_LOOSEEDGES:
       BLI_assert(false);
@@ -1579,6 +1641,189 @@ BVHTree *BKE_bvhtree_from_editmesh_get(BVHTreeFromEditMesh *data,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Deformed Mesh Builder
+ * \{ */
+
+/* Rebuild the tree instead of refitting it once its bounds overlap this much more
+ * than right after the build (see #BLI_bvhtree_get_area_ratio). */
+#define BVH_REFIT_AREA_RATIO_FACTOR_MAX 1.5f
+
+typedef struct BVHTreeRefitMeshData {
+  BVHTree *tree;
+  BVHTree_InsertBulkCallback callback;
+  BVHTreeInsertBulkMeshData mesh;
+} BVHTreeRefitMeshData;
+
+static void bvhtree_refit_mesh_task_cb(void *__restrict userdata,
+                                       const int i,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BVHTreeRefitMeshData *data = userdata;
+  float co[BVH_BULK_INSERT_POINTS_MAX][3];
+  const int numpoints = data->callback(&data->mesh, i, co);
+  BLI_bvhtree_update_node(data->tree, i, co[0], NULL, numpoints);
+}
+
+/**
+ * Hash of the mesh connectivity used by a tree of the given type,
+ * the tree can be refitted as long as it does not change.
+ */
+static uint bvhtree_mesh_topology_hash(const Mesh *mesh, const int bvh_cache_type)
+{
+  BLI_HashMurmur2A mm2;
+  BLI_hash_mm2a_init(&mm2, (uint32_t)bvh_cache_type);
+
+  switch (bvh_cache_type) {
+    case BVHTREE_FROM_VERTS:
+      BLI_hash_mm2a_add_int(&mm2, mesh->totvert);
+      break;
+    case BVHTREE_FROM_EDGES:
+      for (int i = 0; i < mesh->totedge; i++) {
+        BLI_hash_mm2a_add_int(&mm2, (int)mesh->medge[i].v1);
+        BLI_hash_mm2a_add_int(&mm2, (int)mesh->medge[i].v2);
+      }
+      break;
+    case BVHTREE_FROM_LOOPTRI:
+      /* Not the triangles themselves, the tessellation of quads may flip as they deform. */
+      for (int i = 0; i < mesh->totpoly; i++) {
+        BLI_hash_mm2a_add_int(&mm2, mesh->mpoly[i].totloop);
+      }
+      for (int i = 0; i < mesh->totloop; i++) {
+        BLI_hash_mm2a_add_int(&mm2, (int)mesh->mloop[i].v);
+      }
+      break;
+  }
+
+  return BLI_hash_mm2a_end(&mm2);
+}
+
+/**
+ * Same as #BKE_bvhtree_from_mesh_get, for meshes which are deformed between calls
+ * (colliders, modifier targets...).
+ *
+ * The tree is owned by \a data instead of the mesh cache, and kept between calls:
+ * while \a mesh has the same topology as the mesh the tree was built from, only its bounds
+ * are updated to the new vertex positions. It is rebuilt when the topology changes,
+ * or when the bounds overlap too much after deforming.
+ *
+ * Only #BVHTREE_FROM_VERTS, #BVHTREE_FROM_EDGES and #BVHTREE_FROM_LOOPTRI are supported.
+ * \a data must be zero initialized before the first call and freed with #free_bvhtree_from_mesh.
+ */
+BVHTree *BKE_bvhtree_from_mesh_get_deformed(struct BVHTreeFromMesh *data,
+                                            struct Mesh *mesh,
+                                            const int bvh_cache_type,
+                                            const int tree_type)
+{
+  BVHTreeRefitMeshData refit_data = {.mesh = {.vert = mesh->mvert}};
+  int elem_num;
+
+  switch (bvh_cache_type) {
+    case BVHTREE_FROM_VERTS:
+      elem_num = mesh->totvert;
+      refit_data.callback = bvhtree_insert_bulk_mesh_vert_cb;
+      break;
+    case BVHTREE_FROM_EDGES:
+      elem_num = mesh->totedge;
+      refit_data.callback = bvhtree_insert_bulk_mesh_edge_cb;
+      refit_data.mesh.edge = mesh->medge;
+      break;
+    case BVHTREE_FROM_LOOPTRI:
+      refit_data.mesh.looptri = BKE_mesh_runtime_looptri_ensure(mesh);
+      refit_data.mesh.mloop = mesh->mloop;
+      refit_data.callback = bvhtree_insert_bulk_mesh_looptri_cb;
+      elem_num = BKE_mesh_runtime_looptri_len(mesh);
+      break;
+    default:
+      BLI_assert(0);
+      free_bvhtree_from_mesh(data);
+      return NULL;
+  }
+
+  const uint topology_hash = bvhtree_mesh_topology_hash(mesh, bvh_cache_type);
+  bool use_refit = (data->tree != NULL) && !data->cached &&
+                   (data->deformed_type == bvh_cache_type) &&
+                   (data->deformed_topology_hash == topology_hash) &&
+                   (BLI_bvhtree_get_len(data->tree) == elem_num) &&
+                   (BLI_bvhtree_get_tree_type(data->tree) == tree_type);
+
+  if (use_refit) {
+    refit_data.tree = data->tree;
+
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1024;
+    BLI_task_parallel_range(0, elem_num, &refit_data, bvhtree_refit_mesh_task_cb, &settings);
+    BLI_bvhtree_update_tree(data->tree);
+
+    use_refit = BLI_bvhtree_get_area_ratio(data->tree) <=
+                data->deformed_area_ratio * BVH_REFIT_AREA_RATIO_FACTOR_MAX;
+  }
+
+  if (use_refit) {
+    /* Same tree, the arrays of the new mesh are used by the callbacks. */
+    data->vert = refit_data.mesh.vert;
+    data->edge = refit_data.mesh.edge;
+    data->loop = refit_data.mesh.mloop;
+    data->looptri = refit_data.mesh.looptri;
+    return data->tree;
+  }
+
+  free_bvhtree_from_mesh(data);
+
+  switch (bvh_cache_type) {
+    case BVHTREE_FROM_VERTS:
+      bvhtree_from_mesh_verts_ex(
+          data, mesh->mvert, elem_num, false, NULL, -1, 0.0f, tree_type, 6, bvh_cache_type, NULL);
+      break;
+    case BVHTREE_FROM_EDGES:
+      bvhtree_from_mesh_edges_ex(data,
+                                 mesh->mvert,
+                                 false,
+                                 mesh->medge,
+                                 elem_num,
+                                 false,
+                                 NULL,
+                                 -1,
+                                 0.0f,
+                                 tree_type,
+                                 6,
+                                 bvh_cache_type,
+                                 NULL);
+      break;
+    case BVHTREE_FROM_LOOPTRI:
+      bvhtree_from_mesh_looptri_ex(data,
+                                   mesh->mvert,
+                                   false,
+                                   mesh->mloop,
+                                   false,
+                                   refit_data.mesh.looptri,
+                                   elem_num,
+                                   false,
+                                   NULL,
+                                   -1,
+                                   0.0f,
+                                   tree_type,
+                                   6,
+                                   bvh_cache_type,
+                                   NULL);
+      break;
+  }
+
+  if (data->tree != NULL) {
+    data->deformed_type = bvh_cache_type;
+    data->deformed_topology_hash = topology_hash;
+    data->deformed_area_ratio = BLI_bvhtree_get_area_ratio(data->tree);
+  }
+  else {
+    free_bvhtree_from_mesh(data);
+  }
+
+  return data->tree;
+}
+
+/** \} */
+
 /* Frees data allocated by a call to bvhtree_from_editmesh_*. */
 void free_bvhtree_from_editmesh(struct BVHTreeFromEditMesh *data)
 {
@@ -136,6 +136,42 @@ BVHTree *bvhtree_build_from_mvert(const MVert *mvert,
   return tree;
 }
 
+typedef struct BVHUpdateFromMVertData {
+  BVHTree *bvhtree;
+  const MVert *mvert;
+  const MVert *mvert_moving;
+  const MVertTri *tri;
+} BVHUpdateFromMVertData;
+
+static void bvhtree_update_from_mvert_task_cb(void *__restrict userdata,
+                                              const int i,
+                                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHUpdateFromMVertData *data = userdata;
+  const MVertTri *vt = &data->tri[i];
+  const MVert *mvert = data->mvert;
+  float co[3][3];
+
+  copy_v3_v3(co[0], mvert[vt->tri[0]].co);
+  copy_v3_v3(co[1], mvert[vt->tri[1]].co);
+  copy_v3_v3(co[2], mvert[vt->tri[2]].co);
+
+  /* copy new locations into array */
+  if (data->mvert_moving) {
+    const MVert *mvert_moving = data->mvert_moving;
+    float co_moving[3][3];
+    /* update moving positions */
+    copy_v3_v3(co_moving[0], mvert_moving[vt->tri[0]].co);
+    copy_v3_v3(co_moving[1], mvert_moving[vt->tri[1]].co);
+    copy_v3_v3(co_moving[2], mvert_moving[vt->tri[2]].co);
+
+    BLI_bvhtree_update_node(data->bvhtree, i, &co[0][0], &co_moving[0][0], 3);
+  }
+  else {
+    BLI_bvhtree_update_node(data->bvhtree, i, &co[0][0], NULL, 3);
+  }
+}
+
 void bvhtree_update_from_mvert(BVHTree *bvhtree,
                                const MVert *mvert,
                                const MVert *mvert_moving,
@@ -143,44 +179,25 @@ void bvhtree_update_from_mvert(BVHTree *bvhtree,
                                int tri_num,
                                bool moving)
 {
-  const MVertTri *vt;
-  int i;
-
   if ((bvhtree == NULL) || (mvert == NULL)) {
     return;
   }
 
-  if (mvert_moving == NULL) {
-    moving = false;
-  }
+  /* The tree may be built from less triangles (check if tree is already full). */
+  tri_num = min_ii(tri_num, BLI_bvhtree_get_len(bvhtree));
 
-  for (i = 0, vt = tri; i < tri_num; i++, vt++) {
-    float co[3][3];
-    bool ret;
-
-    copy_v3_v3(co[0], mvert[vt->tri[0]].co);
-    copy_v3_v3(co[1], mvert[vt->tri[1]].co);
-    copy_v3_v3(co[2], mvert[vt->tri[2]].co);
-
-    /* copy new locations into array */
-    if (moving) {
-      float co_moving[3][3];
-      /* update moving positions */
-      copy_v3_v3(co_moving[0], mvert_moving[vt->tri[0]].co);
-      copy_v3_v3(co_moving[1], mvert_moving[vt->tri[1]].co);
-      copy_v3_v3(co_moving[2], mvert_moving[vt->tri[2]].co);
-
-      ret = BLI_bvhtree_update_node(bvhtree, i, &co[0][0], &co_moving[0][0], 3);
-    }
-    else {
-      ret = BLI_bvhtree_update_node(bvhtree, i, &co[0][0], NULL, 3);
-    }
+  BVHUpdateFromMVertData data = {
+      .bvhtree = bvhtree,
+      .mvert = mvert,
+      .mvert_moving = moving ? mvert_moving : NULL,
+      .tri = tri,
+  };
 
-    /* check if tree is already full */
-    if (ret == false) {
-      break;
-    }
-  }
+  /* Colliders are updated on every sub-step, refit them in parallel. */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+  BLI_task_parallel_range(0, tri_num, &data, bvhtree_update_from_mvert_task_cb, &settings);
 
   BLI_bvhtree_update_tree(bvhtree);
 }
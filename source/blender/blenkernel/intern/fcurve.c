@@ -38,6 +38,7 @@
 #include "BLI_easing.h"
 #include "BLI_threads.h"
 #include "BLI_string_utils.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "BLI_expr_pylike_eval.h"
 #include "BLI_alloca.h"
@@ -3193,6 +3194,41 @@ float evaluate_fcurve_only_curve(FCurve *fcu, float evaltime)
   return evaluate_fcurve_ex(fcu, evaltime, 0.0);
 }
 
+typedef struct FCurvesEvalData {
+  FCurve **fcurves;
+  float evaltime;
+  float *r_values;
+} FCurvesEvalData;
+
+static void evaluate_fcurves_cb(void *__restrict userdata,
+                                const int i,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const FCurvesEvalData *data = userdata;
+  data->r_values[i] = evaluate_fcurve_ex(data->fcurves[i], data->evaltime, 0.0);
+}
+
+/**
+ * Evaluate many F-Curves at the same frame, each like #evaluate_fcurve_only_curve.
+ *
+ * The curves don't depend on each other, so large sets of them (the channels of dense motion
+ * capture actions for example) are evaluated in parallel. Unlike #calculate_fcurve, curval isn't
+ * set, that's left to the caller.
+ */
+void evaluate_fcurves(FCurve **fcurves, int totfcurve, float evaltime, float *r_values)
+{
+  FCurvesEvalData data = {
+      .fcurves = fcurves,
+      .evaltime = evaltime,
+      .r_values = r_values,
+  };
+
+  /* Small sets are evaluated on this thread, see #BLI_task_parallel_range. */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  BLI_task_parallel_range(0, totfcurve, &data, evaluate_fcurves_cb, &settings);
+}
+
 float evaluate_fcurve_driver(PathResolvedRNA *anim_rna,
                              FCurve *fcu,
                              ChannelDriver *driver_orig,
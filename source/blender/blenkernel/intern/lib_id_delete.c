@@ -83,6 +83,7 @@
 #include "BKE_mesh.h"
 #include "BKE_material.h"
 #include "BKE_main.h"
+#include "BKE_main_namemap.h"
 #include "BKE_mask.h"
 #include "BKE_mball.h"
 #include "BKE_movieclip.h"
@@ -329,6 +330,7 @@ void BKE_id_free_ex(Main *bmain, void *idv, int flag, const bool use_flag_from_i
 
   if ((flag & LIB_ID_FREE_NO_MAIN) == 0) {
     ListBase *lb = which_libbase(bmain, type);
+    BKE_main_namemap_remove_name(bmain, id, id->name + 2);
     BLI_remlink(lb, id);
   }
 
@@ -428,6 +430,7 @@ static void id_delete(Main *bmain, const bool do_tagged_deletion)
           id_next = id->next;
           /* Note: in case we delete a library, we also delete all its datablocks! */
           if ((id->tag & tag) || (id->lib != NULL && (id->lib->id.tag & tag))) {
+            BKE_main_namemap_remove_name(bmain, id, id->name + 2);
             BLI_remlink(lb, id);
             BLI_addtail(&tagged_deleted_ids, id);
             /* Do not tag as no_main now, we want to unlink it first (lower-level ID management
@@ -38,6 +38,7 @@
 #include "BKE_lib_id.h"
 #include "BKE_lib_query.h"
 #include "BKE_main.h"
+#include "BKE_main_namemap.h"
 
 #include "IMB_imbuf.h"
 #include "IMB_imbuf_types.h"
@@ -62,6 +63,7 @@ void BKE_main_free(Main *mainvar)
                          LIB_ID_FREE_NO_USER_REFCOUNT | LIB_ID_FREE_NO_DEG_TAG);
 
   MEM_SAFE_FREE(mainvar->blen_thumb);
+  BKE_main_namemap_destroy(&mainvar->name_map);
 
   a = set_listbasepointers(mainvar, lbarray);
   while (a--) {
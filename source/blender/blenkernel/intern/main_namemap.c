@@ -0,0 +1,505 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_bitmap.h"
+#include "BLI_ghash.h"
+#include "BLI_listbase.h"
+#include "BLI_math_base.h"
+#include "BLI_math_bits.h"
+#include "BLI_mempool.h"
+#include "BLI_string.h"
+#include "BLI_string_utf8.h"
+#include "BLI_string_utils.h"
+#include "BLI_threads.h"
+
+#include "DNA_ID.h"
+
+#include "BKE_idcode.h"
+#include "BKE_main.h"
+#include "BKE_main_namemap.h" /* own include */
+
+/** \file
+ * \ingroup bke
+ *
+ * Utility functions for faster unique ID names.
+ */
+
+/** \name BKE_main_namemap API
+ *
+ * For each ID type, the names of all local data-blocks are stored along with the numbers used
+ * as suffix by each base name ("name.number"), so finding a free name doesn't depend on the
+ * amount of data-blocks using the same base name.
+ *
+ * A second set of names covers linked data-blocks as well, to find data-blocks by name
+ * (see #BKE_main_namemap_find_id).
+ *
+ * \note Type maps are built on demand from the Main lists,
+ * so only types getting new data-blocks or being searched ever pay for them.
+ * \{ */
+
+/* Note: this code assumes and ensures that the suffix number can never go beyond 1 billion. */
+#define MAX_NUMBER 1000000000
+/* We do not want to get "name.000", so minimal number is 1. */
+#define MIN_NUMBER 1
+/* The maximum value up to which we search for the actual smallest unused number. Beyond that
+ * value, we will only use the first biggest unused number, without trying to 'fill the gaps'
+ * in-between already used numbers... */
+#define MAX_NUMBERS_IN_USE 1024
+
+/** A name used by one or more data-blocks. */
+typedef struct UniqueName_Entry {
+  /** One of the data-blocks using the name, NULL when not known anymore. */
+  struct ID *id;
+  /** Number of data-blocks using the name (more than one for invalid duplicates, or data-blocks
+   * from different libraries). */
+  int users;
+  /** The key in #UniqueName_TypeMap.names or #UniqueName_TypeMap.ids. */
+  char name[MAX_ID_NAME - 2];
+} UniqueName_Entry;
+
+/** The suffix numbers used along with a base name. */
+typedef struct UniqueName_Value {
+  /** Numbers below #MAX_NUMBERS_IN_USE which are used, 0 being the base name itself. */
+  BLI_bitmap mask[MAX_NUMBERS_IN_USE >> 5];
+  /** Largest number ever used, not decreased when data-blocks are removed. */
+  int max_number;
+  /** The key in #UniqueName_TypeMap.base_names. */
+  char base_name[MAX_ID_NAME - 2];
+} UniqueName_Value;
+
+struct UniqueName_TypeMap {
+  /** Full names of local data-blocks, #UniqueName_Entry values. */
+  GHash *names;
+  /** Base names of local data-blocks, #UniqueName_Value values. */
+  GHash *base_names;
+  /** Full names of all data-blocks, local and linked ones, #UniqueName_Entry values. */
+  GHash *ids;
+};
+
+/**
+ * Opaque structure, external API users only see this.
+ */
+struct UniqueName_Map {
+  struct UniqueName_TypeMap type_maps[INDEX_ID_MAX];
+  BLI_mempool *entries;
+  BLI_mempool *values;
+};
+
+void BKE_main_namemap_destroy(struct UniqueName_Map **r_name_map)
+{
+  struct UniqueName_Map *name_map = *r_name_map;
+  if (name_map == NULL) {
+    return;
+  }
+
+  struct UniqueName_TypeMap *type_map = name_map->type_maps;
+  for (int i = 0; i < INDEX_ID_MAX; i++, type_map++) {
+    if (type_map->names) {
+      BLI_ghash_free(type_map->names, NULL, NULL);
+      BLI_ghash_free(type_map->base_names, NULL, NULL);
+    }
+    if (type_map->ids) {
+      BLI_ghash_free(type_map->ids, NULL, NULL);
+    }
+  }
+  BLI_mempool_destroy(name_map->entries);
+  BLI_mempool_destroy(name_map->values);
+
+  MEM_freeN(name_map);
+  *r_name_map = NULL;
+}
+
+/**
+ * Free the name map of \a bmain, it is built again from the Main lists on next use.
+ * Needed whenever data-blocks are added, renamed or removed without going through the
+ * regular ID management functions.
+ */
+void BKE_main_namemap_clear(Main *bmain)
+{
+  BKE_main_namemap_destroy(&bmain->name_map);
+}
+
+static struct UniqueName_Map *namemap_ensure(Main *bmain)
+{
+  if (bmain->name_map == NULL) {
+    bmain->name_map = MEM_callocN(sizeof(*bmain->name_map), __func__);
+    bmain->name_map->entries = BLI_mempool_create(
+        sizeof(UniqueName_Entry), 0, 512, BLI_MEMPOOL_NOP);
+    bmain->name_map->values = BLI_mempool_create(
+        sizeof(UniqueName_Value), 0, 64, BLI_MEMPOOL_NOP);
+  }
+  return bmain->name_map;
+}
+
+static void namemap_entry_add(struct UniqueName_Map *name_map,
+                              GHash *names,
+                              ID *id,
+                              const char *name)
+{
+  UniqueName_Entry *entry = BLI_ghash_lookup(names, name);
+  if (entry == NULL) {
+    entry = BLI_mempool_alloc(name_map->entries);
+    entry->id = NULL;
+    entry->users = 0;
+    BLI_strncpy(entry->name, name, sizeof(entry->name));
+    BLI_ghash_insert(names, entry->name, entry);
+  }
+  entry->users++;
+  if (entry->id == NULL) {
+    entry->id = id;
+  }
+}
+
+/* Return true when the last user of the name was removed. */
+static bool namemap_entry_remove(struct UniqueName_Map *name_map,
+                                 GHash *names,
+                                 ID *id,
+                                 const char *name)
+{
+  UniqueName_Entry *entry = BLI_ghash_lookup(names, name);
+  if (entry == NULL) {
+    BLI_assert(!"ID name not registered");
+    return false;
+  }
+
+  if (entry->id == id) {
+    entry->id = NULL;
+  }
+  if (--entry->users > 0) {
+    return false;
+  }
+
+  BLI_ghash_remove(names, entry->name, NULL, NULL);
+  BLI_mempool_free(name_map->entries, entry);
+  return true;
+}
+
+static void namemap_add(struct UniqueName_Map *name_map,
+                        struct UniqueName_TypeMap *type_map,
+                        ID *id,
+                        const char *name)
+{
+  namemap_entry_add(name_map, type_map->names, id, name);
+
+  char base_name[MAX_ID_NAME - 2];
+  int number;
+  BLI_split_name_num(base_name, &number, name, '.');
+
+  UniqueName_Value *value = BLI_ghash_lookup(type_map->base_names, base_name);
+  if (value == NULL) {
+    value = BLI_mempool_calloc(name_map->values);
+    BLI_strncpy(value->base_name, base_name, sizeof(value->base_name));
+    BLI_ghash_insert(type_map->base_names, value->base_name, value);
+  }
+  if (number < MAX_NUMBERS_IN_USE) {
+    BLI_BITMAP_ENABLE(value->mask, number);
+  }
+  value->max_number = max_ii(value->max_number, min_ii(number, MAX_NUMBER));
+}
+
+/**
+ * \param id_exclude: The data-block the name is generated for, it's in the list already but
+ * its name is not registered yet.
+ */
+static struct UniqueName_TypeMap *namemap_type_ensure(Main *bmain, ID *id_exclude)
+{
+  const short id_type = GS(id_exclude->name);
+  struct UniqueName_Map *name_map = namemap_ensure(bmain);
+  struct UniqueName_TypeMap *type_map = &name_map->type_maps[BKE_idcode_to_index(id_type)];
+
+  /* lazy init */
+  if (type_map->names == NULL) {
+    ListBase *lb = which_libbase(bmain, id_type);
+    type_map->names = BLI_ghash_str_new(__func__);
+    type_map->base_names = BLI_ghash_str_new(__func__);
+
+    for (ID *id = lb->first; id; id = id->next) {
+      if (id != id_exclude && !ID_IS_LINKED(id)) {
+        namemap_add(name_map, type_map, id, id->name + 2);
+      }
+    }
+  }
+
+  return type_map;
+}
+
+/**
+ * Helper building final ID name from given base_name and number.
+ *
+ * If everything goes well and we do generate a valid final ID name in given name, we return true.
+ * In case the final name would overflow the allowed ID name length, or given number is bigger than
+ * maximum allowed value, we truncate further the base_name (and given name, which is assumed to
+ * have the same 'base_name' part), and return false.
+ */
+static bool id_name_final_build(char *name, char *base_name, size_t base_name_len, int number)
+{
+  char number_str[11]; /* Dot + nine digits + NULL terminator. */
+  size_t number_str_len = BLI_snprintf_rlen(number_str, ARRAY_SIZE(number_str), ".%.3d", number);
+
+  /* If the number would lead to an overflow of the maximum ID name length, we need to truncate
+   * the base name part and do all the number checks again. */
+  if (base_name_len + number_str_len >= MAX_ID_NAME - 2 || number >= MAX_NUMBER) {
+    if (base_name_len + number_str_len >= MAX_ID_NAME - 2) {
+      base_name_len = MAX_ID_NAME - 2 - number_str_len - 1;
+    }
+    else {
+      base_name_len--;
+    }
+    base_name[base_name_len] = '\0';
+
+    /* Code above may have generated invalid utf-8 string, due to raw truncation.
+     * Ensure we get a valid one now. */
+    base_name_len -= (size_t)BLI_utf8_invalid_strip(base_name, base_name_len);
+
+    /* Also truncate orig name, and start the whole check again. */
+    name[base_name_len] = '\0';
+    return false;
+  }
+
+  /* We have our final number, we can put it in name and exit the function. */
+  BLI_strncpy(name + base_name_len, number_str, number_str_len + 1);
+  return true;
+}
+
+/* Smallest number within [MIN_NUMBER .. MAX_NUMBERS_IN_USE - 1] not in the mask, or 0. */
+static int namemap_number_unused(const UniqueName_Value *value)
+{
+  for (int i = 0; i < (int)ARRAY_SIZE(value->mask); i++) {
+    BLI_bitmap unused = ~value->mask[i];
+    if (i == 0) {
+      unused &= ~((1u << MIN_NUMBER) - 1);
+    }
+    if (unused != 0) {
+      return (i << 5) + (int)bitscan_forward_uint(unused);
+    }
+  }
+  return 0;
+}
+
+/**
+ * Check to see if an ID name is already used by another local data-block of the same type, and
+ * find a new one if so. The final name is registered as used by \a id.
+ * Return true if a new name was created (returned in name).
+ *
+ * \note The previous name of \a id must not be registered anymore,
+ * see #BKE_main_namemap_remove_name.
+ *
+ * \param r_id_sorting_hint: The data-block using the name preceding the new one (if any),
+ * see #id_sort_by_name.
+ */
+bool BKE_main_namemap_get_name(Main *bmain, ID *id, char *name, ID **r_id_sorting_hint)
+{
+  BLI_assert(strlen(name) < MAX_ID_NAME - 2);
+  BLI_assert(!ID_IS_LINKED(id));
+
+  struct UniqueName_TypeMap *type_map = namemap_type_ensure(bmain, id);
+  bool is_name_changed = false;
+
+  *r_id_sorting_hint = NULL;
+
+  while (true) {
+    /* If there is no double, we are done.
+     * Note however that name might have been changed (truncated) in a previous iteration already.
+     */
+    if (!BLI_ghash_haskey(type_map->names, name)) {
+      break;
+    }
+
+    /* Get the name and number parts ("name.number"). */
+    char base_name[MAX_ID_NAME - 2];
+    int number = MIN_NUMBER;
+    size_t base_name_len = BLI_split_name_num(base_name, &number, name, '.');
+
+    /* In case we get an insane initial number suffix in given name. */
+    /* Note: BLI_split_name_num() cannot return negative numbers, so we do not have to check for
+     * that here. */
+    if (number >= MAX_NUMBER || number < MIN_NUMBER) {
+      number = MIN_NUMBER;
+    }
+
+    UniqueName_Value *value = BLI_ghash_lookup(type_map->base_names, base_name);
+    BLI_assert(value != NULL);
+
+    /* Decide which value of number to use, either the smallest unused one if possible, or default
+     * to the first largest unused one. */
+    const int number_unused = namemap_number_unused(value);
+    if (number_unused != 0) {
+      number = number_unused;
+    }
+    else if (number <= value->max_number) {
+      number = value->max_number + 1;
+    }
+
+    /* We know for sure that name will be changed. */
+    is_name_changed = true;
+
+    /* If id_name_final_build helper returns false, it had to truncate further given name, hence we
+     * have to go over the whole check again. */
+    if (!id_name_final_build(name, base_name, base_name_len, number)) {
+      continue;
+    }
+
+    /* The mask doesn't know about different names using the same number ("name.1" and
+     * "name.001"), when one of them was removed. Mark the number as used and check again. */
+    if (BLI_ghash_haskey(type_map->names, name)) {
+      if (number < MAX_NUMBERS_IN_USE) {
+        BLI_BITMAP_ENABLE(value->mask, number);
+      }
+      value->max_number = max_ii(value->max_number, number);
+      continue;
+    }
+
+    /* The data-block using the previous number is where the new one is sorted. */
+    char name_prev[MAX_ID_NAME - 2];
+    if (number - 1 > 0) {
+      BLI_snprintf(name_prev, sizeof(name_prev), "%s.%.3d", base_name, number - 1);
+    }
+    else {
+      BLI_strncpy(name_prev, base_name, sizeof(name_prev));
+    }
+    UniqueName_Entry *entry_prev = BLI_ghash_lookup(type_map->names, name_prev);
+    if (entry_prev != NULL) {
+      *r_id_sorting_hint = entry_prev->id;
+    }
+    break;
+  }
+
+  namemap_add(bmain->name_map, type_map, id, name);
+  if (type_map->ids) {
+    namemap_entry_add(bmain->name_map, type_map->ids, id, name);
+  }
+  return is_name_changed;
+}
+
+/**
+ * Register \a name as used by \a id, without checking whether it's unique.
+ * For code setting an ID name directly, before calling #BLI_libblock_ensure_unique_name,
+ * or adding data-blocks to the Main lists directly.
+ */
+void BKE_main_namemap_add_name(Main *bmain, ID *id, const char *name)
+{
+  if (bmain->name_map == NULL) {
+    return;
+  }
+  struct UniqueName_Map *name_map = bmain->name_map;
+  struct UniqueName_TypeMap *type_map = &name_map->type_maps[BKE_idcode_to_index(GS(id->name))];
+
+  if (type_map->ids) {
+    namemap_entry_add(name_map, type_map->ids, id, name);
+  }
+  if (type_map->names && !ID_IS_LINKED(id)) {
+    namemap_add(name_map, type_map, id, name);
+  }
+}
+
+/**
+ * Remove \a name of \a id from the used names, before \a id gets renamed or removed from the
+ * Main database.
+ */
+void BKE_main_namemap_remove_name(Main *bmain, ID *id, const char *name)
+{
+  if (bmain->name_map == NULL) {
+    return;
+  }
+  struct UniqueName_Map *name_map = bmain->name_map;
+  struct UniqueName_TypeMap *type_map = &name_map->type_maps[BKE_idcode_to_index(GS(id->name))];
+
+  if (type_map->ids) {
+    namemap_entry_remove(name_map, type_map->ids, id, name);
+  }
+  if (type_map->names == NULL || ID_IS_LINKED(id)) {
+    return;
+  }
+  if (!namemap_entry_remove(name_map, type_map->names, id, name)) {
+    return;
+  }
+
+  char base_name[MAX_ID_NAME - 2];
+  int number;
+  BLI_split_name_num(base_name, &number, name, '.');
+  if (number < MAX_NUMBERS_IN_USE) {
+    UniqueName_Value *value = BLI_ghash_lookup(type_map->base_names, base_name);
+    BLI_assert(value != NULL);
+    BLI_BITMAP_DISABLE(value->mask, number);
+  }
+}
+
+/* Lookups may run on several threads at once (drivers, depsgraph evaluation), while the map
+ * of all names is built on demand. Changing the Main database during lookups is not supported,
+ * as for the Main lists themselves. */
+static ThreadRWMutex namemap_ids_rwlock = BLI_RWLOCK_INITIALIZER;
+
+/**
+ * Find the data-block of type \a id_type named \a name, local or linked, like a search of the
+ * Main list for the first data-block with that name would.
+ */
+ID *BKE_main_namemap_find_id(Main *bmain, const short id_type, const char *name)
+{
+  const int type_index = BKE_idcode_to_index(id_type);
+  UniqueName_Entry *entry = NULL;
+
+  BLI_rw_mutex_lock(&namemap_ids_rwlock, THREAD_LOCK_READ);
+  if (bmain->name_map != NULL && bmain->name_map->type_maps[type_index].ids != NULL) {
+    entry = BLI_ghash_lookup(bmain->name_map->type_maps[type_index].ids, name);
+    if (entry == NULL || (entry->users == 1 && entry->id != NULL)) {
+      ID *id = entry ? entry->id : NULL;
+      BLI_rw_mutex_unlock(&namemap_ids_rwlock);
+      return id;
+    }
+  }
+  BLI_rw_mutex_unlock(&namemap_ids_rwlock);
+
+  BLI_rw_mutex_lock(&namemap_ids_rwlock, THREAD_LOCK_WRITE);
+  struct UniqueName_Map *name_map = namemap_ensure(bmain);
+  struct UniqueName_TypeMap *type_map = &name_map->type_maps[type_index];
+  ListBase *lb = which_libbase(bmain, id_type);
+
+  /* lazy init */
+  if (type_map->ids == NULL) {
+    type_map->ids = BLI_ghash_str_new(__func__);
+    for (ID *id = lb->first; id; id = id->next) {
+      namemap_entry_add(name_map, type_map->ids, id, id->name + 2);
+    }
+  }
+
+  ID *id = NULL;
+  entry = BLI_ghash_lookup(type_map->ids, name);
+  if (entry != NULL) {
+    if (entry->users == 1 && entry->id != NULL) {
+      id = entry->id;
+    }
+    else {
+      /* The name is used by data-blocks from several libraries, or the data-block using it is
+       * not known anymore, the first one in the list is the expected result. */
+      id = BLI_findstring(lb, name, offsetof(ID, name) + 2);
+      BLI_assert(id != NULL);
+      if (entry->users == 1) {
+        entry->id = id;
+      }
+    }
+  }
+  BLI_rw_mutex_unlock(&namemap_ids_rwlock);
+  return id;
+}
+
+/** \} */
@@ -78,6 +78,41 @@ static bool mesh_remap_bvhtree_query_nearest(BVHTreeFromMesh *treedata,
   }
 }
 
+/**
+ * Batched version of #mesh_remap_bvhtree_query_nearest for all destination vertices,
+ * stores their coordinates (in tree space) in \a r_cos_dst and the results in \a r_nearests.
+ */
+static void mesh_remap_bvhtree_query_nearest_verts(BVHTreeFromMesh *treedata,
+                                                   const SpaceTransform *space_transform,
+                                                   const MVert *verts_dst,
+                                                   const int numverts_dst,
+                                                   const float max_dist_sq,
+                                                   float (*r_cos_dst)[3],
+                                                   BVHTreeNearest *r_nearests)
+{
+  int i;
+
+  for (i = 0; i < numverts_dst; i++) {
+    copy_v3_v3(r_cos_dst[i], verts_dst[i].co);
+
+    /* Convert the vertex to tree coordinates, if needed. */
+    if (space_transform) {
+      BLI_space_transform_apply(space_transform, r_cos_dst[i]);
+    }
+
+    r_nearests[i].index = -1;
+    r_nearests[i].dist_sq = max_dist_sq;
+  }
+
+  BLI_bvhtree_find_nearest_batch(treedata->tree,
+                                 (const float(*)[3])r_cos_dst,
+                                 numverts_dst,
+                                 r_nearests,
+                                 treedata->nearest_callback,
+                                 treedata,
+                                 0);
+}
+
 static bool mesh_remap_bvhtree_query_raycast(BVHTreeFromMesh *treedata,
                                              BVHTreeRayHit *rayhit,
                                              const float co[3],
@@ -112,6 +147,75 @@ static bool mesh_remap_bvhtree_query_raycast(BVHTreeFromMesh *treedata,
   }
 }
 
+/**
+ * Batched version of #mesh_remap_bvhtree_query_raycast along the normals of all destination
+ * vertices, the results are stored in \a r_rayhits, hits further than \a max_dist are invalid.
+ */
+static void mesh_remap_bvhtree_query_raycast_verts(BVHTreeFromMesh *treedata,
+                                                   const SpaceTransform *space_transform,
+                                                   const MVert *verts_dst,
+                                                   const int numverts_dst,
+                                                   const float radius,
+                                                   const float max_dist,
+                                                   BVHTreeRayHit *r_rayhits)
+{
+  float(*cos_dst)[3] = MEM_mallocN(sizeof(*cos_dst) * (size_t)numverts_dst, __func__);
+  float(*nos_dst)[3] = MEM_mallocN(sizeof(*nos_dst) * (size_t)numverts_dst, __func__);
+  BVHTreeRayHit *rayhits_inv = MEM_mallocN(sizeof(*rayhits_inv) * (size_t)numverts_dst,
+                                           __func__);
+  int i;
+
+  for (i = 0; i < numverts_dst; i++) {
+    copy_v3_v3(cos_dst[i], verts_dst[i].co);
+    normal_short_to_float_v3(nos_dst[i], verts_dst[i].no);
+
+    /* Convert the vertex to tree coordinates, if needed. */
+    if (space_transform) {
+      BLI_space_transform_apply(space_transform, cos_dst[i]);
+      BLI_space_transform_apply_normal(space_transform, nos_dst[i]);
+    }
+
+    r_rayhits[i].index = -1;
+    r_rayhits[i].dist = max_dist;
+  }
+
+  BLI_bvhtree_ray_cast_batch(treedata->tree,
+                             (const float(*)[3])cos_dst,
+                             (const float(*)[3])nos_dst,
+                             numverts_dst,
+                             radius,
+                             r_rayhits,
+                             treedata->raycast_callback,
+                             treedata,
+                             BVH_RAYCAST_DEFAULT);
+
+  /* Also cast in the other direction, no further than the first hit! */
+  for (i = 0; i < numverts_dst; i++) {
+    negate_v3(nos_dst[i]);
+    rayhits_inv[i] = r_rayhits[i];
+  }
+
+  BLI_bvhtree_ray_cast_batch(treedata->tree,
+                             (const float(*)[3])cos_dst,
+                             (const float(*)[3])nos_dst,
+                             numverts_dst,
+                             radius,
+                             rayhits_inv,
+                             treedata->raycast_callback,
+                             treedata,
+                             BVH_RAYCAST_DEFAULT);
+
+  for (i = 0; i < numverts_dst; i++) {
+    if (rayhits_inv[i].dist < r_rayhits[i].dist) {
+      r_rayhits[i] = rayhits_inv[i];
+    }
+  }
+
+  MEM_freeN(cos_dst);
+  MEM_freeN(nos_dst);
+  MEM_freeN(rayhits_inv);
+}
+
 /** \} */
 
 /**
@@ -520,56 +624,55 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
   else {
     BVHTreeFromMesh treedata = {NULL};
     BVHTreeNearest nearest = {0};
-    BVHTreeRayHit rayhit = {0};
     float hit_dist;
-    float tmp_co[3], tmp_no[3];
+    float tmp_co[3];
 
     if (mode == MREMAP_MODE_VERT_NEAREST) {
+      BVHTreeNearest *nearests = MEM_mallocN(sizeof(*nearests) * (size_t)numverts_dst, __func__);
+      float(*cos_dst)[3] = MEM_mallocN(sizeof(*cos_dst) * (size_t)numverts_dst, __func__);
+
       BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_VERTS, 2);
-      nearest.index = -1;
+      mesh_remap_bvhtree_query_nearest_verts(
+          &treedata, space_transform, verts_dst, numverts_dst, max_dist_sq, cos_dst, nearests);
 
       for (i = 0; i < numverts_dst; i++) {
-        copy_v3_v3(tmp_co, verts_dst[i].co);
-
-        /* Convert the vertex to tree coordinates, if needed. */
-        if (space_transform) {
-          BLI_space_transform_apply(space_transform, tmp_co);
-        }
-
-        if (mesh_remap_bvhtree_query_nearest(
-                &treedata, &nearest, tmp_co, max_dist_sq, &hit_dist)) {
-          mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &nearest.index, &full_weight);
+        if ((nearests[i].index != -1) && (nearests[i].dist_sq <= max_dist_sq)) {
+          hit_dist = sqrtf(nearests[i].dist_sq);
+          mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &nearests[i].index, &full_weight);
         }
         else {
           /* No source for this dest vertex! */
           BKE_mesh_remap_item_define_invalid(r_map, i);
         }
       }
+
+      MEM_freeN(cos_dst);
+      MEM_freeN(nearests);
     }
     else if (ELEM(mode, MREMAP_MODE_VERT_EDGE_NEAREST, MREMAP_MODE_VERT_EDGEINTERP_NEAREST)) {
       MEdge *edges_src = me_src->medge;
       float(*vcos_src)[3] = BKE_mesh_vert_coords_alloc(me_src, NULL);
 
+      BVHTreeNearest *nearests = MEM_mallocN(sizeof(*nearests) * (size_t)numverts_dst, __func__);
+      float(*cos_dst)[3] = MEM_mallocN(sizeof(*cos_dst) * (size_t)numverts_dst, __func__);
+
       BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_EDGES, 2);
-      nearest.index = -1;
+      mesh_remap_bvhtree_query_nearest_verts(
+          &treedata, space_transform, verts_dst, numverts_dst, max_dist_sq, cos_dst, nearests);
 
       for (i = 0; i < numverts_dst; i++) {
-        copy_v3_v3(tmp_co, verts_dst[i].co);
+        const float *co_dst = cos_dst[i];
 
-        /* Convert the vertex to tree coordinates, if needed. */
-        if (space_transform) {
-          BLI_space_transform_apply(space_transform, tmp_co);
-        }
-
-        if (mesh_remap_bvhtree_query_nearest(
-                &treedata, &nearest, tmp_co, max_dist_sq, &hit_dist)) {
-          MEdge *me = &edges_src[nearest.index];
+        if ((nearests[i].index != -1) && (nearests[i].dist_sq <= max_dist_sq)) {
+          MEdge *me = &edges_src[nearests[i].index];
           const float *v1cos = vcos_src[me->v1];
           const float *v2cos = vcos_src[me->v2];
 
+          hit_dist = sqrtf(nearests[i].dist_sq);
+
           if (mode == MREMAP_MODE_VERT_EDGE_NEAREST) {
-            const float dist_v1 = len_squared_v3v3(tmp_co, v1cos);
-            const float dist_v2 = len_squared_v3v3(tmp_co, v2cos);
+            const float dist_v1 = len_squared_v3v3(co_dst, v1cos);
+            const float dist_v2 = len_squared_v3v3(co_dst, v2cos);
             const int index = (int)((dist_v1 > dist_v2) ? me->v2 : me->v1);
             mesh_remap_item_define(r_map, i, hit_dist, 0, 1, &index, &full_weight);
           }
@@ -581,7 +684,7 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
             indices[1] = (int)me->v2;
 
             /* Weight is inverse of point factor here... */
-            weights[0] = line_point_factor_v3(tmp_co, v2cos, v1cos);
+            weights[0] = line_point_factor_v3(co_dst, v2cos, v1cos);
             CLAMP(weights[0], 0.0f, 1.0f);
             weights[1] = 1.0f - weights[0];
 
@@ -594,6 +697,8 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
         }
       }
 
+      MEM_freeN(cos_dst);
+      MEM_freeN(nearests);
       MEM_freeN(vcos_src);
     }
     else if (ELEM(mode,
@@ -612,24 +717,19 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
       BKE_bvhtree_from_mesh_get(&treedata, me_src, BVHTREE_FROM_LOOPTRI, 2);
 
       if (mode == MREMAP_MODE_VERT_POLYINTERP_VNORPROJ) {
-        for (i = 0; i < numverts_dst; i++) {
-          copy_v3_v3(tmp_co, verts_dst[i].co);
-          normal_short_to_float_v3(tmp_no, verts_dst[i].no);
+        BVHTreeRayHit *rayhits = MEM_mallocN(sizeof(*rayhits) * (size_t)numverts_dst, __func__);
 
-          /* Convert the vertex to tree coordinates, if needed. */
-          if (space_transform) {
-            BLI_space_transform_apply(space_transform, tmp_co);
-            BLI_space_transform_apply_normal(space_transform, tmp_no);
-          }
+        mesh_remap_bvhtree_query_raycast_verts(
+            &treedata, space_transform, verts_dst, numverts_dst, ray_radius, max_dist, rayhits);
 
-          if (mesh_remap_bvhtree_query_raycast(
-                  &treedata, &rayhit, tmp_co, tmp_no, ray_radius, max_dist, &hit_dist)) {
-            const MLoopTri *lt = &treedata.looptri[rayhit.index];
+        for (i = 0; i < numverts_dst; i++) {
+          if ((rayhits[i].index != -1) && (rayhits[i].dist <= max_dist)) {
+            const MLoopTri *lt = &treedata.looptri[rayhits[i].index];
             MPoly *mp_src = &polys_src[lt->poly];
             const int sources_num = mesh_remap_interp_poly_data_get(mp_src,
                                                                     loops_src,
                                                                     (const float(*)[3])vcos_src,
-                                                                    rayhit.co,
+                                                                    rayhits[i].co,
                                                                     &tmp_buff_size,
                                                                     &vcos,
                                                                     false,
@@ -638,13 +738,16 @@ void BKE_mesh_remap_calc_verts_from_mesh(const int mode,
                                                                     true,
                                                                     NULL);
 
-            mesh_remap_item_define(r_map, i, hit_dist, 0, sources_num, indices, weights);
+            mesh_remap_item_define(
+                r_map, i, rayhits[i].dist, 0, sources_num, indices, weights);
           }
           else {
             /* No source for this dest vertex! */
             BKE_mesh_remap_item_define_invalid(r_map, i);
           }
         }
+
+        MEM_freeN(rayhits);
       }
       else {
         nearest.index = -1;
@@ -24,6 +24,7 @@
 #include <limits.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "MEM_guardedalloc.h"
 
@@ -32,6 +33,7 @@
 
 #include "BLI_math.h"
 #include "BLI_rand.h"
+#include "BLI_task.h"
 
 #include "DNA_anim_types.h"
 #include "DNA_collection_types.h"
@@ -64,6 +66,15 @@
 
 /* Dupli-Geometry */
 
+/* Minimum number of instances per thread for the parallel generators. */
+#define DUPLI_PARALLEL_GRAINSIZE 1024
+
+/** Contiguous dupli storage, linked into the resulting ListBase once generation is done. */
+typedef struct DupliArray {
+  DupliObject *data;
+  int len, alloc_len;
+} DupliArray;
+
 typedef struct DupliContext {
   Depsgraph *depsgraph;
   /** XXX child objects are selected from this group if set, could be nicer. */
@@ -81,8 +92,8 @@ typedef struct DupliContext {
 
   const struct DupliGenerator *gen;
 
-  /** Result containers. */
-  ListBase *duplilist; /* legacy doubly-linked list */
+  /** Result container. */
+  DupliArray *duplis;
 } DupliContext;
 
 typedef struct DupliGenerator {
@@ -116,7 +127,7 @@ static void init_context(DupliContext *r_ctx,
 
   r_ctx->gen = get_dupli_generator(r_ctx);
 
-  r_ctx->duplilist = NULL;
+  r_ctx->duplis = NULL;
 }
 
 /* create sub-context for recursive duplis */
@@ -141,23 +152,60 @@ static void copy_dupli_context(
   r_ctx->gen = get_dupli_generator(r_ctx);
 }
 
-/* generate a dupli instance
- * mat is transform of the object relative to current context (including object obmat)
- */
-static DupliObject *make_dupli(const DupliContext *ctx, Object *ob, float mat[4][4], int index)
+/* Add len zero initialized duplis to the result container, the returned range stays valid
+ * until more duplis are added. NULL when the total would exceed the int range. */
+static DupliObject *dupli_array_add(const DupliContext *ctx, size_t len)
 {
-  DupliObject *dob;
-  int i;
+  DupliArray *duplis = ctx->duplis;
 
-  /* add a DupliObject instance to the result container */
-  if (ctx->duplilist) {
-    dob = MEM_callocN(sizeof(DupliObject), "dupli object");
-    BLI_addtail(ctx->duplilist, dob);
-  }
-  else {
+  if (len > (size_t)(INT_MAX - duplis->len)) {
     return NULL;
   }
 
+  const int new_len = duplis->len + (int)len;
+  if (new_len > duplis->alloc_len) {
+    duplis->alloc_len = (duplis->alloc_len > INT_MAX / 2) ?
+                            new_len :
+                            max_ii(new_len, max_ii(duplis->alloc_len * 2, 64));
+    duplis->data = MEM_recallocN_id(
+        duplis->data, sizeof(DupliObject) * (size_t)duplis->alloc_len, "dupli objects");
+  }
+
+  DupliObject *dob = duplis->data + duplis->len;
+  duplis->len = new_len;
+  return dob;
+}
+
+/* Remove duplis from start onwards which were skipped by a parallel generator
+ * (ob set to NULL), keeping the order of the others. */
+static void dupli_array_compact(const DupliContext *ctx, int start)
+{
+  DupliArray *duplis = ctx->duplis;
+  int len = start;
+
+  for (int i = start; i < duplis->len; i++) {
+    if (duplis->data[i].ob != NULL) {
+      if (i != len) {
+        duplis->data[len] = duplis->data[i];
+      }
+      len++;
+    }
+  }
+
+  if (len < duplis->len) {
+    memset(duplis->data + len, 0, sizeof(DupliObject) * (size_t)(duplis->len - len));
+    duplis->len = len;
+  }
+}
+
+/* Initialize a dupli instance, this only writes to dob so it can be called from threads.
+ * mat is transform of the object relative to current context (including object obmat)
+ */
+static void dupli_init(
+    const DupliContext *ctx, DupliObject *dob, Object *ob, float mat[4][4], int index)
+{
+  int i;
+
   dob->ob = ob;
   mul_m4_m4m4(dob->mat, (float(*)[4])ctx->space_mat, mat);
   dob->type = ctx->gen->type;
@@ -198,6 +246,28 @@ static DupliObject *make_dupli(const DupliContext *ctx, Object *ob, float mat[4]
   if (ctx->object != ob) {
     dob->random_id ^= BLI_hash_int(BLI_hash_string(ctx->object->id.name + 2));
   }
+}
+
+/* generate a dupli instance
+ * mat is transform of the object relative to current context (including object obmat)
+ */
+static DupliObject *make_dupli(const DupliContext *ctx, Object *ob, float mat[4][4], int index)
+{
+  DupliObject *dob;
+
+  /* add a DupliObject instance to the result container */
+  if (ctx->duplis) {
+    dob = dupli_array_add(ctx, 1);
+  }
+  else {
+    return NULL;
+  }
+
+  if (dob == NULL) {
+    return NULL;
+  }
+
+  dupli_init(ctx, dob, ob, mat, index);
 
   return dob;
 }
@@ -220,6 +290,31 @@ static void make_recursive_duplis(const DupliContext *ctx,
   }
 }
 
+/* Instances of ob generate duplis of their own, generators have to add these serially. */
+static bool dupli_has_recursion(const DupliContext *ctx, Object *ob)
+{
+  if (ctx->level < MAX_DUPLI_RECUR) {
+    DupliContext rctx;
+    copy_dupli_context(&rctx, ctx, ob, NULL, 0);
+    return rctx.gen != NULL;
+  }
+  return false;
+}
+
+/* Parallel generators fill a pre-sized range of the result container. */
+static bool dupli_use_parallel(const DupliContext *ctx, Object *ob, int len)
+{
+  return ctx->duplis && (len > DUPLI_PARALLEL_GRAINSIZE) && !dupli_has_recursion(ctx, ob);
+}
+
+static void dupli_parallel_range(int len, void *userdata, TaskParallelRangeFunc func)
+{
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = DUPLI_PARALLEL_GRAINSIZE;
+  BLI_task_parallel_range(0, len, userdata, func, &settings);
+}
+
 /* ---- Child Duplis ---- */
 
 typedef void (*MakeChildDuplisFunc)(const DupliContext *ctx, void *userdata, Object *child);
@@ -359,28 +454,41 @@ static void get_duplivert_transform(const float co[3],
   loc_quat_size_to_mat4(mat, co, quat, size);
 }
 
+static void vertex_dupli_transform(const VertexDupliData *vdd,
+                                   const float co[3],
+                                   const short no[3],
+                                   float r_obmat[4][4])
+{
+  Object *inst_ob = vdd->inst_ob;
+
+  /* obmat is transform to vertex */
+  get_duplivert_transform(
+      co, no, vdd->use_rotation, inst_ob->trackflag, inst_ob->upflag, r_obmat);
+  /* make offset relative to inst_ob using relative child transform */
+  mul_mat3_m4_v3((float(*)[4])vdd->child_imat, r_obmat[3]);
+  /* apply obmat _after_ the local vertex transform */
+  mul_m4_m4m4(r_obmat, inst_ob->obmat, r_obmat);
+}
+
 static void vertex_dupli(const VertexDupliData *vdd,
                          int index,
                          const float co[3],
                          const short no[3])
 {
-  Object *inst_ob = vdd->inst_ob;
   DupliObject *dob;
   float obmat[4][4], space_mat[4][4];
 
-  /* obmat is transform to vertex */
-  get_duplivert_transform(co, no, vdd->use_rotation, inst_ob->trackflag, inst_ob->upflag, obmat);
-  /* make offset relative to inst_ob using relative child transform */
-  mul_mat3_m4_v3((float(*)[4])vdd->child_imat, obmat[3]);
-  /* apply obmat _after_ the local vertex transform */
-  mul_m4_m4m4(obmat, inst_ob->obmat, obmat);
+  vertex_dupli_transform(vdd, co, no, obmat);
 
   /* space matrix is constructed by removing obmat transform,
    * this yields the worldspace transform for recursive duplis
    */
-  mul_m4_m4m4(space_mat, obmat, inst_ob->imat);
+  mul_m4_m4m4(space_mat, obmat, vdd->inst_ob->imat);
 
   dob = make_dupli(vdd->ctx, vdd->inst_ob, obmat, index);
+  if (dob == NULL) {
+    return;
+  }
 
   if (vdd->orco) {
     copy_v3_v3(dob->orco, vdd->orco[index]);
@@ -390,6 +498,29 @@ static void vertex_dupli(const VertexDupliData *vdd,
   make_recursive_duplis(vdd->ctx, vdd->inst_ob, space_mat, index);
 }
 
+typedef struct VertexDupliTaskData {
+  const VertexDupliData *vdd;
+  const MVert *mvert;
+  DupliObject *duplis;
+} VertexDupliTaskData;
+
+static void vertex_dupli_task_cb(void *__restrict userdata,
+                                 const int i,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const VertexDupliTaskData *data = userdata;
+  const VertexDupliData *vdd = data->vdd;
+  DupliObject *dob = &data->duplis[i];
+  float obmat[4][4];
+
+  vertex_dupli_transform(vdd, data->mvert[i].co, data->mvert[i].no, obmat);
+  dupli_init(vdd->ctx, dob, vdd->inst_ob, obmat, i);
+
+  if (vdd->orco) {
+    copy_v3_v3(dob->orco, vdd->orco[i]);
+  }
+}
+
 static void make_child_duplis_verts(const DupliContext *ctx, void *userdata, Object *child)
 {
   VertexDupliData *vdd = userdata;
@@ -401,8 +532,20 @@ static void make_child_duplis_verts(const DupliContext *ctx, void *userdata, Obj
   mul_m4_m4m4(vdd->child_imat, child->imat, ctx->object->obmat);
 
   const MVert *mvert = me_eval->mvert;
-  for (int i = 0; i < me_eval->totvert; i++) {
-    vertex_dupli(vdd, i, mvert[i].co, mvert[i].no);
+  if (dupli_use_parallel(vdd->ctx, child, me_eval->totvert)) {
+    VertexDupliTaskData data = {
+        .vdd = vdd,
+        .mvert = mvert,
+        .duplis = dupli_array_add(vdd->ctx, (size_t)me_eval->totvert),
+    };
+    if (data.duplis) {
+      dupli_parallel_range(me_eval->totvert, &data, vertex_dupli_task_cb);
+    }
+  }
+  else {
+    for (int i = 0; i < me_eval->totvert; i++) {
+      vertex_dupli(vdd, i, mvert[i].co, mvert[i].no);
+    }
   }
 }
 
@@ -616,14 +759,83 @@ static void get_dupliface_transform(
   loc_quat_size_to_mat4(mat, loc, quat, size);
 }
 
+static void face_dupli_transform(const DupliContext *ctx,
+                                 const FaceDupliData *fdd,
+                                 Object *inst_ob,
+                                 float child_imat[4][4],
+                                 MPoly *mp,
+                                 float r_obmat[4][4])
+{
+  MLoop *loopstart = fdd->mloop + mp->loopstart;
+
+  /* obmat is transform to face */
+  get_dupliface_transform(
+      mp, loopstart, fdd->mvert, fdd->use_scale, ctx->object->instance_faces_scale, r_obmat);
+  /* make offset relative to inst_ob using relative child transform */
+  mul_mat3_m4_v3(child_imat, r_obmat[3]);
+
+  /* XXX ugly hack to ensure same behavior as in master
+   * this should not be needed, parentinv is not consistent
+   * outside of parenting.
+   */
+  {
+    float imat[3][3];
+    copy_m3_m4(imat, inst_ob->parentinv);
+    mul_m4_m3m4(r_obmat, imat, r_obmat);
+  }
+
+  /* apply obmat _after_ the local face transform */
+  mul_m4_m4m4(r_obmat, inst_ob->obmat, r_obmat);
+}
+
+static void face_dupli_texcoords(const FaceDupliData *fdd, const MPoly *mp, DupliObject *dob)
+{
+  const MLoop *loopstart = fdd->mloop + mp->loopstart;
+  const float w = 1.0f / (float)mp->totloop;
+
+  if (fdd->orco) {
+    for (int j = 0; j < mp->totloop; j++) {
+      madd_v3_v3fl(dob->orco, fdd->orco[loopstart[j].v], w);
+    }
+  }
+  if (fdd->mloopuv) {
+    for (int j = 0; j < mp->totloop; j++) {
+      madd_v2_v2fl(dob->uv, fdd->mloopuv[mp->loopstart + j].uv, w);
+    }
+  }
+}
+
+typedef struct FaceDupliTaskData {
+  const DupliContext *ctx;
+  const FaceDupliData *fdd;
+  Object *inst_ob;
+  float (*child_imat)[4];
+  DupliObject *duplis;
+} FaceDupliTaskData;
+
+static void face_dupli_task_cb(void *__restrict userdata,
+                               const int a,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const FaceDupliTaskData *data = userdata;
+  MPoly *mp = &data->fdd->mpoly[a];
+  DupliObject *dob = &data->duplis[a];
+  float obmat[4][4];
+
+  /* left with a NULL object, removed afterwards */
+  if (UNLIKELY(mp->totloop < 3)) {
+    return;
+  }
+
+  face_dupli_transform(data->ctx, data->fdd, data->inst_ob, data->child_imat, mp, obmat);
+  dupli_init(data->ctx, dob, data->inst_ob, obmat, a);
+  face_dupli_texcoords(data->fdd, mp, dob);
+}
+
 static void make_child_duplis_faces(const DupliContext *ctx, void *userdata, Object *inst_ob)
 {
   FaceDupliData *fdd = userdata;
   MPoly *mpoly = fdd->mpoly, *mp;
-  MLoop *mloop = fdd->mloop;
-  MVert *mvert = fdd->mvert;
-  float(*orco)[3] = fdd->orco;
-  MLoopUV *mloopuv = fdd->mloopuv;
   int a, totface = fdd->totface;
   float child_imat[4][4];
   DupliObject *dob;
@@ -632,32 +844,30 @@ static void make_child_duplis_faces(const DupliContext *ctx, void *userdata, Obj
   /* relative transform from parent to child space */
   mul_m4_m4m4(child_imat, inst_ob->imat, ctx->object->obmat);
 
+  if (dupli_use_parallel(ctx, inst_ob, totface)) {
+    const int start = ctx->duplis->len;
+    FaceDupliTaskData data = {
+        .ctx = ctx,
+        .fdd = fdd,
+        .inst_ob = inst_ob,
+        .child_imat = child_imat,
+        .duplis = dupli_array_add(ctx, (size_t)totface),
+    };
+    if (data.duplis) {
+      dupli_parallel_range(totface, &data, face_dupli_task_cb);
+      dupli_array_compact(ctx, start);
+    }
+    return;
+  }
+
   for (a = 0, mp = mpoly; a < totface; a++, mp++) {
-    MLoop *loopstart = mloop + mp->loopstart;
     float space_mat[4][4], obmat[4][4];
 
     if (UNLIKELY(mp->totloop < 3)) {
       continue;
     }
 
-    /* obmat is transform to face */
-    get_dupliface_transform(
-        mp, loopstart, mvert, fdd->use_scale, ctx->object->instance_faces_scale, obmat);
-    /* make offset relative to inst_ob using relative child transform */
-    mul_mat3_m4_v3(child_imat, obmat[3]);
-
-    /* XXX ugly hack to ensure same behavior as in master
-     * this should not be needed, parentinv is not consistent
-     * outside of parenting.
-     */
-    {
-      float imat[3][3];
-      copy_m3_m4(imat, inst_ob->parentinv);
-      mul_m4_m3m4(obmat, imat, obmat);
-    }
-
-    /* apply obmat _after_ the local face transform */
-    mul_m4_m4m4(obmat, inst_ob->obmat, obmat);
+    face_dupli_transform(ctx, fdd, inst_ob, child_imat, mp, obmat);
 
     /* space matrix is constructed by removing obmat transform,
      * this yields the worldspace transform for recursive duplis
@@ -665,18 +875,10 @@ static void make_child_duplis_faces(const DupliContext *ctx, void *userdata, Obj
     mul_m4_m4m4(space_mat, obmat, inst_ob->imat);
 
     dob = make_dupli(ctx, inst_ob, obmat, a);
-
-    const float w = 1.0f / (float)mp->totloop;
-    if (orco) {
-      for (int j = 0; j < mp->totloop; j++) {
-        madd_v3_v3fl(dob->orco, orco[loopstart[j].v], w);
-      }
-    }
-    if (mloopuv) {
-      for (int j = 0; j < mp->totloop; j++) {
-        madd_v2_v2fl(dob->uv, mloopuv[mp->loopstart + j].uv, w);
-      }
+    if (dob == NULL) {
+      return;
     }
+    face_dupli_texcoords(fdd, mp, dob);
 
     /* recursion */
     make_recursive_duplis(ctx, inst_ob, space_mat, a);
@@ -730,6 +932,162 @@ static const DupliGenerator gen_dupli_faces = {
 };
 
 /* OB_DUPLIPARTS */
+typedef struct ParticleDupliData {
+  const DupliContext *ctx;
+  ParticleSimulationData *sim;
+  float ctime;
+  int hair;
+  bool use_whole_collection;
+  Object **oblist;
+  int totcollection;
+
+  /* particles to instance and their objects */
+  const int *pa_index;
+  Object *const *pa_ob;
+
+  DupliObject *duplis;
+  int duplis_per_particle;
+} ParticleDupliData;
+
+/* Fill the duplis of one particle, this only reads particle data so it can run in threads. */
+static void particle_dupli_task_cb(void *__restrict userdata,
+                                   const int i,
+                                   const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ParticleDupliData *pdd = userdata;
+  const DupliContext *ctx = pdd->ctx;
+  ParticleSimulationData *sim = pdd->sim;
+  ParticleSystem *psys = sim->psys;
+  ParticleSettings *part = psys->part;
+  DupliObject *dobs = pdd->duplis + (size_t)i * (size_t)pdd->duplis_per_particle;
+  const int totpart = psys->totpart;
+  const int a = pdd->pa_index[i];
+  Object *ob = pdd->pa_ob[i];
+  ParticleData *pa = NULL;
+  ChildParticle *cpa = NULL;
+  ParticleCacheKey *cache;
+  float scale = 1.0f, size;
+  float tmat[4][4], mat[4][4], pamat[4][4];
+
+  if (a < totpart) {
+    /* handle parent particle */
+    pa = psys->particles + a;
+    size = pa->size;
+  }
+  else {
+    /* handle child particle */
+    cpa = &psys->child[a - totpart];
+    size = psys_get_child_size(psys, cpa, pdd->ctime, NULL);
+  }
+
+  if (pdd->hair) {
+    /* hair we handle separate and compute transform based on hair keys */
+    if (a < totpart) {
+      cache = psys->pathcache[a];
+      psys_get_dupli_path_transform(sim, pa, NULL, cache, pamat, &scale);
+    }
+    else {
+      cache = psys->childcache[a - totpart];
+      psys_get_dupli_path_transform(sim, NULL, cpa, cache, pamat, &scale);
+    }
+
+    copy_v3_v3(pamat[3], cache->co);
+    pamat[3][3] = 1.0f;
+  }
+  else {
+    /* first key */
+    ParticleKey state;
+    state.time = pdd->ctime;
+    if (psys_get_particle_state(sim, a, &state, 0) == 0) {
+      /* left with a NULL object, removed afterwards */
+      return;
+    }
+    else {
+      float tquat[4];
+      normalize_qt_qt(tquat, state.rot);
+      quat_to_mat4(pamat, tquat);
+      copy_v3_v3(pamat[3], state.co);
+      pamat[3][3] = 1.0f;
+    }
+  }
+
+  if (pdd->use_whole_collection) {
+    /* oblist holds the visible collection objects in iteration order */
+    for (int b = 0; b < pdd->totcollection; b++) {
+      Object *object = pdd->oblist[b];
+      copy_m4_m4(tmat, object->obmat);
+
+      /* apply particle scale */
+      mul_mat3_m4_fl(tmat, size * scale);
+      mul_v3_fl(tmat[3], size * scale);
+
+      /* collection dupli offset, should apply after everything else */
+      if (!is_zero_v3(part->instance_collection->instance_offset)) {
+        sub_v3_v3(tmat[3], part->instance_collection->instance_offset);
+      }
+
+      /* individual particle transform */
+      mul_m4_m4m4(mat, pamat, tmat);
+
+      dupli_init(ctx, &dobs[b], object, mat, a);
+      dobs[b].particle_system = psys;
+
+      psys_get_dupli_texture(psys, part, sim->psmd, pa, cpa, dobs[b].uv, dobs[b].orco);
+    }
+  }
+  else {
+    float obmat[4][4];
+    copy_m4_m4(obmat, ob->obmat);
+
+    float vec[3];
+    copy_v3_v3(vec, obmat[3]);
+    zero_v3(obmat[3]);
+
+    /* Particle rotation uses x-axis as the aligned axis,
+     * so pre-rotate the object accordingly. */
+    if ((part->draw & PART_DRAW_ROTATE_OB) == 0) {
+      float xvec[3], q[4], size_mat[4][4], original_size[3];
+
+      mat4_to_size(original_size, obmat);
+      size_to_mat4(size_mat, original_size);
+
+      xvec[0] = -1.f;
+      xvec[1] = xvec[2] = 0;
+      vec_to_quat(q, xvec, ob->trackflag, ob->upflag);
+      quat_to_mat4(obmat, q);
+      obmat[3][3] = 1.0f;
+
+      /* add scaling if requested */
+      if ((part->draw & PART_DRAW_NO_SCALE_OB) == 0) {
+        mul_m4_m4m4(obmat, obmat, size_mat);
+      }
+    }
+    else if (part->draw & PART_DRAW_NO_SCALE_OB) {
+      /* remove scaling */
+      float size_mat[4][4], original_size[3];
+
+      mat4_to_size(original_size, obmat);
+      size_to_mat4(size_mat, original_size);
+      invert_m4(size_mat);
+
+      mul_m4_m4m4(obmat, obmat, size_mat);
+    }
+
+    mul_m4_m4m4(tmat, pamat, obmat);
+    mul_mat3_m4_fl(tmat, size * scale);
+
+    copy_m4_m4(mat, tmat);
+
+    if (part->draw & PART_DRAW_GLOBAL_OB) {
+      add_v3_v3v3(mat[3], mat[3], vec);
+    }
+
+    dupli_init(ctx, dobs, ob, mat, a);
+    dobs->particle_system = psys;
+    psys_get_dupli_texture(psys, part, sim->psmd, pa, cpa, dobs->uv, dobs->orco);
+  }
+}
+
 static void make_duplis_particle_system(const DupliContext *ctx, ParticleSystem *psys)
 {
   Scene *scene = ctx->scene;
@@ -738,17 +1096,13 @@ static void make_duplis_particle_system(const DupliContext *ctx, ParticleSystem
   bool for_render = mode == DAG_EVAL_RENDER;
 
   Object *ob = NULL, **oblist = NULL;
-  DupliObject *dob;
   ParticleDupliWeight *dw;
   ParticleSettings *part;
-  ParticleData *pa;
-  ChildParticle *cpa = NULL;
-  ParticleKey state;
-  ParticleCacheKey *cache;
-  float ctime, scale = 1.0f;
-  float tmat[4][4], mat[4][4], pamat[4][4], size = 0.0;
+  float ctime;
   int a, b, hair = 0;
-  int totpart, totchild;
+  int totpart, totchild, a_start;
+  int *pa_index, pa_len = 0;
+  Object **pa_ob;
 
   int no_draw_flag = PARS_UNEXIST;
 
@@ -888,28 +1242,23 @@ static void make_duplis_particle_system(const DupliContext *ctx, ParticleSystem
     }
 
     if (totchild == 0 || part->draw & PART_DRAW_PARENT) {
-      a = 0;
+      a_start = 0;
     }
     else {
-      a = totpart;
+      a_start = totpart;
     }
 
-    for (pa = psys->particles; a < totpart + totchild; a++, pa++) {
-      if (a < totpart) {
-        /* handle parent particle */
-        if (pa->flag & no_draw_flag) {
-          continue;
-        }
-
-        /* pa_num = pa->num; */ /* UNUSED */
-        size = pa->size;
-      }
-      else {
-        /* handle child particle */
-        cpa = &psys->child[a - totpart];
+    /* Select the particles to instance and their objects up front,
+     * the random object choice has to happen in particle order. */
+    pa_index = MEM_mallocN(sizeof(int) * (size_t)max_ii(totpart + totchild - a_start, 1),
+                           "dupli particle index");
+    pa_ob = MEM_mallocN(sizeof(Object *) * (size_t)max_ii(totpart + totchild - a_start, 1),
+                        "dupli particle object");
 
-        /* pa_num = a; */ /* UNUSED */
-        size = psys_get_child_size(psys, cpa, ctime, NULL);
+    for (a = a_start; a < totpart + totchild; a++) {
+      /* handle parent particle */
+      if (a < totpart && (psys->particles[a].flag & no_draw_flag)) {
+        continue;
       }
 
       /* some hair paths might be non-existent so they can't be used for duplication */
@@ -936,115 +1285,41 @@ static void make_duplis_particle_system(const DupliContext *ctx, ParticleSystem
         ob = oblist[b];
       }
 
-      if (hair) {
-        /* hair we handle separate and compute transform based on hair keys */
-        if (a < totpart) {
-          cache = psys->pathcache[a];
-          psys_get_dupli_path_transform(&sim, pa, NULL, cache, pamat, &scale);
-        }
-        else {
-          cache = psys->childcache[a - totpart];
-          psys_get_dupli_path_transform(&sim, NULL, cpa, cache, pamat, &scale);
-        }
-
-        copy_v3_v3(pamat[3], cache->co);
-        pamat[3][3] = 1.0f;
-      }
-      else {
-        /* first key */
-        state.time = ctime;
-        if (psys_get_particle_state(&sim, a, &state, 0) == 0) {
-          continue;
-        }
-        else {
-          float tquat[4];
-          normalize_qt_qt(tquat, state.rot);
-          quat_to_mat4(pamat, tquat);
-          copy_v3_v3(pamat[3], state.co);
-          pamat[3][3] = 1.0f;
-        }
-      }
-
-      if (part->ren_as == PART_DRAW_GR && psys->part->draw & PART_DRAW_WHOLE_GR) {
-        b = 0;
-        FOREACH_COLLECTION_VISIBLE_OBJECT_RECURSIVE_BEGIN (
-            part->instance_collection, object, mode) {
-          copy_m4_m4(tmat, oblist[b]->obmat);
-
-          /* apply particle scale */
-          mul_mat3_m4_fl(tmat, size * scale);
-          mul_v3_fl(tmat[3], size * scale);
-
-          /* collection dupli offset, should apply after everything else */
-          if (!is_zero_v3(part->instance_collection->instance_offset)) {
-            sub_v3_v3(tmat[3], part->instance_collection->instance_offset);
-          }
-
-          /* individual particle transform */
-          mul_m4_m4m4(mat, pamat, tmat);
-
-          dob = make_dupli(ctx, object, mat, a);
-          dob->particle_system = psys;
-
-          psys_get_dupli_texture(psys, part, sim.psmd, pa, cpa, dob->uv, dob->orco);
+      pa_index[pa_len] = a;
+      pa_ob[pa_len] = ob;
+      pa_len++;
+    }
 
-          b++;
-        }
-        FOREACH_COLLECTION_VISIBLE_OBJECT_RECURSIVE_END;
+    /* Every particle fills a fixed range of duplis, particles without a valid state leave
+     * theirs empty and are removed afterwards. */
+    {
+      const int dupli_start = ctx->duplis->len;
+      ParticleDupliData pdd = {
+          .ctx = ctx,
+          .sim = &sim,
+          .ctime = ctime,
+          .hair = hair,
+          .use_whole_collection = (part->ren_as == PART_DRAW_GR) && use_whole_collection,
+          .oblist = oblist,
+          .totcollection = totcollection,
+          .pa_index = pa_index,
+          .pa_ob = pa_ob,
+      };
+      pdd.duplis_per_particle = pdd.use_whole_collection ? totcollection : 1;
+      /* Both are below INT_MAX, check the product fits when size_t is 32 bit. */
+      if ((size_t)pa_len <= SIZE_MAX / (size_t)max_ii(pdd.duplis_per_particle, 1)) {
+        pdd.duplis = dupli_array_add(ctx,
+                                     (size_t)pa_len * (size_t)pdd.duplis_per_particle);
       }
-      else {
-        float obmat[4][4];
-        copy_m4_m4(obmat, ob->obmat);
-
-        float vec[3];
-        copy_v3_v3(vec, obmat[3]);
-        zero_v3(obmat[3]);
-
-        /* Particle rotation uses x-axis as the aligned axis,
-         * so pre-rotate the object accordingly. */
-        if ((part->draw & PART_DRAW_ROTATE_OB) == 0) {
-          float xvec[3], q[4], size_mat[4][4], original_size[3];
-
-          mat4_to_size(original_size, obmat);
-          size_to_mat4(size_mat, original_size);
-
-          xvec[0] = -1.f;
-          xvec[1] = xvec[2] = 0;
-          vec_to_quat(q, xvec, ob->trackflag, ob->upflag);
-          quat_to_mat4(obmat, q);
-          obmat[3][3] = 1.0f;
-
-          /* add scaling if requested */
-          if ((part->draw & PART_DRAW_NO_SCALE_OB) == 0) {
-            mul_m4_m4m4(obmat, obmat, size_mat);
-          }
-        }
-        else if (part->draw & PART_DRAW_NO_SCALE_OB) {
-          /* remove scaling */
-          float size_mat[4][4], original_size[3];
-
-          mat4_to_size(original_size, obmat);
-          size_to_mat4(size_mat, original_size);
-          invert_m4(size_mat);
-
-          mul_m4_m4m4(obmat, obmat, size_mat);
-        }
-
-        mul_m4_m4m4(tmat, pamat, obmat);
-        mul_mat3_m4_fl(tmat, size * scale);
 
-        copy_m4_m4(mat, tmat);
-
-        if (part->draw & PART_DRAW_GLOBAL_OB) {
-          add_v3_v3v3(mat[3], mat[3], vec);
-        }
-
-        dob = make_dupli(ctx, ob, mat, a);
-        dob->particle_system = psys;
-        psys_get_dupli_texture(psys, part, sim.psmd, pa, cpa, dob->uv, dob->orco);
+      if (pdd.duplis) {
+        dupli_parallel_range(pa_len, &pdd, particle_dupli_task_cb);
+        dupli_array_compact(ctx, dupli_start);
       }
     }
 
+    MEM_freeN(pa_index);
+    MEM_freeN(pa_ob);
     BLI_rng_free(rng);
   }
 
@@ -1121,22 +1396,52 @@ static const DupliGenerator *get_dupli_generator(const DupliContext *ctx)
 
 /* ---- ListBase dupli container implementation ---- */
 
-/* Returns a list of DupliObject */
+/* Returns a list of DupliObject.
+ * The items are stored in a single array, linked in order so iterating over the list
+ * walks memory sequentially, see #object_duplilist_array. */
 ListBase *object_duplilist(Depsgraph *depsgraph, Scene *sce, Object *ob)
 {
   ListBase *duplilist = MEM_callocN(sizeof(ListBase), "duplilist");
+  DupliArray duplis = {NULL};
   DupliContext ctx;
   init_context(&ctx, depsgraph, sce, ob, NULL);
   if (ctx.gen) {
-    ctx.duplilist = duplilist;
+    ctx.duplis = &duplis;
     ctx.gen->make_duplis(&ctx);
   }
 
+  if (duplis.len == 0) {
+    MEM_SAFE_FREE(duplis.data);
+    return duplilist;
+  }
+
+  /* the array must start at the first item so freeing the list frees it */
+  if (duplis.len < duplis.alloc_len) {
+    duplis.data = MEM_reallocN_id(
+        duplis.data, sizeof(DupliObject) * (size_t)duplis.len, "dupli objects");
+  }
+
+  for (int i = 0; i < duplis.len; i++) {
+    duplis.data[i].prev = (i > 0) ? &duplis.data[i - 1] : NULL;
+    duplis.data[i].next = (i + 1 < duplis.len) ? &duplis.data[i + 1] : NULL;
+  }
+  duplilist->first = &duplis.data[0];
+  duplilist->last = &duplis.data[duplis.len - 1];
+
   return duplilist;
 }
 
+/* Access the list created by #object_duplilist as an array. */
+DupliObject *object_duplilist_array(ListBase *lb, int *r_len)
+{
+  DupliObject *first = lb->first, *last = lb->last;
+  *r_len = first ? (int)(last - first) + 1 : 0;
+  return first;
+}
+
 void free_object_duplilist(ListBase *lb)
 {
-  BLI_freelistN(lb);
+  /* items are a single allocation, see #object_duplilist */
+  MEM_SAFE_FREE(lb->first);
   MEM_freeN(lb);
 }
@@ -352,8 +352,13 @@ void BKE_object_eval_uber_data(Depsgraph *depsgraph, Scene *scene, Object *ob)
 {
   DEG_debug_print_eval(depsgraph, __func__, ob->id.name, ob);
   BLI_assert(ob->type != OB_ARMATURE);
+  ob->runtime.is_mesh_batch_cache_deformed = false;
   BKE_object_handle_data_update(depsgraph, scene, ob);
-  BKE_object_batch_cache_dirty_tag(ob);
+  /* A batch cache handed over to the new evaluated mesh is already tagged, only the buffers
+   * depending on vertex positions are to be extracted again. */
+  if (!ob->runtime.is_mesh_batch_cache_deformed) {
+    BKE_object_batch_cache_dirty_tag(ob);
+  }
 }
 
 void BKE_object_eval_ptcache_reset(Depsgraph *depsgraph, Scene *scene, Object *object)
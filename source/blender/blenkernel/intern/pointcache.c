@@ -21,6 +21,8 @@
  * \ingroup bke
  */
 
+#include <fcntl.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -43,8 +45,11 @@
 #include "DNA_fluid_types.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
 #include "BLI_math.h"
+#include "BLI_mmap.h"
 #include "BLI_string.h"
+#include "BLI_threads.h"
 #include "BLI_utildefines.h"
 
 #include "BLT_translation.h"
@@ -98,10 +103,16 @@
 #  include "LzmaLib.h"
 #endif
 
+#ifdef WITH_ZSTD
+#  include <zstd.h>
+#endif
+
 /* needed for directory lookup */
 #ifndef WIN32
 #  include <dirent.h>
+#  include <unistd.h>
 #else
+#  include <io.h>
 #  include "BLI_winstuff.h"
 #endif
 
@@ -146,6 +157,8 @@ static int ptcache_file_compressed_write(
     PTCacheFile *pf, unsigned char *in, unsigned int in_len, unsigned char *out, int mode);
 static int ptcache_file_write(PTCacheFile *pf, const void *f, unsigned int tot, unsigned int size);
 static int ptcache_file_read(PTCacheFile *pf, void *f, unsigned int tot, unsigned int size);
+static int ptcache_file_seek(PTCacheFile *pf, long offset, int whence);
+static void ptcache_disk_write_wait(const char *filename);
 
 /* Common functions */
 static int ptcache_basic_header_read(PTCacheFile *pf)
@@ -153,11 +166,11 @@ static int ptcache_basic_header_read(PTCacheFile *pf)
   int error = 0;
 
   /* Custom functions should read these basic elements too! */
-  if (!error && !fread(&pf->totpoint, sizeof(unsigned int), 1, pf->fp)) {
+  if (!error && !ptcache_file_read(pf, &pf->totpoint, 1, sizeof(unsigned int))) {
     error = 1;
   }
 
-  if (!error && !fread(&pf->data_types, sizeof(unsigned int), 1, pf->fp)) {
+  if (!error && !ptcache_file_read(pf, &pf->data_types, 1, sizeof(unsigned int))) {
     error = 1;
   }
 
@@ -166,11 +179,11 @@ static int ptcache_basic_header_read(PTCacheFile *pf)
 static int ptcache_basic_header_write(PTCacheFile *pf)
 {
   /* Custom functions should write these basic elements too! */
-  if (!fwrite(&pf->totpoint, sizeof(unsigned int), 1, pf->fp)) {
+  if (!ptcache_file_write(pf, &pf->totpoint, 1, sizeof(unsigned int))) {
     return 0;
   }
 
-  if (!fwrite(&pf->data_types, sizeof(unsigned int), 1, pf->fp)) {
+  if (!ptcache_file_write(pf, &pf->data_types, 1, sizeof(unsigned int))) {
     return 0;
   }
 
@@ -847,7 +860,7 @@ static int ptcache_smoke_read(PTCacheFile *pf, void *smoke_v)
   ptcache_file_read(pf, version, 4, sizeof(char));
   if (!STREQLEN(version, SMOKE_CACHE_VERSION, 4)) {
     /* reset file pointer */
-    fseek(pf->fp, -4, SEEK_CUR);
+    ptcache_file_seek(pf, -4, SEEK_CUR);
     return ptcache_smoke_read_old(pf, smoke_v);
   }
 
@@ -2154,10 +2167,642 @@ static int ptcache_filename(PTCacheID *pid, char *filename, int cfra, short do_p
   return len; /* make sure the above string is always 16 chars */
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Single File Disk Cache
+ *
+ * With #PTCACHE_SINGLE_FILE all frames of a disk cache are stored in one file: a header with
+ * the frame range, a table with the location of each frame and the frames themselves, stored
+ * the same way as the files of the regular disk cache. Frames are appended while baking and
+ * clearing a frame only clears its table entry, the file is rewritten without the cleared frames
+ * once they take up most of it. When the frame range of the cache changes, the table is extended
+ * to the new range and keeps the frames outside of it, like the files of the regular disk cache.
+ *
+ * For reading, the file is memory-mapped once and shared by all frames, so playback doesn't
+ * open a file for every frame.
+ * \{ */
+
+#define PTCACHE_PACK_VERSION 1
+/* Initial size of the buffer frames are written to before appending them. */
+#define PTCACHE_PACK_BUFFER_SIZE 4096
+/* Minimum size of the cleared frames before the file is compacted. */
+#define PTCACHE_PACK_COMPACT_MIN (1 << 20)
+
+typedef struct PTCachePackHeader {
+  char id[8]; /* "BPHYSPAK" */
+  int version;
+  int frame_start;
+  int frames_len;
+  int _pad;
+} PTCachePackHeader;
+
+typedef struct PTCachePackFrame {
+  uint64_t offset;
+  /* Zero when the frame isn't cached. */
+  uint64_t size;
+} PTCachePackFrame;
+
+/* File and frame range the frames of a cache are stored in. */
+typedef struct PTCachePackInfo {
+  char filename[MAX_PTCACHE_FILE];
+  int frame_start, frames_len;
+} PTCachePackInfo;
+
+/* Memory-mapped pack file, shared by the cache files reading from it. */
+typedef struct PTCachePackMap {
+  BLI_mmap_file *mmap;
+  int users;
+  /* The file changed after mapping it, freed by the last user. */
+  bool is_outdated;
+} PTCachePackMap;
+
+/* Pack filename -> #PTCachePackMap, for the files mapped for reading. */
+static GHash *ptcache_pack_maps = NULL;
+/* Guards the mappings and writing to pack files. */
+static ThreadMutex ptcache_pack_mutex = BLI_MUTEX_INITIALIZER;
+
+static bool ptcache_pack_supported(const PTCacheID *pid)
+{
+  /* Streamed and OpenVDB caches write their own file format per frame. */
+  return (pid->cache->flag & PTCACHE_EXTERNAL) == 0 && pid->file_type == PTCACHE_FILE_PTCACHE &&
+         pid->write_stream == NULL;
+}
+
+/* Whether the cache uses a pack file, \a info is filled in when it does. */
+static bool ptcache_pack_info_get(PTCacheID *pid, PTCachePackInfo *info)
+{
+  PointCache *cache = pid->cache;
+  int len;
+
+  if ((cache->flag & PTCACHE_SINGLE_FILE) == 0 || !ptcache_pack_supported(pid)) {
+    return false;
+  }
+
+  len = ptcache_filename(pid, info->filename, 0, 1, 0);
+  if (len == 0) {
+    return false;
+  }
+
+  if (cache->index < 0) {
+    cache->index = pid->stack_index = BKE_object_insert_ptcache(pid->ob);
+  }
+
+  BLI_snprintf(info->filename + len,
+               sizeof(info->filename) - len,
+               "_%02u" PTCACHE_PACK_EXT,
+               pid->stack_index);
+
+  /* Frame 0 holds the info of baked caches. */
+  info->frame_start = MIN2(cache->startframe, 0);
+  info->frames_len = cache->endframe - info->frame_start + 1;
+
+  return true;
+}
+
+static void ptcache_pack_header_init(PTCachePackHeader *header, const PTCachePackInfo *info)
+{
+  memcpy(header->id, "BPHYSPAK", sizeof(header->id));
+  header->version = PTCACHE_PACK_VERSION;
+  header->frame_start = info->frame_start;
+  header->frames_len = info->frames_len;
+  header->_pad = 0;
+}
+
+static bool ptcache_pack_header_check(const PTCachePackHeader *header, size_t file_len)
+{
+  return file_len >= sizeof(*header) && STREQLEN(header->id, "BPHYSPAK", sizeof(header->id)) &&
+         header->version == PTCACHE_PACK_VERSION && header->frames_len >= 0 &&
+         sizeof(*header) + sizeof(PTCachePackFrame) * (size_t)header->frames_len <= file_len;
+}
+
+static void ptcache_pack_map_free(PTCachePackMap *map)
+{
+  BLI_mmap_free(map->mmap);
+  MEM_freeN(map);
+}
+
+/* Drop the mapping of a file that changed, #ptcache_pack_mutex must be locked. */
+static void ptcache_pack_map_invalidate(const char *filename)
+{
+  PTCachePackMap *map = ptcache_pack_maps ?
+                            BLI_ghash_popkey(ptcache_pack_maps, filename, MEM_freeN) :
+                            NULL;
+
+  if (map) {
+    if (map->users == 0) {
+      ptcache_pack_map_free(map);
+    }
+    else {
+      map->is_outdated = true;
+    }
+  }
+}
+
+/* Map the pack file for reading, NULL when it doesn't exist or isn't valid. */
+static PTCachePackMap *ptcache_pack_map_acquire(const char *filename)
+{
+  PTCachePackMap *map;
+
+  BLI_mutex_lock(&ptcache_pack_mutex);
+
+  if (ptcache_pack_maps == NULL) {
+    ptcache_pack_maps = BLI_ghash_str_new(__func__);
+  }
+
+  map = BLI_ghash_lookup(ptcache_pack_maps, filename);
+
+  if (map && BLI_mmap_any_io_error(map->mmap)) {
+    /* Reading failed (e.g. the file was truncated), map it again. */
+    ptcache_pack_map_invalidate(filename);
+    map = NULL;
+  }
+
+  if (map == NULL) {
+    const int file = BLI_open(filename, O_BINARY | O_RDONLY, 0);
+    BLI_mmap_file *mmap = NULL;
+
+    if (file != -1) {
+      mmap = BLI_mmap_open(file);
+      /* The mapping stays valid after closing. */
+      close(file);
+    }
+
+    if (mmap && !ptcache_pack_header_check(BLI_mmap_get_pointer(mmap),
+                                           BLI_mmap_get_length(mmap))) {
+      BLI_mmap_free(mmap);
+      mmap = NULL;
+    }
+
+    if (mmap) {
+      map = MEM_callocN(sizeof(*map), "PTCachePackMap");
+      map->mmap = mmap;
+      BLI_ghash_insert(ptcache_pack_maps, BLI_strdup(filename), map);
+    }
+  }
+
+  if (map) {
+    map->users++;
+  }
+
+  BLI_mutex_unlock(&ptcache_pack_mutex);
+
+  return map;
+}
+
+static void ptcache_pack_map_release(PTCachePackMap *map)
+{
+  BLI_mutex_lock(&ptcache_pack_mutex);
+  map->users--;
+  if (map->users == 0 && map->is_outdated) {
+    ptcache_pack_map_free(map);
+  }
+  BLI_mutex_unlock(&ptcache_pack_mutex);
+}
+
+/* Data of the frame in the mapped file, false when the frame isn't cached. */
+static bool ptcache_pack_map_frame(const PTCachePackMap *map,
+                                   int frame,
+                                   const unsigned char **r_data,
+                                   size_t *r_size)
+{
+  const unsigned char *mem = BLI_mmap_get_pointer(map->mmap);
+  const size_t mem_len = BLI_mmap_get_length(map->mmap);
+  const PTCachePackHeader *header = (const PTCachePackHeader *)mem;
+  const PTCachePackFrame *entry;
+
+  if (frame < header->frame_start || frame >= header->frame_start + header->frames_len) {
+    return false;
+  }
+
+  entry = (const PTCachePackFrame *)(header + 1) + (frame - header->frame_start);
+
+  if (entry->size == 0 || entry->offset > mem_len || entry->size > mem_len - entry->offset) {
+    return false;
+  }
+
+  *r_data = mem + entry->offset;
+  *r_size = (size_t)entry->size;
+
+  return true;
+}
+
+/**
+ * Copy the frames of the pack file to a new file with a table for \a frame_start and
+ * \a frames_len, which include the frame range of \a header, leaving out the space of cleared
+ * frames. The file is only replaced once the copy is complete, \a fp is closed.
+ * #ptcache_pack_mutex must be locked.
+ */
+static bool ptcache_pack_rewrite(const char *filename,
+                                 FILE *fp,
+                                 const PTCachePackHeader *header,
+                                 const PTCachePackFrame *frames,
+                                 int frame_start,
+                                 int frames_len)
+{
+  char filename_tmp[MAX_PTCACHE_FILE + 4];
+  PTCachePackHeader header_tmp = *header;
+  PTCachePackFrame *frames_tmp;
+  const size_t table_len = sizeof(*frames_tmp) * (size_t)frames_len;
+  FILE *fp_tmp;
+  bool ok;
+
+  BLI_assert(frame_start <= header->frame_start &&
+             frame_start + frames_len >= header->frame_start + header->frames_len);
+
+  header_tmp.frame_start = frame_start;
+  header_tmp.frames_len = frames_len;
+  frames_tmp = MEM_callocN(MAX2(table_len, 1), "PTCachePackFrame");
+
+  BLI_snprintf(filename_tmp, sizeof(filename_tmp), "%s.tmp", filename);
+  fp_tmp = BLI_fopen(filename_tmp, "wb");
+  ok = fp_tmp && fwrite(&header_tmp, sizeof(header_tmp), 1, fp_tmp) == 1 &&
+       fwrite(frames_tmp, 1, table_len, fp_tmp) == table_len;
+
+  if (ok) {
+    uint64_t offset = sizeof(header_tmp) + table_len;
+    void *buffer = NULL;
+    size_t buffer_len = 0;
+
+    for (int i = 0; i < header->frames_len && ok; i++) {
+      const PTCachePackFrame *entry = &frames[i];
+      PTCachePackFrame *entry_tmp = &frames_tmp[i + header->frame_start - frame_start];
+
+      if (entry->size == 0) {
+        continue;
+      }
+      if (entry->size > buffer_len) {
+        MEM_SAFE_FREE(buffer);
+        buffer_len = (size_t)entry->size;
+        buffer = MEM_mallocN(buffer_len, __func__);
+      }
+
+      ok = BLI_fseek(fp, (int64_t)entry->offset, SEEK_SET) == 0 &&
+           fread(buffer, 1, (size_t)entry->size, fp) == entry->size &&
+           fwrite(buffer, 1, (size_t)entry->size, fp_tmp) == entry->size;
+
+      entry_tmp->offset = offset;
+      entry_tmp->size = entry->size;
+      offset += entry->size;
+    }
+
+    MEM_SAFE_FREE(buffer);
+
+    ok = ok && BLI_fseek(fp_tmp, (int64_t)sizeof(header_tmp), SEEK_SET) == 0 &&
+         fwrite(frames_tmp, 1, table_len, fp_tmp) == table_len;
+  }
+
+  if (fp_tmp && fclose(fp_tmp) != 0) {
+    ok = false;
+  }
+  fclose(fp);
+  MEM_freeN(frames_tmp);
+
+  if (ok) {
+    ok = BLI_rename(filename_tmp, filename) == 0;
+  }
+  if (!ok && BLI_exists(filename_tmp)) {
+    BLI_delete(filename_tmp, false, false);
+  }
+
+  return ok;
+}
+
+/**
+ * Extend the table of the pack file in \a fp to the frame range of \a info as well, keeping
+ * the frames of the range it was written for. Returns the rewritten file opened for appending
+ * with its header in \a r_header, or NULL when it couldn't be rewritten. \a fp is closed.
+ * #ptcache_pack_mutex must be locked.
+ */
+static FILE *ptcache_pack_range_extend(const PTCachePackInfo *info,
+                                       FILE *fp,
+                                       PTCachePackHeader *r_header)
+{
+  const int frame_start = MIN2(r_header->frame_start, info->frame_start);
+  const int frame_end = MAX2(r_header->frame_start + r_header->frames_len,
+                             info->frame_start + info->frames_len);
+  const size_t table_len = sizeof(PTCachePackFrame) * (size_t)r_header->frames_len;
+  PTCachePackFrame *frames = MEM_mallocN(MAX2(table_len, 1), "PTCachePackFrame");
+  bool ok;
+
+  if (fread(frames, 1, table_len, fp) == table_len) {
+    ok = ptcache_pack_rewrite(
+        info->filename, fp, r_header, frames, frame_start, frame_end - frame_start);
+  }
+  else {
+    fclose(fp);
+    ok = false;
+  }
+  MEM_freeN(frames);
+
+  fp = ok ? BLI_fopen(info->filename, "rb+") : NULL;
+
+  if (fp && !(fread(r_header, sizeof(*r_header), 1, fp) == 1 &&
+              ptcache_pack_header_check(r_header, (size_t)-1))) {
+    fclose(fp);
+    fp = NULL;
+  }
+
+  return fp;
+}
+
+/**
+ * Append the frame to the pack file. The file is created when it doesn't exist yet. When the
+ * frame range of the cache changed, the file is rewritten with a table covering the frame range
+ * it was written for and the current one, so no frames get lost.
+ */
+static bool ptcache_pack_frame_write(const PTCachePackInfo *info,
+                                     int frame,
+                                     const void *data,
+                                     size_t size)
+{
+  PTCachePackHeader header;
+  PTCachePackFrame entry;
+  FILE *fp;
+  bool ok = false;
+
+  if (frame < info->frame_start || frame >= info->frame_start + info->frames_len) {
+    return false;
+  }
+
+  BLI_mutex_lock(&ptcache_pack_mutex);
+
+  ptcache_pack_map_invalidate(info->filename);
+
+  fp = BLI_fopen(info->filename, "rb+");
+
+  if (fp) {
+    if (!(fread(&header, sizeof(header), 1, fp) == 1 &&
+          ptcache_pack_header_check(&header, (size_t)-1))) {
+      /* Not a complete pack file, there are no frames to keep. */
+      fclose(fp);
+      fp = NULL;
+    }
+    else if (info->frame_start < header.frame_start ||
+             info->frame_start + info->frames_len > header.frame_start + header.frames_len) {
+      fp = ptcache_pack_range_extend(info, fp, &header);
+
+      if (fp == NULL) {
+        /* Don't replace the frames by a new file. */
+        BLI_mutex_unlock(&ptcache_pack_mutex);
+        CLOG_ERROR(&LOG, "Failed to extend the frame range of '%s'", info->filename);
+        return false;
+      }
+    }
+  }
+
+  if (fp == NULL) {
+    BLI_make_existing_file(info->filename);
+    fp = BLI_fopen(info->filename, "wb+");
+
+    if (fp) {
+      PTCachePackFrame *frames = MEM_callocN(sizeof(*frames) * (size_t)info->frames_len,
+                                             "PTCachePackFrame");
+
+      ptcache_pack_header_init(&header, info);
+
+      if (fwrite(&header, sizeof(header), 1, fp) != 1 ||
+          fwrite(frames, sizeof(*frames), (size_t)info->frames_len, fp) !=
+              (size_t)info->frames_len) {
+        fclose(fp);
+        fp = NULL;
+      }
+
+      MEM_freeN(frames);
+    }
+  }
+
+  if (fp) {
+    if (BLI_fseek(fp, 0, SEEK_END) == 0) {
+      entry.offset = (uint64_t)BLI_ftell(fp);
+      entry.size = (uint64_t)size;
+
+      ok = fwrite(data, 1, size, fp) == size &&
+           BLI_fseek(fp,
+                     (int64_t)(sizeof(header) +
+                               sizeof(entry) * (size_t)(frame - header.frame_start)),
+                     SEEK_SET) == 0 &&
+           fwrite(&entry, sizeof(entry), 1, fp) == 1;
+    }
+
+    if (fclose(fp) != 0) {
+      ok = false;
+    }
+  }
+
+  BLI_mutex_unlock(&ptcache_pack_mutex);
+
+  if (!ok && G.debug & G_DEBUG) {
+    printf("Error writing to disk cache file %s\n", info->filename);
+  }
+
+  return ok;
+}
+
+/**
+ * Rewrite the pack file without the space of cleared frames, when they take up more than half
+ * of it. #ptcache_pack_mutex must be locked.
+ */
+static void ptcache_pack_compact(const char *filename)
+{
+  PTCachePackHeader header;
+  PTCachePackFrame *frames;
+  FILE *fp;
+  size_t table_len;
+  uint64_t data_len = 0;
+  int64_t file_len;
+  bool ok;
+
+  fp = BLI_fopen(filename, "rb");
+  if (fp == NULL) {
+    return;
+  }
+
+  if (!(fread(&header, sizeof(header), 1, fp) == 1 &&
+        ptcache_pack_header_check(&header, (size_t)-1))) {
+    fclose(fp);
+    return;
+  }
+
+  table_len = sizeof(*frames) * (size_t)header.frames_len;
+  frames = MEM_mallocN(MAX2(table_len, 1), "PTCachePackFrame");
+
+  ok = fread(frames, 1, table_len, fp) == table_len && BLI_fseek(fp, 0, SEEK_END) == 0;
+  file_len = ok ? BLI_ftell(fp) : -1;
+
+  if (file_len > 0) {
+    const uint64_t frames_end = sizeof(header) + table_len;
+
+    for (int i = 0; i < header.frames_len; i++) {
+      data_len += frames[i].size;
+    }
+
+    if ((uint64_t)file_len < frames_end + data_len) {
+      /* Frames past the end of the file, let reading handle it. */
+      ok = false;
+    }
+    else {
+      const uint64_t cleared_len = (uint64_t)file_len - frames_end - data_len;
+      ok = cleared_len >= PTCACHE_PACK_COMPACT_MIN && cleared_len > data_len;
+    }
+  }
+  else {
+    ok = false;
+  }
+
+  if (!ok) {
+    MEM_freeN(frames);
+    fclose(fp);
+    return;
+  }
+
+  ok = ptcache_pack_rewrite(filename, fp, &header, frames, header.frame_start, header.frames_len);
+  MEM_freeN(frames);
+
+  if (!ok && G.debug & G_DEBUG) {
+    printf("Error compacting disk cache file %s\n", filename);
+  }
+}
+
+/* Clear the table entries of the frames from \a frame_min to \a frame_max. */
+static void ptcache_pack_frames_clear(const PTCachePackInfo *info, int frame_min, int frame_max)
+{
+  PTCachePackHeader header;
+  FILE *fp;
+
+  BLI_mutex_lock(&ptcache_pack_mutex);
+
+  ptcache_pack_map_invalidate(info->filename);
+
+  fp = BLI_fopen(info->filename, "rb+");
+
+  if (fp) {
+    if (fread(&header, sizeof(header), 1, fp) == 1 &&
+        ptcache_pack_header_check(&header, (size_t)-1)) {
+      CLAMP_MIN(frame_min, header.frame_start);
+      CLAMP_MAX(frame_max, header.frame_start + header.frames_len - 1);
+
+      if (frame_min <= frame_max) {
+        const int frames_len = frame_max - frame_min + 1;
+        PTCachePackFrame *frames = MEM_callocN(sizeof(*frames) * (size_t)frames_len,
+                                               "PTCachePackFrame");
+
+        if (BLI_fseek(fp,
+                      (int64_t)(sizeof(header) +
+                                sizeof(*frames) * (size_t)(frame_min - header.frame_start)),
+                      SEEK_SET) == 0) {
+          fwrite(frames, sizeof(*frames), (size_t)frames_len, fp);
+        }
+
+        MEM_freeN(frames);
+      }
+    }
+
+    fclose(fp);
+
+    ptcache_pack_compact(info->filename);
+  }
+
+  BLI_mutex_unlock(&ptcache_pack_mutex);
+}
+
+static void ptcache_pack_delete(const PTCachePackInfo *info)
+{
+  BLI_mutex_lock(&ptcache_pack_mutex);
+  ptcache_pack_map_invalidate(info->filename);
+  if (BLI_exists(info->filename)) {
+    BLI_delete(info->filename, false, false);
+  }
+  BLI_mutex_unlock(&ptcache_pack_mutex);
+}
+
+static bool ptcache_pack_frame_exists(const PTCachePackInfo *info, int frame)
+{
+  PTCachePackMap *map = ptcache_pack_map_acquire(info->filename);
+  const unsigned char *data;
+  size_t size;
+  bool exists = false;
+
+  if (map) {
+    exists = ptcache_pack_map_frame(map, frame, &data, &size);
+    ptcache_pack_map_release(map);
+  }
+
+  return exists;
+}
+
+static PTCacheFile *ptcache_pack_file_open(const PTCachePackInfo *info, int mode, int cfra)
+{
+  PTCacheFile *pf;
+
+  if (mode == PTCACHE_FILE_READ) {
+    PTCachePackMap *map = ptcache_pack_map_acquire(info->filename);
+    const unsigned char *data;
+    size_t size;
+
+    if (map == NULL) {
+      return NULL;
+    }
+
+    if (!ptcache_pack_map_frame(map, cfra, &data, &size)) {
+      ptcache_pack_map_release(map);
+      return NULL;
+    }
+
+    pf = MEM_callocN(sizeof(PTCacheFile), "PTCacheFile");
+    /* Only read from, the mapping is read-only. */
+    pf->mem = (unsigned char *)data;
+    pf->mem_len = size;
+    pf->pack_map = map;
+  }
+  else if (mode == PTCACHE_FILE_WRITE) {
+    pf = MEM_callocN(sizeof(PTCacheFile), "PTCacheFile");
+    pf->mem = MEM_mallocN(PTCACHE_PACK_BUFFER_SIZE, "PTCacheFile mem");
+    pf->pack_info = MEM_mallocN(sizeof(*info), "PTCachePackInfo");
+    memcpy(pf->pack_info, info, sizeof(*info));
+  }
+  else {
+    /* Frames in a pack file can't be updated in place. */
+    return NULL;
+  }
+
+  pf->frame = cfra;
+
+  return pf;
+}
+
+/**
+ * Free the mappings of pack files, called on exit.
+ */
+static void ptcache_pack_maps_free(void)
+{
+  BLI_mutex_lock(&ptcache_pack_mutex);
+  if (ptcache_pack_maps) {
+    GHashIterator gh_iter;
+
+    GHASH_ITER (gh_iter, ptcache_pack_maps) {
+      PTCachePackMap *map = BLI_ghashIterator_getValue(&gh_iter);
+
+      /* Mappings still in use are freed by their last user. */
+      if (map->users == 0) {
+        ptcache_pack_map_free(map);
+      }
+      else {
+        map->is_outdated = true;
+      }
+    }
+
+    BLI_ghash_free(ptcache_pack_maps, MEM_freeN, NULL);
+    ptcache_pack_maps = NULL;
+  }
+  BLI_mutex_unlock(&ptcache_pack_mutex);
+}
+
+/** \} */
+
 /* youll need to close yourself after! */
 static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 {
   PTCacheFile *pf;
+  PTCachePackInfo pack_info;
   FILE *fp = NULL;
   char filename[FILE_MAX * 2];
 
@@ -2173,6 +2818,13 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 
   ptcache_filename(pid, filename, cfra, 1, 1);
 
+  /* The frame may still be in the disk writer queue. */
+  ptcache_disk_write_wait(filename);
+
+  if (ptcache_pack_info_get(pid, &pack_info)) {
+    return ptcache_pack_file_open(&pack_info, mode, cfra);
+  }
+
   if (mode == PTCACHE_FILE_READ) {
     fp = BLI_fopen(filename, "rb");
   }
@@ -2191,7 +2843,7 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
     return NULL;
   }
 
-  pf = MEM_mallocN(sizeof(PTCacheFile), "PTCacheFile");
+  pf = MEM_callocN(sizeof(PTCacheFile), "PTCacheFile");
   pf->fp = fp;
   pf->old_format = 0;
   pf->frame = cfra;
@@ -2201,7 +2853,17 @@ static PTCacheFile *ptcache_file_open(PTCacheID *pid, int mode, int cfra)
 static void ptcache_file_close(PTCacheFile *pf)
 {
   if (pf) {
-    fclose(pf->fp);
+    if (pf->fp) {
+      fclose(pf->fp);
+    }
+    if (pf->pack_map) {
+      ptcache_pack_map_release(pf->pack_map);
+    }
+    if (pf->pack_info) {
+      ptcache_pack_frame_write(pf->pack_info, pf->frame, pf->mem, pf->mem_len);
+      MEM_freeN(pf->pack_info);
+      MEM_freeN(pf->mem);
+    }
     MEM_freeN(pf);
   }
 }
@@ -2243,6 +2905,11 @@ static int ptcache_file_compressed_read(PTCacheFile *pf, unsigned char *result,
         ptcache_file_read(pf, props, sizeOfIt, sizeof(unsigned char));
         r = LzmaUncompress(result, &leno, in, &leni, props, sizeOfIt);
       }
+#endif
+#ifdef WITH_ZSTD
+      if (compressed == 3) {
+        r = ZSTD_isError(ZSTD_decompress(result, len, in, in_len)) ? 1 : 0;
+      }
 #endif
       MEM_freeN(in);
     }
@@ -2305,6 +2972,20 @@ static int ptcache_file_compressed_write(
     }
   }
 #endif
+#ifdef WITH_ZSTD
+  if (mode == 3) {
+    /* Low level, decompression speed barely depends on it and scrubbing needs fast reads. */
+    out_len = ZSTD_compress(out, LZO_OUT_LEN(in_len), in, in_len, 1);
+
+    if (ZSTD_isError(out_len) || (out_len >= in_len)) {
+      compressed = 0;
+      r = ZSTD_isError(out_len) ? 1 : 0;
+    }
+    else {
+      compressed = 3;
+    }
+  }
+#endif
 
   ptcache_file_write(pf, &compressed, 1, sizeof(unsigned char));
   if (compressed) {
@@ -2328,12 +3009,58 @@ static int ptcache_file_compressed_write(
 }
 static int ptcache_file_read(PTCacheFile *pf, void *f, unsigned int tot, unsigned int size)
 {
+  if (pf->fp == NULL) {
+    const size_t len = (size_t)tot * size;
+
+    if (len > pf->mem_len - pf->mem_pos) {
+      return 0;
+    }
+
+    memcpy(f, pf->mem + pf->mem_pos, len);
+    pf->mem_pos += len;
+
+    /* The mapped file failed to read, the copied data is zeroed. */
+    if (pf->pack_map && BLI_mmap_any_io_error(pf->pack_map->mmap)) {
+      return 0;
+    }
+    return 1;
+  }
+
   return (fread(f, size, tot, pf->fp) == tot);
 }
 static int ptcache_file_write(PTCacheFile *pf, const void *f, unsigned int tot, unsigned int size)
 {
+  if (pf->fp == NULL) {
+    const size_t len = (size_t)tot * size;
+
+    if (pf->mem_pos + len > MEM_allocN_len(pf->mem)) {
+      pf->mem = MEM_reallocN(pf->mem, (pf->mem_pos + len) * 2);
+    }
+
+    memcpy(pf->mem + pf->mem_pos, f, len);
+    pf->mem_pos += len;
+    pf->mem_len = MAX2(pf->mem_len, pf->mem_pos);
+    return 1;
+  }
+
   return (fwrite(f, size, tot, pf->fp) == tot);
 }
+static int ptcache_file_seek(PTCacheFile *pf, long offset, int whence)
+{
+  if (pf->fp == NULL) {
+    const size_t base = (whence == SEEK_SET) ? 0 :
+                        (whence == SEEK_CUR) ? pf->mem_pos : pf->mem_len;
+
+    if ((offset < 0 && (size_t)-offset > base) || base + offset > pf->mem_len) {
+      return 0;
+    }
+
+    pf->mem_pos = base + offset;
+    return 1;
+  }
+
+  return (fseek(pf->fp, offset, whence) == 0);
+}
 static int ptcache_file_data_read(PTCacheFile *pf)
 {
   int i;
@@ -2368,7 +3095,7 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
 
   pf->data_types = 0;
 
-  if (fread(bphysics, sizeof(char), 8, pf->fp) != 8) {
+  if (!ptcache_file_read(pf, bphysics, 8, sizeof(char))) {
     error = 1;
   }
 
@@ -2376,7 +3103,7 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
     error = 1;
   }
 
-  if (!error && !fread(&typeflag, sizeof(unsigned int), 1, pf->fp)) {
+  if (!error && !ptcache_file_read(pf, &typeflag, 1, sizeof(unsigned int))) {
     error = 1;
   }
 
@@ -2385,7 +3112,7 @@ static int ptcache_file_header_begin_read(PTCacheFile *pf)
 
   /* if there was an error set file as it was */
   if (error) {
-    fseek(pf->fp, 0, SEEK_SET);
+    ptcache_file_seek(pf, 0, SEEK_SET);
   }
 
   return !error;
@@ -2395,11 +3122,11 @@ static int ptcache_file_header_begin_write(PTCacheFile *pf)
   const char *bphysics = "BPHYSICS";
   unsigned int typeflag = pf->type + pf->flag;
 
-  if (fwrite(bphysics, sizeof(char), 8, pf->fp) != 8) {
+  if (!ptcache_file_write(pf, bphysics, 8, sizeof(char))) {
     return 0;
   }
 
-  if (!fwrite(&typeflag, sizeof(unsigned int), 1, pf->fp)) {
+  if (!ptcache_file_write(pf, &typeflag, 1, sizeof(unsigned int))) {
     return 0;
   }
 
@@ -2717,48 +3444,39 @@ static PTCacheMem *ptcache_disk_frame_to_mem(PTCacheID *pid, int cfra)
 
   return pm;
 }
-static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
+/* Write \a pm to \a pf, the file type and header function are given by the cache ID. */
+static int ptcache_mem_frame_write(PTCacheFile *pf,
+                                   PTCacheMem *pm,
+                                   int (*write_header)(PTCacheFile *pf),
+                                   const int compression)
 {
-  PTCacheFile *pf = NULL;
   unsigned int i, error = 0;
 
-  BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, pm->frame);
-
-  pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, pm->frame);
-
-  if (pf == NULL) {
-    if (G.debug & G_DEBUG) {
-      printf("Error opening disk cache file for writing\n");
-    }
-    return 0;
-  }
-
   pf->data_types = pm->data_types;
   pf->totpoint = pm->totpoint;
-  pf->type = pid->type;
   pf->flag = 0;
 
   if (pm->extradata.first) {
     pf->flag |= PTCACHE_TYPEFLAG_EXTRADATA;
   }
 
-  if (pid->cache->compression) {
+  if (compression) {
     pf->flag |= PTCACHE_TYPEFLAG_COMPRESS;
   }
 
-  if (!ptcache_file_header_begin_write(pf) || !pid->write_header(pf)) {
+  if (!ptcache_file_header_begin_write(pf) || !write_header(pf)) {
     error = 1;
   }
 
   if (!error) {
-    if (pid->cache->compression) {
+    if (compression) {
       for (i = 0; i < BPHYS_TOT_DATA; i++) {
         if (pm->data[i]) {
           unsigned int in_len = pm->totpoint * ptcache_data_size[i];
           unsigned char *out = (unsigned char *)MEM_callocN(LZO_OUT_LEN(in_len) * 4,
                                                             "pointcache_lzo_buffer");
           ptcache_file_compressed_write(
-              pf, (unsigned char *)(pm->data[i]), in_len, out, pid->cache->compression);
+              pf, (unsigned char *)(pm->data[i]), in_len, out, compression);
           MEM_freeN(out);
         }
       }
@@ -2789,12 +3507,11 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
       ptcache_file_write(pf, &extra->type, 1, sizeof(unsigned int));
       ptcache_file_write(pf, &extra->totdata, 1, sizeof(unsigned int));
 
-      if (pid->cache->compression) {
+      if (compression) {
         unsigned int in_len = extra->totdata * ptcache_extra_datasize[extra->type];
         unsigned char *out = (unsigned char *)MEM_callocN(LZO_OUT_LEN(in_len) * 4,
                                                           "pointcache_lzo_buffer");
-        ptcache_file_compressed_write(
-            pf, (unsigned char *)(extra->data), in_len, out, pid->cache->compression);
+        ptcache_file_compressed_write(pf, (unsigned char *)(extra->data), in_len, out, compression);
         MEM_freeN(out);
       }
       else {
@@ -2803,14 +3520,261 @@ static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
     }
   }
 
-  ptcache_file_close(pf);
-
   if (error && G.debug & G_DEBUG) {
     printf("Error writing to disk cache\n");
   }
 
   return error == 0;
 }
+static int ptcache_mem_frame_to_disk(PTCacheID *pid, PTCacheMem *pm)
+{
+  PTCacheFile *pf = NULL;
+  int ok;
+
+  BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, pm->frame);
+
+  pf = ptcache_file_open(pid, PTCACHE_FILE_WRITE, pm->frame);
+
+  if (pf == NULL) {
+    if (G.debug & G_DEBUG) {
+      printf("Error opening disk cache file for writing\n");
+    }
+    return 0;
+  }
+
+  pf->type = pid->type;
+  ok = ptcache_mem_frame_write(pf, pm, pid->write_header, pid->cache->compression);
+
+  ptcache_file_close(pf);
+
+  return ok;
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Disk Cache Writer
+ *
+ * Frames of the disk cache are compressed and written by background threads, so simulations
+ * don't wait for the disk. Each thread takes the next frame from the queue, frames of a single
+ * file cache are appended to it one at a time. The number of frames waiting to be written is
+ * bounded, a frame is waited for when its file gets read or removed, and all of them when the
+ * cache directory is scanned.
+ * \{ */
+
+/* Maximum amount of threads writing frames, compression makes up most of their work. */
+#define PTCACHE_DISK_WRITE_THREADS_MAX 4
+/* Maximum amount of frames waiting to be written, per thread. */
+#define PTCACHE_DISK_WRITE_QUEUE_PER_THREAD 2
+
+typedef struct PTCacheDiskWrite {
+  PTCacheMem *pm;
+  int (*write_header)(PTCacheFile *pf);
+  unsigned int type;
+  int compression;
+  char filename[MAX_PTCACHE_FILE];
+  /* Used when the frame is appended to a pack file instead of written to \a filename. */
+  bool use_pack;
+  PTCachePackInfo pack_info;
+} PTCacheDiskWrite;
+
+static struct {
+  ListBase threads;
+  ThreadQueue *queue;
+  ThreadCondition cond;
+  /* Filenames of the frames in the queue or being written. */
+  GSet *pending;
+  /* Frames that could not be written since startup, only ever grows. */
+  int failed_len;
+  int threads_len;
+  bool is_running;
+} ptcache_disk_writer = {{NULL}};
+
+static ThreadMutex ptcache_disk_writer_mutex = BLI_MUTEX_INITIALIZER;
+
+static void *ptcache_disk_write_thread(void *UNUSED(customdata))
+{
+  PTCacheDiskWrite *write;
+
+  while ((write = BLI_thread_queue_pop(ptcache_disk_writer.queue))) {
+    FILE *fp = NULL;
+    bool ok = false;
+
+    if (write->use_pack) {
+      PTCacheFile pf = {NULL};
+      pf.mem = MEM_mallocN(PTCACHE_PACK_BUFFER_SIZE, "PTCacheFile mem");
+      pf.frame = write->pm->frame;
+      pf.type = write->type;
+      if (ptcache_mem_frame_write(&pf, write->pm, write->write_header, write->compression)) {
+        ok = ptcache_pack_frame_write(&write->pack_info, pf.frame, pf.mem, pf.mem_len);
+      }
+      MEM_freeN(pf.mem);
+    }
+    else if ((fp = BLI_fopen(write->filename, "wb"))) {
+      PTCacheFile pf = {NULL};
+      pf.fp = fp;
+      pf.frame = write->pm->frame;
+      pf.type = write->type;
+      ok = ptcache_mem_frame_write(&pf, write->pm, write->write_header, write->compression);
+      /* Catches errors of buffered writes. */
+      if (fclose(fp) != 0) {
+        ok = false;
+      }
+    }
+
+    if (!ok) {
+      CLOG_ERROR(&LOG, "Failed to write frame %d to '%s'", write->pm->frame, write->filename);
+    }
+
+    ptcache_data_free(write->pm);
+    ptcache_extra_free(write->pm);
+    MEM_freeN(write->pm);
+
+    BLI_mutex_lock(&ptcache_disk_writer_mutex);
+    if (!ok) {
+      ptcache_disk_writer.failed_len++;
+    }
+    BLI_gset_remove(ptcache_disk_writer.pending, write->filename, NULL);
+    BLI_condition_notify_all(&ptcache_disk_writer.cond);
+    BLI_mutex_unlock(&ptcache_disk_writer_mutex);
+
+    MEM_freeN(write);
+  }
+
+  return NULL;
+}
+
+/* Whether the file is in the queue or being written. */
+static bool ptcache_disk_write_is_pending(const char *filename)
+{
+  bool is_pending = false;
+
+  BLI_mutex_lock(&ptcache_disk_writer_mutex);
+  if (ptcache_disk_writer.is_running) {
+    is_pending = BLI_gset_haskey(ptcache_disk_writer.pending, filename);
+  }
+  BLI_mutex_unlock(&ptcache_disk_writer_mutex);
+
+  return is_pending;
+}
+
+/* Number of frames that failed to be written so far, compare before and after a flush. */
+static int ptcache_disk_write_failed_len(void)
+{
+  int failed_len;
+
+  BLI_mutex_lock(&ptcache_disk_writer_mutex);
+  failed_len = ptcache_disk_writer.failed_len;
+  BLI_mutex_unlock(&ptcache_disk_writer_mutex);
+
+  return failed_len;
+}
+
+/* Wait until the file is written, or all pending files when \a filename is NULL. */
+static void ptcache_disk_write_wait(const char *filename)
+{
+  BLI_mutex_lock(&ptcache_disk_writer_mutex);
+  if (ptcache_disk_writer.is_running) {
+    while (filename ? BLI_gset_haskey(ptcache_disk_writer.pending, filename) :
+                      BLI_gset_len(ptcache_disk_writer.pending) != 0) {
+      BLI_condition_wait(&ptcache_disk_writer.cond, &ptcache_disk_writer_mutex);
+    }
+  }
+  BLI_mutex_unlock(&ptcache_disk_writer_mutex);
+}
+
+/**
+ * Queue \a pm to be written to disk, taking ownership of it.
+ * Blocks while the queue is full.
+ */
+static int ptcache_mem_frame_to_disk_queue(PTCacheID *pid, PTCacheMem *pm)
+{
+  PTCacheDiskWrite *write;
+
+#ifndef DURIAN_POINTCACHE_LIB_OK
+  /* don't allow writing for linked objects */
+  if (pid->ob->id.lib) {
+    return 0;
+  }
+#endif
+  if (!G.relbase_valid && (pid->cache->flag & PTCACHE_EXTERNAL) == 0) {
+    return 0; /* save blend file before using disk pointcache */
+  }
+
+  BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_FRAME, pm->frame);
+
+  write = MEM_mallocN(sizeof(*write), "PTCacheDiskWrite");
+  write->pm = pm;
+  write->write_header = pid->write_header;
+  write->type = pid->type;
+  write->compression = pid->cache->compression;
+  ptcache_filename(pid, write->filename, pm->frame, 1, 1);
+  write->use_pack = ptcache_pack_info_get(pid, &write->pack_info);
+
+  /* Will create the dir if needs be, same as "//textures" is created. */
+  BLI_make_existing_file(write->filename);
+
+  BLI_mutex_lock(&ptcache_disk_writer_mutex);
+  if (!ptcache_disk_writer.is_running) {
+    ptcache_disk_writer.queue = BLI_thread_queue_init();
+    ptcache_disk_writer.pending = BLI_gset_str_new(__func__);
+    BLI_condition_init(&ptcache_disk_writer.cond);
+    ptcache_disk_writer.threads_len = min_ii(BLI_system_thread_count(),
+                                             PTCACHE_DISK_WRITE_THREADS_MAX);
+    BLI_threadpool_init(&ptcache_disk_writer.threads,
+                        ptcache_disk_write_thread,
+                        ptcache_disk_writer.threads_len);
+    for (int i = 0; i < ptcache_disk_writer.threads_len; i++) {
+      BLI_threadpool_insert(&ptcache_disk_writer.threads, NULL);
+    }
+    ptcache_disk_writer.is_running = true;
+  }
+  while (BLI_gset_len(ptcache_disk_writer.pending) >=
+         ptcache_disk_writer.threads_len * PTCACHE_DISK_WRITE_QUEUE_PER_THREAD) {
+    BLI_condition_wait(&ptcache_disk_writer.cond, &ptcache_disk_writer_mutex);
+  }
+  BLI_gset_insert(ptcache_disk_writer.pending, write->filename);
+  BLI_thread_queue_push(ptcache_disk_writer.queue, write);
+  BLI_mutex_unlock(&ptcache_disk_writer_mutex);
+
+  return 1;
+}
+
+/**
+ * Wait until all disk cache frames queued so far are written.
+ */
+void BKE_ptcache_disk_write_flush(void)
+{
+  ptcache_disk_write_wait(NULL);
+}
+
+/**
+ * Write the remaining disk cache frames and stop the writer threads.
+ */
+void BKE_ptcache_disk_write_exit(void)
+{
+  ptcache_pack_maps_free();
+
+  BLI_mutex_lock(&ptcache_disk_writer_mutex);
+  if (!ptcache_disk_writer.is_running) {
+    BLI_mutex_unlock(&ptcache_disk_writer_mutex);
+    return;
+  }
+  BLI_mutex_unlock(&ptcache_disk_writer_mutex);
+
+  /* The queue is drained before the threads exit. */
+  BLI_thread_queue_nowait(ptcache_disk_writer.queue);
+  BLI_threadpool_end(&ptcache_disk_writer.threads);
+
+  BLI_mutex_lock(&ptcache_disk_writer_mutex);
+  BLI_thread_queue_free(ptcache_disk_writer.queue);
+  BLI_gset_free(ptcache_disk_writer.pending, NULL);
+  BLI_condition_end(&ptcache_disk_writer.cond);
+  ptcache_disk_writer.queue = NULL;
+  ptcache_disk_writer.pending = NULL;
+  ptcache_disk_writer.is_running = false;
+  BLI_mutex_unlock(&ptcache_disk_writer_mutex);
+}
+
+/** \} */
 
 static int ptcache_read_stream(PTCacheID *pid, int cfra)
 {
@@ -3221,17 +4185,16 @@ static int ptcache_write(PTCacheID *pid, int cfra, int overwrite)
   pm->frame = cfra;
 
   if (cache->flag & PTCACHE_DISK_CACHE) {
-    error += !ptcache_mem_frame_to_disk(pid, pm);
-
-    // if (pm) /* pm is always set */
-    {
+    /* The writer threads free the frames once written. */
+    if (!ptcache_mem_frame_to_disk_queue(pid, pm)) {
+      error++;
       ptcache_data_free(pm);
       ptcache_extra_free(pm);
       MEM_freeN(pm);
     }
 
-    if (pm2) {
-      error += !ptcache_mem_frame_to_disk(pid, pm2);
+    if (pm2 && !ptcache_mem_frame_to_disk_queue(pid, pm2)) {
+      error++;
       ptcache_data_free(pm2);
       ptcache_extra_free(pm2);
       MEM_freeN(pm2);
@@ -3341,6 +4304,62 @@ int BKE_ptcache_write(PTCacheID *pid, unsigned int cfra)
 
   return !error;
 }
+
+/* #BKE_ptcache_id_clear for caches stored in a single file. */
+static void ptcache_pack_id_clear(PTCacheID *pid,
+                                  const PTCachePackInfo *info,
+                                  int mode,
+                                  unsigned int cfra)
+{
+  PointCache *cache = pid->cache;
+  const int sta = cache->startframe;
+  const int end = cache->endframe;
+  int frame_min, frame_max, frame;
+
+  switch (mode) {
+    case PTCACHE_CLEAR_ALL:
+      BKE_ptcache_disk_write_flush();
+      ptcache_pack_delete(info);
+      cache->last_exact = MIN2(cache->startframe, 0);
+      if (cache->cached_frames) {
+        memset(cache->cached_frames, 0, MEM_allocN_len(cache->cached_frames));
+      }
+      return;
+    case PTCACHE_CLEAR_BEFORE:
+      BKE_ptcache_disk_write_flush();
+      /* Including frames of previous frame ranges, as for the files of each frame. */
+      frame_min = INT_MIN;
+      frame_max = (int)cfra - 1;
+      ptcache_pack_frames_clear(info, frame_min, frame_max);
+      break;
+    case PTCACHE_CLEAR_AFTER:
+      BKE_ptcache_disk_write_flush();
+      frame_min = (int)cfra + 1;
+      frame_max = INT_MAX;
+      ptcache_pack_frames_clear(info, frame_min, frame_max);
+      break;
+    case PTCACHE_CLEAR_FRAME:
+      frame_min = frame_max = (int)cfra;
+      if (BKE_ptcache_id_exist(pid, cfra)) {
+        char filename[MAX_PTCACHE_FILE];
+
+        /* The frame may still be in the disk writer queue. */
+        ptcache_filename(pid, filename, cfra, 1, 1);
+        ptcache_disk_write_wait(filename);
+        ptcache_pack_frames_clear(info, frame_min, frame_max);
+      }
+      break;
+    default:
+      return;
+  }
+
+  if (cache->cached_frames) {
+    for (frame = MAX2(frame_min, sta); frame <= MIN2(frame_max, end); frame++) {
+      cache->cached_frames[frame - sta] = 0;
+    }
+  }
+}
+
 /* you'll need to close yourself after!
  * mode - PTCACHE_CLEAR_ALL,
  */
@@ -3358,6 +4377,7 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
   char filename[MAX_PTCACHE_FILE];
   char path_full[MAX_PTCACHE_FILE];
   char ext[MAX_PTCACHE_PATH];
+  PTCachePackInfo pack_info;
 
   if (!pid || !pid->cache || pid->cache->flag & PTCACHE_BAKED) {
     return;
@@ -3379,6 +4399,12 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
 
   /*if (!G.relbase_valid) return; */ /* save blend file before using pointcache */
 
+  if ((pid->cache->flag & PTCACHE_DISK_CACHE) && ptcache_pack_info_get(pid, &pack_info)) {
+    ptcache_pack_id_clear(pid, &pack_info, mode, cfra);
+    pid->cache->flag |= PTCACHE_FLAG_INFO_DIRTY;
+    return;
+  }
+
   const char *fext = ptcache_file_extension(pid);
 
   /* clear all files in the temp dir with the prefix of the ID and the ".bphys" suffix */
@@ -3387,6 +4413,8 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
     case PTCACHE_CLEAR_BEFORE:
     case PTCACHE_CLEAR_AFTER:
       if (pid->cache->flag & PTCACHE_DISK_CACHE) {
+        BKE_ptcache_disk_write_flush();
+
         ptcache_path(pid, path);
 
         dir = opendir(path);
@@ -3479,6 +4507,7 @@ void BKE_ptcache_id_clear(PTCacheID *pid, int mode, unsigned int cfra)
       if (pid->cache->flag & PTCACHE_DISK_CACHE) {
         if (BKE_ptcache_id_exist(pid, cfra)) {
           ptcache_filename(pid, filename, cfra, 1, 1); /* no path */
+          ptcache_disk_write_wait(filename);
           BLI_delete(filename, false, false);
         }
       }
@@ -3519,9 +4548,18 @@ int BKE_ptcache_id_exist(PTCacheID *pid, int cfra)
 
   if (pid->cache->flag & PTCACHE_DISK_CACHE) {
     char filename[MAX_PTCACHE_FILE];
+    PTCachePackInfo pack_info;
 
     ptcache_filename(pid, filename, cfra, 1, 1);
 
+    if (ptcache_disk_write_is_pending(filename)) {
+      return 1;
+    }
+
+    if (ptcache_pack_info_get(pid, &pack_info)) {
+      return ptcache_pack_frame_exists(&pack_info, cfra);
+    }
+
     return BLI_exists(filename);
   }
   else {
@@ -3595,6 +4633,28 @@ void BKE_ptcache_id_time(
       char filename[MAX_PTCACHE_FILE];
       char ext[MAX_PTCACHE_PATH];
       unsigned int len; /* store the length of the string */
+      PTCachePackInfo pack_info;
+
+      BKE_ptcache_disk_write_flush();
+
+      if (ptcache_pack_info_get(pid, &pack_info)) {
+        PTCachePackMap *map = ptcache_pack_map_acquire(pack_info.filename);
+
+        if (map) {
+          const unsigned char *data;
+          size_t size;
+          int frame;
+
+          for (frame = cache->startframe; frame <= cache->endframe; frame++) {
+            if (ptcache_pack_map_frame(map, frame, &data, &size)) {
+              cache->cached_frames[frame - cache->startframe] = 1;
+            }
+          }
+
+          ptcache_pack_map_release(map);
+        }
+        return;
+      }
 
       ptcache_path(pid, path);
 
@@ -3782,6 +4842,8 @@ void BKE_ptcache_remove(void)
   char path_full[MAX_PTCACHE_PATH];
   int rmdir = 1;
 
+  BKE_ptcache_disk_write_flush();
+
   ptcache_path(NULL, path);
 
   if (BLI_exists(path)) {
@@ -3799,7 +4861,7 @@ void BKE_ptcache_remove(void)
       if (FILENAME_IS_CURRPAR(de->d_name)) {
         /* do nothing */
       }
-      else if (strstr(de->d_name, PTCACHE_EXT)) { /* do we have the right extension?*/
+      else if (strstr(de->d_name, PTCACHE_EXT) || strstr(de->d_name, PTCACHE_PACK_EXT)) {
         BLI_join_dirfile(path_full, sizeof(path_full), path, de->d_name);
         BLI_delete(path_full, false, false);
       }
@@ -3983,6 +5045,7 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
   int startframe = MAXFRAME, endframe = baker->anim_init ? scene->r.sfra : CFRA;
   int bake = baker->bake;
   int render = baker->render;
+  const int failed_len = ptcache_disk_write_failed_len();
 
   G.is_break = false;
 
@@ -4140,6 +5203,17 @@ void BKE_ptcache_bake(PTCacheBaker *baker)
     CFRA += 1;
   }
 
+  /* The bake isn't done before its last frames are on disk. */
+  BKE_ptcache_disk_write_flush();
+
+  if (ptcache_disk_write_failed_len() != failed_len) {
+    /* Frames are missing from disk, don't flag the caches as baked. */
+    CLOG_ERROR(&LOG,
+               "Bake failed to write %d frame(s) to disk",
+               ptcache_disk_write_failed_len() - failed_len);
+    bake = 0;
+  }
+
   if (use_timer) {
     /* start with newline because of \r above */
     ptcache_dt_to_str(run, PIL_check_seconds_timer() - stime);
@@ -4299,6 +5373,57 @@ void BKE_ptcache_toggle_disk_cache(PTCacheID *pid)
   }
 }
 
+void BKE_ptcache_toggle_single_file(PTCacheID *pid)
+{
+  PointCache *cache = pid->cache;
+  ListBase frames = {NULL, NULL};
+  PTCacheMem *pm;
+  int baked = cache->flag & PTCACHE_BAKED;
+  int last_exact = cache->last_exact;
+  int cfra;
+
+  /* Other caches store a file per frame either way. */
+  if ((cache->flag & PTCACHE_DISK_CACHE) == 0 || !G.relbase_valid ||
+      !ptcache_pack_supported(pid)) {
+    return;
+  }
+
+  /* Read the frames stored the other way, including the info frame. */
+  cache->flag ^= PTCACHE_SINGLE_FILE;
+
+  for (cfra = MIN2(cache->startframe, 0); cfra <= cache->endframe; cfra++) {
+    if ((pm = ptcache_disk_frame_to_mem(pid, cfra))) {
+      BLI_addtail(&frames, pm);
+    }
+  }
+
+  /* Remove possible bake flag to allow clear */
+  cache->flag &= ~PTCACHE_BAKED;
+
+  BKE_ptcache_id_clear(pid, PTCACHE_CLEAR_ALL, 0);
+
+  cache->flag ^= PTCACHE_SINGLE_FILE;
+
+  for (pm = frames.first; pm; pm = pm->next) {
+    ptcache_mem_frame_to_disk(pid, pm);
+  }
+  BKE_ptcache_free_mem(&frames);
+
+  /* restore possible bake flag */
+  cache->flag |= baked;
+  cache->last_exact = last_exact;
+
+  if (cache->cached_frames) {
+    MEM_freeN(cache->cached_frames);
+    cache->cached_frames = NULL;
+    cache->cached_frames_len = 0;
+  }
+
+  BKE_ptcache_id_time(pid, NULL, 0.0f, NULL, NULL, NULL);
+
+  cache->flag |= PTCACHE_FLAG_INFO_DIRTY;
+}
+
 void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const char *name_dst)
 {
   char old_name[80];
@@ -4311,6 +5436,7 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
   char new_path_full[MAX_PTCACHE_FILE];
   char old_path_full[MAX_PTCACHE_FILE];
   char ext[MAX_PTCACHE_PATH];
+  PTCachePackInfo pack_info_src, pack_info_dst;
 
   /* save old name */
   BLI_strncpy(old_name, pid->cache->name, sizeof(old_name));
@@ -4320,6 +5446,24 @@ void BKE_ptcache_disk_cache_rename(PTCacheID *pid, const char *name_src, const c
 
   len = ptcache_filename(pid, old_filename, 0, 0, 0); /* no path */
 
+  BKE_ptcache_disk_write_flush();
+
+  if (ptcache_pack_info_get(pid, &pack_info_src)) {
+    BLI_strncpy(pid->cache->name, name_dst, sizeof(pid->cache->name));
+    ptcache_pack_info_get(pid, &pack_info_dst);
+
+    BLI_mutex_lock(&ptcache_pack_mutex);
+    ptcache_pack_map_invalidate(pack_info_src.filename);
+    ptcache_pack_map_invalidate(pack_info_dst.filename);
+    if (BLI_exists(pack_info_src.filename)) {
+      BLI_rename(pack_info_src.filename, pack_info_dst.filename);
+    }
+    BLI_mutex_unlock(&ptcache_pack_mutex);
+
+    BLI_strncpy(pid->cache->name, old_name, sizeof(pid->cache->name));
+    return;
+  }
+
   ptcache_path(pid, path);
   dir = opendir(path);
   if (dir == NULL) {
@@ -4373,6 +5517,8 @@ void BKE_ptcache_load_external(PTCacheID *pid)
     return;
   }
 
+  BKE_ptcache_disk_write_flush();
+
   ptcache_path(pid, path);
 
   len = ptcache_filename(pid, filename, 1, 0, 0); /* no path */
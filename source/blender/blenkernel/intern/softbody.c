@@ -59,7 +59,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_listbase.h"
 #include "BLI_ghash.h"
-#include "BLI_threads.h"
+#include "BLI_task.h"
 
 #include "BKE_collection.h"
 #include "BKE_collision.h"
@@ -123,21 +123,6 @@ typedef struct SBScratch {
   ReferenceState Ref;
 } SBScratch;
 
-typedef struct SB_thread_context {
-  Scene *scene;
-  Object *ob;
-  float forcetime;
-  float timenow;
-  int ifirst;
-  int ilast;
-  ListBase *effectors;
-  int do_deflector;
-  float fieldfactor;
-  float windfactor;
-  int nr;
-  int tot;
-} SB_thread_context;
-
 #define MID_PRESERVE 1
 
 #define SOFTGOALSNAP 0.999f
@@ -264,6 +249,183 @@ typedef struct ccdf_minmax {
   float minx, miny, minz, maxx, maxy, maxz;
 } ccdf_minmax;
 
+/* +++ the grid section */
+
+/* Largest number of cells along an axis of a grid. */
+#define SB_GRID_RES_MAX 64
+/* Number of items #sb_grid_query gathers without allocating. */
+#define SB_GRID_QUERY_STACK 256
+
+/* Uniform grid over boxes, to find the boxes near a location without scanning all of them. */
+typedef struct SBGrid {
+  float min[3];
+  float cell_size_inv;
+  int res[3];
+  /* The boxes overlapping cell i are items[cell_start[i]] .. items[cell_start[i + 1] - 1]. */
+  int *cell_start;
+  int *items;
+} SBGrid;
+
+static void sb_grid_cell_range(
+    const SBGrid *grid, const float min[3], const float max[3], int r_lo[3], int r_hi[3])
+{
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    const float last = (float)(grid->res[i] - 1);
+    r_lo[i] = (int)clamp_f((min[i] - grid->min[i]) * grid->cell_size_inv, 0.0f, last);
+    r_hi[i] = (int)clamp_f((max[i] - grid->min[i]) * grid->cell_size_inv, 0.0f, last);
+  }
+}
+
+BLI_INLINE int sb_grid_cell_index(const SBGrid *grid, int x, int y, int z)
+{
+  return (z * grid->res[1] + y) * grid->res[0] + x;
+}
+
+/* Build the grid over \a boxes, all inside \a bbmin and \a bbmax. */
+static void sb_grid_build(SBGrid *grid,
+                          const ccdf_minmax *boxes,
+                          int boxes_len,
+                          const float bbmin[3],
+                          const float bbmax[3])
+{
+  float extent[3], cell_size = 0.0f;
+  int lo[3], hi[3], *cursor;
+  int i, x, y, z, cells_len;
+
+  /* Cells about as large as the average box, so most boxes are in a few cells only. */
+  for (i = 0; i < boxes_len; i++) {
+    cell_size += max_fff(boxes[i].maxx - boxes[i].minx,
+                         boxes[i].maxy - boxes[i].miny,
+                         boxes[i].maxz - boxes[i].minz);
+  }
+  cell_size /= (float)max_ii(boxes_len, 1);
+
+  for (i = 0; i < 3; i++) {
+    extent[i] = max_ff(bbmax[i] - bbmin[i], 0.0f);
+  }
+  cell_size = max_ff(cell_size, max_fff(extent[0], extent[1], extent[2]) / SB_GRID_RES_MAX);
+  cell_size = max_ff(cell_size, FLT_EPSILON);
+
+  copy_v3_v3(grid->min, bbmin);
+  grid->cell_size_inv = 1.0f / cell_size;
+  for (i = 0; i < 3; i++) {
+    grid->res[i] = clamp_i((int)(extent[i] * grid->cell_size_inv) + 1, 1, SB_GRID_RES_MAX);
+  }
+
+  cells_len = grid->res[0] * grid->res[1] * grid->res[2];
+  grid->cell_start = MEM_callocN(sizeof(int) * (cells_len + 1), "SBGrid cells");
+
+  /* Count the boxes of every cell first, then fill in the boxes in ascending order. */
+  for (i = 0; i < boxes_len; i++) {
+    const float min[3] = {boxes[i].minx, boxes[i].miny, boxes[i].minz};
+    const float max[3] = {boxes[i].maxx, boxes[i].maxy, boxes[i].maxz};
+
+    sb_grid_cell_range(grid, min, max, lo, hi);
+    for (z = lo[2]; z <= hi[2]; z++) {
+      for (y = lo[1]; y <= hi[1]; y++) {
+        for (x = lo[0]; x <= hi[0]; x++) {
+          grid->cell_start[sb_grid_cell_index(grid, x, y, z) + 1]++;
+        }
+      }
+    }
+  }
+
+  for (i = 0; i < cells_len; i++) {
+    grid->cell_start[i + 1] += grid->cell_start[i];
+  }
+
+  grid->items = MEM_mallocN(sizeof(int) * max_ii(grid->cell_start[cells_len], 1), "SBGrid items");
+  cursor = MEM_dupallocN(grid->cell_start);
+
+  for (i = 0; i < boxes_len; i++) {
+    const float min[3] = {boxes[i].minx, boxes[i].miny, boxes[i].minz};
+    const float max[3] = {boxes[i].maxx, boxes[i].maxy, boxes[i].maxz};
+
+    sb_grid_cell_range(grid, min, max, lo, hi);
+    for (z = lo[2]; z <= hi[2]; z++) {
+      for (y = lo[1]; y <= hi[1]; y++) {
+        for (x = lo[0]; x <= hi[0]; x++) {
+          grid->items[cursor[sb_grid_cell_index(grid, x, y, z)]++] = i;
+        }
+      }
+    }
+  }
+
+  MEM_freeN(cursor);
+}
+
+static void sb_grid_free(SBGrid *grid)
+{
+  MEM_SAFE_FREE(grid->cell_start);
+  MEM_SAFE_FREE(grid->items);
+}
+
+static int sb_grid_cmp_item(const void *a, const void *b)
+{
+  const int item_a = *(const int *)a, item_b = *(const int *)b;
+  return (item_a > item_b) - (item_a < item_b);
+}
+
+/**
+ * Gather the boxes in the cells overlapping the box from \a min to \a max, in ascending order,
+ * so looping over them gives the same results as looping over all boxes.
+ * \a r_items is set to \a stack or to an array the caller has to free.
+ */
+static int sb_grid_query(const SBGrid *grid,
+                         const float min[3],
+                         const float max[3],
+                         int stack[SB_GRID_QUERY_STACK],
+                         int **r_items)
+{
+  int lo[3], hi[3], *items;
+  int x, y, z, i, len = 0;
+
+  sb_grid_cell_range(grid, min, max, lo, hi);
+
+  for (z = lo[2]; z <= hi[2]; z++) {
+    for (y = lo[1]; y <= hi[1]; y++) {
+      for (x = lo[0]; x <= hi[0]; x++) {
+        const int cell = sb_grid_cell_index(grid, x, y, z);
+        len += grid->cell_start[cell + 1] - grid->cell_start[cell];
+      }
+    }
+  }
+
+  items = (len > SB_GRID_QUERY_STACK) ? MEM_mallocN(sizeof(int) * len, __func__) : stack;
+  len = 0;
+
+  for (z = lo[2]; z <= hi[2]; z++) {
+    for (y = lo[1]; y <= hi[1]; y++) {
+      for (x = lo[0]; x <= hi[0]; x++) {
+        const int cell = sb_grid_cell_index(grid, x, y, z);
+        const int cell_len = grid->cell_start[cell + 1] - grid->cell_start[cell];
+        memcpy(items + len, grid->items + grid->cell_start[cell], sizeof(int) * cell_len);
+        len += cell_len;
+      }
+    }
+  }
+
+  /* Boxes in more than one cell are gathered more than once. */
+  if ((lo[0] != hi[0]) || (lo[1] != hi[1]) || (lo[2] != hi[2])) {
+    int unique_len = 0;
+
+    qsort(items, len, sizeof(int), sb_grid_cmp_item);
+    for (i = 0; i < len; i++) {
+      if (unique_len == 0 || items[unique_len - 1] != items[i]) {
+        items[unique_len++] = items[i];
+      }
+    }
+    len = unique_len;
+  }
+
+  *r_items = items;
+  return len;
+}
+
+/* --- the grid section */
+
 typedef struct ccd_Mesh {
   int mvert_num, tri_num;
   const MVert *mvert;
@@ -274,6 +436,8 @@ typedef struct ccd_Mesh {
   /* Axis Aligned Bounding Box AABB */
   float bbmin[3];
   float bbmax[3];
+  /* Grid over mima, to find the faces near a location. */
+  SBGrid grid;
 } ccd_Mesh;
 
 static ccd_Mesh *ccd_mesh_make(Object *ob)
@@ -361,6 +525,8 @@ static ccd_Mesh *ccd_mesh_make(Object *ob)
     mima->maxz = max_ff(mima->maxz, v[2] + hull);
   }
 
+  sb_grid_build(&pccd_M->grid, pccd_M->mima, pccd_M->tri_num, pccd_M->bbmin, pccd_M->bbmax);
+
   return pccd_M;
 }
 static void ccd_mesh_update(Object *ob, ccd_Mesh *pccd_M)
@@ -481,7 +647,9 @@ static void ccd_mesh_update(Object *ob, ccd_Mesh *pccd_M)
     mima->maxy = max_ff(mima->maxy, v[1] + hull);
     mima->maxz = max_ff(mima->maxz, v[2] + hull);
   }
-  return;
+
+  sb_grid_free(&pccd_M->grid);
+  sb_grid_build(&pccd_M->grid, pccd_M->mima, pccd_M->tri_num, pccd_M->bbmin, pccd_M->bbmax);
 }
 
 static void ccd_mesh_free(ccd_Mesh *ccdm)
@@ -494,6 +662,7 @@ static void ccd_mesh_free(ccd_Mesh *ccdm)
       MEM_freeN((void *)ccdm->mprevvert);
     }
     MEM_freeN(ccdm->mima);
+    sb_grid_free(&ccdm->grid);
     MEM_freeN(ccdm);
     ccdm = NULL;
   }
@@ -1159,7 +1328,8 @@ static int sb_detect_face_collisionCached(float face_v1[3],
   GHashIterator *ihash;
   float nv1[3], nv2[3], nv3[3], edge1[3], edge2[3], d_nvect[3], aabbmin[3], aabbmax[3];
   float t, tune = 10.0f;
-  int a, deflected = 0;
+  int faces_stack[SB_GRID_QUERY_STACK], *faces;
+  int f, faces_len, deflected = 0;
 
   aabbmin[0] = min_fff(face_v1[0], face_v2[0], face_v3[0]);
   aabbmin[1] = min_fff(face_v1[1], face_v2[1], face_v3[1]);
@@ -1187,7 +1357,6 @@ static int sb_detect_face_collisionCached(float face_v1[3],
           vt = ccdm->tri;
           mprevvert = ccdm->mprevvert;
           mima = ccdm->mima;
-          a = ccdm->tri_num;
 
           if ((aabbmax[0] < ccdm->bbmin[0]) || (aabbmax[1] < ccdm->bbmin[1]) ||
               (aabbmax[2] < ccdm->bbmin[2]) || (aabbmin[0] > ccdm->bbmax[0]) ||
@@ -1205,12 +1374,14 @@ static int sb_detect_face_collisionCached(float face_v1[3],
         }
 
         /* use mesh*/
-        while (a--) {
+        faces_len = sb_grid_query(&ccdm->grid, aabbmin, aabbmax, faces_stack, &faces);
+        for (f = 0; f < faces_len; f++) {
+          mima = &ccdm->mima[faces[f]];
+          vt = &ccdm->tri[faces[f]];
+
           if ((aabbmax[0] < mima->minx) || (aabbmin[0] > mima->maxx) ||
               (aabbmax[1] < mima->miny) || (aabbmin[1] > mima->maxy) ||
               (aabbmax[2] < mima->minz) || (aabbmin[2] > mima->maxz)) {
-            mima++;
-            vt++;
             continue;
           }
 
@@ -1244,9 +1415,10 @@ static int sb_detect_face_collisionCached(float face_v1[3],
             *damp = tune * ob->pd->pdef_sbdamp;
             deflected = 2;
           }
-          mima++;
-          vt++;
-        } /* while a */
+        } /* for faces */
+        if (faces != faces_stack) {
+          MEM_freeN(faces);
+        }
       }   /* if (ob->pd && ob->pd->deflect) */
       BLI_ghashIterator_step(ihash);
     }
@@ -1337,7 +1509,8 @@ static int sb_detect_edge_collisionCached(float edge_v1[3],
   GHashIterator *ihash;
   float nv1[3], nv2[3], nv3[3], edge1[3], edge2[3], d_nvect[3], aabbmin[3], aabbmax[3];
   float t, el;
-  int a, deflected = 0;
+  int faces_stack[SB_GRID_QUERY_STACK], *faces;
+  int f, faces_len, deflected = 0;
 
   minmax_v3v3_v3(aabbmin, aabbmax, edge_v1);
   minmax_v3v3_v3(aabbmin, aabbmax, edge_v2);
@@ -1363,7 +1536,6 @@ static int sb_detect_edge_collisionCached(float edge_v1[3],
           mprevvert = ccdm->mprevvert;
           vt = ccdm->tri;
           mima = ccdm->mima;
-          a = ccdm->tri_num;
 
           if ((aabbmax[0] < ccdm->bbmin[0]) || (aabbmax[1] < ccdm->bbmin[1]) ||
               (aabbmax[2] < ccdm->bbmin[2]) || (aabbmin[0] > ccdm->bbmax[0]) ||
@@ -1381,12 +1553,14 @@ static int sb_detect_edge_collisionCached(float edge_v1[3],
         }
 
         /* use mesh*/
-        while (a--) {
+        faces_len = sb_grid_query(&ccdm->grid, aabbmin, aabbmax, faces_stack, &faces);
+        for (f = 0; f < faces_len; f++) {
+          mima = &ccdm->mima[faces[f]];
+          vt = &ccdm->tri[faces[f]];
+
           if ((aabbmax[0] < mima->minx) || (aabbmin[0] > mima->maxx) ||
               (aabbmax[1] < mima->miny) || (aabbmin[1] > mima->maxy) ||
               (aabbmax[2] < mima->minz) || (aabbmin[2] > mima->maxz)) {
-            mima++;
-            vt++;
             continue;
           }
 
@@ -1426,10 +1600,10 @@ static int sb_detect_edge_collisionCached(float edge_v1[3],
             *damp = ob->pd->pdef_sbdamp;
             deflected = 2;
           }
-
-          mima++;
-          vt++;
-        } /* while a */
+        } /* for faces */
+        if (faces != faces_stack) {
+          MEM_freeN(faces);
+        }
       }   /* if (ob->pd && ob->pd->deflect) */
       BLI_ghashIterator_step(ihash);
     }
@@ -1511,12 +1685,19 @@ static void _scan_for_ext_spring_forces(
   }
 }
 
-static void *exec_scan_for_ext_spring_forces(void *data)
+typedef struct SBSpringForcesData {
+  Scene *scene;
+  Object *ob;
+  float timenow;
+  ListBase *effectors;
+} SBSpringForcesData;
+
+static void sb_spring_forces_cb(void *__restrict userdata,
+                                const int a,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
 {
-  SB_thread_context *pctx = (SB_thread_context *)data;
-  _scan_for_ext_spring_forces(
-      pctx->scene, pctx->ob, pctx->timenow, pctx->ifirst, pctx->ilast, pctx->effectors);
-  return NULL;
+  SBSpringForcesData *data = userdata;
+  _scan_for_ext_spring_forces(data->scene, data->ob, data->timenow, a, a + 1, data->effectors);
 }
 
 static void sb_sfesf_threads_run(struct Depsgraph *depsgraph,
@@ -1526,61 +1707,20 @@ static void sb_sfesf_threads_run(struct Depsgraph *depsgraph,
                                  int totsprings,
                                  int *UNUSED(ptr_to_break_func(void)))
 {
-  ListBase threads;
-  SB_thread_context *sb_threads;
-  int i, totthread, left, dec;
-
-  /* wild guess .. may increase with better thread management 'above'
-   * or even be UI option sb->spawn_cf_threads_nopts */
-  int lowsprings = 100;
-
   ListBase *effectors = BKE_effectors_create(depsgraph, ob, NULL, ob->soft->effector_weights);
-
-  /* figure the number of threads while preventing pretty pointless threading overhead */
-  totthread = BKE_scene_num_threads(scene);
-  /* what if we got zillions of CPUs running but less to spread*/
-  while ((totsprings / totthread < lowsprings) && (totthread > 1)) {
-    totthread--;
-  }
-
-  sb_threads = MEM_callocN(sizeof(SB_thread_context) * totthread, "SBSpringsThread");
-  memset(sb_threads, 0, sizeof(SB_thread_context) * totthread);
-  left = totsprings;
-  dec = totsprings / totthread + 1;
-  for (i = 0; i < totthread; i++) {
-    sb_threads[i].scene = scene;
-    sb_threads[i].ob = ob;
-    sb_threads[i].forcetime = 0.0;  // not used here
-    sb_threads[i].timenow = timenow;
-    sb_threads[i].ilast = left;
-    left = left - dec;
-    if (left > 0) {
-      sb_threads[i].ifirst = left;
-    }
-    else {
-      sb_threads[i].ifirst = 0;
-    }
-    sb_threads[i].effectors = effectors;
-    sb_threads[i].do_deflector = false;  // not used here
-    sb_threads[i].fieldfactor = 0.0f;    // not used here
-    sb_threads[i].windfactor = 0.0f;     // not used here
-    sb_threads[i].nr = i;
-    sb_threads[i].tot = totthread;
-  }
-  if (totthread > 1) {
-    BLI_threadpool_init(&threads, exec_scan_for_ext_spring_forces, totthread);
-
-    for (i = 0; i < totthread; i++) {
-      BLI_threadpool_insert(&threads, &sb_threads[i]);
-    }
-
-    BLI_threadpool_end(&threads);
-  }
-  else {
-    exec_scan_for_ext_spring_forces(&sb_threads[0]);
-  }
-  /* clean up */
-  MEM_freeN(sb_threads);
+  SBSpringForcesData data = {
+      .scene = scene,
+      .ob = ob,
+      .timenow = timenow,
+      .effectors = effectors,
+  };
+
+  /* Every spring only writes to itself, so the result doesn't depend on the threads. */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  /* wild guess .. prevents pretty pointless threading overhead */
+  settings.min_iter_per_thread = 100;
+  BLI_task_parallel_range(0, totsprings, &data, sb_spring_forces_cb, &settings);
 
   BKE_effectors_free(effectors);
 }
@@ -1635,7 +1775,8 @@ static int sb_detect_vertex_collisionCached(float opco[3],
       mindistedge = 1000.0f, outerforceaccu[3], innerforceaccu[3], facedist,
       /* n_mag, */ /* UNUSED */ force_mag_norm, minx, miny, minz, maxx, maxy, maxz,
       innerfacethickness = -0.5f, outerfacethickness = 0.2f, ee = 5.0f, ff = 0.1f, fa = 1;
-  int a, deflected = 0, cavel = 0, ci = 0;
+  int faces_stack[SB_GRID_QUERY_STACK], *faces;
+  int f, faces_len, deflected = 0, cavel = 0, ci = 0;
   /* init */
   *intrusion = 0.0f;
   hash = vertexowner->soft->scratch->colliderhash;
@@ -1660,7 +1801,6 @@ static int sb_detect_vertex_collisionCached(float opco[3],
           mprevvert = ccdm->mprevvert;
           vt = ccdm->tri;
           mima = ccdm->mima;
-          a = ccdm->tri_num;
 
           minx = ccdm->bbmin[0];
           miny = ccdm->bbmin[1];
@@ -1693,11 +1833,13 @@ static int sb_detect_vertex_collisionCached(float opco[3],
         fa = 1.0f / fa;
         avel[0] = avel[1] = avel[2] = 0.0f;
         /* use mesh*/
-        while (a--) {
+        faces_len = sb_grid_query(&ccdm->grid, opco, opco, faces_stack, &faces);
+        for (f = 0; f < faces_len; f++) {
+          mima = &ccdm->mima[faces[f]];
+          vt = &ccdm->tri[faces[f]];
+
           if ((opco[0] < mima->minx) || (opco[0] > mima->maxx) || (opco[1] < mima->miny) ||
               (opco[1] > mima->maxy) || (opco[2] < mima->minz) || (opco[2] > mima->maxz)) {
-            mima++;
-            vt++;
             continue;
           }
 
@@ -1768,10 +1910,10 @@ static int sb_detect_vertex_collisionCached(float opco[3],
               ci++;
             }
           }
-
-          mima++;
-          vt++;
-        } /* while a */
+        } /* for faces */
+        if (faces != faces_stack) {
+          MEM_freeN(faces);
+        }
       }   /* if (ob->pd && ob->pd->deflect) */
       BLI_ghashIterator_step(ihash);
     }
@@ -1966,7 +2108,8 @@ static int _softbody_calc_forces_slice_in_a_thread(Scene *scene,
                                                    ListBase *effectors,
                                                    int do_deflector,
                                                    float fieldfactor,
-                                                   float windfactor)
+                                                   float windfactor,
+                                                   const SBGrid *self_grid)
 {
   float iks;
   int bb, do_selfcollision, do_springcollision, do_aero;
@@ -1979,7 +2122,7 @@ static int _softbody_calc_forces_slice_in_a_thread(Scene *scene,
     /* check conditions for various options */
     /* +++ could be done on object level to squeeze out the last bits of it */
     do_selfcollision = ((ob->softflag & OB_SB_EDGES) && (sb->bspring) &&
-                        (ob->softflag & OB_SB_SELF));
+                        (ob->softflag & OB_SB_SELF) && self_grid);
     do_springcollision = do_deflector && (ob->softflag & OB_SB_EDGES) &&
                          (ob->softflag & OB_SB_EDGECOLL);
     do_aero = ((sb->aeroedge) && (ob->softflag & OB_SB_EDGES));
@@ -2012,10 +2155,24 @@ static int _softbody_calc_forces_slice_in_a_thread(Scene *scene,
       float distance;
       float compare;
       float bstune = sb->ballstiff;
+      int balls_stack[SB_GRID_QUERY_STACK], *balls, balls_len;
+      float ballmin[3], ballmax[3];
+      /* Slightly larger, only points found in the grid are checked. */
+      const float ballsize = bp->colball * 1.01f + FLT_EPSILON;
+
+      ballmin[0] = bp->pos[0] - ballsize;
+      ballmin[1] = bp->pos[1] - ballsize;
+      ballmin[2] = bp->pos[2] - ballsize;
+      ballmax[0] = bp->pos[0] + ballsize;
+      ballmax[1] = bp->pos[1] + ballsize;
+      ballmax[2] = bp->pos[2] + ballsize;
+
+      balls_len = sb_grid_query(self_grid, ballmin, ballmax, balls_stack, &balls);
 
       /* Running in a slice we must not assume anything done with obp
        * neither alter the data of obp. */
-      for (c = sb->totpoint, obp = sb->bpoint; c > 0; c--, obp++) {
+      for (c = 0; c < balls_len; c++) {
+        obp = &sb->bpoint[balls[c]];
         compare = (obp->colball + bp->colball);
         sub_v3_v3v3(def, bp->pos, obp->pos);
         /* rather check the AABBoxes before ever calculating the real distance */
@@ -2047,6 +2204,10 @@ static int _softbody_calc_forces_slice_in_a_thread(Scene *scene,
           }
         }
       }
+
+      if (balls != balls_stack) {
+        MEM_freeN(balls);
+      }
     }
     /* naive ball self collision done */
 
@@ -2178,21 +2339,62 @@ static int _softbody_calc_forces_slice_in_a_thread(Scene *scene,
   return 0; /*done fine*/
 }
 
-static void *exec_softbody_calc_forces(void *data)
+/* Grid over the collision balls of the points, for self collision. */
+static void sb_self_grid_build(SoftBody *sb, SBGrid *grid)
 {
-  SB_thread_context *pctx = (SB_thread_context *)data;
-  _softbody_calc_forces_slice_in_a_thread(pctx->scene,
-                                          pctx->ob,
-                                          pctx->forcetime,
-                                          pctx->timenow,
-                                          pctx->ifirst,
-                                          pctx->ilast,
+  ccdf_minmax *balls = MEM_mallocN(sizeof(*balls) * sb->totpoint, __func__);
+  float bbmin[3], bbmax[3];
+  BodyPoint *bp;
+  int a;
+
+  INIT_MINMAX(bbmin, bbmax);
+
+  for (a = 0, bp = sb->bpoint; a < sb->totpoint; a++, bp++) {
+    balls[a].minx = bp->pos[0] - bp->colball;
+    balls[a].miny = bp->pos[1] - bp->colball;
+    balls[a].minz = bp->pos[2] - bp->colball;
+    balls[a].maxx = bp->pos[0] + bp->colball;
+    balls[a].maxy = bp->pos[1] + bp->colball;
+    balls[a].maxz = bp->pos[2] + bp->colball;
+
+    minmax_v3v3_v3(bbmin, bbmax, &balls[a].minx);
+    minmax_v3v3_v3(bbmin, bbmax, &balls[a].maxx);
+  }
+
+  sb_grid_build(grid, balls, sb->totpoint, bbmin, bbmax);
+
+  MEM_freeN(balls);
+}
+
+typedef struct SBCalcForcesData {
+  Scene *scene;
+  Object *ob;
+  float forcetime;
+  float timenow;
+  ListBase *effectors;
+  int do_deflector;
+  float fieldfactor;
+  float windfactor;
+  const SBGrid *self_grid;
+} SBCalcForcesData;
+
+static void sb_calc_forces_cb(void *__restrict userdata,
+                              const int a,
+                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  SBCalcForcesData *data = userdata;
+  _softbody_calc_forces_slice_in_a_thread(data->scene,
+                                          data->ob,
+                                          data->forcetime,
+                                          data->timenow,
+                                          a,
+                                          a + 1,
                                           NULL,
-                                          pctx->effectors,
-                                          pctx->do_deflector,
-                                          pctx->fieldfactor,
-                                          pctx->windfactor);
-  return NULL;
+                                          data->effectors,
+                                          data->do_deflector,
+                                          data->fieldfactor,
+                                          data->windfactor,
+                                          data->self_grid);
 }
 
 static void sb_cf_threads_run(Scene *scene,
@@ -2206,62 +2408,35 @@ static void sb_cf_threads_run(Scene *scene,
                               float fieldfactor,
                               float windfactor)
 {
-  ListBase threads;
-  SB_thread_context *sb_threads;
-  int i, totthread, left, dec;
-
-  /* wild guess .. may increase with better thread management 'above'
-   * or even be UI option sb->spawn_cf_threads_nopts. */
-  int lowpoints = 100;
-
-  /* figure the number of threads while preventing pretty pointless threading overhead */
-  totthread = BKE_scene_num_threads(scene);
-  /* what if we got zillions of CPUs running but less to spread*/
-  while ((totpoint / totthread < lowpoints) && (totthread > 1)) {
-    totthread--;
-  }
-
-  /* printf("sb_cf_threads_run spawning %d threads\n", totthread); */
-
-  sb_threads = MEM_callocN(sizeof(SB_thread_context) * totthread, "SBThread");
-  memset(sb_threads, 0, sizeof(SB_thread_context) * totthread);
-  left = totpoint;
-  dec = totpoint / totthread + 1;
-  for (i = 0; i < totthread; i++) {
-    sb_threads[i].scene = scene;
-    sb_threads[i].ob = ob;
-    sb_threads[i].forcetime = forcetime;
-    sb_threads[i].timenow = timenow;
-    sb_threads[i].ilast = left;
-    left = left - dec;
-    if (left > 0) {
-      sb_threads[i].ifirst = left;
-    }
-    else {
-      sb_threads[i].ifirst = 0;
-    }
-    sb_threads[i].effectors = effectors;
-    sb_threads[i].do_deflector = do_deflector;
-    sb_threads[i].fieldfactor = fieldfactor;
-    sb_threads[i].windfactor = windfactor;
-    sb_threads[i].nr = i;
-    sb_threads[i].tot = totthread;
-  }
-
-  if (totthread > 1) {
-    BLI_threadpool_init(&threads, exec_softbody_calc_forces, totthread);
-
-    for (i = 0; i < totthread; i++) {
-      BLI_threadpool_insert(&threads, &sb_threads[i]);
-    }
-
-    BLI_threadpool_end(&threads);
-  }
-  else {
-    exec_softbody_calc_forces(&sb_threads[0]);
-  }
-  /* clean up */
-  MEM_freeN(sb_threads);
+  SoftBody *sb = ob->soft;
+  SBGrid self_grid = {{0}};
+  const bool do_selfcollision = ((ob->softflag & OB_SB_EDGES) && (sb->bspring) &&
+                                 (ob->softflag & OB_SB_SELF));
+
+  if (do_selfcollision) {
+    sb_self_grid_build(sb, &self_grid);
+  }
+
+  SBCalcForcesData data = {
+      .scene = scene,
+      .ob = ob,
+      .forcetime = forcetime,
+      .timenow = timenow,
+      .effectors = effectors,
+      .do_deflector = do_deflector,
+      .fieldfactor = fieldfactor,
+      .windfactor = windfactor,
+      .self_grid = do_selfcollision ? &self_grid : NULL,
+  };
+
+  /* Every point only writes to itself, so the result doesn't depend on the threads. */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  /* wild guess .. prevents pretty pointless threading overhead */
+  settings.min_iter_per_thread = 100;
+  BLI_task_parallel_range(0, totpoint, &data, sb_calc_forces_cb, &settings);
+
+  sb_grid_free(&self_grid);
 }
 
 static void softbody_calc_forces(
@@ -105,6 +105,17 @@ enum {
 #define BVH_RAYCAST_DEFAULT (BVH_RAYCAST_WATERTIGHT)
 #define BVH_RAYCAST_DIST_MAX (FLT_MAX / 2.0f)
 
+typedef enum eBVHTreeBuildMode {
+  /* Split nodes at the median leaf along their largest axis, fast to build (default). */
+  BVH_BUILD_MEDIAN = 0,
+  /* Split nodes using a binned surface area heuristic, slower to build
+   * but gives faster queries when leafs are not uniformly distributed. */
+  BVH_BUILD_SAH = 1,
+} eBVHTreeBuildMode;
+
+/* Maximum number of points per leaf for #BLI_bvhtree_insert_bulk. */
+#define BVH_BULK_INSERT_POINTS_MAX 4
+
 /* callback must update nearest in case it finds a nearest result */
 typedef void (*BVHTree_NearestPointCallback)(void *userdata,
                                              int index,
@@ -131,6 +142,12 @@ typedef void (*BVHTree_NearestProjectedCallback)(void *userdata,
                                                  const int clip_plane_len,
                                                  BVHTreeNearest *nearest);
 
+/* callback to get the points of a leaf for BLI_bvhtree_insert_bulk,
+ * returns the number of points written (at most #BVH_BULK_INSERT_POINTS_MAX). */
+typedef int (*BVHTree_InsertBulkCallback)(void *userdata,
+                                          int index,
+                                          float r_co[BVH_BULK_INSERT_POINTS_MAX][3]);
+
 /* callbacks to BLI_bvhtree_walk_dfs */
 /* return true to traverse into this nodes children, else skip. */
 typedef bool (*BVHTree_WalkParentCallback)(const BVHTreeAxisRange *bounds, void *userdata);
@@ -143,17 +160,25 @@ typedef bool (*BVHTree_WalkOrderCallback)(const BVHTreeAxisRange *bounds,
                                           char axis,
                                           void *userdata);
 
+BVHTree *BLI_bvhtree_new_ex(
+    int maxsize, float epsilon, char tree_type, char axis, eBVHTreeBuildMode build_mode);
 BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis);
 void BLI_bvhtree_free(BVHTree *tree);
 
 /* construct: first insert points, then call balance */
 void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints);
+void BLI_bvhtree_insert_bulk(BVHTree *tree,
+                             const int *indices,
+                             int indices_len,
+                             BVHTree_InsertBulkCallback callback,
+                             void *userdata);
 void BLI_bvhtree_balance(BVHTree *tree);
 
 /* update: first update points/nodes, then call update_tree to refit the bounding volumes */
 bool BLI_bvhtree_update_node(
     BVHTree *tree, int index, const float co[3], const float co_moving[3], int numpoints);
 void BLI_bvhtree_update_tree(BVHTree *tree);
+float BLI_bvhtree_get_area_ratio(const BVHTree *tree);
 
 int BLI_bvhtree_overlap_thread_num(const BVHTree *tree);
 
@@ -231,6 +256,25 @@ void BLI_bvhtree_ray_cast_all(BVHTree *tree,
                               BVHTree_RayCastCallback callback,
                               void *userdata);
 
+/* Batched versions of the queries above, results are stored per query.
+ * Queries are split between threads. */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree,
+                                    const float (*co)[3],
+                                    int co_len,
+                                    BVHTreeNearest *r_nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    int flag);
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const float (*co)[3],
+                                const float (*dir)[3],
+                                int ray_len,
+                                float radius,
+                                BVHTreeRayHit *r_hit,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag);
+
 float BLI_bvhtree_bb_raycast(const float bv[6],
                              const float light_start[3],
                              const float light_end[3],
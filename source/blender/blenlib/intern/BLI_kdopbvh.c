@@ -102,11 +102,12 @@ struct BVHTree {
   axis_t start_axis, stop_axis; /* bvhtree_kdop_axes array indices according to axis */
   axis_t axis;                  /* kdop type (6 => OBB, 7 => AABB, ...) */
   char tree_type;               /* type of tree (4 => quadtree) */
+  char build_mode;              /* eBVHTreeBuildMode */
 };
 
 /* optimization, ensure we stay small */
-BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 48) ||
-                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 32),
+BLI_STATIC_ASSERT((sizeof(void *) == 8 && sizeof(BVHTree) <= 56) ||
+                      (sizeof(void *) == 4 && sizeof(BVHTree) <= 36),
                   "over sized")
 
 /* avoid duplicating vars in BVHOverlapData_Thread */
@@ -154,6 +155,9 @@ typedef struct BVHRayCastData {
   float idot_axis[13];
   int index[6];
 
+  /** Leaf already tested before the traversal, see #bvhtree_ray_cast (only for #dfs_raycast). */
+  int seed_index;
+
   BVHTreeRayHit hit;
 } BVHRayCastData;
 
@@ -859,6 +863,429 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name SAH Tree Build
+ *
+ * Alternative to the implicit tree (see #BVH_BUILD_SAH): nodes are split using a binned
+ * surface area heuristic, so the tree follows the distribution of the leafs.
+ *
+ * Since the tree isn't balanced anymore, each subtree reserves branches for the worst case
+ * (a binary subtree, so one branch less than its leafs), which lets threads build subtrees
+ * without any synchronization and gives the same tree whatever the scheduling.
+ * Unused branches are skipped when linking the branches to the nodes array,
+ * children still always have an index greater than their parent.
+ * \{ */
+
+#define BVH_SAH_BINS 16
+/* Past this depth nodes are split at the median, to avoid degenerate trees. */
+#define BVH_SAH_DEPTH_MAX 48
+
+typedef struct BVHSahBin {
+  float min[3], max[3];
+  int count;
+} BVHSahBin;
+
+typedef struct BVHSahBuildData {
+  const BVHTree *tree;
+  BVHNode **leafs_array;
+  /* Reserved branches, the root is the first one. */
+  BVHNode *branches_array;
+  /* NULL when building single threaded. */
+  TaskPool *task_pool;
+} BVHSahBuildData;
+
+typedef struct BVHSahTaskData {
+  int branch_index;
+  int leafs_begin, leafs_end;
+  int depth;
+} BVHSahTaskData;
+
+BLI_INLINE float bvh_node_centroid(const BVHNode *node, const int axis)
+{
+  return (node->bv[2 * axis] + node->bv[2 * axis + 1]) * 0.5f;
+}
+
+BLI_INLINE int bvh_sah_bin_index(const float centroid, const float min, const float scale)
+{
+  return min_ii((int)((centroid - min) * scale), BVH_SAH_BINS - 1);
+}
+
+BLI_INLINE void bvh_sah_bounds_add(float min[3],
+                                   float max[3],
+                                   const float bv_min[3],
+                                   const float bv_max[3])
+{
+  for (int axis = 0; axis < 3; axis++) {
+    min[axis] = min_ff(min[axis], bv_min[axis]);
+    max[axis] = max_ff(max[axis], bv_max[axis]);
+  }
+}
+
+/* Half of the surface area, only relative values matter. */
+BLI_INLINE float bvh_sah_bounds_area(const float min[3], const float max[3])
+{
+  float size[3];
+  sub_v3_v3v3(size, max, min);
+  return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+}
+
+static float bvh_sah_leafs_area(BVHNode **leafs_array, const int begin, const int end)
+{
+  float min[3], max[3];
+
+  INIT_MINMAX(min, max);
+  for (int i = begin; i < end; i++) {
+    const BVHNode *leaf = leafs_array[i];
+    const float bv_min[3] = {leaf->bv[0], leaf->bv[2], leaf->bv[4]};
+    const float bv_max[3] = {leaf->bv[1], leaf->bv[3], leaf->bv[5]};
+    bvh_sah_bounds_add(min, max, bv_min, bv_max);
+  }
+  return bvh_sah_bounds_area(min, max);
+}
+
+/**
+ * Split the leafs in two, returns the index of the first leaf of the second part.
+ * \param r_axis: Axis of the split, the first part is on its minimum side.
+ * \param r_area: Surface area of both parts.
+ */
+static int bvh_sah_split(BVHNode **leafs_array,
+                         const int begin,
+                         const int end,
+                         const int depth,
+                         int *r_axis,
+                         float r_area[2])
+{
+  float cent_min[3], cent_max[3];
+  float best_cost = FLT_MAX, best_area[2] = {0.0f, 0.0f};
+  int best_axis = -1, best_bin = 0;
+  int i, axis;
+
+  INIT_MINMAX(cent_min, cent_max);
+  for (i = begin; i < end; i++) {
+    for (axis = 0; axis < 3; axis++) {
+      const float centroid = bvh_node_centroid(leafs_array[i], axis);
+      cent_min[axis] = min_ff(cent_min[axis], centroid);
+      cent_max[axis] = max_ff(cent_max[axis], centroid);
+    }
+  }
+
+  if (depth < BVH_SAH_DEPTH_MAX) {
+    BVHSahBin bins[3][BVH_SAH_BINS];
+    float scale[3];
+
+    /* Fill the bins of all axes at once. */
+    for (axis = 0; axis < 3; axis++) {
+      const float extent = cent_max[axis] - cent_min[axis];
+      scale[axis] = (extent > 0.0f) ? (float)BVH_SAH_BINS / extent : 0.0f;
+      for (int b = 0; b < BVH_SAH_BINS; b++) {
+        INIT_MINMAX(bins[axis][b].min, bins[axis][b].max);
+        bins[axis][b].count = 0;
+      }
+    }
+    for (i = begin; i < end; i++) {
+      const BVHNode *leaf = leafs_array[i];
+      const float bv_min[3] = {leaf->bv[0], leaf->bv[2], leaf->bv[4]};
+      const float bv_max[3] = {leaf->bv[1], leaf->bv[3], leaf->bv[5]};
+
+      for (axis = 0; axis < 3; axis++) {
+        BVHSahBin *bin = &bins[axis][bvh_sah_bin_index(
+            bvh_node_centroid(leaf, axis), cent_min[axis], scale[axis])];
+        bvh_sah_bounds_add(bin->min, bin->max, bv_min, bv_max);
+        bin->count++;
+      }
+    }
+
+    for (axis = 0; axis < 3; axis++) {
+      const BVHSahBin *axis_bins = bins[axis];
+      float right_area[BVH_SAH_BINS];
+      int right_count[BVH_SAH_BINS];
+      float min[3], max[3];
+      int b, count;
+
+      if (scale[axis] == 0.0f) {
+        continue;
+      }
+
+      /* Area and leafs count of the right part of every split. */
+      INIT_MINMAX(min, max);
+      for (b = BVH_SAH_BINS - 1, count = 0; b > 0; b--) {
+        if (axis_bins[b].count) {
+          bvh_sah_bounds_add(min, max, axis_bins[b].min, axis_bins[b].max);
+          count += axis_bins[b].count;
+        }
+        right_count[b] = count;
+        right_area[b] = count ? bvh_sah_bounds_area(min, max) : 0.0f;
+      }
+
+      /* Add the cost of the left part, split is between `b` and `b + 1`. */
+      INIT_MINMAX(min, max);
+      for (b = 0, count = 0; b < BVH_SAH_BINS - 1; b++) {
+        if (axis_bins[b].count) {
+          bvh_sah_bounds_add(min, max, axis_bins[b].min, axis_bins[b].max);
+          count += axis_bins[b].count;
+        }
+        if (count == 0 || right_count[b + 1] == 0) {
+          continue;
+        }
+        const float left_area = bvh_sah_bounds_area(min, max);
+        const float cost = left_area * (float)count +
+                           right_area[b + 1] * (float)right_count[b + 1];
+        if (cost < best_cost) {
+          best_cost = cost;
+          best_area[0] = left_area;
+          best_area[1] = right_area[b + 1];
+          best_axis = axis;
+          best_bin = b;
+        }
+      }
+    }
+  }
+
+  if (best_axis != -1) {
+    const float scale = (float)BVH_SAH_BINS / (cent_max[best_axis] - cent_min[best_axis]);
+    int lo = begin, hi = end - 1;
+
+    while (lo <= hi) {
+      const int bin = bvh_sah_bin_index(
+          bvh_node_centroid(leafs_array[lo], best_axis), cent_min[best_axis], scale);
+      if (bin <= best_bin) {
+        lo++;
+      }
+      else {
+        SWAP(BVHNode *, leafs_array[lo], leafs_array[hi]);
+        hi--;
+      }
+    }
+
+    *r_axis = best_axis;
+    copy_v2_v2(r_area, best_area);
+    return lo;
+  }
+
+  /* All the centroids are at the same place (or the tree is too deep), split at the median. */
+  axis = 0;
+  for (i = 1; i < 3; i++) {
+    if (cent_max[i] - cent_min[i] > cent_max[axis] - cent_min[axis]) {
+      axis = i;
+    }
+  }
+  const int mid = (begin + end) / 2;
+  partition_nth_element(leafs_array, begin, end, mid, axis * 2 + 1);
+
+  *r_axis = axis;
+  r_area[0] = bvh_sah_leafs_area(leafs_array, begin, mid);
+  r_area[1] = bvh_sah_leafs_area(leafs_array, mid, end);
+  return mid;
+}
+
+/**
+ * Sort the children by the average centroid of their leafs along \a axis.
+ */
+static void bvh_sah_sort_children(BVHNode **leafs_array,
+                                  int (*children_ranges)[2],
+                                  const int children_len,
+                                  const int axis)
+{
+  float keys[MAX_TREETYPE];
+  int i, j;
+
+  for (i = 0; i < children_len; i++) {
+    float sum = 0.0f;
+    for (j = children_ranges[i][0]; j < children_ranges[i][1]; j++) {
+      sum += bvh_node_centroid(leafs_array[j], axis);
+    }
+    keys[i] = sum / (float)(children_ranges[i][1] - children_ranges[i][0]);
+  }
+
+  /* Insertion sort, there are only a few children. */
+  for (i = 1; i < children_len; i++) {
+    const float key = keys[i];
+    const int range[2] = {children_ranges[i][0], children_ranges[i][1]};
+    for (j = i; (j > 0) && (key < keys[j - 1]); j--) {
+      keys[j] = keys[j - 1];
+      children_ranges[j][0] = children_ranges[j - 1][0];
+      children_ranges[j][1] = children_ranges[j - 1][1];
+    }
+    keys[j] = key;
+    children_ranges[j][0] = range[0];
+    children_ranges[j][1] = range[1];
+  }
+}
+
+static void bvh_sah_build_task(TaskPool *__restrict pool, void *taskdata, int threadid);
+
+static void bvh_sah_build_node(const BVHSahBuildData *data,
+                               const int branch_index,
+                               const int leafs_begin,
+                               const int leafs_end,
+                               const int depth,
+                               const int thread_id)
+{
+  const BVHTree *tree = data->tree;
+  BVHNode *node = &data->branches_array[branch_index];
+  /* Leafs of the children, split in order. */
+  int ranges[MAX_TREETYPE + 1];
+  float ranges_area[MAX_TREETYPE];
+  /* Leafs of child `k` are in the range [children_ranges[k][0], children_ranges[k][1]). */
+  int children_ranges[MAX_TREETYPE][2];
+  int ranges_len = 1;
+  int branch_next = branch_index + 1;
+  int k;
+
+  refit_kdop_hull(tree, node, leafs_begin, leafs_end);
+  node->main_axis = get_largest_axis(node->bv) / 2;
+
+  if (leafs_begin == leafs_end) {
+    node->totnode = 0;
+    return;
+  }
+
+  /* Split the largest child until all children are used. */
+  ranges[0] = leafs_begin;
+  ranges[1] = leafs_end;
+  {
+    const float bv_min[3] = {node->bv[0], node->bv[2], node->bv[4]};
+    const float bv_max[3] = {node->bv[1], node->bv[3], node->bv[5]};
+    ranges_area[0] = bvh_sah_bounds_area(bv_min, bv_max);
+  }
+  while (ranges_len < tree->tree_type) {
+    float split_area = -1.0f, area[2];
+    int k_split = -1, axis;
+
+    for (k = 0; k < ranges_len; k++) {
+      if ((ranges[k + 1] - ranges[k] > 1) && (ranges_area[k] > split_area)) {
+        split_area = ranges_area[k];
+        k_split = k;
+      }
+    }
+    if (k_split == -1) {
+      break;
+    }
+
+    const int split = bvh_sah_split(
+        data->leafs_array, ranges[k_split], ranges[k_split + 1], depth, &axis, area);
+    if (ranges_len == 1) {
+      /* Children are ordered along the first split. */
+      node->main_axis = (char)axis;
+    }
+
+    memmove(&ranges[k_split + 2],
+            &ranges[k_split + 1],
+            sizeof(*ranges) * (size_t)(ranges_len - k_split));
+    memmove(&ranges_area[k_split + 2],
+            &ranges_area[k_split + 1],
+            sizeof(*ranges_area) * (size_t)(ranges_len - k_split - 1));
+    ranges[k_split + 1] = split;
+    ranges_area[k_split] = area[0];
+    ranges_area[k_split + 1] = area[1];
+    ranges_len++;
+  }
+
+  for (k = 0; k < ranges_len; k++) {
+    children_ranges[k][0] = ranges[k];
+    children_ranges[k][1] = ranges[k + 1];
+  }
+
+  /* Traversal expects children to be sorted along the main axis,
+   * which isn't the case when children were split along other axes. */
+  if (ranges_len > 2) {
+    bvh_sah_sort_children(data->leafs_array, children_ranges, ranges_len, node->main_axis);
+  }
+
+  for (k = 0; k < ranges_len; k++) {
+    const int child_leafs_begin = children_ranges[k][0];
+    const int child_leafs_end = children_ranges[k][1];
+    const int child_leafs_len = child_leafs_end - child_leafs_begin;
+    BVHNode *child;
+
+    if (child_leafs_len == 1) {
+      child = data->leafs_array[child_leafs_begin];
+    }
+    else {
+      child = &data->branches_array[branch_next];
+    }
+    child->parent = node;
+    node->children[k] = child;
+
+    if (child_leafs_len > 1) {
+      if (data->task_pool && (child_leafs_len > KDOPBVH_THREAD_LEAF_THRESHOLD)) {
+        BVHSahTaskData *task_data = MEM_mallocN(sizeof(*task_data), __func__);
+        task_data->branch_index = branch_next;
+        task_data->leafs_begin = child_leafs_begin;
+        task_data->leafs_end = child_leafs_end;
+        task_data->depth = depth + 1;
+        BLI_task_pool_push_from_thread(
+            data->task_pool, bvh_sah_build_task, task_data, true, TASK_PRIORITY_HIGH, thread_id);
+      }
+      else {
+        bvh_sah_build_node(
+            data, branch_next, child_leafs_begin, child_leafs_end, depth + 1, thread_id);
+      }
+      branch_next += child_leafs_len - 1;
+    }
+  }
+  node->totnode = (char)ranges_len;
+}
+
+static void bvh_sah_build_task(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+  const BVHSahBuildData *data = BLI_task_pool_userdata(pool);
+  const BVHSahTaskData *task_data = taskdata;
+
+  bvh_sah_build_node(data,
+                     task_data->branch_index,
+                     task_data->leafs_begin,
+                     task_data->leafs_end,
+                     task_data->depth,
+                     threadid);
+}
+
+/**
+ * Build the branches of the tree with SAH splits, and link them to the nodes array.
+ */
+static void bvh_sah_build(BVHTree *tree)
+{
+  /* Worst case is a binary tree. */
+  const int branches_reserved = implicit_needed_branches(2, tree->totleaf);
+  BVHSahBuildData data = {
+      .tree = tree,
+      .leafs_array = tree->nodes,
+      .branches_array = tree->nodearray + tree->totleaf,
+      .task_pool = NULL,
+  };
+
+  data.branches_array[0].parent = NULL;
+
+  if (tree->totleaf > KDOPBVH_THREAD_LEAF_THRESHOLD) {
+    TaskScheduler *scheduler = BLI_task_scheduler_get();
+    BVHSahTaskData *task_data = MEM_mallocN(sizeof(*task_data), __func__);
+
+    task_data->branch_index = 0;
+    task_data->leafs_begin = 0;
+    task_data->leafs_end = tree->totleaf;
+    task_data->depth = 0;
+
+    data.task_pool = BLI_task_pool_create(scheduler, &data);
+    BLI_task_pool_push(data.task_pool, bvh_sah_build_task, task_data, true, TASK_PRIORITY_HIGH);
+    BLI_task_pool_work_and_wait(data.task_pool);
+    BLI_task_pool_free(data.task_pool);
+  }
+  else {
+    bvh_sah_build_node(&data, 0, 0, tree->totleaf, 0, -1);
+  }
+
+  /* Link the used branches (the root is always used). */
+  tree->totbranch = 0;
+  for (int i = 0; i < branches_reserved; i++) {
+    if (i == 0 || data.branches_array[i].totnode != 0) {
+      tree->nodes[tree->totleaf + tree->totbranch] = &data.branches_array[i];
+      tree->totbranch++;
+    }
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree API
  * \{ */
@@ -866,7 +1293,8 @@ static void non_recursive_bvh_div_nodes(const BVHTree *tree,
 /**
  * \note many callers don't check for ``NULL`` return.
  */
-BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis)
+BVHTree *BLI_bvhtree_new_ex(
+    int maxsize, float epsilon, char tree_type, char axis, eBVHTreeBuildMode build_mode)
 {
   BVHTree *tree;
   int numnodes, i;
@@ -885,6 +1313,7 @@ BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis)
     tree->epsilon = epsilon;
     tree->tree_type = tree_type;
     tree->axis = axis;
+    tree->build_mode = (char)build_mode;
 
     if (axis == 26) {
       tree->start_axis = 0;
@@ -913,8 +1342,11 @@ BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis)
       goto fail;
     }
 
-    /* Allocate arrays */
-    numnodes = maxsize + implicit_needed_branches(tree_type, maxsize) + tree_type;
+    /* Allocate arrays, SAH trees are not balanced so they may need as many branches
+     * as a binary tree. */
+    numnodes = maxsize +
+               implicit_needed_branches((build_mode == BVH_BUILD_SAH) ? 2 : tree_type, maxsize) +
+               tree_type;
 
     tree->nodes = MEM_callocN(sizeof(BVHNode *) * (size_t)numnodes, "BVHNodes");
     tree->nodebv = MEM_callocN(sizeof(float) * (size_t)(axis * numnodes), "BVHNodeBV");
@@ -938,6 +1370,11 @@ fail:
   return NULL;
 }
 
+BVHTree *BLI_bvhtree_new(int maxsize, float epsilon, char tree_type, char axis)
+{
+  return BLI_bvhtree_new_ex(maxsize, epsilon, tree_type, axis, BVH_BUILD_MEDIAN);
+}
+
 void BLI_bvhtree_free(BVHTree *tree)
 {
   if (tree) {
@@ -957,15 +1394,21 @@ void BLI_bvhtree_balance(BVHTree *tree)
    * (some big bug goes here if its being called more than once per tree) */
   BLI_assert(tree->totbranch == 0);
 
-  /* Build the implicit tree */
-  non_recursive_bvh_div_nodes(
-      tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
+  /* SAH splits use the x/y/z axes, which are not part of all k-DOP's. */
+  if ((tree->build_mode == BVH_BUILD_SAH) && (tree->start_axis == 0)) {
+    bvh_sah_build(tree);
+  }
+  else {
+    /* Build the implicit tree */
+    non_recursive_bvh_div_nodes(
+        tree, tree->nodearray + (tree->totleaf - 1), leafs_array, tree->totleaf);
 
-  /* current code expects the branches to be linked to the nodes array
-   * we perform that linkage here */
-  tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
-  for (int i = 0; i < tree->totbranch; i++) {
-    tree->nodes[tree->totleaf + i] = &tree->nodearray[tree->totleaf + i];
+    /* current code expects the branches to be linked to the nodes array
+     * we perform that linkage here */
+    tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
+    for (int i = 0; i < tree->totbranch; i++) {
+      tree->nodes[tree->totleaf + i] = &tree->nodearray[tree->totleaf + i];
+    }
   }
 
 #ifdef USE_SKIP_LINKS
@@ -981,17 +1424,11 @@ void BLI_bvhtree_balance(BVHTree *tree)
 #endif
 }
 
-void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints)
+static void bvhtree_insert_leaf(
+    BVHTree *tree, const int leaf_index, int index, const float co[3], int numpoints)
 {
   axis_t axis_iter;
-  BVHNode *node = NULL;
-
-  /* insert should only possible as long as tree->totbranch is 0 */
-  BLI_assert(tree->totbranch <= 0);
-  BLI_assert((size_t)tree->totleaf < MEM_allocN_len(tree->nodes) / sizeof(*(tree->nodes)));
-
-  node = tree->nodes[tree->totleaf] = &(tree->nodearray[tree->totleaf]);
-  tree->totleaf++;
+  BVHNode *node = tree->nodes[leaf_index] = &(tree->nodearray[leaf_index]);
 
   create_kdop_hull(tree, node, co, numpoints, 0);
   node->index = index;
@@ -1003,6 +1440,68 @@ void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoin
   }
 }
 
+void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints)
+{
+  /* insert should only possible as long as tree->totbranch is 0 */
+  BLI_assert(tree->totbranch <= 0);
+  BLI_assert((size_t)tree->totleaf < MEM_allocN_len(tree->nodes) / sizeof(*(tree->nodes)));
+
+  bvhtree_insert_leaf(tree, tree->totleaf, index, co, numpoints);
+  tree->totleaf++;
+}
+
+typedef struct BVHInsertBulkData {
+  BVHTree *tree;
+  const int *indices;
+  BVHTree_InsertBulkCallback callback;
+  void *userdata;
+} BVHInsertBulkData;
+
+static void bvhtree_insert_bulk_task_cb(void *__restrict userdata,
+                                        const int i,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHInsertBulkData *data = userdata;
+  const int index = data->indices ? data->indices[i] : i;
+  float co[BVH_BULK_INSERT_POINTS_MAX][3];
+
+  const int numpoints = data->callback(data->userdata, index, co);
+  BLI_assert(numpoints > 0 && numpoints <= BVH_BULK_INSERT_POINTS_MAX);
+
+  bvhtree_insert_leaf(data->tree, data->tree->totleaf + i, index, co[0], numpoints);
+}
+
+/**
+ * Insert many leafs at once, the same as calling #BLI_bvhtree_insert for each of the \a indices
+ * (or from 0 to \a indices_len when NULL), but leafs are computed in parallel.
+ *
+ * \param callback: Fills in the points of a leaf, must be thread-safe.
+ */
+void BLI_bvhtree_insert_bulk(BVHTree *tree,
+                             const int *indices,
+                             int indices_len,
+                             BVHTree_InsertBulkCallback callback,
+                             void *userdata)
+{
+  BLI_assert(tree->totbranch <= 0);
+  BLI_assert((size_t)(tree->totleaf + indices_len) <=
+             MEM_allocN_len(tree->nodes) / sizeof(*(tree->nodes)));
+
+  BVHInsertBulkData data = {
+      .tree = tree,
+      .indices = indices,
+      .callback = callback,
+      .userdata = userdata,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (indices_len > KDOPBVH_THREAD_LEAF_THRESHOLD);
+  BLI_task_parallel_range(0, indices_len, &data, bvhtree_insert_bulk_task_cb, &settings);
+
+  tree->totleaf += indices_len;
+}
+
 /* call before BLI_bvhtree_update_tree() */
 bool BLI_bvhtree_update_node(
     BVHTree *tree, int index, const float co[3], const float co_moving[3], int numpoints)
@@ -1032,19 +1531,126 @@ bool BLI_bvhtree_update_node(
   return true;
 }
 
+/* Minimum number of sub-trees refitted in parallel by #BLI_bvhtree_update_tree. */
+#define BVH_UPDATE_TASKS_MIN 64
+
+typedef struct BVHUpdateTreeData {
+  BVHTree *tree;
+  BVHNode **branches;
+} BVHUpdateTreeData;
+
+static void node_join_recursive(BVHTree *tree, BVHNode *node)
+{
+  for (int i = 0; i < node->totnode; i++) {
+    if (node->children[i]->totnode != 0) {
+      node_join_recursive(tree, node->children[i]);
+    }
+  }
+  node_join(tree, node);
+}
+
+static void bvhtree_update_tree_task_cb(void *__restrict userdata,
+                                        const int i,
+                                        const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHUpdateTreeData *data = userdata;
+  node_join_recursive(data->tree, data->branches[i]);
+}
+
 /* call BLI_bvhtree_update_node() first for every node/point/triangle */
 void BLI_bvhtree_update_tree(BVHTree *tree)
 {
-  /* Update bottom=>top
-   * TRICKY: the way we build the tree all the childs have an index greater than the parent
-   * This allows us todo a bottom up update by starting on the bigger numbered branch */
+  if (tree->totleaf <= KDOPBVH_THREAD_LEAF_THRESHOLD) {
+    /* Update bottom=>top
+     * TRICKY: the way we build the tree all the childs have an index greater than the parent
+     * This allows us todo a bottom up update by starting on the bigger numbered branch */
+
+    BVHNode **root = tree->nodes + tree->totleaf;
+    BVHNode **index = tree->nodes + tree->totleaf + tree->totbranch - 1;
+
+    for (; index >= root; index--) {
+      node_join(tree, *index);
+    }
+    return;
+  }
+
+  /* Gather branches breadth first until there are enough sub-trees to refit them in parallel,
+   * the branches above them are joined afterwards, in reverse order so children come first. */
+  BVHNode **branches = MEM_mallocN(sizeof(*branches) * (size_t)tree->totbranch, __func__);
+  int level_begin = 0, level_end = 1;
 
-  BVHNode **root = tree->nodes + tree->totleaf;
-  BVHNode **index = tree->nodes + tree->totleaf + tree->totbranch - 1;
+  branches[0] = tree->nodes[tree->totleaf];
+  while ((level_end - level_begin) < BVH_UPDATE_TASKS_MIN) {
+    int next_end = level_end;
+    for (int i = level_begin; i < level_end; i++) {
+      BVHNode *node = branches[i];
+      for (int j = 0; j < node->totnode; j++) {
+        if (node->children[j]->totnode != 0) {
+          branches[next_end++] = node->children[j];
+        }
+      }
+    }
+    if (next_end == level_end) {
+      /* Only leafs below this level. */
+      break;
+    }
+    level_begin = level_end;
+    level_end = next_end;
+  }
+
+  BVHUpdateTreeData data = {
+      .tree = tree,
+      .branches = branches,
+  };
 
-  for (; index >= root; index--) {
-    node_join(tree, *index);
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(level_begin, level_end, &data, bvhtree_update_tree_task_cb, &settings);
+
+  for (int i = level_begin - 1; i >= 0; i--) {
+    node_join(tree, branches[i]);
   }
+
+  MEM_freeN(branches);
+}
+
+/**
+ * Sum of the surface area of all branches bounds, relative to the area of the root bounds.
+ *
+ * This is a measure of the cost of traversing the tree, as used by the SAH build.
+ * It grows when the bounds of a refitted tree start to overlap, comparing it with its value
+ * right after the build is a way to decide when to rebuild a tree instead of updating it.
+ *
+ * \note Only the first 3 axes of the k-DOP are used (the x/y/z axes for most tree types).
+ */
+float BLI_bvhtree_get_area_ratio(const BVHTree *tree)
+{
+  if (tree->totbranch == 0) {
+    return 0.0f;
+  }
+
+  const int axis_offset = 2 * tree->start_axis;
+  float bv_min[3], bv_max[3];
+  float area = 0.0f;
+
+  for (int i = 0; i < tree->totbranch; i++) {
+    const float *bv = tree->nodes[tree->totleaf + i]->bv + axis_offset;
+    for (int axis = 0; axis < 3; axis++) {
+      bv_min[axis] = bv[2 * axis];
+      bv_max[axis] = bv[2 * axis + 1];
+    }
+    area += bvh_sah_bounds_area(bv_min, bv_max);
+  }
+
+  const float *bv = tree->nodes[tree->totleaf]->bv + axis_offset;
+  for (int axis = 0; axis < 3; axis++) {
+    bv_min[axis] = bv[2 * axis];
+    bv_max[axis] = bv[2 * axis + 1];
+  }
+  const float root_area = bvh_sah_bounds_area(bv_min, bv_max);
+
+  return (root_area > FLT_EPSILON) ? area / root_area : 0.0f;
 }
 /**
  * Number of times #BLI_bvhtree_insert has been called.
@@ -1752,7 +2358,9 @@ static void dfs_raycast(BVHRayCastData *data, BVHNode *node)
 
   if (node->totnode == 0) {
     if (data->callback) {
-      data->callback(data->userdata, node->index, &data->ray, &data->hit);
+      if (node->index != data->seed_index) {
+        data->callback(data->userdata, node->index, &data->ray, &data->hit);
+      }
     }
     else {
       data->hit.index = node->index;
@@ -1848,14 +2456,20 @@ static void bvhtree_ray_cast_data_precalc(BVHRayCastData *data, int flag)
 #endif
 }
 
-int BLI_bvhtree_ray_cast_ex(BVHTree *tree,
+/**
+ * \param seed_index: Primitive to test before traversing the tree (-1 to skip),
+ * a hit with it narrows down the traversal for coherent rays.
+ * The callback runs once for it, the traversal skips it.
+ */
+static int bvhtree_ray_cast(BVHTree *tree,
                             const float co[3],
                             const float dir[3],
                             float radius,
                             BVHTreeRayHit *hit,
                             BVHTree_RayCastCallback callback,
                             void *userdata,
-                            int flag)
+                            int flag,
+                            int seed_index)
 {
   BVHRayCastData data;
   BVHNode *root = tree->nodes[tree->totleaf];
@@ -1866,6 +2480,7 @@ int BLI_bvhtree_ray_cast_ex(BVHTree *tree,
 
   data.callback = callback;
   data.userdata = userdata;
+  data.seed_index = callback ? seed_index : -1;
 
   copy_v3_v3(data.ray.origin, co);
   copy_v3_v3(data.ray.direction, dir);
@@ -1882,6 +2497,9 @@ int BLI_bvhtree_ray_cast_ex(BVHTree *tree,
   }
 
   if (root) {
+    if (data.seed_index != -1) {
+      callback(userdata, seed_index, &data.ray, &data.hit);
+    }
     dfs_raycast(&data, root);
     //      iterative_raycast(&data, root);
   }
@@ -1893,6 +2511,18 @@ int BLI_bvhtree_ray_cast_ex(BVHTree *tree,
   return data.hit.index;
 }
 
+int BLI_bvhtree_ray_cast_ex(BVHTree *tree,
+                            const float co[3],
+                            const float dir[3],
+                            float radius,
+                            BVHTreeRayHit *hit,
+                            BVHTree_RayCastCallback callback,
+                            void *userdata,
+                            int flag)
+{
+  return bvhtree_ray_cast(tree, co, dir, radius, hit, callback, userdata, flag, -1);
+}
+
 int BLI_bvhtree_ray_cast(BVHTree *tree,
                          const float co[3],
                          const float dir[3],
@@ -1989,6 +2619,170 @@ void BLI_bvhtree_ray_cast_all(BVHTree *tree,
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name BLI_bvhtree_find_nearest_batch / BLI_bvhtree_ray_cast_batch
+ *
+ * Queries are split into chunks of a fixed size which are handled by threads,
+ * so the results do not depend on the number of threads.
+ * Inside of a chunk every query is narrowed down using result of the previous one.
+ * \{ */
+
+#define BVH_BATCH_CHUNK_SIZE 64
+/* Don't use threading for small batches. */
+#define BVH_BATCH_THREAD_LIMIT 1024
+
+typedef struct BVHNearestBatchData {
+  BVHTree *tree;
+  const float (*co)[3];
+  int co_len;
+  BVHTreeNearest *nearest;
+  BVHTree_NearestPointCallback callback;
+  void *userdata;
+  int flag;
+} BVHNearestBatchData;
+
+typedef struct BVHRayCastBatchData {
+  BVHTree *tree;
+  const float (*co)[3];
+  const float (*dir)[3];
+  int ray_len;
+  float radius;
+  BVHTreeRayHit *hit;
+  BVHTree_RayCastCallback callback;
+  void *userdata;
+  int flag;
+} BVHRayCastBatchData;
+
+static void bvhtree_batch_run(int len, void *userdata, TaskParallelRangeFunc func)
+{
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (len > BVH_BATCH_THREAD_LIMIT);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(
+      0, (len + BVH_BATCH_CHUNK_SIZE - 1) / BVH_BATCH_CHUNK_SIZE, userdata, func, &settings);
+}
+
+static void bvhtree_find_nearest_batch_task_cb(void *__restrict userdata,
+                                               const int chunk,
+                                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHNearestBatchData *data = userdata;
+  const int start = chunk * BVH_BATCH_CHUNK_SIZE;
+  const int end = min_ii(start + BVH_BATCH_CHUNK_SIZE, data->co_len);
+  const BVHTreeNearest *nearest_prev = NULL;
+
+  for (int i = start; i < end; i++) {
+    BVHTreeNearest *nearest = &data->nearest[i];
+    /* Use local proximity heuristics: previous hit is likely to be close to the current one,
+     * distance to it is an upper bound of the search radius. */
+    if (nearest_prev) {
+      const float dist_sq = len_squared_v3v3(data->co[i], nearest_prev->co);
+      if (dist_sq < nearest->dist_sq) {
+        nearest->index = nearest_prev->index;
+        copy_v3_v3(nearest->co, nearest_prev->co);
+        copy_v3_v3(nearest->no, nearest_prev->no);
+        nearest->dist_sq = dist_sq;
+      }
+    }
+    BLI_bvhtree_find_nearest_ex(
+        data->tree, data->co[i], nearest, data->callback, data->userdata, data->flag);
+    if (nearest->index != -1) {
+      nearest_prev = nearest;
+    }
+  }
+}
+
+/**
+ * Find nearest node for every coordinate, see #BLI_bvhtree_find_nearest_ex.
+ *
+ * \param r_nearest: Array of \a co_len items, the search radius of each query is read from it,
+ * so initialize `index` to -1 and `dist_sq` to the squared radius (or FLT_MAX).
+ *
+ * \note Callback is called from multiple threads, coordinates which are close in the array
+ * are expected to be close in space for the best performance.
+ */
+void BLI_bvhtree_find_nearest_batch(BVHTree *tree,
+                                    const float (*co)[3],
+                                    int co_len,
+                                    BVHTreeNearest *r_nearest,
+                                    BVHTree_NearestPointCallback callback,
+                                    void *userdata,
+                                    int flag)
+{
+  BVHNearestBatchData data = {
+      .tree = tree,
+      .co = co,
+      .co_len = co_len,
+      .nearest = r_nearest,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+  bvhtree_batch_run(co_len, &data, bvhtree_find_nearest_batch_task_cb);
+}
+
+static void bvhtree_ray_cast_batch_task_cb(void *__restrict userdata,
+                                           const int chunk,
+                                           const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const BVHRayCastBatchData *data = userdata;
+  const int start = chunk * BVH_BATCH_CHUNK_SIZE;
+  const int end = min_ii(start + BVH_BATCH_CHUNK_SIZE, data->ray_len);
+  int index_prev = -1;
+
+  for (int i = start; i < end; i++) {
+    /* Coherent rays are likely to hit the same primitive. */
+    const int index = bvhtree_ray_cast(data->tree,
+                                       data->co[i],
+                                       data->dir[i],
+                                       data->radius,
+                                       &data->hit[i],
+                                       data->callback,
+                                       data->userdata,
+                                       data->flag,
+                                       index_prev);
+    if (index != -1) {
+      index_prev = index;
+    }
+  }
+}
+
+/**
+ * Cast a ray for every origin and direction, see #BLI_bvhtree_ray_cast_ex.
+ *
+ * \param r_hit: Array of \a ray_len items, the maximum distance of each ray is read from it,
+ * so initialize `index` to -1 and `dist` to the maximum distance (or #BVH_RAYCAST_DIST_MAX).
+ *
+ * \note Callback is called from multiple threads, rays which are close in the array
+ * are expected to be coherent for the best performance.
+ */
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree,
+                                const float (*co)[3],
+                                const float (*dir)[3],
+                                int ray_len,
+                                float radius,
+                                BVHTreeRayHit *r_hit,
+                                BVHTree_RayCastCallback callback,
+                                void *userdata,
+                                int flag)
+{
+  BVHRayCastBatchData data = {
+      .tree = tree,
+      .co = co,
+      .dir = dir,
+      .ray_len = ray_len,
+      .radius = radius,
+      .hit = r_hit,
+      .callback = callback,
+      .userdata = userdata,
+      .flag = flag,
+  };
+  bvhtree_batch_run(ray_len, &data, bvhtree_ray_cast_batch_task_cb);
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name BLI_bvhtree_range_query
  *
@@ -0,0 +1,270 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ *
+ * Read-only memory mapping of files.
+ *
+ * Reading from the mapping avoids a system call for every read and lets callers access data
+ * in place, it doesn't avoid copying data that has to outlive the mapping.
+ *
+ * \note Truncating a file while it's mapped, or an I/O error while paging it in, causes the
+ * access to fault (`SIGBUS` on POSIX, `EXCEPTION_IN_PAGE_ERROR` on Windows).
+ * These faults are caught, see #BLI_mmap_any_io_error.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BLI_listbase.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "BLI_mmap.h" /* own include */
+
+#include "MEM_guardedalloc.h"
+
+#ifdef WIN32
+#  include <io.h>
+#  include <windows.h>
+#else
+#  include <signal.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+#include "BLI_strict_flags.h" /* keep last */
+
+struct BLI_mmap_file {
+  /* The address to which the file was mapped. */
+  char *memory;
+
+  /* The length of the file (and therefore the mapped region). */
+  size_t length;
+
+  /* Set when reading part of the mapping failed, its contents are zeroed from then on. */
+  volatile bool io_error;
+};
+
+#ifndef WIN32
+/* When using memory-mapped files, any I/O errors result in a SIGBUS signal.
+ * Keep a list of all open mappings, and when a SIGBUS is caught for an address inside one of
+ * them, flag the error and remap the region to zeroed memory so the read can continue.
+ * Callers check #BLI_mmap_any_io_error after reading.
+ * Errors outside of the mapped regions are passed on to the previous handler (if any).
+ *
+ * Files may be opened, read and closed from multiple threads at once,
+ * #error_handler_lock guards the list and the handler setup. It's never held while reading
+ * from a mapping, so a thread faulting in the handler can't be the one holding it. */
+
+static struct error_handler_data {
+  ListBase open_mmaps;
+  bool configured;
+  struct sigaction next_action;
+} error_handler;
+
+static ThreadMutex error_handler_lock = BLI_MUTEX_INITIALIZER;
+
+static void sigbus_handler(int sig, siginfo_t *siginfo, void *ptr)
+{
+  BLI_assert(sig == SIGBUS);
+
+  char *error_addr = (char *)siginfo->si_addr;
+  bool handled = false;
+  BLI_mutex_lock(&error_handler_lock);
+  LISTBASE_FOREACH (LinkData *, link, &error_handler.open_mmaps) {
+    BLI_mmap_file *file = link->data;
+    if (error_addr >= file->memory && error_addr < file->memory + file->length) {
+      file->io_error = true;
+
+      /* Replace the mapped memory with zeroes. */
+      const void *mapped_memory = mmap(
+          file->memory, file->length, PROT_READ, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (mapped_memory == MAP_FAILED) {
+        fprintf(stderr, "SIGBUS handler: Error replacing mapped file with zeros\n");
+      }
+      handled = true;
+      break;
+    }
+  }
+  BLI_mutex_unlock(&error_handler_lock);
+
+  if (handled) {
+    return;
+  }
+
+  /* Fall back to the previous handler. */
+  const struct sigaction *next = &error_handler.next_action;
+  if (next->sa_flags & SA_SIGINFO) {
+    next->sa_sigaction(sig, siginfo, ptr);
+  }
+  else if (!ELEM(next->sa_handler, SIG_DFL, SIG_IGN)) {
+    next->sa_handler(sig);
+  }
+  else {
+    fprintf(stderr, "Unhandled SIGBUS caught\n");
+    abort();
+  }
+}
+
+/* Ensures that the error handler is set up. */
+static bool sigbus_handler_setup(void)
+{
+  BLI_mutex_lock(&error_handler_lock);
+  if (!error_handler.configured) {
+    struct sigaction newact;
+    memset(&newact, 0, sizeof(newact));
+    newact.sa_sigaction = sigbus_handler;
+    newact.sa_flags = SA_SIGINFO;
+    sigemptyset(&newact.sa_mask);
+
+    if (sigaction(SIGBUS, &newact, &error_handler.next_action) == 0) {
+      error_handler.configured = true;
+    }
+  }
+  const bool configured = error_handler.configured;
+  BLI_mutex_unlock(&error_handler_lock);
+  return configured;
+}
+
+static void sigbus_handler_add(BLI_mmap_file *file)
+{
+  LinkData *link = BLI_genericNodeN(file);
+  BLI_mutex_lock(&error_handler_lock);
+  BLI_addtail(&error_handler.open_mmaps, link);
+  BLI_mutex_unlock(&error_handler_lock);
+}
+
+static void sigbus_handler_remove(BLI_mmap_file *file)
+{
+  BLI_mutex_lock(&error_handler_lock);
+  LinkData *link = BLI_findptr(&error_handler.open_mmaps, file, offsetof(LinkData, data));
+  BLI_remlink(&error_handler.open_mmaps, link);
+  BLI_mutex_unlock(&error_handler_lock);
+  MEM_freeN(link);
+}
+#endif
+
+BLI_mmap_file *BLI_mmap_open(int fd)
+{
+  void *memory;
+  size_t length;
+
+#ifdef WIN32
+  const __int64 file_length = _lseeki64(fd, 0, SEEK_END);
+  if (file_length <= 0 || (unsigned __int64)file_length > SIZE_MAX) {
+    return NULL;
+  }
+  length = (size_t)file_length;
+
+  HANDLE handle = (HANDLE)_get_osfhandle(fd);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return NULL;
+  }
+  HANDLE mapping = CreateFileMapping(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL) {
+    return NULL;
+  }
+  memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  /* The view keeps a reference to the mapping object. */
+  CloseHandle(mapping);
+  if (memory == NULL) {
+    return NULL;
+  }
+#else
+  if (!sigbus_handler_setup()) {
+    return NULL;
+  }
+
+  const off_t file_length = lseek(fd, 0, SEEK_END);
+  if (file_length <= 0 || (uint64_t)file_length > SIZE_MAX) {
+    return NULL;
+  }
+  length = (size_t)file_length;
+
+  memory = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (memory == MAP_FAILED) {
+    return NULL;
+  }
+#endif
+
+  BLI_mmap_file *file = MEM_callocN(sizeof(BLI_mmap_file), __func__);
+  file->memory = memory;
+  file->length = length;
+
+#ifndef WIN32
+  sigbus_handler_add(file);
+#endif
+
+  return file;
+}
+
+bool BLI_mmap_read(BLI_mmap_file *file, void *dest, size_t offset, size_t length)
+{
+  /* If the requested block is outside the file, return an error. */
+  if (offset > file->length || length > file->length - offset) {
+    return false;
+  }
+
+  if (file->io_error) {
+    return false;
+  }
+
+#ifdef WIN32
+  __try {
+    memcpy(dest, file->memory + offset, length);
+  }
+  __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER :
+                                                            EXCEPTION_CONTINUE_SEARCH) {
+    file->io_error = true;
+  }
+#else
+  /* On an I/O error #sigbus_handler sets #BLI_mmap_file.io_error. */
+  memcpy(dest, file->memory + offset, length);
+#endif
+
+  return !file->io_error;
+}
+
+const void *BLI_mmap_get_pointer(const BLI_mmap_file *file)
+{
+  return file->memory;
+}
+
+size_t BLI_mmap_get_length(const BLI_mmap_file *file)
+{
+  return file->length;
+}
+
+bool BLI_mmap_any_io_error(const BLI_mmap_file *file)
+{
+  return file->io_error;
+}
+
+void BLI_mmap_free(BLI_mmap_file *file)
+{
+#ifdef WIN32
+  UnmapViewOfFile(file->memory);
+#else
+  /* Remove first, the address range may be reused by another mapping once unmapped. */
+  sigbus_handler_remove(file);
+  munmap(file->memory, file->length);
+#endif
+
+  MEM_freeN(file);
+}
@@ -199,6 +199,30 @@ size_t BLI_file_size(const char *path)
   return stats.st_size;
 }
 
+/**
+ * Returns the position in the file, with a 64 bit offset also on platforms where long is 32 bit.
+ */
+int64_t BLI_ftell(FILE *stream)
+{
+#ifdef WIN32
+  return _ftelli64(stream);
+#else
+  return ftello(stream);
+#endif
+}
+
+/**
+ * Sets the position in the file, see #BLI_ftell.
+ */
+int BLI_fseek(FILE *stream, int64_t offset, int whence)
+{
+#ifdef WIN32
+  return _fseeki64(stream, offset, whence);
+#else
+  return fseeko(stream, (off_t)offset, whence);
+#endif
+}
+
 /**
  * Returns the st_mode from stat-ing the specified path name, or 0 if stat fails
  * (most likely doesn't exist or no access).
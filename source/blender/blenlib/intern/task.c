@@ -45,19 +45,6 @@
  */
 #define MEMPOOL_SIZE 256
 
-/* Number of tasks which are pushed directly to local thread queue.
- *
- * This allows thread to fetch next task without locking the whole queue.
- */
-#define LOCAL_QUEUE_SIZE 1
-
-/* Number of tasks which are allowed to be scheduled in a delayed manner.
- *
- * This allows to use less locks per graph node children schedule. More details
- * could be found at TaskThreadLocalStorage::do_delayed_push.
- */
-#define DELAYED_QUEUE_SIZE 4096
-
 #ifndef NDEBUG
 #  define ASSERT_THREAD_ID(scheduler, thread_id) \
     do { \
@@ -132,43 +119,54 @@ typedef struct TaskMemPoolStats {
 } TaskMemPoolStats;
 #endif
 
+/* Double-ended queues of tasks owned by a single thread, one per priority.
+ *
+ * High priority tasks are always taken before low priority ones. The owning
+ * thread pushes high priority tasks to the head and takes them from there, so
+ * the most recently spawned work is picked up first and stays hot in the caches.
+ * Idle threads steal from the tail, which holds the oldest (and typically
+ * biggest) pieces of work. Low priority tasks are handled in push order.
+ *
+ * The lock is only contended when another thread steals from this queue, so
+ * unlike a single global queue it does not serialize all threads of the
+ * scheduler.
+ */
+typedef struct TaskQueue {
+  /* Indexed by #TaskPriority. */
+  ListBase tasks[2];
+  SpinLock lock;
+  /* Number of tasks in the queue, read without lock to skip empty queues. */
+  volatile int num_tasks;
+} TaskQueue;
+
 typedef struct TaskThreadLocalStorage {
   /* Memory pool for faster task allocation.
    * The idea is to re-use memory of finished/discarded tasks by this thread.
    */
   TaskMemPool task_mempool;
 
-  /* Local queue keeps thread alive by keeping small amount of tasks ready
-   * to be picked up without causing global thread locks for synchronization.
-   */
-  int num_local_queue;
-  Task *local_queue[LOCAL_QUEUE_SIZE];
-
   /* Thread can be marked for delayed tasks push. This is helpful when it's
    * know that lots of subsequent task pushed will happen from the same thread
    * without "interrupting" for task execution.
    *
-   * We try to accumulate as much tasks as possible in a local queue without
-   * any locks first, and then we push all of them into a scheduler's queue
-   * from within a single mutex lock.
+   * Tasks are still pushed to the thread's queue right away, but waking up
+   * idle threads is postponed and done once for all of them.
    */
   bool do_delayed_push;
-  int num_delayed_queue;
-  Task *delayed_queue[DELAYED_QUEUE_SIZE];
+  int num_delayed_push;
 } TaskThreadLocalStorage;
 
 struct TaskPool {
   TaskScheduler *scheduler;
 
+  /* Number of tasks pushed to the scheduler which are not finished yet.
+   * Updated atomically. */
   volatile size_t num;
-  ThreadMutex num_mutex;
-  ThreadCondition num_cond;
 
   void *userdata;
   ThreadMutex user_mutex;
 
   volatile bool do_cancel;
-  volatile bool do_work;
 
   volatile bool is_suspended;
   bool start_suspended;
@@ -207,9 +205,25 @@ struct TaskScheduler {
   int num_threads;
   bool background_thread_only;
 
-  ListBase queue;
-  ThreadMutex queue_mutex;
-  ThreadCondition queue_cond;
+  /* Queue for tasks pushed from threads which are neither the main thread
+   * nor a worker of this scheduler. */
+  TaskQueue shared_queue;
+
+  /* Idle worker threads sleep on sleep_cond, threads waiting for a pool to
+   * finish sleep on wait_cond. Both use the same mutex, which is only locked
+   * when there actually is a sleeping thread to wake up. */
+  ThreadMutex sleep_mutex;
+  ThreadCondition sleep_cond;
+  ThreadCondition wait_cond;
+  volatile unsigned int num_sleeping;
+  volatile unsigned int num_waiting;
+
+  /* Counters incremented after every push, used to detect tasks which were
+   * pushed while a thread was looking for work and is about to go to sleep.
+   * The worker counter is only incremented for tasks worker threads are
+   * allowed to run. */
+  volatile unsigned int num_pushed;
+  volatile unsigned int num_pushed_for_workers;
 
   ThreadMutex startup_mutex;
   ThreadCondition startup_cond;
@@ -224,6 +238,7 @@ struct TaskScheduler {
 typedef struct TaskThread {
   TaskScheduler *scheduler;
   int id;
+  TaskQueue queue;
   TaskThreadLocalStorage tls;
 } TaskThread;
 
@@ -326,110 +341,281 @@ static void task_free(TaskPool *pool, Task *task, const int thread_id)
   }
 }
 
-/* Task Scheduler */
+/* Task Queue */
 
-static void task_pool_num_decrease(TaskPool *pool, size_t done)
+static void task_queue_init(TaskQueue *queue)
 {
-  BLI_mutex_lock(&pool->num_mutex);
+  BLI_listbase_clear(&queue->tasks[TASK_PRIORITY_LOW]);
+  BLI_listbase_clear(&queue->tasks[TASK_PRIORITY_HIGH]);
+  BLI_spin_init(&queue->lock);
+  queue->num_tasks = 0;
+}
 
-  BLI_assert(pool->num >= done);
+static void task_queue_free(TaskQueue *queue)
+{
+  /* delete leftover tasks */
+  for (int i = 0; i < ARRAY_SIZE(queue->tasks); i++) {
+    LISTBASE_FOREACH (Task *, task, &queue->tasks[i]) {
+      task_data_free(task, 0);
+    }
+    BLI_freelistN(&queue->tasks[i]);
+  }
+  BLI_spin_end(&queue->lock);
+}
 
-  pool->num -= done;
+static void task_queue_push(TaskQueue *queue, Task *task, TaskPriority priority)
+{
+  BLI_spin_lock(&queue->lock);
+  if (priority == TASK_PRIORITY_HIGH) {
+    BLI_addhead(&queue->tasks[TASK_PRIORITY_HIGH], task);
+  }
+  else {
+    BLI_addtail(&queue->tasks[TASK_PRIORITY_LOW], task);
+  }
+  queue->num_tasks++;
+  BLI_spin_unlock(&queue->lock);
+}
+
+BLI_INLINE bool task_queue_task_match(const Task *task,
+                                      const TaskPool *pool,
+                                      const bool background_only)
+{
+  return (pool == NULL || task->pool == pool) &&
+         (!background_only || task->pool->run_in_background);
+}
+
+/* Take a task of the given priority from the queue. High priority tasks are taken from the head
+ * when the queue belongs to the calling thread and from the tail when stealing, low priority
+ * ones always from the head.
+ *
+ * When pool is given only tasks of that pool are considered: running tasks of
+ * other pools from #BLI_task_pool_work_and_wait() could lead to a deadlock.
+ */
+static Task *task_queue_pop(TaskQueue *queue,
+                            const TaskPriority priority,
+                            const TaskPool *pool,
+                            const bool background_only,
+                            const bool do_steal)
+{
+  if (queue->num_tasks == 0) {
+    return NULL;
+  }
+
+  ListBase *tasks = &queue->tasks[priority];
+  const bool from_tail = do_steal && (priority == TASK_PRIORITY_HIGH);
 
-  if (pool->num == 0) {
-    BLI_condition_notify_all(&pool->num_cond);
+  BLI_spin_lock(&queue->lock);
+  Task *task = from_tail ? tasks->last : tasks->first;
+  while (task != NULL) {
+    if (task_queue_task_match(task, pool, background_only)) {
+      BLI_remlink(tasks, task);
+      queue->num_tasks--;
+      break;
+    }
+    task = from_tail ? task->prev : task->next;
   }
+  BLI_spin_unlock(&queue->lock);
 
-  BLI_mutex_unlock(&pool->num_mutex);
+  return task;
 }
 
-static void task_pool_num_increase(TaskPool *pool, size_t new)
+/* Remove all tasks of the given pool from the queue, returns number of removed tasks. */
+static size_t task_queue_clear(TaskQueue *queue, TaskPool *pool)
 {
-  BLI_mutex_lock(&pool->num_mutex);
+  size_t done = 0;
 
-  pool->num += new;
-  BLI_condition_notify_all(&pool->num_cond);
+  if (queue->num_tasks == 0) {
+    return 0;
+  }
+
+  BLI_spin_lock(&queue->lock);
+  for (int i = 0; i < ARRAY_SIZE(queue->tasks); i++) {
+    LISTBASE_FOREACH_MUTABLE (Task *, task, &queue->tasks[i]) {
+      if (task->pool == pool) {
+        task_data_free(task, pool->thread_id);
+        BLI_freelinkN(&queue->tasks[i], task);
+        queue->num_tasks--;
+        done++;
+      }
+    }
+  }
+  BLI_spin_unlock(&queue->lock);
 
-  BLI_mutex_unlock(&pool->num_mutex);
+  return done;
 }
 
-static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task)
+/* Task Scheduler */
+
+/* Index of the queue of the calling thread: 0 for the main thread, worker ID for the
+ * scheduler's own threads and -1 for any other thread. */
+static int task_scheduler_current_queue_index(TaskScheduler *scheduler)
 {
-  bool found_task = false;
-  BLI_mutex_lock(&scheduler->queue_mutex);
+  TaskThread *thread = pthread_getspecific(scheduler->tls_id_key);
+  if (thread != NULL) {
+    return thread->id;
+  }
+  if (BLI_thread_is_main()) {
+    return 0;
+  }
+  return -1;
+}
 
-  while (!scheduler->queue.first && !scheduler->do_exit) {
-    BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+BLI_INLINE TaskQueue *task_scheduler_queue_get(TaskScheduler *scheduler, const int queue_index)
+{
+  if (queue_index == -1) {
+    return &scheduler->shared_queue;
   }
+  return &scheduler->task_threads[queue_index].queue;
+}
 
-  do {
-    Task *current_task;
+/* Find a task of the given priority for the thread owning the given queue: from its own queue
+ * first, then from the shared queue, and finally by stealing from the other threads' queues. */
+static Task *task_scheduler_find_task_priority(TaskScheduler *scheduler,
+                                               const int queue_index,
+                                               const TaskPriority priority,
+                                               const TaskPool *pool,
+                                               const bool background_only)
+{
+  const int num_queues = scheduler->num_threads + 1;
+  Task *task;
 
-    /* Assuming we can only have a void queue in 'exit' case here seems logical
-     * (we should only be here after our worker thread has been woken up from a
-     * condition_wait(), which only happens after a new task was added to the queue),
-     * but it is wrong.
-     * Waiting on condition may wake up the thread even if condition is not signaled
-     * (spurious wake-ups), and some race condition may also empty the queue **after**
-     * condition has been signaled, but **before** awoken thread reaches this point...
-     * See http://stackoverflow.com/questions/8594591
-     *
-     * So we only abort here if do_exit is set.
-     */
-    if (scheduler->do_exit) {
-      BLI_mutex_unlock(&scheduler->queue_mutex);
-      return false;
+  if (queue_index != -1) {
+    task = task_queue_pop(
+        &scheduler->task_threads[queue_index].queue, priority, pool, background_only, false);
+    if (task != NULL) {
+      return task;
     }
+  }
 
-    for (current_task = scheduler->queue.first; current_task != NULL;
-         current_task = current_task->next) {
-      TaskPool *pool = current_task->pool;
+  task = task_queue_pop(&scheduler->shared_queue, priority, pool, background_only, false);
+  if (task != NULL) {
+    return task;
+  }
 
-      if (scheduler->background_thread_only && !pool->run_in_background) {
-        continue;
-      }
+  /* Visit every other queue once, starting from the neighbor so threads don't all hammer the
+   * same victim. */
+  const int first_index = queue_index + 1;
+  for (int i = 0; i < num_queues; i++) {
+    const int victim_index = (first_index + i) % num_queues;
+    if (victim_index == queue_index) {
+      continue;
+    }
+    task = task_queue_pop(
+        &scheduler->task_threads[victim_index].queue, priority, pool, background_only, true);
+    if (task != NULL) {
+      return task;
+    }
+  }
 
-      *task = current_task;
-      found_task = true;
-      BLI_remlink(&scheduler->queue, *task);
-      break;
+  return NULL;
+}
+
+/* Find a task to run, high priority tasks of all queues are taken before any low priority one. */
+static Task *task_scheduler_find_task(TaskScheduler *scheduler,
+                                      const int queue_index,
+                                      const TaskPool *pool,
+                                      const bool background_only)
+{
+  Task *task = task_scheduler_find_task_priority(
+      scheduler, queue_index, TASK_PRIORITY_HIGH, pool, background_only);
+  if (task == NULL) {
+    task = task_scheduler_find_task_priority(
+        scheduler, queue_index, TASK_PRIORITY_LOW, pool, background_only);
+  }
+  return task;
+}
+
+/* Wake up threads after tasks were pushed to the queues. */
+static void task_scheduler_notify_push(TaskScheduler *scheduler,
+                                       const bool for_workers,
+                                       const bool notify_all)
+{
+  atomic_add_and_fetch_u((unsigned int *)&scheduler->num_pushed, 1);
+  if (for_workers) {
+    atomic_add_and_fetch_u((unsigned int *)&scheduler->num_pushed_for_workers, 1);
+  }
+
+  /* NOTE: Counters above are updated with a full memory barrier, so either we see the sleeping
+   * thread here, or it sees the updated counter before going to sleep. */
+  const bool wake_workers = for_workers && scheduler->num_sleeping != 0;
+  const bool wake_waiters = scheduler->num_waiting != 0;
+  if (!wake_workers && !wake_waiters) {
+    return;
+  }
+
+  BLI_mutex_lock(&scheduler->sleep_mutex);
+  if (wake_workers) {
+    if (notify_all) {
+      BLI_condition_notify_all(&scheduler->sleep_cond);
     }
-    if (!found_task) {
-      BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+    else {
+      BLI_condition_notify_one(&scheduler->sleep_cond);
     }
-  } while (!found_task);
+  }
+  if (wake_waiters) {
+    BLI_condition_notify_all(&scheduler->wait_cond);
+  }
+  BLI_mutex_unlock(&scheduler->sleep_mutex);
+}
+
+static void task_scheduler_notify_waiters(TaskScheduler *scheduler)
+{
+  if (scheduler->num_waiting != 0) {
+    BLI_mutex_lock(&scheduler->sleep_mutex);
+    BLI_condition_notify_all(&scheduler->wait_cond);
+    BLI_mutex_unlock(&scheduler->sleep_mutex);
+  }
+}
+
+static void task_pool_num_decrease(TaskPool *pool, size_t done)
+{
+  TaskScheduler *scheduler = pool->scheduler;
 
-  BLI_mutex_unlock(&scheduler->queue_mutex);
+  BLI_assert(pool->num >= done);
 
-  return true;
+  if (atomic_sub_and_fetch_z((size_t *)&pool->num, done) == 0) {
+    /* NOTE: The pool can be freed by its owner as soon as the counter reached zero,
+     * only access the scheduler from here on. */
+    task_scheduler_notify_waiters(scheduler);
+  }
 }
 
-BLI_INLINE void handle_local_queue(TaskThreadLocalStorage *tls, const int thread_id)
+static void task_pool_num_increase(TaskPool *pool, size_t new)
 {
-  BLI_assert(!tls->do_delayed_push);
-  while (tls->num_local_queue > 0) {
-    /* We pop task from queue before handling it so handler of the task can
-     * push next job to the local queue.
-     */
-    tls->num_local_queue--;
-    Task *local_task = tls->local_queue[tls->num_local_queue];
-    /* TODO(sergey): Double-check work_and_wait() doesn't handle other's
-     * pool tasks.
-     */
-    TaskPool *local_pool = local_task->pool;
-    local_task->run(local_pool, local_task->taskdata, thread_id);
-    task_free(local_pool, local_task, thread_id);
+  atomic_add_and_fetch_z((size_t *)&pool->num, new);
+}
+
+/* Sleep until the pool has no more tasks, or new tasks were pushed since num_pushed was read. */
+static void task_pool_wait(TaskPool *pool, const bool wait_for_push, const unsigned int num_pushed)
+{
+  TaskScheduler *scheduler = pool->scheduler;
+
+  BLI_mutex_lock(&scheduler->sleep_mutex);
+  atomic_add_and_fetch_u((unsigned int *)&scheduler->num_waiting, 1);
+  while (pool->num != 0 && (!wait_for_push || scheduler->num_pushed == num_pushed)) {
+    BLI_condition_wait(&scheduler->wait_cond, &scheduler->sleep_mutex);
   }
-  BLI_assert(!tls->do_delayed_push);
+  atomic_sub_and_fetch_u((unsigned int *)&scheduler->num_waiting, 1);
+  BLI_mutex_unlock(&scheduler->sleep_mutex);
+}
+
+static void task_scheduler_thread_sleep(TaskScheduler *scheduler, const unsigned int num_pushed)
+{
+  BLI_mutex_lock(&scheduler->sleep_mutex);
+  atomic_add_and_fetch_u((unsigned int *)&scheduler->num_sleeping, 1);
+  /* NOTE: Use loop here to deal with spurious wake-ups. */
+  while (scheduler->num_pushed_for_workers == num_pushed && !scheduler->do_exit) {
+    BLI_condition_wait(&scheduler->sleep_cond, &scheduler->sleep_mutex);
+  }
+  atomic_sub_and_fetch_u((unsigned int *)&scheduler->num_sleeping, 1);
+  BLI_mutex_unlock(&scheduler->sleep_mutex);
 }
 
 static void *task_scheduler_thread_run(void *thread_p)
 {
   TaskThread *thread = (TaskThread *)thread_p;
-  TaskThreadLocalStorage *tls = &thread->tls;
   TaskScheduler *scheduler = thread->scheduler;
-  int thread_id = thread->id;
-  Task *task;
+  const int thread_id = thread->id;
 
   pthread_setspecific(scheduler->tls_id_key, thread);
 
@@ -442,20 +628,29 @@ static void *task_scheduler_thread_run(void *thread_p)
   BLI_mutex_unlock(&scheduler->startup_mutex);
 
   /* keep popping off tasks */
-  while (task_scheduler_thread_wait_pop(scheduler, &task)) {
+  while (!scheduler->do_exit) {
+    /* Read the counter before looking for work, so any task pushed after this point
+     * prevents the thread from going to sleep. */
+    const unsigned int num_pushed = atomic_fetch_and_add_u(
+        (unsigned int *)&scheduler->num_pushed_for_workers, 0);
+    Task *task = task_scheduler_find_task(
+        scheduler, thread_id, NULL, scheduler->background_thread_only);
+
+    if (task == NULL) {
+      task_scheduler_thread_sleep(scheduler, num_pushed);
+      continue;
+    }
+
     TaskPool *pool = task->pool;
 
     /* run task */
-    BLI_assert(!tls->do_delayed_push);
+    BLI_assert(!thread->tls.do_delayed_push);
     task->run(pool, task->taskdata, thread_id);
-    BLI_assert(!tls->do_delayed_push);
+    BLI_assert(!thread->tls.do_delayed_push);
 
     /* delete task */
     task_free(pool, task, thread_id);
 
-    /* Handle all tasks from local queue. */
-    handle_local_queue(tls, thread_id);
-
     /* notify pool task was done */
     task_pool_num_decrease(pool, 1);
   }
@@ -471,9 +666,11 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
    * threads, so we keep track of the number of users. */
   scheduler->do_exit = false;
 
-  BLI_listbase_clear(&scheduler->queue);
-  BLI_mutex_init(&scheduler->queue_mutex);
-  BLI_condition_init(&scheduler->queue_cond);
+  task_queue_init(&scheduler->shared_queue);
+
+  BLI_mutex_init(&scheduler->sleep_mutex);
+  BLI_condition_init(&scheduler->sleep_cond);
+  BLI_condition_init(&scheduler->wait_cond);
 
   BLI_mutex_init(&scheduler->startup_mutex);
   BLI_condition_init(&scheduler->startup_cond);
@@ -496,7 +693,10 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
   scheduler->task_threads = MEM_mallocN(sizeof(TaskThread) * (num_threads + 1),
                                         "TaskScheduler task threads");
 
-  /* Initialize TLS for main thread. */
+  /* Initialize queue and TLS for main thread. */
+  scheduler->task_threads[0].scheduler = scheduler;
+  scheduler->task_threads[0].id = 0;
+  task_queue_init(&scheduler->task_threads[0].queue);
   initialize_task_tls(&scheduler->task_threads[0].tls);
 
   pthread_key_create(&scheduler->tls_id_key, NULL);
@@ -508,12 +708,18 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
     scheduler->num_threads = num_threads;
     scheduler->threads = MEM_callocN(sizeof(pthread_t) * num_threads, "TaskScheduler threads");
 
+    /* Queues are initialized before any thread is launched, since threads steal from
+     * each other right away. */
     for (i = 0; i < num_threads; i++) {
       TaskThread *thread = &scheduler->task_threads[i + 1];
       thread->scheduler = scheduler;
       thread->id = i + 1;
+      task_queue_init(&thread->queue);
       initialize_task_tls(&thread->tls);
+    }
 
+    for (i = 0; i < num_threads; i++) {
+      TaskThread *thread = &scheduler->task_threads[i + 1];
       if (pthread_create(&scheduler->threads[i], NULL, task_scheduler_thread_run, thread) != 0) {
         fprintf(stderr, "TaskScheduler failed to launch thread %d/%d\n", i, num_threads);
       }
@@ -536,13 +742,11 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 
 void BLI_task_scheduler_free(TaskScheduler *scheduler)
 {
-  Task *task;
-
   /* stop all waiting threads */
-  BLI_mutex_lock(&scheduler->queue_mutex);
+  BLI_mutex_lock(&scheduler->sleep_mutex);
   scheduler->do_exit = true;
-  BLI_condition_notify_all(&scheduler->queue_cond);
-  BLI_mutex_unlock(&scheduler->queue_mutex);
+  BLI_condition_notify_all(&scheduler->sleep_cond);
+  BLI_mutex_unlock(&scheduler->sleep_mutex);
 
   pthread_key_delete(scheduler->tls_id_key);
 
@@ -559,25 +763,22 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
     MEM_freeN(scheduler->threads);
   }
 
-  /* Delete task thread data */
+  /* Delete task thread data and leftover tasks. */
   if (scheduler->task_threads) {
     for (int i = 0; i < scheduler->num_threads + 1; i++) {
-      TaskThreadLocalStorage *tls = &scheduler->task_threads[i].tls;
-      free_task_tls(tls);
+      task_queue_free(&scheduler->task_threads[i].queue);
+      free_task_tls(&scheduler->task_threads[i].tls);
     }
 
     MEM_freeN(scheduler->task_threads);
   }
 
-  /* delete leftover tasks */
-  for (task = scheduler->queue.first; task; task = task->next) {
-    task_data_free(task, 0);
-  }
-  BLI_freelistN(&scheduler->queue);
+  task_queue_free(&scheduler->shared_queue);
 
   /* delete mutex/condition */
-  BLI_mutex_end(&scheduler->queue_mutex);
-  BLI_condition_end(&scheduler->queue_cond);
+  BLI_mutex_end(&scheduler->sleep_mutex);
+  BLI_condition_end(&scheduler->sleep_cond);
+  BLI_condition_end(&scheduler->wait_cond);
   BLI_mutex_end(&scheduler->startup_mutex);
   BLI_condition_end(&scheduler->startup_cond);
 
@@ -589,68 +790,18 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler)
   return scheduler->num_threads + 1;
 }
 
-static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
-{
-  task_pool_num_increase(task->pool, 1);
-
-  /* add task to queue */
-  BLI_mutex_lock(&scheduler->queue_mutex);
-
-  if (priority == TASK_PRIORITY_HIGH) {
-    BLI_addhead(&scheduler->queue, task);
-  }
-  else {
-    BLI_addtail(&scheduler->queue, task);
-  }
-
-  BLI_condition_notify_one(&scheduler->queue_cond);
-  BLI_mutex_unlock(&scheduler->queue_mutex);
-}
-
-static void task_scheduler_push_all(TaskScheduler *scheduler,
-                                    TaskPool *pool,
-                                    Task **tasks,
-                                    int num_tasks)
-{
-  if (num_tasks == 0) {
-    return;
-  }
-
-  task_pool_num_increase(pool, num_tasks);
-
-  BLI_mutex_lock(&scheduler->queue_mutex);
-
-  for (int i = 0; i < num_tasks; i++) {
-    BLI_addhead(&scheduler->queue, tasks[i]);
-  }
-
-  BLI_condition_notify_all(&scheduler->queue_cond);
-  BLI_mutex_unlock(&scheduler->queue_mutex);
-}
-
 static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
 {
-  Task *task, *nexttask;
-  size_t done = 0;
-
-  BLI_mutex_lock(&scheduler->queue_mutex);
-
-  /* free all tasks from this pool from the queue */
-  for (task = scheduler->queue.first; task; task = nexttask) {
-    nexttask = task->next;
-
-    if (task->pool == pool) {
-      task_data_free(task, pool->thread_id);
-      BLI_freelinkN(&scheduler->queue, task);
-
-      done++;
-    }
+  /* free all tasks from this pool from the queues */
+  size_t done = task_queue_clear(&scheduler->shared_queue, pool);
+  for (int i = 0; i < scheduler->num_threads + 1; i++) {
+    done += task_queue_clear(&scheduler->task_threads[i].queue, pool);
   }
 
-  BLI_mutex_unlock(&scheduler->queue_mutex);
-
   /* notify done */
-  task_pool_num_decrease(pool, done);
+  if (done != 0) {
+    task_pool_num_decrease(pool, done);
+  }
 }
 
 /* Task Pool */
@@ -678,7 +829,6 @@ static TaskPool *task_pool_create_ex(TaskScheduler *scheduler,
   pool->scheduler = scheduler;
   pool->num = 0;
   pool->do_cancel = false;
-  pool->do_work = false;
   pool->is_suspended = is_suspended;
   pool->start_suspended = is_suspended;
   pool->num_suspended = 0;
@@ -686,9 +836,6 @@ static TaskPool *task_pool_create_ex(TaskScheduler *scheduler,
   pool->run_in_background = is_background;
   pool->use_local_tls = false;
 
-  BLI_mutex_init(&pool->num_mutex);
-  BLI_condition_init(&pool->num_cond);
-
   pool->userdata = userdata;
   BLI_mutex_init(&pool->user_mutex);
 
@@ -770,9 +917,6 @@ void BLI_task_pool_free(TaskPool *pool)
 {
   BLI_task_pool_cancel(pool);
 
-  BLI_mutex_end(&pool->num_mutex);
-  BLI_condition_end(&pool->num_cond);
-
   BLI_mutex_end(&pool->user_mutex);
 
 #ifdef DEBUG_STATS
@@ -796,11 +940,6 @@ void BLI_task_pool_free(TaskPool *pool)
   BLI_threaded_malloc_end();
 }
 
-BLI_INLINE bool task_can_use_local_queues(TaskPool *pool, int thread_id)
-{
-  return (thread_id != -1 && (thread_id != pool->thread_id || pool->do_work));
-}
-
 static void task_pool_push(TaskPool *pool,
                            TaskRunFunction run,
                            void *taskdata,
@@ -809,6 +948,8 @@ static void task_pool_push(TaskPool *pool,
                            TaskPriority priority,
                            int thread_id)
 {
+  TaskScheduler *scheduler = pool->scheduler;
+
   /* Allocate task and fill it's properties. */
   Task *task = task_alloc(pool, thread_id);
   task->run = run;
@@ -827,32 +968,34 @@ static void task_pool_push(TaskPool *pool,
     atomic_fetch_and_add_z(&pool->num_suspended, 1);
     return;
   }
-  /* Populate to any local queue first, this is cheapest push ever. */
-  if (task_can_use_local_queues(pool, thread_id)) {
-    ASSERT_THREAD_ID(pool->scheduler, thread_id);
+
+  /* In the delayed push mode idle threads are only woken up once all tasks were pushed. */
+  bool do_notify = true;
+  if (thread_id != -1) {
+    ASSERT_THREAD_ID(scheduler, thread_id);
     TaskThreadLocalStorage *tls = get_task_tls(pool, thread_id);
-    /* Try to push to a local execution queue.
-     * These tasks will be picked up next.
-     */
-    if (tls->num_local_queue < LOCAL_QUEUE_SIZE) {
-      tls->local_queue[tls->num_local_queue] = task;
-      tls->num_local_queue++;
-      return;
-    }
-    /* If we are in the delayed tasks push mode, we push tasks to a
-     * temporary local queue first without any locks, and then move them
-     * to global execution queue with a single lock.
-     */
-    if (tls->do_delayed_push && tls->num_delayed_queue < DELAYED_QUEUE_SIZE) {
-      tls->delayed_queue[tls->num_delayed_queue] = task;
-      tls->num_delayed_queue++;
-      return;
+    if (tls->do_delayed_push) {
+      tls->num_delayed_push++;
+      do_notify = false;
     }
   }
-  /* Do push to a global execution pool, slowest possible method,
-   * causes quite reasonable amount of threading overhead.
-   */
-  task_scheduler_push(pool->scheduler, task, priority);
+
+  /* In single threaded case the background thread is only allowed to handle
+   * background pools, don't wake it up for nothing. */
+  const bool for_workers = !scheduler->background_thread_only || pool->run_in_background;
+
+  /* Push to the queue of the calling thread, this only takes a lock which other threads
+   * touch when they are out of work and steal from us. */
+  task_pool_num_increase(pool, 1);
+  task_queue_push(task_scheduler_queue_get(scheduler, task_scheduler_current_queue_index(scheduler)),
+                  task,
+                  priority);
+
+  /* NOTE: Pool must not be accessed from here on: the task might have already been handled by
+   * other thread, letting the owner of the pool to free it. */
+  if (do_notify) {
+    task_scheduler_notify_push(scheduler, for_workers, false);
+  }
 }
 
 void BLI_task_pool_push_ex(TaskPool *pool,
@@ -883,90 +1026,64 @@ void BLI_task_pool_push_from_thread(TaskPool *pool,
 
 void BLI_task_pool_work_and_wait(TaskPool *pool)
 {
-  TaskThreadLocalStorage *tls = get_task_tls(pool, pool->thread_id);
   TaskScheduler *scheduler = pool->scheduler;
+  /* Queue of the thread which created the pool, which is the one expected to wait for it. */
+  const int queue_index = pool->use_local_tls ? -1 : pool->thread_id;
+
+  ASSERT_THREAD_ID(pool->scheduler, pool->thread_id);
 
   if (atomic_fetch_and_and_uint8((uint8_t *)&pool->is_suspended, 0)) {
     if (pool->num_suspended) {
+      TaskQueue *queue = task_scheduler_queue_get(scheduler, queue_index);
+
       task_pool_num_increase(pool, pool->num_suspended);
-      BLI_mutex_lock(&scheduler->queue_mutex);
 
-      BLI_movelisttolist(&scheduler->queue, &pool->suspended_queue);
+      BLI_spin_lock(&queue->lock);
+      BLI_movelisttolist(&queue->tasks[TASK_PRIORITY_LOW], &pool->suspended_queue);
+      queue->num_tasks += (int)pool->num_suspended;
+      BLI_spin_unlock(&queue->lock);
 
-      BLI_condition_notify_all(&scheduler->queue_cond);
-      BLI_mutex_unlock(&scheduler->queue_mutex);
+      task_scheduler_notify_push(
+          scheduler, !scheduler->background_thread_only || pool->run_in_background, true);
 
       pool->num_suspended = 0;
     }
   }
 
-  pool->do_work = true;
-
-  ASSERT_THREAD_ID(pool->scheduler, pool->thread_id);
-
-  handle_local_queue(tls, pool->thread_id);
-
-  BLI_mutex_lock(&pool->num_mutex);
-
   while (pool->num != 0) {
-    Task *task, *work_task = NULL;
-    bool found_task = false;
-
-    BLI_mutex_unlock(&pool->num_mutex);
-
-    BLI_mutex_lock(&scheduler->queue_mutex);
-
-    /* find task from this pool. if we get a task from another pool,
-     * we can get into deadlock */
+    const unsigned int num_pushed = atomic_fetch_and_add_u(
+        (unsigned int *)&scheduler->num_pushed, 0);
 
-    for (task = scheduler->queue.first; task; task = task->next) {
-      if (task->pool == pool) {
-        work_task = task;
-        found_task = true;
-        BLI_remlink(&scheduler->queue, task);
-        break;
-      }
-    }
-
-    BLI_mutex_unlock(&scheduler->queue_mutex);
+    /* Find task from this pool. if we get a task from another pool,
+     * we can get into deadlock. */
+    Task *task = task_scheduler_find_task(scheduler, queue_index, pool, false);
 
     /* if found task, do it, otherwise wait until other tasks are done */
-    if (found_task) {
+    if (task != NULL) {
+      TaskThreadLocalStorage *tls = get_task_tls(pool, pool->thread_id);
+
       /* run task */
       BLI_assert(!tls->do_delayed_push);
-      work_task->run(pool, work_task->taskdata, pool->thread_id);
+      task->run(pool, task->taskdata, pool->thread_id);
       BLI_assert(!tls->do_delayed_push);
+      UNUSED_VARS_NDEBUG(tls);
 
       /* delete task */
       task_free(pool, task, pool->thread_id);
 
-      /* Handle all tasks from local queue. */
-      handle_local_queue(tls, pool->thread_id);
-
       /* notify pool task was done */
       task_pool_num_decrease(pool, 1);
     }
-
-    BLI_mutex_lock(&pool->num_mutex);
-    if (pool->num == 0) {
-      break;
-    }
-
-    if (!found_task) {
-      BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
+    else {
+      task_pool_wait(pool, true, num_pushed);
     }
   }
-
-  BLI_mutex_unlock(&pool->num_mutex);
-
-  BLI_assert(tls->num_local_queue == 0);
 }
 
 void BLI_task_pool_work_wait_and_reset(TaskPool *pool)
 {
   BLI_task_pool_work_and_wait(pool);
 
-  pool->do_work = false;
   pool->is_suspended = pool->start_suspended;
 }
 
@@ -977,11 +1094,7 @@ void BLI_task_pool_cancel(TaskPool *pool)
   task_scheduler_clear(pool->scheduler, pool);
 
   /* wait until all entries are cleared */
-  BLI_mutex_lock(&pool->num_mutex);
-  while (pool->num) {
-    BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
-  }
-  BLI_mutex_unlock(&pool->num_mutex);
+  task_pool_wait(pool, false, 0);
 
   pool->do_cancel = false;
 }
@@ -1003,7 +1116,7 @@ ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool)
 
 void BLI_task_pool_delayed_push_begin(TaskPool *pool, int thread_id)
 {
-  if (task_can_use_local_queues(pool, thread_id)) {
+  if (thread_id != -1) {
     ASSERT_THREAD_ID(pool->scheduler, thread_id);
     TaskThreadLocalStorage *tls = get_task_tls(pool, thread_id);
     tls->do_delayed_push = true;
@@ -1012,13 +1125,18 @@ void BLI_task_pool_delayed_push_begin(TaskPool *pool, int thread_id)
 
 void BLI_task_pool_delayed_push_end(TaskPool *pool, int thread_id)
 {
-  if (task_can_use_local_queues(pool, thread_id)) {
+  if (thread_id != -1) {
     ASSERT_THREAD_ID(pool->scheduler, thread_id);
     TaskThreadLocalStorage *tls = get_task_tls(pool, thread_id);
     BLI_assert(tls->do_delayed_push);
-    task_scheduler_push_all(pool->scheduler, pool, tls->delayed_queue, tls->num_delayed_queue);
     tls->do_delayed_push = false;
-    tls->num_delayed_queue = 0;
+    if (tls->num_delayed_push != 0) {
+      tls->num_delayed_push = 0;
+      task_scheduler_notify_push(pool->scheduler,
+                                 !pool->scheduler->background_thread_only ||
+                                     pool->run_in_background,
+                                 true);
+    }
   }
 }
 
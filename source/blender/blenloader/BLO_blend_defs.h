@@ -65,6 +65,12 @@ enum {
    * (written to #BLENDER_STARTUP_FILE & #BLENDER_USERPREF_FILE).
    */
   USER = BLEND_MAKE_ID('U', 'S', 'E', 'R'),
+  /**
+   * Index of ID blocks and their file offsets, written as the last block before #ENDB,
+   * used to seek directly to the blocks needed for linking.
+   * (ignored when reading the whole file).
+   */
+  INDX = BLEND_MAKE_ID('I', 'N', 'D', 'X'),
   /**
    * Terminate reading (no data).
    */
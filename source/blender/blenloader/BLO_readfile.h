@@ -96,6 +96,7 @@ BlendFileData *BLO_read_from_memory(const void *mem,
 BlendFileData *BLO_read_from_memfile(struct Main *oldmain,
                                      const char *filename,
                                      struct MemFile *memfile,
+                                     const struct MemFile *oldmain_memfile,
                                      eBLOReadSkip skip_flags,
                                      struct ReportList *reports);
 
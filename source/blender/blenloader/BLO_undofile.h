@@ -25,6 +25,9 @@
  * \ingroup blenloader
  */
 
+struct GSet;
+struct MemFileChunkStore;
+struct MemFileSharedChunk;
 struct Scene;
 
 typedef struct {
@@ -32,13 +35,22 @@ typedef struct {
   const char *buf;
   /** Size in bytes. */
   unsigned int size;
-  /** When true, this chunk doesn't own the memory, it's shared with a previous #MemFileChunk */
+  /** When true, the data was already stored by a previous step, it's shared with it. */
   bool is_identical;
+  /** Reference counted data, shared by all chunks with the same contents. */
+  struct MemFileSharedChunk *shared;
+  /** Address of the ID this chunk belongs to (as written), NULL for data outside of IDs. */
+  const void *id;
 } MemFileChunk;
 
 typedef struct MemFile {
   ListBase chunks;
+  /** Size of the data this step added to the store. */
   size_t size;
+  /** Size of the data shared with previous steps (memory saved by de-duplication). */
+  size_t size_shared;
+  /** Chunks of all undo steps, by contents, shared by all memfiles written from each other. */
+  struct MemFileChunkStore *store;
 } MemFile;
 
 typedef struct MemFileUndoData {
@@ -48,14 +60,19 @@ typedef struct MemFileUndoData {
 } MemFileUndoData;
 
 /* actually only used writefile.c */
+extern void memfile_write_init(MemFile *memfile, MemFile *reference);
 extern void memfile_chunk_add(MemFile *memfile,
                               const char *buf,
                               unsigned int size,
+                              const void *id,
                               MemFileChunk **compchunk_step);
 
 /* exports */
 extern void BLO_memfile_free(MemFile *memfile);
 extern void BLO_memfile_merge(MemFile *first, MemFile *second);
+extern struct GSet *BLO_memfile_identical_ids(const MemFile *memfile,
+                                              const MemFile *memfile_ref,
+                                              bool *r_ids_removed);
 
 /* utilities */
 extern struct Main *BLO_memfile_main_get(struct MemFile *memfile,
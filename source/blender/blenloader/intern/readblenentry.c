@@ -38,10 +38,12 @@
 #include "BLI_string.h"
 
 #include "DNA_genfile.h"
+#include "DNA_scene_types.h"
 #include "DNA_sdna_types.h"
 
 #include "BKE_main.h"
 #include "BKE_idcode.h"
+#include "BKE_scene.h"
 
 #include "BLO_readfile.h"
 #include "BLO_undofile.h"
@@ -359,10 +361,13 @@ BlendFileData *BLO_read_from_memory(const void *mem,
  * \param oldmain: old main,
  * from which we will keep libraries and other data-blocks that should not have changed.
  * \param filename: current file, only for retrieving library data.
+ * \param oldmain_memfile: \a oldmain written using \a memfile as reference (can be NULL),
+ * the local data-blocks of \a oldmain which are unchanged in \a memfile are reused.
  */
 BlendFileData *BLO_read_from_memfile(Main *oldmain,
                                      const char *filename,
                                      MemFile *memfile,
+                                     const MemFile *oldmain_memfile,
                                      eBLOReadSkip skip_flags,
                                      ReportList *reports)
 {
@@ -384,6 +389,10 @@ BlendFileData *BLO_read_from_memfile(Main *oldmain,
     /* add the library pointers in oldmap lookup */
     blo_add_library_pointer_map(&old_mainlist, fd);
 
+    if (oldmain_memfile != NULL) {
+      blo_make_undo_old_id_map(fd, oldmain, oldmain_memfile);
+    }
+
     /* makes lookup of existing images in old main */
     blo_make_image_pointer_map(fd, oldmain);
 
@@ -424,6 +433,7 @@ BlendFileData *BLO_read_from_memfile(Main *oldmain,
       Main *libmain, *libmain_next;
       Main *newmain = bfd->main;
       ListBase new_mainlist = {newmain, newmain};
+      bool is_lib_dropped = false;
 
       for (libmain = oldmain->next; libmain; libmain = libmain_next) {
         libmain_next = libmain->next;
@@ -437,6 +447,16 @@ BlendFileData *BLO_read_from_memfile(Main *oldmain,
 #ifdef PRINT_DEBUG
           printf("Dropped Main for lib: %s\n", libmain->curlib->id.name);
 #endif
+          is_lib_dropped = true;
+        }
+      }
+
+      if (is_lib_dropped) {
+        /* Dependency graphs of reused scenes may use the linked data-blocks being freed. */
+        LISTBASE_FOREACH (Scene *, scene, &newmain->scenes) {
+          if (scene->id.tag & LIB_TAG_UNDO_OLD_ID_REUSED) {
+            BKE_scene_free_depsgraph_hash(scene);
+          }
         }
       }
       /* In any case, we need to move all lib data-blocks themselves - those are
@@ -23,6 +23,10 @@
 
 #include "zlib.h"
 
+#ifdef WITH_ZSTD
+#  include <zstd.h>
+#endif
+
 #include <limits.h>
 #include <stdlib.h> /* for atoi. */
 #include <stddef.h> /* for offsetof. */
@@ -98,8 +102,10 @@
 #include "BLI_endian_switch.h"
 #include "BLI_blenlib.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 #include "BLI_mempool.h"
+#include "BLI_mmap.h"
 #include "BLI_ghash.h"
 
 #include "BLT_translation.h"
@@ -122,6 +128,7 @@
 #include "BKE_layer.h"
 #include "BKE_lib_id.h"
 #include "BKE_main_idmap.h"
+#include "BKE_main_namemap.h"
 #include "BKE_lib_override.h"
 #include "BKE_lib_query.h"
 #include "BKE_main.h"  // for Main
@@ -218,8 +225,9 @@
  * Delay reading blocks we might not use (especially applies to library linking).
  * which keeps large arrays in memory from data-blocks we may not even use.
  *
- * \note This is disabled when using compression,
+ * \note This is disabled when using zlib compression,
  * while zlib supports seek it's unusably slow, see: T61880.
+ * Zstd compressed files written with a seek table only decompress the frames that are read.
  */
 #define USE_BHEAD_READ_ON_DEMAND
 
@@ -243,6 +251,7 @@ static void read_libraries(FileData *basefd, ListBase *mainlist);
 static void *read_struct(FileData *fd, BHead *bh, const char *blockname);
 static void direct_link_modifiers(FileData *fd, ListBase *lb, Object *ob);
 static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const char *name);
+static BHead *blo_bhead_at_offset(FileData *fd, off64_t offset);
 static BHead *find_bhead_from_idname(FileData *fd, const char *idname);
 
 #ifdef USE_COLLECTION_COMPAT_28
@@ -253,9 +262,12 @@ static void lib_link_animdata(FileData *fd, ID *id, AnimData *adt);
 
 typedef struct BHeadN {
   struct BHeadN *next, *prev;
-#ifdef USE_BHEAD_READ_ON_DEMAND
-  /** Use to read the data from the file directly into memory as needed. */
+  /**
+   * Offset of the data (directly after the #BHead) in the file.
+   * Use to read the data from the file directly into memory as needed.
+   */
   off64_t file_offset;
+#ifdef USE_BHEAD_READ_ON_DEMAND
   /** When set, the remainder of this allocation is the data, otherwise it needs to be read. */
   bool has_data;
 #endif
@@ -264,6 +276,28 @@ typedef struct BHeadN {
 
 #define BHEADN_FROM_BHEAD(bh) ((BHeadN *)POINTER_OFFSET(bh, -offsetof(BHeadN, bhead)))
 
+/**
+ * Offset of the #BHead itself, only valid when using #FileData.bhead_index
+ * (no pointer size conversion, so the size of the #BHead in the file is known).
+ */
+#define BHEADN_OFFSET(bheadn) ((bheadn)->file_offset - (off64_t)sizeof(BHead))
+
+/**
+ * Contents of the #INDX block.
+ *
+ * When a file has an index, #FileData.bhead_list only contains the blocks that have been read,
+ * ordered by their offset. Blocks are read on demand by seeking to them, see #blo_bhead_next.
+ */
+typedef struct BHeadIndex {
+  /** The #INDX block data, #BHeadIndex.header and #BHeadIndex.entries point into it. */
+  void *data;
+  const BHeadIndexHeader *header;
+  const BHeadIndexEntry *entries;
+  /** Entries by ID name and by old address. */
+  GHash *name_map;
+  GHash *old_map;
+} BHeadIndex;
+
 /* We could change this in the future, for now it's simplest if only data is delayed
  * because ID names are used in lookup tables. */
 #define BHEAD_USE_READ_ON_DEMAND(bhead) ((bhead)->code == DATA)
@@ -302,6 +336,9 @@ static const char *library_parent_filepath(Library *lib)
 
 /* -------------------------------------------------------------------- */
 /** \name OldNewMap API
+ *
+ * Maps are not locked, when reading in parallel each thread inserts into its own data map,
+ * while shared maps (such as the lib map during lib-linking) are only looked up.
  * \{ */
 
 typedef struct OldNew {
@@ -516,6 +553,7 @@ void blo_join_main(ListBase *mainlist)
   Main *tojoin, *mainl;
 
   mainl = mainlist->first;
+  BKE_main_namemap_clear(mainl);
   while ((tojoin = mainl->next)) {
     add_main_to_main(mainl, tojoin);
     BLI_remlink(mainlist, tojoin);
@@ -554,6 +592,9 @@ void blo_split_main(ListBase *mainlist, Main *main)
     return;
   }
 
+  /* Linked IDs are moved to their library's Main below. */
+  BKE_main_namemap_clear(main);
+
   /* (Library.temp_index -> Main), lookup table */
   const uint lib_main_array_len = BLI_listbase_count(&main->libraries);
   Main **lib_main_array = MEM_malloc_arrayN(lib_main_array_len, sizeof(*lib_main_array), __func__);
@@ -587,7 +628,16 @@ static void read_file_version(FileData *fd, Main *main)
 {
   BHead *bhead;
 
-  for (bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead)) {
+  if (fd->bhead_index) {
+    /* Only read the #GLOB block. */
+    const off64_t glob_offset = fd->bhead_index->header->glob_offset;
+    bhead = glob_offset ? blo_bhead_at_offset(fd, glob_offset) : NULL;
+  }
+  else {
+    bhead = blo_bhead_first(fd);
+  }
+
+  for (; bhead; bhead = blo_bhead_next(fd, bhead)) {
     if (bhead->code == GLOB) {
       FileGlobal *fg = read_struct(fd, bhead, "Global");
       if (fg) {
@@ -596,6 +646,9 @@ static void read_file_version(FileData *fd, Main *main)
         main->minsubversionfile = fg->minsubversion;
         MEM_freeN(fg);
       }
+      if (fd->bhead_index) {
+        break;
+      }
       else if (bhead->code == ENDB) {
         break;
       }
@@ -617,6 +670,11 @@ static void read_file_bhead_idname_map_create(FileData *fd)
   int code_prev = ENDB;
   uint reserve = 0;
 
+  /* Lookups use the index instead. */
+  if (fd->bhead_index) {
+    return;
+  }
+
   for (bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead)) {
     if (code_prev != bhead->code) {
       code_prev = bhead->code;
@@ -871,8 +929,8 @@ static BHeadN *get_bhead(FileData *fd)
         new_bhead = MEM_mallocN(sizeof(BHeadN) + bhead.len, "new_bhead");
         if (new_bhead) {
           new_bhead->next = new_bhead->prev = NULL;
+          new_bhead->file_offset = fd->file_offset;
 #ifdef USE_BHEAD_READ_ON_DEMAND
-          new_bhead->file_offset = 0; /* don't seek. */
           new_bhead->has_data = true;
 #endif
           new_bhead->bhead = bhead;
@@ -902,6 +960,53 @@ static BHeadN *get_bhead(FileData *fd)
   return new_bhead;
 }
 
+/**
+ * Read the block at \a offset and insert it after \a prev (the head of the list when NULL).
+ * Only for files with a #BHeadIndex, where the list of blocks may have gaps.
+ */
+static BHeadN *get_bhead_at_offset(FileData *fd, BHeadN *prev, off64_t offset)
+{
+  BLI_assert(fd->bhead_index != NULL);
+
+  if (fd->file_offset != offset && fd->seek(fd, offset, SEEK_SET) == -1) {
+    return NULL;
+  }
+
+  /* End of file only applies to the previous position. */
+  fd->is_eof = false;
+
+  BHeadN *new_bhead = get_bhead(fd);
+  if (new_bhead) {
+    BLI_remlink(&fd->bhead_list, new_bhead);
+    BLI_insertlinkafter(&fd->bhead_list, prev, new_bhead);
+  }
+  return new_bhead;
+}
+
+/**
+ * Return the block at \a offset, reading it when it's not yet in the list.
+ * Only for files with a #BHeadIndex.
+ */
+static BHead *blo_bhead_at_offset(FileData *fd, off64_t offset)
+{
+  BHeadN *prev = NULL;
+
+  /* Blocks are mostly looked up close to the end of what has been read so far. */
+  for (BHeadN *bheadn = fd->bhead_list.last; bheadn; bheadn = bheadn->prev) {
+    if (BHEADN_OFFSET(bheadn) <= offset) {
+      prev = bheadn;
+      break;
+    }
+  }
+
+  if (prev && BHEADN_OFFSET(prev) == offset) {
+    return &prev->bhead;
+  }
+
+  BHeadN *new_bhead = get_bhead_at_offset(fd, prev, offset);
+  return new_bhead ? &new_bhead->bhead : NULL;
+}
+
 BHead *blo_bhead_first(FileData *fd)
 {
   BHeadN *new_bhead;
@@ -911,7 +1016,12 @@ BHead *blo_bhead_first(FileData *fd)
    * Read in a new block if necessary
    */
   new_bhead = fd->bhead_list.first;
-  if (new_bhead == NULL) {
+  if (fd->bhead_index) {
+    if (new_bhead == NULL || BHEADN_OFFSET(new_bhead) != SIZEOFBLENDERHEADER) {
+      new_bhead = get_bhead_at_offset(fd, NULL, SIZEOFBLENDERHEADER);
+    }
+  }
+  else if (new_bhead == NULL) {
     new_bhead = get_bhead(fd);
   }
 
@@ -922,11 +1032,19 @@ BHead *blo_bhead_first(FileData *fd)
   return bhead;
 }
 
-BHead *blo_bhead_prev(FileData *UNUSED(fd), BHead *thisblock)
+/**
+ * \note With a #BHeadIndex, this only returns the previous block when it has been read.
+ */
+BHead *blo_bhead_prev(FileData *fd, BHead *thisblock)
 {
   BHeadN *bheadn = BHEADN_FROM_BHEAD(thisblock);
   BHeadN *prev = bheadn->prev;
 
+  if (prev && fd->bhead_index &&
+      (prev->file_offset + prev->bhead.len != BHEADN_OFFSET(bheadn))) {
+    return NULL;
+  }
+
   return (prev) ? &prev->bhead : NULL;
 }
 
@@ -940,10 +1058,25 @@ BHead *blo_bhead_next(FileData *fd, BHead *thisblock)
      * We calculate the BHeadN pointer from the BHead pointer below */
     new_bhead = BHEADN_FROM_BHEAD(thisblock);
 
-    /* get the next BHeadN. If it doesn't exist we read in the next one */
-    new_bhead = new_bhead->next;
-    if (new_bhead == NULL) {
-      new_bhead = get_bhead(fd);
+    if (fd->bhead_index) {
+      /* The next block in the list may not follow this one in the file. */
+      const off64_t offset_next = new_bhead->file_offset + thisblock->len;
+      if (thisblock->code == ENDB) {
+        new_bhead = NULL;
+      }
+      else if (new_bhead->next && BHEADN_OFFSET(new_bhead->next) == offset_next) {
+        new_bhead = new_bhead->next;
+      }
+      else {
+        new_bhead = get_bhead_at_offset(fd, new_bhead, offset_next);
+      }
+    }
+    else {
+      /* get the next BHeadN. If it doesn't exist we read in the next one */
+      new_bhead = new_bhead->next;
+      if (new_bhead == NULL) {
+        new_bhead = get_bhead(fd);
+      }
     }
   }
 
@@ -990,6 +1123,33 @@ static BHead *blo_bhead_read_full(FileData *fd, BHead *thisblock)
   }
   return &new_bhead_data->bhead;
 }
+
+/**
+ * Return the data of a block that wasn't read yet from the memory-mapped file,
+ * or NULL when the data isn't available as-is (so it must be read into a copy).
+ *
+ * The data must not be modified, blocks that need their endian switched are copied first.
+ */
+static const void *blo_bhead_data_mapped(const FileData *fd, const BHead *thisblock)
+{
+  const BHeadN *new_bhead = BHEADN_FROM_BHEAD(thisblock);
+  BLI_assert(new_bhead->has_data == false);
+  if (fd->mmap_file == NULL) {
+    return NULL;
+  }
+  const size_t length = BLI_mmap_get_length(fd->mmap_file);
+  const size_t offset = (size_t)new_bhead->file_offset;
+  if (offset > length || (size_t)thisblock->len > length - offset) {
+    return NULL;
+  }
+  const char *data = (const char *)BLI_mmap_get_pointer(fd->mmap_file) + offset;
+  /* Block sizes in the file are multiples of 4 (see #writedata), anything else is corrupt.
+   * 8 byte members may be unaligned here, which all supported platforms handle. */
+  if (((uintptr_t)data & (sizeof(int) - 1)) != 0) {
+    return NULL;
+  }
+  return data;
+}
 #endif /* USE_BHEAD_READ_ON_DEMAND */
 
 /* Warning! Caller's responsibility to ensure given bhead **is** and ID one! */
@@ -1038,6 +1198,171 @@ static void decode_blender_header(FileData *fd)
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Block Index
+ * \{ */
+
+static void read_file_bhead_index_free(BHeadIndex *index)
+{
+  BLI_ghash_free(index->name_map, NULL, NULL);
+  BLI_ghash_free(index->old_map, NULL, NULL);
+  MEM_freeN(index->data);
+  MEM_freeN(index);
+}
+
+/**
+ * Read the #INDX block from the end of the file, see #write_bhead_index.
+ * \return false when the file has no (usable) index.
+ */
+static bool read_file_bhead_index(FileData *fd)
+{
+  if ((fd->seek == NULL) || (fd->flags & (FD_FLAGS_SWITCH_ENDIAN | FD_FLAGS_POINTSIZE_DIFFERS))) {
+    return false;
+  }
+
+  const off64_t offset_backup = fd->file_offset;
+  const off64_t file_size = fd->seek(fd, 0, SEEK_END);
+  const off64_t footer_offset = file_size - (off64_t)(sizeof(BHead) + sizeof(BHeadIndexFooter));
+  BHeadIndexFooter footer;
+  BHead bhead;
+  void *data = NULL;
+  bool ok = false;
+
+  if (footer_offset > SIZEOFBLENDERHEADER && fd->seek(fd, footer_offset, SEEK_SET) != -1 &&
+      fd->read(fd, &footer, sizeof(footer)) == sizeof(footer) &&
+      memcmp(footer.magic, BHEAD_INDEX_MAGIC, sizeof(footer.magic)) == 0 &&
+      footer.index_offset > SIZEOFBLENDERHEADER && footer.index_offset < footer_offset &&
+      fd->seek(fd, footer.index_offset, SEEK_SET) != -1 &&
+      fd->read(fd, &bhead, sizeof(bhead)) == sizeof(bhead) && bhead.code == INDX &&
+      /* The index must be the last block before #ENDB. */
+      footer.index_offset + (off64_t)sizeof(bhead) + bhead.len ==
+          file_size - (off64_t)sizeof(BHead) &&
+      bhead.len >= (int)(sizeof(BHeadIndexHeader) + sizeof(BHeadIndexFooter))) {
+    data = MEM_mallocN((size_t)bhead.len, __func__);
+    if (fd->read(fd, data, bhead.len) == bhead.len) {
+      const BHeadIndexHeader *header = data;
+      ok = (header->entries_len >= 0) &&
+           ((size_t)bhead.len == sizeof(BHeadIndexHeader) +
+                                     sizeof(BHeadIndexEntry) * (size_t)header->entries_len +
+                                     sizeof(BHeadIndexFooter)) &&
+           (header->dna_offset > SIZEOFBLENDERHEADER) &&
+           (header->dna_offset < footer.index_offset);
+    }
+  }
+
+  fd->seek(fd, offset_backup, SEEK_SET);
+
+  if (!ok) {
+    MEM_SAFE_FREE(data);
+    return false;
+  }
+
+  BHeadIndex *index = MEM_callocN(sizeof(*index), __func__);
+  index->data = data;
+  index->header = data;
+  index->entries = POINTER_OFFSET(data, sizeof(BHeadIndexHeader));
+
+  const uint entries_len = (uint)index->header->entries_len;
+  index->name_map = BLI_ghash_str_new_ex(__func__, entries_len);
+  index->old_map = BLI_ghash_ptr_new_ex(__func__, entries_len);
+  for (uint i = 0; i < entries_len; i++) {
+    const BHeadIndexEntry *entry = &index->entries[i];
+    void *old = (void *)(uintptr_t)entry->old;
+    if (entry->offset <= SIZEOFBLENDERHEADER || entry->offset >= footer.index_offset ||
+        entry->name[sizeof(entry->name) - 1] != '\0') {
+      read_file_bhead_index_free(index);
+      return false;
+    }
+    /* Same as #read_file_bhead_idname_map_create. */
+    if (BKE_idcode_is_valid(entry->code) && BKE_idcode_is_linkable(entry->code)) {
+      BLI_ghash_insert(index->name_map, (void *)entry->name, (void *)entry);
+    }
+    BLI_ghash_insert(index->old_map, old, (void *)entry);
+  }
+
+  fd->bhead_index = index;
+  return true;
+}
+
+/**
+ * Fall back to reading the file sequentially,
+ * for indices that don't match the file contents.
+ */
+static void read_file_bhead_index_discard(FileData *fd)
+{
+  read_file_bhead_index_free(fd->bhead_index);
+  fd->bhead_index = NULL;
+  BLI_freelistN(&fd->bhead_list);
+  fd->is_eof = false;
+  fd->seek(fd, SIZEOFBLENDERHEADER, SEEK_SET);
+}
+
+static BHead *read_file_bhead_index_lookup_entry(FileData *fd, const BHeadIndexEntry *entry)
+{
+  if (entry == NULL) {
+    return NULL;
+  }
+  BHead *bhead = blo_bhead_at_offset(fd, entry->offset);
+  /* In 2.50+ files, the file identifier for screens is patched, see #expand_doit_library. */
+  if (bhead &&
+      !((bhead->code == entry->code) || (bhead->code == ID_SCR && entry->code == ID_SCRN))) {
+    return NULL;
+  }
+  return bhead;
+}
+
+static BHead *read_file_bhead_index_lookup_name(FileData *fd, const char *idname)
+{
+  return read_file_bhead_index_lookup_entry(fd,
+                                            BLI_ghash_lookup(fd->bhead_index->name_map, idname));
+}
+
+static BHead *read_file_bhead_index_lookup_old(FileData *fd, const void *old)
+{
+  return read_file_bhead_index_lookup_entry(fd,
+                                            BLI_ghash_lookup(fd->bhead_index->old_map, old));
+}
+
+/** \} */
+
+static int read_file_dna_subversion(FileData *fd, BHead *bhead)
+{
+  /* Before this, the subversion didn't exist in 'FileGlobal' so the subversion
+   * value isn't accessible for the purpose of DNA versioning in this case. */
+  if (fd->fileversion <= 242) {
+    return 0;
+  }
+  /* We can't use read_global because this needs 'DNA1' to be decoded,
+   * however the first 4 chars are _always_ the subversion. */
+  FileGlobal *fg = (void *)&bhead[1];
+  BLI_STATIC_ASSERT(offsetof(FileGlobal, subvstr) == 0, "Must be first: subvstr")
+  char num[5];
+  memcpy(num, fg->subvstr, 4);
+  num[4] = 0;
+  return atoi(num);
+}
+
+static bool read_file_dna_decode(FileData *fd,
+                                 BHead *bhead,
+                                 int subversion,
+                                 const char **r_error_message)
+{
+  const bool do_endian_swap = (fd->flags & FD_FLAGS_SWITCH_ENDIAN) != 0;
+
+  fd->filesdna = DNA_sdna_from_data(&bhead[1], bhead->len, do_endian_swap, true, r_error_message);
+  if (fd->filesdna) {
+    blo_do_versions_dna(fd->filesdna, fd->fileversion, subversion);
+    fd->compflags = DNA_struct_get_compareflags(fd->filesdna, fd->memsdna);
+    /* used to retrieve ID names from (bhead+1) */
+    fd->id_name_offs = DNA_elem_offset(fd->filesdna, "ID", "char", "name[]");
+
+    return true;
+  }
+  else {
+    return false;
+  }
+}
+
 /**
  * \return Success if the file is read correctly, else set \a r_error_message.
  */
@@ -1046,38 +1371,30 @@ static bool read_file_dna(FileData *fd, const char **r_error_message)
   BHead *bhead;
   int subversion = 0;
 
+  /* With an index only the #GLOB and #DNA1 blocks are read, instead of scanning the file. */
+  if (read_file_bhead_index(fd)) {
+    const BHeadIndexHeader *header = fd->bhead_index->header;
+    BHead *bhead_glob = header->glob_offset ? blo_bhead_at_offset(fd, header->glob_offset) :
+                                              NULL;
+    BHead *bhead_dna = blo_bhead_at_offset(fd, header->dna_offset);
+
+    if ((bhead_glob == NULL || bhead_glob->code == GLOB) && bhead_dna &&
+        bhead_dna->code == DNA1) {
+      if (bhead_glob) {
+        subversion = read_file_dna_subversion(fd, bhead_glob);
+      }
+      return read_file_dna_decode(fd, bhead_dna, subversion, r_error_message);
+    }
+
+    read_file_bhead_index_discard(fd);
+  }
+
   for (bhead = blo_bhead_first(fd); bhead; bhead = blo_bhead_next(fd, bhead)) {
     if (bhead->code == GLOB) {
-      /* Before this, the subversion didn't exist in 'FileGlobal' so the subversion
-       * value isn't accessible for the purpose of DNA versioning in this case. */
-      if (fd->fileversion <= 242) {
-        continue;
-      }
-      /* We can't use read_global because this needs 'DNA1' to be decoded,
-       * however the first 4 chars are _always_ the subversion. */
-      FileGlobal *fg = (void *)&bhead[1];
-      BLI_STATIC_ASSERT(offsetof(FileGlobal, subvstr) == 0, "Must be first: subvstr")
-      char num[5];
-      memcpy(num, fg->subvstr, 4);
-      num[4] = 0;
-      subversion = atoi(num);
+      subversion = read_file_dna_subversion(fd, bhead);
     }
     else if (bhead->code == DNA1) {
-      const bool do_endian_swap = (fd->flags & FD_FLAGS_SWITCH_ENDIAN) != 0;
-
-      fd->filesdna = DNA_sdna_from_data(
-          &bhead[1], bhead->len, do_endian_swap, true, r_error_message);
-      if (fd->filesdna) {
-        blo_do_versions_dna(fd->filesdna, fd->fileversion, subversion);
-        fd->compflags = DNA_struct_get_compareflags(fd->filesdna, fd->memsdna);
-        /* used to retrieve ID names from (bhead+1) */
-        fd->id_name_offs = DNA_elem_offset(fd->filesdna, "ID", "char", "name[]");
-
-        return true;
-      }
-      else {
-        return false;
-      }
+      return read_file_dna_decode(fd, bhead, subversion, r_error_message);
     }
     else if (bhead->code == ENDB) {
       break;
@@ -1156,6 +1473,52 @@ static off64_t fd_seek_data_from_file(FileData *filedata, off64_t offset, int wh
   return filedata->file_offset;
 }
 
+/* Memory-mapped file reading.
+ * Uncompressed files are mapped so reading blocks doesn't need a system call each time,
+ * and blocks can be copied or reconstructed from the mapping without an intermediate buffer.
+ * The data is still copied into its own allocation, it's not referenced in the mapping. */
+
+static int fd_read_from_mmap(FileData *filedata, void *buffer, uint size)
+{
+  const size_t length = BLI_mmap_get_length(filedata->mmap_file);
+  const size_t offset = (size_t)filedata->file_offset;
+
+  /* Don't read more bytes than there are available in the file. */
+  const size_t readsize = (offset < length) ? MIN2((size_t)size, length - offset) : 0;
+
+  if (!BLI_mmap_read(filedata->mmap_file, buffer, offset, readsize)) {
+    return EOF;
+  }
+
+  filedata->file_offset += readsize;
+
+  return (int)readsize;
+}
+
+static off64_t fd_seek_from_mmap(FileData *filedata, off64_t offset, int whence)
+{
+  off64_t new_pos;
+  if (whence == SEEK_CUR) {
+    new_pos = filedata->file_offset + offset;
+  }
+  else if (whence == SEEK_SET) {
+    new_pos = offset;
+  }
+  else if (whence == SEEK_END) {
+    new_pos = (off64_t)BLI_mmap_get_length(filedata->mmap_file) + offset;
+  }
+  else {
+    return -1;
+  }
+
+  if (new_pos < 0 || new_pos > (off64_t)BLI_mmap_get_length(filedata->mmap_file)) {
+    return -1;
+  }
+
+  filedata->file_offset = new_pos;
+  return filedata->file_offset;
+}
+
 /* GZip file reading. */
 
 static int fd_read_gzip_from_file(FileData *filedata, void *buffer, uint size)
@@ -1172,86 +1535,352 @@ static int fd_read_gzip_from_file(FileData *filedata, void *buffer, uint size)
   return (readsize);
 }
 
-/* Memory reading. */
+#ifdef WITH_ZSTD
+/* Zstd file reading.
+ *
+ * Files with a seek table (see #ww_close_zstd) are read frame by frame, decompressing only
+ * the frame containing the requested offset, which makes seeking cheap.
+ * Other zstd files (compressed by external tools for e.g.) are decompressed as a stream. */
 
-static int fd_read_from_memory(FileData *filedata, void *buffer, uint size)
-{
-  /* don't read more bytes then there are available in the buffer */
-  int readsize = (int)MIN2(size, (uint)(filedata->buffersize - filedata->file_offset));
+#  define ZSTD_SKIPPABLE_SEEK_TABLE_MAGIC 0x184D2A5E
+#  define ZSTD_SEEKABLE_FOOTER_MAGIC 0x8F92EAB1
+#  define ZSTD_SEEKABLE_FOOTER_SIZE 9
 
-  memcpy(buffer, filedata->buffer + filedata->file_offset, readsize);
-  filedata->file_offset += readsize;
+typedef struct ZstdReadWrap {
+  ZSTD_DCtx *ctx;
 
-  return (readsize);
-}
+  /* Seekable reading. */
+  int frames_len;
+  /** Start of each frame (#ZstdReadWrap.frames_len + 1 entries, the last is the total size). */
+  off64_t *compressed_ofs;
+  off64_t *uncompressed_ofs;
 
-/* MemFile reading. */
+  /** Most recently decompressed frame. */
+  int frame_cached;
+  char *frame_buf;
+  size_t frame_buf_alloc;
+  char *compressed_buf;
+  size_t compressed_buf_alloc;
 
-static int fd_read_from_memfile(FileData *filedata, void *buffer, uint size)
+  /* Stream reading. */
+  ZSTD_inBuffer in;
+  char *in_buf;
+} ZstdReadWrap;
+
+static uint32_t zstd_read_u32_le(const uchar *data)
 {
-  static size_t seek = SIZE_MAX; /* the current position */
-  static size_t offset = 0;      /* size of previous chunks */
-  static MemFileChunk *chunk = NULL;
-  size_t chunkoffset, readsize, totread;
+  return ((uint32_t)data[0]) | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) |
+         ((uint32_t)data[3] << 24);
+}
 
-  if (size == 0) {
-    return 0;
+static bool zstd_read_exact(int file, off64_t offset, void *buffer, size_t size)
+{
+  if (lseek(file, offset, SEEK_SET) != offset) {
+    return false;
   }
+  return (size_t)read(file, buffer, size) == size;
+}
 
-  if (seek != (size_t)filedata->file_offset) {
-    chunk = filedata->memfile->chunks.first;
-    seek = 0;
+/**
+ * Read the seek table from the end of the file.
+ * \return false when the file has no (valid) seek table.
+ */
+static bool zstd_read_seek_table(int file, ZstdReadWrap *zstd)
+{
+  const off64_t file_size = lseek(file, 0, SEEK_END);
+  uchar footer[ZSTD_SEEKABLE_FOOTER_SIZE];
 
-    while (chunk) {
-      if (seek + chunk->size > (size_t)filedata->file_offset) {
-        break;
-      }
-      seek += chunk->size;
-      chunk = chunk->next;
-    }
-    offset = seek;
-    seek = filedata->file_offset;
+  if (file_size < 8 + ZSTD_SEEKABLE_FOOTER_SIZE ||
+      !zstd_read_exact(file, file_size - ZSTD_SEEKABLE_FOOTER_SIZE, footer, sizeof(footer)) ||
+      zstd_read_u32_le(&footer[5]) != ZSTD_SEEKABLE_FOOTER_MAGIC) {
+    return false;
   }
 
-  if (chunk) {
-    totread = 0;
-
-    do {
-      /* first check if it's on the end if current chunk */
-      if (seek - offset == chunk->size) {
-        offset += chunk->size;
-        chunk = chunk->next;
-      }
-
-      /* debug, should never happen */
-      if (chunk == NULL) {
-        printf("illegal read, chunk zero\n");
-        return 0;
-      }
+  const uint32_t frames_len = zstd_read_u32_le(&footer[0]);
+  /* Optional per-frame checksum, not used by Blender but allowed by the format. */
+  const uint32_t entry_size = (footer[4] & (1 << 7)) ? 12 : 8;
+  const uint64_t table_size = (uint64_t)frames_len * entry_size + ZSTD_SEEKABLE_FOOTER_SIZE;
+  if (frames_len == 0 || table_size + 8 > (uint64_t)file_size) {
+    return false;
+  }
 
-      chunkoffset = seek - offset;
-      readsize = size - totread;
+  const off64_t table_ofs = file_size - (off64_t)table_size - 8;
+  uchar *table = MEM_mallocN(table_size - ZSTD_SEEKABLE_FOOTER_SIZE + 8, __func__);
+  bool ok = zstd_read_exact(file, table_ofs, table, table_size - ZSTD_SEEKABLE_FOOTER_SIZE + 8) &&
+            zstd_read_u32_le(&table[0]) == ZSTD_SKIPPABLE_SEEK_TABLE_MAGIC &&
+            zstd_read_u32_le(&table[4]) == table_size;
 
-      /* data can be spread over multiple chunks, so clamp size
-       * to within this chunk, and then it will read further in
-       * the next chunk */
-      if (chunkoffset + readsize > chunk->size) {
-        readsize = chunk->size - chunkoffset;
-      }
+  if (ok) {
+    zstd->frames_len = (int)frames_len;
+    zstd->compressed_ofs = MEM_mallocN(sizeof(off64_t) * (frames_len + 1), __func__);
+    zstd->uncompressed_ofs = MEM_mallocN(sizeof(off64_t) * (frames_len + 1), __func__);
+    zstd->compressed_ofs[0] = 0;
+    zstd->uncompressed_ofs[0] = 0;
+    for (uint32_t i = 0; i < frames_len; i++) {
+      const uchar *entry = &table[8 + i * entry_size];
+      zstd->compressed_ofs[i + 1] = zstd->compressed_ofs[i] + zstd_read_u32_le(&entry[0]);
+      zstd->uncompressed_ofs[i + 1] = zstd->uncompressed_ofs[i] + zstd_read_u32_le(&entry[4]);
+    }
+    /* Frames must exactly fill the space before the seek table. */
+    if (zstd->compressed_ofs[frames_len] != table_ofs) {
+      MEM_SAFE_FREE(zstd->compressed_ofs);
+      MEM_SAFE_FREE(zstd->uncompressed_ofs);
+      zstd->frames_len = 0;
+      ok = false;
+    }
+  }
 
-      memcpy(POINTER_OFFSET(buffer, totread), chunk->buf + chunkoffset, readsize);
-      totread += readsize;
-      filedata->file_offset += readsize;
-      seek += readsize;
-    } while (totread < size);
+  MEM_freeN(table);
+  return ok;
+}
 
-    return totread;
+static int zstd_frame_find(const ZstdReadWrap *zstd, off64_t offset)
+{
+  /* Binary search for the last frame starting at or before `offset`. */
+  int lo = 0, hi = zstd->frames_len - 1;
+  while (lo < hi) {
+    const int mid = (lo + hi + 1) / 2;
+    if (zstd->uncompressed_ofs[mid] <= offset) {
+      lo = mid;
+    }
+    else {
+      hi = mid - 1;
+    }
   }
-
-  return 0;
+  return lo;
 }
 
-static FileData *filedata_new(void)
+static bool zstd_frame_load(FileData *filedata, int frame)
+{
+  ZstdReadWrap *zstd = filedata->zstd;
+  if (zstd->frame_cached == frame) {
+    return true;
+  }
+
+  const size_t compressed_size = (size_t)(zstd->compressed_ofs[frame + 1] -
+                                          zstd->compressed_ofs[frame]);
+  const size_t uncompressed_size = (size_t)(zstd->uncompressed_ofs[frame + 1] -
+                                            zstd->uncompressed_ofs[frame]);
+
+  if (compressed_size > zstd->compressed_buf_alloc) {
+    MEM_SAFE_FREE(zstd->compressed_buf);
+    zstd->compressed_buf = MEM_mallocN(compressed_size, __func__);
+    zstd->compressed_buf_alloc = compressed_size;
+  }
+  if (uncompressed_size > zstd->frame_buf_alloc) {
+    MEM_SAFE_FREE(zstd->frame_buf);
+    zstd->frame_buf = MEM_mallocN(uncompressed_size, __func__);
+    zstd->frame_buf_alloc = uncompressed_size;
+  }
+
+  /* Invalidate first, in case decompression fails half way. */
+  zstd->frame_cached = -1;
+
+  if (!zstd_read_exact(filedata->filedes,
+                       zstd->compressed_ofs[frame],
+                       zstd->compressed_buf,
+                       compressed_size)) {
+    return false;
+  }
+
+  const size_t result = ZSTD_decompressDCtx(
+      zstd->ctx, zstd->frame_buf, uncompressed_size, zstd->compressed_buf, compressed_size);
+  if (result != uncompressed_size) {
+    return false;
+  }
+
+  zstd->frame_cached = frame;
+  return true;
+}
+
+static int fd_read_zstd_seekable(FileData *filedata, void *buffer, uint size)
+{
+  ZstdReadWrap *zstd = filedata->zstd;
+  const off64_t total_size = zstd->uncompressed_ofs[zstd->frames_len];
+  uint readsize = 0;
+
+  while (readsize < size && filedata->file_offset < total_size) {
+    const int frame = zstd_frame_find(zstd, filedata->file_offset);
+    if (!zstd_frame_load(filedata, frame)) {
+      return EOF;
+    }
+    const size_t frame_offset = (size_t)(filedata->file_offset - zstd->uncompressed_ofs[frame]);
+    const size_t frame_size = (size_t)(zstd->uncompressed_ofs[frame + 1] -
+                                       zstd->uncompressed_ofs[frame]);
+    const uint len = (uint)MIN2((size_t)(size - readsize), frame_size - frame_offset);
+
+    memcpy((char *)buffer + readsize, zstd->frame_buf + frame_offset, len);
+    readsize += len;
+    filedata->file_offset += len;
+  }
+
+  return (int)readsize;
+}
+
+static off64_t fd_seek_zstd_seekable(FileData *filedata, off64_t offset, int whence)
+{
+  ZstdReadWrap *zstd = filedata->zstd;
+  const off64_t total_size = zstd->uncompressed_ofs[zstd->frames_len];
+  off64_t new_offset;
+
+  switch (whence) {
+    case SEEK_SET:
+      new_offset = offset;
+      break;
+    case SEEK_CUR:
+      new_offset = filedata->file_offset + offset;
+      break;
+    case SEEK_END:
+      new_offset = total_size + offset;
+      break;
+    default:
+      return -1;
+  }
+
+  if (new_offset < 0 || new_offset > total_size) {
+    return -1;
+  }
+
+  filedata->file_offset = new_offset;
+  return new_offset;
+}
+
+static int fd_read_zstd_stream(FileData *filedata, void *buffer, uint size)
+{
+  ZstdReadWrap *zstd = filedata->zstd;
+  ZSTD_outBuffer output = {buffer, size, 0};
+
+  while (output.pos < output.size) {
+    if (zstd->in.pos == zstd->in.size) {
+      const int in_size = read(filedata->filedes, zstd->in_buf, ZSTD_DStreamInSize());
+      if (in_size < 0) {
+        return EOF;
+      }
+      if (in_size == 0) {
+        break;
+      }
+      zstd->in.size = (size_t)in_size;
+      zstd->in.pos = 0;
+    }
+
+    const size_t ret = ZSTD_decompressStream(zstd->ctx, &output, &zstd->in);
+    if (ZSTD_isError(ret)) {
+      return EOF;
+    }
+  }
+
+  filedata->file_offset += output.pos;
+  return (int)output.pos;
+}
+
+static ZstdReadWrap *zstd_read_wrap_new(int file, bool *r_is_seekable)
+{
+  ZstdReadWrap *zstd = MEM_callocN(sizeof(*zstd), __func__);
+  zstd->ctx = ZSTD_createDCtx();
+  zstd->frame_cached = -1;
+
+  *r_is_seekable = zstd_read_seek_table(file, zstd);
+  if (*r_is_seekable == false) {
+    zstd->in_buf = MEM_mallocN(ZSTD_DStreamInSize(), __func__);
+    zstd->in.src = zstd->in_buf;
+  }
+
+  lseek(file, 0, SEEK_SET);
+  return zstd;
+}
+
+static void zstd_read_wrap_free(ZstdReadWrap *zstd)
+{
+  ZSTD_freeDCtx(zstd->ctx);
+  MEM_SAFE_FREE(zstd->compressed_ofs);
+  MEM_SAFE_FREE(zstd->uncompressed_ofs);
+  MEM_SAFE_FREE(zstd->frame_buf);
+  MEM_SAFE_FREE(zstd->compressed_buf);
+  MEM_SAFE_FREE(zstd->in_buf);
+  MEM_freeN(zstd);
+}
+#endif /* WITH_ZSTD */
+
+/* Memory reading. */
+
+static int fd_read_from_memory(FileData *filedata, void *buffer, uint size)
+{
+  /* don't read more bytes then there are available in the buffer */
+  int readsize = (int)MIN2(size, (uint)(filedata->buffersize - filedata->file_offset));
+
+  memcpy(buffer, filedata->buffer + filedata->file_offset, readsize);
+  filedata->file_offset += readsize;
+
+  return (readsize);
+}
+
+/* MemFile reading. */
+
+static int fd_read_from_memfile(FileData *filedata, void *buffer, uint size)
+{
+  static size_t seek = SIZE_MAX; /* the current position */
+  static size_t offset = 0;      /* size of previous chunks */
+  static MemFileChunk *chunk = NULL;
+  size_t chunkoffset, readsize, totread;
+
+  if (size == 0) {
+    return 0;
+  }
+
+  if (seek != (size_t)filedata->file_offset) {
+    chunk = filedata->memfile->chunks.first;
+    seek = 0;
+
+    while (chunk) {
+      if (seek + chunk->size > (size_t)filedata->file_offset) {
+        break;
+      }
+      seek += chunk->size;
+      chunk = chunk->next;
+    }
+    offset = seek;
+    seek = filedata->file_offset;
+  }
+
+  if (chunk) {
+    totread = 0;
+
+    do {
+      /* first check if it's on the end if current chunk */
+      if (seek - offset == chunk->size) {
+        offset += chunk->size;
+        chunk = chunk->next;
+      }
+
+      /* debug, should never happen */
+      if (chunk == NULL) {
+        printf("illegal read, chunk zero\n");
+        return 0;
+      }
+
+      chunkoffset = seek - offset;
+      readsize = size - totread;
+
+      /* data can be spread over multiple chunks, so clamp size
+       * to within this chunk, and then it will read further in
+       * the next chunk */
+      if (chunkoffset + readsize > chunk->size) {
+        readsize = chunk->size - chunkoffset;
+      }
+
+      memcpy(POINTER_OFFSET(buffer, totread), chunk->buf + chunkoffset, readsize);
+      totread += readsize;
+      filedata->file_offset += readsize;
+      seek += readsize;
+    } while (totread < size);
+
+    return totread;
+  }
+
+  return 0;
+}
+
+static FileData *filedata_new(void)
 {
   FileData *fd = MEM_callocN(sizeof(FileData), "FileData");
 
@@ -1298,6 +1927,7 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
   FileDataSeekFn *seek_fn = NULL; /* Optional. */
 
   gzFile gzfile = (gzFile)Z_NULL;
+  BLI_mmap_file *mmap_file = NULL;
 
   char header[7];
 
@@ -1317,8 +1947,18 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   /* Regular file. */
   if (memcmp(header, "BLENDER", sizeof(header)) == 0) {
-    read_fn = fd_read_data_from_file;
-    seek_fn = fd_seek_data_from_file;
+    mmap_file = BLI_mmap_open(file);
+    if (mmap_file != NULL) {
+      read_fn = fd_read_from_mmap;
+      seek_fn = fd_seek_from_mmap;
+    }
+    else {
+      /* Mapping may fail (file systems without support, address space limits),
+       * regular reading works in all cases. */
+      read_fn = fd_read_data_from_file;
+      seek_fn = fd_seek_data_from_file;
+    }
+    lseek(file, 0, SEEK_SET);
   }
 
   /* Gzip file. */
@@ -1343,6 +1983,26 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
     }
   }
 
+#ifdef WITH_ZSTD
+  /* Zstd file. */
+  ZstdReadWrap *zstd = NULL;
+  if ((read_fn == NULL) &&
+      /* Check header magic. */
+      ((uchar)header[0] == 0x28 && (uchar)header[1] == 0xb5 && (uchar)header[2] == 0x2f &&
+       (uchar)header[3] == 0xfd)) {
+    bool is_seekable;
+    zstd = zstd_read_wrap_new(file, &is_seekable);
+    if (is_seekable) {
+      read_fn = fd_read_zstd_seekable;
+      seek_fn = fd_seek_zstd_seekable;
+    }
+    else {
+      /* No seek table, only sequential reading is supported. */
+      read_fn = fd_read_zstd_stream;
+    }
+  }
+#endif
+
   if (read_fn == NULL) {
     BKE_reportf(reports, RPT_WARNING, "Unrecognized file format '%s'", filepath);
     return NULL;
@@ -1352,6 +2012,10 @@ static FileData *blo_filedata_from_file_descriptor(const char *filepath,
 
   fd->filedes = file;
   fd->gzfiledes = gzfile;
+#ifdef WITH_ZSTD
+  fd->zstd = zstd;
+#endif
+  fd->mmap_file = mmap_file;
 
   fd->read = read_fn;
   fd->seek = seek_fn;
@@ -1514,6 +2178,16 @@ void blo_filedata_free(FileData *fd)
       }
     }
 
+#ifdef WITH_ZSTD
+    if (fd->zstd != NULL) {
+      zstd_read_wrap_free(fd->zstd);
+    }
+#endif
+
+    if (fd->mmap_file != NULL) {
+      BLI_mmap_free(fd->mmap_file);
+    }
+
     if (fd->buffer && !(fd->flags & FD_FLAGS_NOT_MY_BUFFER)) {
       MEM_freeN((void *)fd->buffer);
       fd->buffer = NULL;
@@ -1557,6 +2231,7 @@ void blo_filedata_free(FileData *fd)
     if (fd->soundmap) {
       oldnewmap_free(fd->soundmap);
     }
+    blo_end_undo_old_id_map(fd);
     if (fd->packedmap) {
       oldnewmap_free(fd->packedmap);
     }
@@ -1573,6 +2248,10 @@ void blo_filedata_free(FileData *fd)
     }
 #endif
 
+    if (fd->bhead_index) {
+      read_file_bhead_index_free(fd->bhead_index);
+    }
+
     MEM_freeN(fd);
   }
 }
@@ -1792,7 +2471,15 @@ static void *newlibadr_us(FileData *fd, const void *lib, const void *adr)
 {
   ID *id = newlibadr(fd, lib, adr);
 
-  id_us_plus_no_lib(id);
+  if (id != NULL && fd->lib_link_lock != NULL) {
+    /* Lib-linking in parallel, other threads may reference the same ID. */
+    BLI_spin_lock(fd->lib_link_lock);
+    id_us_plus_no_lib(id);
+    BLI_spin_unlock(fd->lib_link_lock);
+  }
+  else {
+    id_us_plus_no_lib(id);
+  }
 
   return id;
 }
@@ -1808,6 +2495,9 @@ static void *newlibadr_real_us(FileData *fd, const void *lib, const void *adr)
 {
   ID *id = newlibadr(fd, lib, adr);
 
+  /* Only used by types which are never lib-linked in parallel. */
+  BLI_assert(fd->lib_link_lock == NULL);
+
   id_us_ensure_real(id);
 
   return id;
@@ -2201,6 +2891,56 @@ void blo_add_library_pointer_map(ListBase *old_mainlist, FileData *fd)
   fd->old_mainlist = old_mainlist;
 }
 
+static bool read_undo_id_type_is_reusable(const short idcode)
+{
+  /* The UI is kept as is on undo, libraries are handled separately. */
+  return !ELEM(idcode, ID_WM, ID_SCR, ID_WS, ID_LI);
+}
+
+/**
+ * Undo file support: find the IDs of \a oldmain which are unchanged in the memfile being read.
+ *
+ * \param oldmain_memfile: \a oldmain as it is now, written using the memfile being read as
+ * reference (so both share their chunks).
+ */
+void blo_make_undo_old_id_map(FileData *fd, Main *oldmain, const MemFile *oldmain_memfile)
+{
+  bool ids_removed;
+  GSet *identical_ids = BLO_memfile_identical_ids(fd->memfile, oldmain_memfile, &ids_removed);
+  if (identical_ids == NULL) {
+    /* Some IDs can't be read at their old address, reuse nothing. */
+    return;
+  }
+
+  fd->undo_identical_ids = identical_ids;
+  fd->undo_ids_removed = ids_removed;
+  fd->undo_old_ids = BLI_gset_ptr_new(__func__);
+
+  ListBase *lb;
+  FOREACH_MAIN_LISTBASE_BEGIN (oldmain, lb) {
+    ID *id = lb->first;
+    if (id == NULL || !read_undo_id_type_is_reusable(GS(id->name))) {
+      continue;
+    }
+    for (; id; id = id->next) {
+      BLI_gset_insert(fd->undo_old_ids, id);
+    }
+  }
+  FOREACH_MAIN_LISTBASE_END;
+}
+
+void blo_end_undo_old_id_map(FileData *fd)
+{
+  if (fd->undo_old_ids != NULL) {
+    BLI_gset_free(fd->undo_old_ids, NULL);
+    fd->undo_old_ids = NULL;
+  }
+  if (fd->undo_identical_ids != NULL) {
+    BLI_gset_free(fd->undo_identical_ids, NULL);
+    fd->undo_identical_ids = NULL;
+  }
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -2248,17 +2988,23 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
 
     if (fd->compflags[bh->SDNAnr] != SDNA_CMP_REMOVED) {
       if (fd->compflags[bh->SDNAnr] == SDNA_CMP_NOT_EQUAL) {
+        const void *data = (bh + 1);
 #ifdef USE_BHEAD_READ_ON_DEMAND
         if (BHEADN_FROM_BHEAD(bh)->has_data == false) {
-          bh = blo_bhead_read_full(fd, bh);
-          if (UNLIKELY(bh == NULL)) {
-            fd->flags &= ~FD_FLAGS_FILE_OK;
-            return NULL;
+          /* Reconstruct directly from the mapped file, avoiding an intermediate copy. */
+          data = blo_bhead_data_mapped(fd, bh);
+          if (data == NULL) {
+            bh = blo_bhead_read_full(fd, bh);
+            if (UNLIKELY(bh == NULL)) {
+              fd->flags &= ~FD_FLAGS_FILE_OK;
+              return NULL;
+            }
+            data = (bh + 1);
           }
         }
 #endif
         temp = DNA_struct_reconstruct(
-            fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, (bh + 1));
+            fd->memsdna, fd->filesdna, fd->compflags, bh->SDNAnr, bh->nr, data);
       }
       else {
         /* SDNA_CMP_EQUAL */
@@ -2270,7 +3016,11 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
         else {
           /* Instead of allocating the bhead, then copying it,
            * read the data from the file directly into the memory. */
-          if (UNLIKELY(!blo_bhead_read_data(fd, bh, temp))) {
+          const void *data = blo_bhead_data_mapped(fd, bh);
+          if (data != NULL) {
+            memcpy(temp, data, bh->len);
+          }
+          else if (UNLIKELY(!blo_bhead_read_data(fd, bh, temp))) {
             fd->flags &= ~FD_FLAGS_FILE_OK;
             MEM_freeN(temp);
             temp = NULL;
@@ -2285,6 +3035,11 @@ static void *read_struct(FileData *fd, BHead *bh, const char *blockname)
     if (bh_orig != bh) {
       MEM_freeN(BHEADN_FROM_BHEAD(bh));
     }
+    /* Data used from the mapping reads as zeroes after an I/O error. */
+    if (fd->mmap_file && UNLIKELY(BLI_mmap_any_io_error(fd->mmap_file))) {
+      fd->flags &= ~FD_FLAGS_FILE_OK;
+      MEM_SAFE_FREE(temp);
+    }
 #endif
   }
 
@@ -3166,6 +3921,24 @@ static void direct_link_action(FileData *fd, bAction *act)
   }
 }
 
+/* Actions are shared by IDs, so this needs the same protection as user counts. */
+static void lib_link_action_idroot_ensure(FileData *fd, bAction *act, const ID *id)
+{
+  if (act == NULL) {
+    return;
+  }
+
+  if (fd->lib_link_lock != NULL) {
+    BLI_spin_lock(fd->lib_link_lock);
+  }
+  if (act->idroot == 0) {
+    act->idroot = GS(id->name);
+  }
+  if (fd->lib_link_lock != NULL) {
+    BLI_spin_unlock(fd->lib_link_lock);
+  }
+}
+
 static void lib_link_nladata_strips(FileData *fd, ID *id, ListBase *list)
 {
   NlaStrip *strip;
@@ -3181,9 +3954,7 @@ static void lib_link_nladata_strips(FileData *fd, ID *id, ListBase *list)
     strip->act = newlibadr_us(fd, id->lib, strip->act);
 
     /* fix action id-root (i.e. if it comes from a pre 2.57 .blend file) */
-    if ((strip->act) && (strip->act->idroot == 0)) {
-      strip->act->idroot = GS(id->name);
-    }
+    lib_link_action_idroot_ensure(fd, strip->act, id);
   }
 }
 
@@ -3279,12 +4050,8 @@ static void lib_link_animdata(FileData *fd, ID *id, AnimData *adt)
   adt->tmpact = newlibadr_us(fd, id->lib, adt->tmpact);
 
   /* fix action id-roots (i.e. if they come from a pre 2.57 .blend file) */
-  if ((adt->action) && (adt->action->idroot == 0)) {
-    adt->action->idroot = GS(id->name);
-  }
-  if ((adt->tmpact) && (adt->tmpact->idroot == 0)) {
-    adt->tmpact->idroot = GS(id->name);
-  }
+  lib_link_action_idroot_ensure(fd, adt->action, id);
+  lib_link_action_idroot_ensure(fd, adt->tmpact, id);
 
   /* link drivers */
   lib_link_fcurves(fd, id, &adt->drivers);
@@ -3306,6 +4073,7 @@ static void direct_link_animdata(FileData *fd, AnimData *adt)
   link_list(fd, &adt->drivers);
   direct_link_fcurves(fd, &adt->drivers);
   adt->driver_array = NULL;
+  adt->fcurve_bindings = NULL;
 
   /* link overrides */
   // TODO...
@@ -4417,6 +5185,12 @@ static void direct_link_pointcache(FileData *fd, PointCache *cache)
   cache->flag &= ~PTCACHE_SIMULATION_VALID;
   cache->simframe = 0;
   cache->edit = NULL;
+#ifndef WITH_ZSTD
+  /* Saved by a build with Zstandard support, the option isn't available here. */
+  if (cache->compression == PTCACHE_COMPRESS_ZSTD) {
+    cache->compression = PTCACHE_COMPRESS_NO;
+  }
+#endif
   cache->free_edit = NULL;
   cache->cached_frames = NULL;
   cache->cached_frames_len = 0;
@@ -8817,6 +9591,7 @@ static ID *create_placeholder(Main *mainvar, const short idcode, const char *idn
 
   BLI_addtail(lb, ph_id);
   id_sort_by_name(lb, ph_id, NULL);
+  BKE_main_namemap_add_name(mainvar, ph_id, ph_id->name + 2);
 
   return ph_id;
 }
@@ -8939,56 +9714,315 @@ static BHead *read_data_into_oldnewmap(FileData *fd, BHead *bhead, const char *a
   return bhead;
 }
 
-static BHead *read_libblock(FileData *fd,
-                            Main *main,
-                            BHead *bhead,
-                            const int tag,
-                            const bool placeholder_set_indirect_extern,
-                            ID **r_id)
-{
-  /* this routine reads a libblock and its direct data. Use link functions to connect it all
-   */
+/* -------------------------------------------------------------------- */
+/** \name Read ID Data in Tasks
+ *
+ * Reading the data of an ID and direct-linking it only touches that ID for some types,
+ * those potentially holding large arrays are read in tasks while the main thread continues
+ * with the next IDs. This relies on the memory-mapped reader, which can be used from any thread
+ * when each thread has its own copy of the #FileData (with its own file offset and data map).
+ * \{ */
+
+typedef struct DirectLinkTask {
   ID *id;
-  ListBase *lb;
+  int tag;
   const char *allocname;
+  BHead **bheads;
+  int bheads_len;
+} DirectLinkTask;
 
-  /* XXX Very weakly handled currently, see comment at the end of this function before trying to
-   * use it for anything new. */
-  bool wrong_id = false;
+static void read_libblock_deferred_begin(FileData *fd)
+{
+  BLI_assert(fd->direct_link_pool == NULL);
 
-  /* In undo case, most libs and linked data should be kept as is from previous state
-   * (see BLO_read_from_memfile).
-   * However, some needed by the snapshot being read may have been removed in previous one,
-   * and would go missing.
-   * This leads e.g. to disappearing objects in some undo/redo case, see T34446.
-   * That means we have to carefully check whether current lib or
-   * libdata already exits in old main, if it does we merely copy it over into new main area,
-   * otherwise we have to do a full read of that bhead... */
-  if (fd->memfile && ELEM(bhead->code, ID_LI, ID_LINK_PLACEHOLDER)) {
-    const char *idname = blo_bhead_id_name(fd, bhead);
+  /* Undo reads from memory and re-uses IDs, regular reading can't be shared between threads. */
+  if (fd->mmap_file == NULL || fd->memfile != NULL) {
+    return;
+  }
 
-    DEBUG_PRINTF("Checking %s...\n", idname);
+  TaskScheduler *scheduler = BLI_task_scheduler_get();
+  const int fds_len = BLI_task_scheduler_num_threads(scheduler) + 1;
 
-    if (bhead->code == ID_LI) {
-      Main *libmain = fd->old_mainlist->first;
-      /* Skip oldmain itself... */
-      for (libmain = libmain->next; libmain; libmain = libmain->next) {
-        DEBUG_PRINTF("... against %s: ", libmain->curlib ? libmain->curlib->id.name : "<NULL>");
-        if (libmain->curlib && STREQ(idname, libmain->curlib->id.name)) {
-          Main *oldmain = fd->old_mainlist->first;
-          DEBUG_PRINTF("FOUND!\n");
-          /* In case of a library, we need to re-add its main to fd->mainlist,
-           * because if we have later a missing ID_LINK_PLACEHOLDER,
-           * we need to get the correct lib it is linked to!
-           * Order is crucial, we cannot bulk-add it in BLO_read_from_memfile()
-           * like it used to be. */
-          BLI_remlink(fd->old_mainlist, libmain);
-          BLI_remlink_safe(&oldmain->libraries, libmain->curlib);
-          BLI_addtail(fd->mainlist, libmain);
-          BLI_addtail(&main->libraries, libmain->curlib);
+  fd->direct_link_fds = MEM_malloc_arrayN(fds_len, sizeof(*fd->direct_link_fds), __func__);
+  for (int i = 0; i < fds_len; i++) {
+    FileData *fd_thread = &fd->direct_link_fds[i];
+    *fd_thread = *fd;
+    fd_thread->datamap = oldnewmap_new();
+  }
 
-          if (r_id) {
-            *r_id = NULL; /* Just in case... */
+  fd->direct_link_pool = BLI_task_pool_create(scheduler, fd);
+}
+
+static void read_libblock_deferred_end(FileData *fd)
+{
+  if (fd->direct_link_pool == NULL) {
+    return;
+  }
+
+  BLI_task_pool_work_and_wait(fd->direct_link_pool);
+  BLI_task_pool_free(fd->direct_link_pool);
+  fd->direct_link_pool = NULL;
+
+  const int fds_len = BLI_task_scheduler_num_threads(BLI_task_scheduler_get()) + 1;
+  for (int i = 0; i < fds_len; i++) {
+    FileData *fd_thread = &fd->direct_link_fds[i];
+    if ((fd_thread->flags & FD_FLAGS_FILE_OK) == 0) {
+      fd->flags &= ~FD_FLAGS_FILE_OK;
+    }
+    oldnewmap_free(fd_thread->datamap);
+  }
+  MEM_freeN(fd->direct_link_fds);
+  fd->direct_link_fds = NULL;
+}
+
+static bool read_libblock_use_deferred(const FileData *fd, const ID *id)
+{
+  if (fd->direct_link_pool == NULL) {
+    return false;
+  }
+  /* Types which only access their own data when direct-linking. */
+  return ELEM(GS(id->name), ID_ME, ID_KE, ID_AC);
+}
+
+static void read_libblock_deferred_task(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+  DirectLinkTask *task = taskdata;
+  FileData *fd_main = BLI_task_pool_userdata(pool);
+  FileData *fd = &fd_main->direct_link_fds[threadid];
+  ID *id = task->id;
+
+  for (int i = 0; i < task->bheads_len; i++) {
+    BHead *bhead = task->bheads[i];
+    void *data = read_struct(fd, bhead, task->allocname);
+    if (data) {
+      oldnewmap_insert(fd->datamap, bhead->old, data, 0);
+    }
+  }
+
+  direct_link_id(fd, id);
+
+  /* Note: doing this after direct_link_id(), which resets that field. */
+  id->tag = task->tag;
+
+  switch (GS(id->name)) {
+    case ID_ME:
+      direct_link_mesh(fd, (Mesh *)id);
+      break;
+    case ID_KE:
+      direct_link_key(fd, (Key *)id);
+      break;
+    case ID_AC:
+      direct_link_action(fd, (bAction *)id);
+      break;
+    default:
+      BLI_assert(0);
+      break;
+  }
+
+  oldnewmap_free_unused(fd->datamap);
+  oldnewmap_clear(fd->datamap);
+
+  MEM_freeN(task->bheads);
+}
+
+/**
+ * Collect the data blocks of \a id and read them in a task, see #read_libblock.
+ */
+static BHead *read_libblock_deferred(
+    FileData *fd, ID *id, BHead *bhead, const int tag, const char *allocname)
+{
+  DirectLinkTask *task = MEM_mallocN(sizeof(*task), __func__);
+  int bheads_alloc = 16;
+
+  task->id = id;
+  task->tag = tag;
+  task->allocname = allocname;
+  task->bheads = MEM_malloc_arrayN(bheads_alloc, sizeof(*task->bheads), __func__);
+  task->bheads_len = 0;
+
+  for (bhead = blo_bhead_next(fd, bhead); bhead && bhead->code == DATA;
+       bhead = blo_bhead_next(fd, bhead)) {
+    if (UNLIKELY(task->bheads_len == bheads_alloc)) {
+      bheads_alloc *= 2;
+      task->bheads = MEM_reallocN(task->bheads, sizeof(*task->bheads) * bheads_alloc);
+    }
+    task->bheads[task->bheads_len++] = bhead;
+  }
+
+  /* The ID is owned by the task from now on, until #read_libblock_deferred_end. */
+  BLI_task_pool_push(
+      fd->direct_link_pool, read_libblock_deferred_task, task, true, TASK_PRIORITY_LOW);
+
+  return bhead;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Undo: Reuse Unchanged IDs
+ *
+ * IDs stored identically in the memfile and in the current state of the old main (see
+ * #blo_make_undo_old_id_map) are moved from the old main as is, instead of being read and
+ * linked again.
+ *
+ * Changed IDs are read at the address they have in the old main, so the ID pointers of the
+ * reused IDs (which are the same as in the memfile) remain valid.
+ * \{ */
+
+static bool read_libblock_undo_is_reusable(FileData *fd, ID *id_old)
+{
+  if (!BLI_gset_haskey(fd->undo_identical_ids, id_old)) {
+    return false;
+  }
+
+  switch (GS(id_old->name)) {
+    case ID_SCE:
+    case ID_GR:
+      /* Their runtime data (bases, object caches and dependency graphs) point to other IDs,
+       * which must all remain. */
+      return !fd->undo_ids_removed;
+    case ID_OB: {
+      Object *ob = (Object *)id_old;
+      /* Modes are entered again after undo, proxies are set up on linking. */
+      if (ob->mode != OB_MODE_OBJECT || ob->proxy != NULL) {
+        return false;
+      }
+      /* Pose channels point to the bones of the armature. */
+      if (ob->pose != NULL && !BLI_gset_haskey(fd->undo_identical_ids, ob->data)) {
+        return false;
+      }
+      return true;
+    }
+    default:
+      return true;
+  }
+}
+
+static BHead *read_libblock_undo_reuse(FileData *fd, Main *main, BHead *bhead, ID *id_old)
+{
+  const short idcode = GS(id_old->name);
+  Main *old_bmain = fd->old_mainlist->first;
+
+  BKE_main_namemap_remove_name(old_bmain, id_old, id_old->name + 2);
+  BLI_remlink(which_libbase(old_bmain, idcode), id_old);
+  BLI_addtail(which_libbase(main, idcode), id_old);
+  BKE_main_namemap_add_name(main, id_old, id_old->name + 2);
+  oldnewmap_insert(fd->libmap, bhead->old, id_old, bhead->code);
+
+  /* Doesn't need lib-linking, user counts are recomputed after undo. */
+  id_old->tag |= LIB_TAG_UNDO_OLD_ID_REUSED;
+
+  /* Skip the data of the ID. */
+  do {
+    bhead = blo_bhead_next(fd, bhead);
+  } while (bhead && bhead->code == DATA);
+
+  return bhead;
+}
+
+static int read_libblock_undo_remap_self_cb(void *user_data,
+                                            ID *UNUSED(id_self),
+                                            ID **id_pointer,
+                                            int UNUSED(cb_flag))
+{
+  ID **id_remap = user_data;
+  if (*id_pointer == id_remap[0]) {
+    *id_pointer = id_remap[1];
+  }
+  return IDWALK_RET_NOP;
+}
+
+/**
+ * Move the newly read \a id to the address of \a id_old, the old contents are freed
+ * with the old main.
+ *
+ * References of an ID to itself (in embedded node trees, the master collection of scenes...)
+ * must follow its contents. The new contents aren't lib-linked yet, their references are still
+ * the address written to the memfile, which is the address of \a id_old already.
+ * Direct data is allocated separately, so it never points into the swapped ID struct.
+ */
+static void read_libblock_undo_restore_at_old_address(FileData *fd, Main *main, ID *id, ID *id_old)
+{
+  const short idcode = GS(id->name);
+  Main *old_bmain = fd->old_mainlist->first;
+  ListBase *old_lb = which_libbase(old_bmain, idcode);
+  ListBase *new_lb = which_libbase(main, idcode);
+
+  BLI_remlink(old_lb, id_old);
+  BLI_insertlinkreplace(new_lb, id, id_old);
+  BLI_addtail(old_lb, id);
+  /* Data-blocks swap places between both databases. */
+  BKE_main_namemap_clear(old_bmain);
+  BKE_main_namemap_clear(main);
+
+  /* Swap everything but the list links. */
+  const size_t id_size = BKE_libblock_get_alloc_info(idcode, NULL);
+  const size_t offset = offsetof(ID, newid);
+  void *id_tmp = MEM_mallocN(id_size - offset, __func__);
+  memcpy(id_tmp, POINTER_OFFSET(id, offset), id_size - offset);
+  memcpy(POINTER_OFFSET(id, offset), POINTER_OFFSET(id_old, offset), id_size - offset);
+  memcpy(POINTER_OFFSET(id_old, offset), id_tmp, id_size - offset);
+  MEM_freeN(id_tmp);
+
+  /* The old contents, now at the address of \a id, are freed with the old main. */
+  ID *id_remap[2] = {id_old, id};
+  BKE_library_foreach_ID_link(NULL, id, read_libblock_undo_remap_self_cb, id_remap, IDWALK_NOP);
+
+  oldnewmap_insert(fd->libmap, id_old, id_old, idcode);
+}
+
+/** \} */
+
+static BHead *read_libblock(FileData *fd,
+                            Main *main,
+                            BHead *bhead,
+                            const int tag,
+                            const bool placeholder_set_indirect_extern,
+                            ID **r_id)
+{
+  /* this routine reads a libblock and its direct data. Use link functions to connect it all
+   */
+  ID *id;
+  ListBase *lb;
+  const char *allocname;
+
+  /* XXX Very weakly handled currently, see comment at the end of this function before trying to
+   * use it for anything new. */
+  bool wrong_id = false;
+
+  /* In undo case, most libs and linked data should be kept as is from previous state
+   * (see BLO_read_from_memfile).
+   * However, some needed by the snapshot being read may have been removed in previous one,
+   * and would go missing.
+   * This leads e.g. to disappearing objects in some undo/redo case, see T34446.
+   * That means we have to carefully check whether current lib or
+   * libdata already exits in old main, if it does we merely copy it over into new main area,
+   * otherwise we have to do a full read of that bhead... */
+  if (fd->memfile && ELEM(bhead->code, ID_LI, ID_LINK_PLACEHOLDER)) {
+    const char *idname = blo_bhead_id_name(fd, bhead);
+
+    DEBUG_PRINTF("Checking %s...\n", idname);
+
+    if (bhead->code == ID_LI) {
+      Main *libmain = fd->old_mainlist->first;
+      /* Skip oldmain itself... */
+      for (libmain = libmain->next; libmain; libmain = libmain->next) {
+        DEBUG_PRINTF("... against %s: ", libmain->curlib ? libmain->curlib->id.name : "<NULL>");
+        if (libmain->curlib && STREQ(idname, libmain->curlib->id.name)) {
+          Main *oldmain = fd->old_mainlist->first;
+          DEBUG_PRINTF("FOUND!\n");
+          /* In case of a library, we need to re-add its main to fd->mainlist,
+           * because if we have later a missing ID_LINK_PLACEHOLDER,
+           * we need to get the correct lib it is linked to!
+           * Order is crucial, we cannot bulk-add it in BLO_read_from_memfile()
+           * like it used to be. */
+          BLI_remlink(fd->old_mainlist, libmain);
+          BLI_remlink_safe(&oldmain->libraries, libmain->curlib);
+          BLI_addtail(fd->mainlist, libmain);
+          BLI_addtail(&main->libraries, libmain->curlib);
+
+          if (r_id) {
+            *r_id = NULL; /* Just in case... */
           }
           return blo_bhead_next(fd, bhead);
         }
@@ -9018,6 +10052,22 @@ static BHead *read_libblock(FileData *fd,
     }
   }
 
+  /* Undo: the ID may be unchanged, or its old address may be kept. */
+  ID *id_old = NULL;
+  if (fd->undo_old_ids != NULL && main->curlib == NULL && bhead->code != ID_LINK_PLACEHOLDER) {
+    id_old = BLI_gset_lookup(fd->undo_old_ids, bhead->old);
+    if (id_old != NULL && GS(id_old->name) != bhead->code) {
+      BLI_assert(!"Old ID of a different type");
+      id_old = NULL;
+    }
+    else if (id_old != NULL && read_libblock_undo_is_reusable(fd, id_old)) {
+      if (r_id) {
+        *r_id = id_old;
+      }
+      return read_libblock_undo_reuse(fd, main, bhead, id_old);
+    }
+  }
+
   /* read libblock */
   id = read_struct(fd, bhead, "lib block");
 
@@ -9030,6 +10080,7 @@ static BHead *read_libblock(FileData *fd,
       oldnewmap_insert(fd->libmap, bhead->old, id, bhead->code);
 
       BLI_addtail(lb, id);
+      BKE_main_namemap_add_name(main, id, id->name + 2);
     }
     else {
       /* unknown ID type */
@@ -9072,6 +10123,11 @@ static BHead *read_libblock(FileData *fd,
   /* need a name for the mallocN, just for debugging and sane prints on leaks */
   allocname = dataname(GS(id->name));
 
+  if (read_libblock_use_deferred(fd, id)) {
+    const int id_tag = tag | LIB_TAG_NEED_LINK | LIB_TAG_NEW;
+    return read_libblock_deferred(fd, id, bhead, id_tag, allocname);
+  }
+
   /* read all data into fd->datamap */
   bhead = read_data_into_oldnewmap(fd, bhead, allocname);
 
@@ -9196,6 +10252,14 @@ static BHead *read_libblock(FileData *fd,
   oldnewmap_free_unused(fd->datamap);
   oldnewmap_clear(fd->datamap);
 
+  if (id_old != NULL && !wrong_id) {
+    read_libblock_undo_restore_at_old_address(fd, main, id, id_old);
+    id = id_old;
+    if (r_id) {
+      *r_id = id;
+    }
+  }
+
   if (wrong_id) {
     /* XXX This is probably working OK currently given the very limited scope of that flag.
      * However, it is absolutely **not** handled correctly: it is freeing an ID pointer that has
@@ -9380,146 +10444,226 @@ static void do_versions_after_linking(Main *main, ReportList *reports)
 /** \name Read Library Data Block (all)
  * \{ */
 
+static void lib_link_all_id(FileData *fd, Main *bmain, ID *id)
+{
+  if ((id->tag & LIB_TAG_NEED_LINK) == 0) {
+    /* This ID does not need liblink, just skip it. */
+    return;
+  }
+
+  if (fd->memfile != NULL && GS(id->name) == ID_WM) {
+    /* No load UI for undo memfiles.
+     * Only WM currently, SCR needs it still (see below), and so does WS? */
+    return;
+  }
+
+  lib_link_id(fd, bmain, id);
+
+  /* Note: ID types are processed in reverse order as defined by INDEX_ID_XXX enums in DNA_ID.h.
+   * This ensures handling of most dependencies in proper order, as elsewhere in code.
+   * Please keep order of entries in that switch matching that order, it's easier to quickly see
+   * whether something is wrong then. */
+  switch (GS(id->name)) {
+    case ID_MSK:
+      lib_link_mask(fd, bmain, (Mask *)id);
+      break;
+    case ID_WM:
+      lib_link_windowmanager(fd, bmain, (wmWindowManager *)id);
+      break;
+    case ID_WS:
+      /* Could we skip WS in undo case? */
+      lib_link_workspaces(fd, bmain, (WorkSpace *)id);
+      break;
+    case ID_SCE:
+      lib_link_scene(fd, bmain, (Scene *)id);
+      break;
+    case ID_LS:
+      lib_link_linestyle(fd, bmain, (FreestyleLineStyle *)id);
+      break;
+    case ID_OB:
+      lib_link_object(fd, bmain, (Object *)id);
+      break;
+    case ID_SCR:
+      /* DO NOT skip screens here,
+       * 3D viewport may contains pointers to other ID data (like bgpic)! See T41411. */
+      lib_link_screen(fd, bmain, (bScreen *)id);
+      break;
+    case ID_MC:
+      lib_link_movieclip(fd, bmain, (MovieClip *)id);
+      break;
+    case ID_WO:
+      lib_link_world(fd, bmain, (World *)id);
+      break;
+    case ID_LP:
+      lib_link_lightprobe(fd, bmain, (LightProbe *)id);
+      break;
+    case ID_SPK:
+      lib_link_speaker(fd, bmain, (Speaker *)id);
+      break;
+    case ID_PA:
+      lib_link_particlesettings(fd, bmain, (ParticleSettings *)id);
+      break;
+    case ID_PC:
+      lib_link_paint_curve(fd, bmain, (PaintCurve *)id);
+      break;
+    case ID_BR:
+      lib_link_brush(fd, bmain, (Brush *)id);
+      break;
+    case ID_GR:
+      lib_link_collection(fd, bmain, (Collection *)id);
+      break;
+    case ID_SO:
+      lib_link_sound(fd, bmain, (bSound *)id);
+      break;
+    case ID_TXT:
+      lib_link_text(fd, bmain, (Text *)id);
+      break;
+    case ID_CA:
+      lib_link_camera(fd, bmain, (Camera *)id);
+      break;
+    case ID_LA:
+      lib_link_light(fd, bmain, (Light *)id);
+      break;
+    case ID_LT:
+      lib_link_latt(fd, bmain, (Lattice *)id);
+      break;
+    case ID_MB:
+      lib_link_mball(fd, bmain, (MetaBall *)id);
+      break;
+    case ID_CU:
+      lib_link_curve(fd, bmain, (Curve *)id);
+      break;
+    case ID_ME:
+      lib_link_mesh(fd, bmain, (Mesh *)id);
+      break;
+    case ID_CF:
+      lib_link_cachefiles(fd, bmain, (CacheFile *)id);
+      break;
+    case ID_AR:
+      lib_link_armature(fd, bmain, (bArmature *)id);
+      break;
+    case ID_VF:
+      lib_link_vfont(fd, bmain, (VFont *)id);
+      break;
+    case ID_MA:
+      lib_link_material(fd, bmain, (Material *)id);
+      break;
+    case ID_TE:
+      lib_link_texture(fd, bmain, (Tex *)id);
+      break;
+    case ID_IM:
+      lib_link_image(fd, bmain, (Image *)id);
+      break;
+    case ID_NT:
+      /* Has to be done after node users (scene/materials/...), this will verify group nodes. */
+      lib_link_nodetree(fd, bmain, (bNodeTree *)id);
+      break;
+    case ID_GD:
+      lib_link_gpencil(fd, bmain, (bGPdata *)id);
+      break;
+    case ID_PAL:
+      lib_link_palette(fd, bmain, (Palette *)id);
+      break;
+    case ID_KE:
+      lib_link_key(fd, bmain, (Key *)id);
+      break;
+    case ID_AC:
+      lib_link_action(fd, bmain, (bAction *)id);
+      break;
+    case ID_IP:
+      /* XXX deprecated... still needs to be maintained for version patches still. */
+      lib_link_ipo(fd, bmain, (Ipo *)id);
+      break;
+    case ID_LI:
+      lib_link_library(fd, bmain, (Library *)id); /* Only init users. */
+      break;
+  }
+
+  /* When linking in parallel, other tasks may change the tag of this ID concurrently
+   * (#id_us_plus_no_lib sets #LIB_TAG_EXTRAUSER), the tag is cleared after all tasks are done. */
+  if (fd->lib_link_lock == NULL) {
+    id->tag &= ~LIB_TAG_NEED_LINK;
+  }
+}
+
+/**
+ * ID types whose lib-linking only changes the ID itself (and the user count of the IDs it uses),
+ * the IDs of those types are linked in parallel.
+ */
+static bool lib_link_id_type_is_threadsafe(const short idcode)
+{
+  switch (idcode) {
+    case ID_ME:
+    case ID_CU:
+    case ID_LT:
+    case ID_MB:
+    case ID_KE:
+    case ID_AC:
+    case ID_IP:
+    case ID_CA:
+    case ID_SPK:
+    case ID_LP:
+    case ID_SO:
+    case ID_AR:
+    case ID_PA:
+    case ID_GD:
+    case ID_MC:
+    case ID_MSK:
+    case ID_BR:
+      return true;
+  }
+  return false;
+}
+
+typedef struct LibLinkAllData {
+  FileData *fd;
+  Main *bmain;
+} LibLinkAllData;
+
+static void lib_link_all_id_cb(void *__restrict userdata,
+                               void *item,
+                               int UNUSED(index),
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  LibLinkAllData *data = userdata;
+  lib_link_all_id(data->fd, data->bmain, item);
+}
+
 static void lib_link_all(FileData *fd, Main *bmain)
 {
-  ID *id;
-  FOREACH_MAIN_ID_BEGIN (bmain, id) {
-    if ((id->tag & LIB_TAG_NEED_LINK) == 0) {
-      /* This ID does not need liblink, just skip to next one. */
+  ListBase *lb;
+  FOREACH_MAIN_LISTBASE_BEGIN (bmain, lb) {
+    ID *id_first = lb->first;
+    if (id_first == NULL) {
       continue;
     }
 
-    if (fd->memfile != NULL && GS(id->name) == ID_WM) {
-      /* No load UI for undo memfiles.
-       * Only WM currently, SCR needs it still (see below), and so does WS? */
-      continue;
-    }
+    /* Undo has too many special cases (re-used and kept IDs), always link it in order. */
+    if (fd->memfile == NULL && lib_link_id_type_is_threadsafe(GS(id_first->name))) {
+      LibLinkAllData data = {fd, bmain};
+      SpinLock lock;
+      BLI_spin_init(&lock);
+      fd->lib_link_lock = &lock;
 
-    lib_link_id(fd, bmain, id);
+      TaskParallelSettings settings;
+      BLI_parallel_range_settings_defaults(&settings);
+      settings.min_iter_per_thread = 64;
+      BLI_task_parallel_listbase(lb, &data, lib_link_all_id_cb, &settings);
 
-    /* Note: ID types are processed in reverse order as defined by INDEX_ID_XXX enums in DNA_ID.h.
-     * This ensures handling of most dependencies in proper order, as elsewhere in code.
-     * Please keep order of entries in that switch matching that order, it's easier to quickly see
-     * whether something is wrong then. */
-    switch (GS(id->name)) {
-      case ID_MSK:
-        lib_link_mask(fd, bmain, (Mask *)id);
-        break;
-      case ID_WM:
-        lib_link_windowmanager(fd, bmain, (wmWindowManager *)id);
-        break;
-      case ID_WS:
-        /* Could we skip WS in undo case? */
-        lib_link_workspaces(fd, bmain, (WorkSpace *)id);
-        break;
-      case ID_SCE:
-        lib_link_scene(fd, bmain, (Scene *)id);
-        break;
-      case ID_LS:
-        lib_link_linestyle(fd, bmain, (FreestyleLineStyle *)id);
-        break;
-      case ID_OB:
-        lib_link_object(fd, bmain, (Object *)id);
-        break;
-      case ID_SCR:
-        /* DO NOT skip screens here,
-         * 3D viewport may contains pointers to other ID data (like bgpic)! See T41411. */
-        lib_link_screen(fd, bmain, (bScreen *)id);
-        break;
-      case ID_MC:
-        lib_link_movieclip(fd, bmain, (MovieClip *)id);
-        break;
-      case ID_WO:
-        lib_link_world(fd, bmain, (World *)id);
-        break;
-      case ID_LP:
-        lib_link_lightprobe(fd, bmain, (LightProbe *)id);
-        break;
-      case ID_SPK:
-        lib_link_speaker(fd, bmain, (Speaker *)id);
-        break;
-      case ID_PA:
-        lib_link_particlesettings(fd, bmain, (ParticleSettings *)id);
-        break;
-      case ID_PC:
-        lib_link_paint_curve(fd, bmain, (PaintCurve *)id);
-        break;
-      case ID_BR:
-        lib_link_brush(fd, bmain, (Brush *)id);
-        break;
-      case ID_GR:
-        lib_link_collection(fd, bmain, (Collection *)id);
-        break;
-      case ID_SO:
-        lib_link_sound(fd, bmain, (bSound *)id);
-        break;
-      case ID_TXT:
-        lib_link_text(fd, bmain, (Text *)id);
-        break;
-      case ID_CA:
-        lib_link_camera(fd, bmain, (Camera *)id);
-        break;
-      case ID_LA:
-        lib_link_light(fd, bmain, (Light *)id);
-        break;
-      case ID_LT:
-        lib_link_latt(fd, bmain, (Lattice *)id);
-        break;
-      case ID_MB:
-        lib_link_mball(fd, bmain, (MetaBall *)id);
-        break;
-      case ID_CU:
-        lib_link_curve(fd, bmain, (Curve *)id);
-        break;
-      case ID_ME:
-        lib_link_mesh(fd, bmain, (Mesh *)id);
-        break;
-      case ID_CF:
-        lib_link_cachefiles(fd, bmain, (CacheFile *)id);
-        break;
-      case ID_AR:
-        lib_link_armature(fd, bmain, (bArmature *)id);
-        break;
-      case ID_VF:
-        lib_link_vfont(fd, bmain, (VFont *)id);
-        break;
-      case ID_MA:
-        lib_link_material(fd, bmain, (Material *)id);
-        break;
-      case ID_TE:
-        lib_link_texture(fd, bmain, (Tex *)id);
-        break;
-      case ID_IM:
-        lib_link_image(fd, bmain, (Image *)id);
-        break;
-      case ID_NT:
-        /* Has to be done after node users (scene/materials/...), this will verify group nodes. */
-        lib_link_nodetree(fd, bmain, (bNodeTree *)id);
-        break;
-      case ID_GD:
-        lib_link_gpencil(fd, bmain, (bGPdata *)id);
-        break;
-      case ID_PAL:
-        lib_link_palette(fd, bmain, (Palette *)id);
-        break;
-      case ID_KE:
-        lib_link_key(fd, bmain, (Key *)id);
-        break;
-      case ID_AC:
-        lib_link_action(fd, bmain, (bAction *)id);
-        break;
-      case ID_IP:
-        /* XXX deprecated... still needs to be maintained for version patches still. */
-        lib_link_ipo(fd, bmain, (Ipo *)id);
-        break;
-      case ID_LI:
-        lib_link_library(fd, bmain, (Library *)id); /* Only init users. */
-        break;
-    }
+      fd->lib_link_lock = NULL;
+      BLI_spin_end(&lock);
 
-    id->tag &= ~LIB_TAG_NEED_LINK;
+      LISTBASE_FOREACH (ID *, id, lb) {
+        id->tag &= ~LIB_TAG_NEED_LINK;
+      }
+    }
+    else {
+      LISTBASE_FOREACH (ID *, id, lb) {
+        lib_link_all_id(fd, bmain, id);
+      }
+    }
   }
-  FOREACH_MAIN_ID_END;
+  FOREACH_MAIN_LISTBASE_END;
 
   /* Check for possible cycles in scenes' 'set' background property. */
   lib_link_scenes_check_set(bmain);
@@ -9539,6 +10683,18 @@ static void lib_link_all(FileData *fd, Main *bmain)
      * example of why it is such a bad idea to keep that kind of double-linked relationships info
      * 'permanently' in our data structures... */
     BKE_main_collections_parent_relations_rebuild(bmain);
+
+    if (fd->undo_old_ids != NULL) {
+      /* Reused collections may cache the objects of changed ones. */
+      LISTBASE_FOREACH (Collection *, collection, &bmain->collections) {
+        BKE_collection_object_cache_free(collection);
+      }
+      LISTBASE_FOREACH (Scene *, scene, &bmain->scenes) {
+        if (scene->master_collection != NULL) {
+          BKE_collection_object_cache_free(scene->master_collection);
+        }
+      }
+    }
   }
 }
 
@@ -9692,12 +10848,17 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+  if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
+    read_libblock_deferred_begin(fd);
+  }
+
   while (bhead) {
     switch (bhead->code) {
       case DATA:
       case DNA1:
       case TEST: /* used as preview since 2.5x */
       case REND:
+      case INDX:
         bhead = blo_bhead_next(fd, bhead);
         break;
       case GLOB:
@@ -9743,6 +10904,9 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     }
   }
 
+  /* All IDs must be complete before versioning. */
+  read_libblock_deferred_end(fd);
+
   /* do before read_libraries, but skip undo case */
   if (fd->memfile == NULL) {
     if ((fd->skip_flags & BLO_READ_SKIP_DATA) == 0) {
@@ -9794,6 +10958,9 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
     link_global(fd, bfd); /* as last */
   }
 
+  /* Versioning renames data-blocks directly, names are indexed again on first use. */
+  BKE_main_namemap_clear(bfd->main);
+
   fd->mainlist = NULL; /* Safety, this is local variable, shall not be used afterward. */
 
   return bfd;
@@ -9857,6 +11024,11 @@ static BHead *find_previous_lib(FileData *fd, BHead *bhead)
     return NULL;
   }
 
+  if (fd->bhead_index) {
+    const BHeadIndexEntry *entry = BLI_ghash_lookup(fd->bhead_index->old_map, bhead->old);
+    return (entry && entry->lib_offset) ? blo_bhead_at_offset(fd, entry->lib_offset) : NULL;
+  }
+
   for (; bhead; bhead = blo_bhead_prev(fd, bhead)) {
     if (bhead->code == ID_LI) {
       break;
@@ -9877,6 +11049,10 @@ static BHead *find_bhead(FileData *fd, void *old)
     return NULL;
   }
 
+  if (fd->bhead_index) {
+    return read_file_bhead_index_lookup_old(fd, old);
+  }
+
   if (fd->bheadmap == NULL) {
     sort_bhead_old_map(fd);
   }
@@ -9901,6 +11077,15 @@ static BHead *find_bhead(FileData *fd, void *old)
 
 static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const char *name)
 {
+  if (fd->bhead_index) {
+    char idname_full[MAX_ID_NAME];
+
+    *((short *)idname_full) = idcode;
+    BLI_strncpy(idname_full + 2, name, sizeof(idname_full) - 2);
+
+    return read_file_bhead_index_lookup_name(fd, idname_full);
+  }
+
 #ifdef USE_GHASH_BHEAD
 
   char idname_full[MAX_ID_NAME];
@@ -9931,6 +11116,10 @@ static BHead *find_bhead_from_code_name(FileData *fd, const short idcode, const
 
 static BHead *find_bhead_from_idname(FileData *fd, const char *idname)
 {
+  if (fd->bhead_index) {
+    return read_file_bhead_index_lookup_name(fd, idname);
+  }
+
 #ifdef USE_GHASH_BHEAD
   return BLI_ghash_lookup(fd->bhead_idname_hash, idname);
 #else
@@ -11413,6 +12602,8 @@ static void split_main_newid(Main *mainptr, Main *main_newid)
   ListBase *lbarray_newid[MAX_LIBARRAY];
   int i = set_listbasepointers(mainptr, lbarray);
   set_listbasepointers(main_newid, lbarray_newid);
+  BKE_main_namemap_clear(mainptr);
+  BKE_main_namemap_clear(main_newid);
   while (i--) {
     BLI_listbase_clear(lbarray_newid[i]);
 
@@ -11635,6 +12826,7 @@ static void read_library_linked_ids(FileData *basefd,
     while (id) {
       ID *id_next = id->next;
       if ((id->tag & LIB_TAG_ID_LINK_PLACEHOLDER) && !(id->flag & LIB_INDIRECT_WEAK_LINK)) {
+        BKE_main_namemap_remove_name(mainvar, id, id->name + 2);
         BLI_remlink(lbarray[a], id);
 
         /* When playing with lib renaming and such, you may end with cases where
@@ -26,16 +26,19 @@
 #define __READFILE_H__
 
 #include "zlib.h"
+#include "BLI_threads.h" /* for SpinLock */
 #include "DNA_sdna_types.h"
 #include "DNA_space_types.h"
 #include "DNA_windowmanager_types.h" /* for ReportType */
 
+struct GSet;
 struct Key;
 struct MemFile;
 struct Object;
 struct OldNewMap;
 struct PartEff;
 struct ReportList;
+struct TaskPool;
 struct View3D;
 
 enum eFileDataFlag {
@@ -60,6 +63,51 @@ typedef int64_t off64_t;
 typedef int(FileDataReadFn)(struct FileData *filedata, void *buffer, unsigned int size);
 typedef off64_t(FileDataSeekFn)(struct FileData *filedata, off64_t offset, int whence);
 
+/* -------------------------------------------------------------------- */
+/** \name Block Index
+ *
+ * Layout of the #INDX block data. It is stored in the native format of the file,
+ * and only used when no endian or pointer size conversion is needed.
+ * \{ */
+
+#define BHEAD_INDEX_MAGIC "BLENIDX1"
+
+typedef struct BHeadIndexHeader {
+  /** Offsets of the #DNA1 and #GLOB blocks. */
+  int64_t dna_offset;
+  int64_t glob_offset;
+  /**
+   * Always zero. Readers without #INDX support treat unknown block codes as ID blocks,
+   * these bytes overlap #ID.name so they see an unknown ID type and skip the block.
+   * #ID.name follows four pointers, so it's at byte 16 in files written by 32 bit builds and at
+   * byte 32 in files written by 64 bit builds, both are covered.
+   */
+  int64_t _pad[3];
+  int64_t entries_len;
+} BHeadIndexHeader;
+
+/** One for each ID block, in file order. Direct data follows the ID block. */
+typedef struct BHeadIndexEntry {
+  /** Offset of the ID block. */
+  int64_t offset;
+  /** For #ID_LINK_PLACEHOLDER, offset of the #ID_LI block of its library, otherwise zero. */
+  int64_t lib_offset;
+  /** #BHead.old */
+  uint64_t old;
+  int code;
+  char name[66]; /* MAX_ID_NAME */
+  char _pad[2];
+} BHeadIndexEntry;
+
+/** Last bytes of the #INDX block, directly before the #ENDB block. */
+typedef struct BHeadIndexFooter {
+  /** Offset of the #INDX block. */
+  int64_t index_offset;
+  char magic[8];
+} BHeadIndexFooter;
+
+/** \} */
+
 typedef struct FileData {
   /** Linked list of BHeadN's. */
   ListBase bhead_list;
@@ -83,6 +131,10 @@ typedef struct FileData {
   gzFile gzfiledes;
   /** Gzip stream for memory decompression. */
   z_stream strm;
+  /** Zstd decompression state (frame seek table, cached frame or stream). */
+  struct ZstdReadWrap *zstd;
+  /** Memory-mapped uncompressed file, data of deferred blocks is accessed in-place. */
+  struct BLI_mmap_file *mmap_file;
 
   /** Now only in use for library appending. */
   char relabase[FILE_MAX];
@@ -117,9 +169,25 @@ typedef struct FileData {
   /** See: #USE_GHASH_BHEAD. */
   struct GHash *bhead_idname_hash;
 
+  /** Contents of the #INDX block, when the file has one and can seek. */
+  struct BHeadIndex *bhead_index;
+
+  /** Reads and direct-links data of some ID types in tasks, see #read_libblock_deferred. */
+  struct TaskPool *direct_link_pool;
+  /** Per-thread copies of this #FileData used by the tasks of #direct_link_pool. */
+  struct FileData *direct_link_fds;
+  /** Set while lib-linking IDs in parallel, protects user counts, see #lib_link_all. */
+  SpinLock *lib_link_lock;
+
   ListBase *mainlist;
   /** Used for undo. */
   ListBase *old_mainlist;
+  /** Undo: local IDs of the old main, by address, see #blo_make_undo_old_id_map. */
+  struct GSet *undo_old_ids;
+  /** Undo: addresses of the IDs which are unchanged in the memfile, these are reused. */
+  struct GSet *undo_identical_ids;
+  /** Undo: some IDs of the old main aren't in the memfile (they're freed). */
+  bool undo_ids_removed;
 
   struct ReportList *reports;
 } FileData;
@@ -149,6 +217,10 @@ void blo_end_sound_pointer_map(FileData *fd, struct Main *oldmain);
 void blo_make_packed_pointer_map(FileData *fd, struct Main *oldmain);
 void blo_end_packed_pointer_map(FileData *fd, struct Main *oldmain);
 void blo_add_library_pointer_map(ListBase *old_mainlist, FileData *fd);
+void blo_make_undo_old_id_map(FileData *fd,
+                              struct Main *oldmain,
+                              const struct MemFile *oldmain_memfile);
+void blo_end_undo_old_id_map(FileData *fd);
 
 void blo_filedata_free(FileData *fd);
 
@@ -41,6 +41,7 @@
 #include "DNA_listBase.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_ghash.h"
 
 #include "BLO_undofile.h"
 #include "BLO_readfile.h"
@@ -52,73 +53,276 @@
 
 /* **************** support for memory-write, for undo buffers *************** */
 
+/* -------------------------------------------------------------------- */
+/** \name Chunk Store
+ *
+ * The data of chunks is stored once per contents, chunks with the same contents reference the
+ * same data, regardless of their position in the file or the undo step they belong to.
+ * All memfiles written using each other as reference share a single store.
+ * \{ */
+
+typedef struct MemFileSharedChunk {
+  const char *buf;
+  uint size;
+  /** Number of #MemFileChunk using this data. */
+  int users;
+  uint64_t hash;
+} MemFileSharedChunk;
+
+typedef struct MemFileChunkStore {
+  /** Set of #MemFileSharedChunk, by contents. */
+  GSet *chunks;
+  /** Number of #MemFile using this store. */
+  int users;
+} MemFileChunkStore;
+
+/**
+ * 64-bit MurmurHash (MurmurHash64A), only used to find candidates,
+ * the contents of chunks with the same hash are compared.
+ */
+static uint64_t memfile_chunk_hash(const char *buf, const uint size)
+{
+  const uint64_t m = 0xc6a4a7935bd1e995ull;
+  const int r = 47;
+  uint64_t h = (uint64_t)size * m;
+
+  const char *buf_end = buf + (size & ~7u);
+  for (; buf != buf_end; buf += 8) {
+    uint64_t k;
+    memcpy(&k, buf, sizeof(k));
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+
+  if (size & 7u) {
+    uint64_t k = 0;
+    memcpy(&k, buf_end, size & 7u);
+    h ^= k;
+    h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+static uint memfile_shared_chunk_hash(const void *key)
+{
+  const MemFileSharedChunk *shared = key;
+  return (uint)(shared->hash ^ (shared->hash >> 32));
+}
+
+static bool memfile_shared_chunk_cmp(const void *a, const void *b)
+{
+  const MemFileSharedChunk *shared_a = a;
+  const MemFileSharedChunk *shared_b = b;
+  if (shared_a == shared_b) {
+    return false;
+  }
+  return !((shared_a->hash == shared_b->hash) && (shared_a->size == shared_b->size) &&
+           (memcmp(shared_a->buf, shared_b->buf, shared_a->size) == 0));
+}
+
+static MemFileSharedChunk *memfile_shared_chunk_ensure(MemFile *memfile,
+                                                       const char *buf,
+                                                       const uint size)
+{
+  MemFileSharedChunk key = {
+      .buf = buf,
+      .size = size,
+      .hash = memfile_chunk_hash(buf, size),
+  };
+
+  MemFileSharedChunk *shared = BLI_gset_lookup(memfile->store->chunks, &key);
+  if (shared == NULL) {
+    char *buf_new = MEM_mallocN(size, "Chunk buffer");
+    memcpy(buf_new, buf, size);
+
+    shared = MEM_mallocN(sizeof(*shared), __func__);
+    *shared = key;
+    shared->buf = buf_new;
+    BLI_gset_insert(memfile->store->chunks, shared);
+
+    memfile->size += size;
+  }
+  return shared;
+}
+
+static void memfile_shared_chunk_release(MemFileChunkStore *store, MemFileSharedChunk *shared)
+{
+  BLI_assert(shared->users > 0);
+  shared->users--;
+  if (shared->users == 0) {
+    BLI_gset_remove(store->chunks, shared, NULL);
+    MEM_freeN((void *)shared->buf);
+    MEM_freeN(shared);
+  }
+}
+
+static void memfile_chunk_store_release(MemFileChunkStore *store)
+{
+  BLI_assert(store->users > 0);
+  store->users--;
+  if (store->users == 0) {
+    BLI_assert(BLI_gset_len(store->chunks) == 0);
+    BLI_gset_free(store->chunks, NULL);
+    MEM_freeN(store);
+  }
+}
+
+/** \} */
+
 /* not memfile itself */
 void BLO_memfile_free(MemFile *memfile)
 {
   MemFileChunk *chunk;
 
   while ((chunk = BLI_pophead(&memfile->chunks))) {
-    if (chunk->is_identical == false) {
-      MEM_freeN((void *)chunk->buf);
-    }
+    memfile_shared_chunk_release(memfile->store, chunk->shared);
     MEM_freeN(chunk);
   }
   memfile->size = 0;
+  memfile->size_shared = 0;
+
+  if (memfile->store != NULL) {
+    memfile_chunk_store_release(memfile->store);
+    memfile->store = NULL;
+  }
 }
 
 /* to keep list of memfiles consistent, 'first' is always first in list */
 /* result is that 'first' is being freed */
 void BLO_memfile_merge(MemFile *first, MemFile *second)
 {
-  MemFileChunk *fc, *sc;
-
-  fc = first->chunks.first;
-  sc = second->chunks.first;
-  while (fc || sc) {
-    if (fc && sc) {
-      if (sc->is_identical) {
-        sc->is_identical = false;
-        fc->is_identical = true;
-      }
-    }
-    if (fc) {
-      fc = fc->next;
-    }
-    if (sc) {
-      sc = sc->next;
+  BLO_memfile_free(first);
+
+  /* Data only kept alive by 'second' now, account for it there. */
+  LISTBASE_FOREACH (MemFileChunk *, chunk, &second->chunks) {
+    if (chunk->is_identical && chunk->shared->users == 1) {
+      chunk->is_identical = false;
+      second->size += chunk->size;
+      second->size_shared -= chunk->size;
     }
   }
+}
 
-  BLO_memfile_free(first);
+/**
+ * \param reference: The memfile of the previous step (can be NULL), its chunk store is shared.
+ */
+void memfile_write_init(MemFile *memfile, MemFile *reference)
+{
+  BLI_assert(memfile->store == NULL && BLI_listbase_is_empty(&memfile->chunks));
+
+  MemFileChunkStore *store = reference ? reference->store : NULL;
+  if (store == NULL) {
+    store = MEM_callocN(sizeof(*store), __func__);
+    store->chunks = BLI_gset_new(memfile_shared_chunk_hash, memfile_shared_chunk_cmp, __func__);
+  }
+  store->users++;
+  memfile->store = store;
 }
 
-void memfile_chunk_add(MemFile *memfile, const char *buf, uint size, MemFileChunk **compchunk_step)
+void memfile_chunk_add(
+    MemFile *memfile, const char *buf, uint size, const void *id, MemFileChunk **compchunk_step)
 {
   MemFileChunk *curchunk = MEM_mallocN(sizeof(MemFileChunk), "MemFileChunk");
   curchunk->size = size;
   curchunk->buf = NULL;
   curchunk->is_identical = false;
+  curchunk->shared = NULL;
+  curchunk->id = id;
   BLI_addtail(&memfile->chunks, curchunk);
 
-  /* we compare compchunk with buf */
+  /* we compare compchunk with buf, unchanged data is usually at the same position */
   if (*compchunk_step != NULL) {
     MemFileChunk *compchunk = *compchunk_step;
     if (compchunk->size == curchunk->size) {
       if (memcmp(compchunk->buf, buf, size) == 0) {
-        curchunk->buf = compchunk->buf;
-        curchunk->is_identical = true;
+        curchunk->shared = compchunk->shared;
       }
     }
     *compchunk_step = compchunk->next;
   }
 
-  /* not equal... */
-  if (curchunk->buf == NULL) {
-    char *buf_new = MEM_mallocN(size, "Chunk buffer");
-    memcpy(buf_new, buf, size);
-    curchunk->buf = buf_new;
-    memfile->size += size;
+  /* not equal... look it up by contents, otherwise it's added to the store */
+  if (curchunk->shared == NULL) {
+    curchunk->shared = memfile_shared_chunk_ensure(memfile, buf, size);
   }
+
+  if (curchunk->shared->users != 0) {
+    curchunk->is_identical = true;
+    memfile->size_shared += size;
+  }
+  curchunk->shared->users++;
+  curchunk->buf = curchunk->shared->buf;
+}
+
+/**
+ * Find the IDs stored identically in both memfiles,
+ * when both are written from the same main database (the address of an ID identifies it).
+ *
+ * \param r_ids_removed: Set when \a memfile_ref contains IDs which \a memfile doesn't.
+ * \return The set of identical ID addresses (as written),
+ * NULL when an address is used by IDs of different types in both memfiles.
+ */
+GSet *BLO_memfile_identical_ids(const MemFile *memfile,
+                                const MemFile *memfile_ref,
+                                bool *r_ids_removed)
+{
+  /* First chunk of each ID in the reference. */
+  GHash *id_chunks_ref = BLI_ghash_ptr_new(__func__);
+  const void *id_prev = NULL;
+  LISTBASE_FOREACH (const MemFileChunk *, chunk, &memfile_ref->chunks) {
+    if (chunk->id != NULL && chunk->id != id_prev) {
+      BLI_ghash_insert(id_chunks_ref, (void *)chunk->id, (void *)chunk);
+    }
+    id_prev = chunk->id;
+  }
+
+  GSet *identical_ids = BLI_gset_ptr_new(__func__);
+  uint ids_found_len = 0;
+
+  const MemFileChunk *chunk = memfile->chunks.first;
+  while (chunk != NULL) {
+    const void *id = chunk->id;
+    if (id == NULL) {
+      chunk = chunk->next;
+      continue;
+    }
+
+    const MemFileChunk *chunk_ref = BLI_ghash_lookup(id_chunks_ref, id);
+    if (chunk_ref != NULL) {
+      ids_found_len++;
+      /* The data of an ID starts with its #BHead, the code is the ID type. */
+      if (MIN2(chunk->size, chunk_ref->size) < sizeof(int) ||
+          memcmp(chunk->buf, chunk_ref->buf, sizeof(int)) != 0) {
+        BLI_gset_free(identical_ids, NULL);
+        identical_ids = NULL;
+        break;
+      }
+    }
+
+    bool is_identical = (chunk_ref != NULL);
+    for (; chunk != NULL && chunk->id == id; chunk = chunk->next) {
+      if (is_identical) {
+        is_identical = (chunk_ref != NULL) && (chunk_ref->id == id) &&
+                       (chunk_ref->shared == chunk->shared);
+        chunk_ref = chunk_ref ? chunk_ref->next : NULL;
+      }
+    }
+    if (is_identical && (chunk_ref == NULL || chunk_ref->id != id)) {
+      BLI_gset_insert(identical_ids, (void *)id);
+    }
+  }
+
+  *r_ids_removed = (ids_found_len != BLI_ghash_len(id_chunks_ref));
+  BLI_ghash_free(id_chunks_ref, NULL, NULL);
+
+  return identical_ids;
 }
 
 struct Main *BLO_memfile_main_get(struct MemFile *memfile,
@@ -127,7 +331,7 @@ struct Main *BLO_memfile_main_get(struct MemFile *memfile,
 {
   struct Main *bmain_undo = NULL;
   BlendFileData *bfd = BLO_read_from_memfile(
-      oldmain, BKE_main_blendfile_path(oldmain), memfile, BLO_READ_SKIP_NONE, NULL);
+      oldmain, BKE_main_blendfile_path(oldmain), memfile, NULL, BLO_READ_SKIP_NONE, NULL);
 
   if (bfd) {
     bmain_undo = bfd->main;
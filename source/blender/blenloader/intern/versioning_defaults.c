@@ -47,6 +47,7 @@
 #include "BKE_layer.h"
 #include "BKE_lib_id.h"
 #include "BKE_main.h"
+#include "BKE_main_namemap.h"
 #include "BKE_mesh.h"
 #include "BKE_node.h"
 #include "BKE_paint.h"
@@ -81,7 +82,9 @@ static ID *rename_id_for_versioning(Main *bmain,
     }
   }
   if (id != NULL) {
+    BKE_main_namemap_remove_name(bmain, id, id->name + 2);
     BLI_strncpy(id->name + 2, name_dst, sizeof(id->name) - 2);
+    BKE_main_namemap_add_name(bmain, id, id->name + 2);
     /* We know it's unique, this just sorts. */
     BLI_libblock_ensure_unique_name(bmain, id->name);
   }
@@ -384,7 +387,9 @@ void BLO_update_defaults_startup_blend(Main *bmain, const char *app_template)
     /* Default only has one window. */
     if (layout->screen) {
       bScreen *screen = layout->screen;
+      BKE_main_namemap_remove_name(bmain, &screen->id, screen->id.name + 2);
       BLI_strncpy(screen->id.name + 2, workspace->id.name + 2, sizeof(screen->id.name) - 2);
+      BKE_main_namemap_add_name(bmain, &screen->id, screen->id.name + 2);
       BLI_libblock_ensure_unique_name(bmain, screen->id.name);
     }
 
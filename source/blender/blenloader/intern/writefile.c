@@ -70,6 +70,8 @@
  * - write #GLOB (#FileGlobal struct) (some global vars).
  * - write #DNA1 (#SDNA struct)
  * - write #USER (#UserDef struct) if filename is ``~/.config/blender/X.XX/config/startup.blend``.
+ * - write #INDX (offsets of ID blocks, not written for undo).
+ * - write #ENDB (end of file).
  */
 
 #include <math.h>
@@ -144,7 +146,9 @@
 #include "MEM_guardedalloc.h"  // MEM_freeN
 #include "BLI_bitmap.h"
 #include "BLI_blenlib.h"
+#include "BLI_endian_switch.h"
 #include "BLI_mempool.h"
+#include "BLI_task.h"
 
 #include "BKE_action.h"
 #include "BKE_blender_version.h"
@@ -181,6 +185,10 @@
 
 #include <errno.h>
 
+#ifdef WITH_ZSTD
+#  include <zstd.h>
+#endif
+
 /* Make preferences read-only. */
 #define U (*((const UserDef *)&U))
 
@@ -190,9 +198,6 @@
 #define MYWRITE_BUFFER_SIZE (MEM_SIZE_OPTIMAL(1 << 17)) /* 128kb */
 #define MYWRITE_MAX_CHUNK (MEM_SIZE_OPTIMAL(1 << 15))   /* ~32kb */
 
-/** Use if we want to store how many bytes have been written to the file. */
-// #define USE_WRITE_DATA_LEN
-
 /* -------------------------------------------------------------------- */
 /** \name Internal Write Wrapper's (Abstracts Compression)
  * \{ */
@@ -200,6 +205,9 @@
 typedef enum {
   WW_WRAP_NONE = 1,
   WW_WRAP_ZLIB,
+#ifdef WITH_ZSTD
+  WW_WRAP_ZSTD,
+#endif
 } eWriteWrapType;
 
 typedef struct WriteWrap WriteWrap;
@@ -216,6 +224,9 @@ struct WriteWrap {
   union {
     int file_handle;
     gzFile gz_handle;
+#ifdef WITH_ZSTD
+    struct ZstdWriteWrap *zstd;
+#endif
   } _user_data;
 };
 
@@ -273,6 +284,225 @@ static size_t ww_write_zlib(WriteWrap *ww, const char *buf, size_t buf_len)
 }
 #undef FILE_HANDLE
 
+#ifdef WITH_ZSTD
+/* zstd
+ *
+ * The stream is split into independent frames of #ZSTD_WRITE_FRAME_SIZE bytes which are
+ * compressed in parallel using the task scheduler, then written out in order.
+ * A seek table is appended as a skippable frame (compatible with the zstd "seekable" format),
+ * so reading can decompress only the frames it needs, see #USE_BHEAD_READ_ON_DEMAND. */
+
+/** Uncompressed size of each frame. */
+#  define ZSTD_WRITE_FRAME_SIZE (1 << 20)
+#  define ZSTD_WRITE_COMPRESSION_LEVEL 3
+
+typedef struct ZstdWriteFrame {
+  struct ZstdWriteFrame *next, *prev;
+
+  void *uncompressed;
+  size_t uncompressed_size;
+
+  /** Set once the frame has been compressed. */
+  void *compressed;
+  size_t compressed_size;
+} ZstdWriteFrame;
+
+typedef struct ZstdWriteWrap {
+  int file_handle;
+  TaskPool *task_pool;
+
+  /** Frames submitted for compression, not yet written to the file. */
+  ListBase frames_pending;
+  int frames_pending_len;
+  int frames_pending_max;
+
+  /** Frame currently being filled, not yet submitted. */
+  char *frame_buf;
+  size_t frame_buf_used;
+
+  /** Seek table, one (compressed, uncompressed) size pair per written frame. */
+  uint32_t *seek_table;
+  uint32_t seek_table_len;
+  uint32_t seek_table_alloc;
+
+  bool write_error;
+} ZstdWriteWrap;
+
+#  define ZSTD_HANDLE(ww) (ww)->_user_data.zstd
+
+static void ww_zstd_compress_task(TaskPool *__restrict UNUSED(pool),
+                                  void *taskdata,
+                                  int UNUSED(threadid))
+{
+  ZstdWriteFrame *frame = taskdata;
+  const size_t bound = ZSTD_compressBound(frame->uncompressed_size);
+
+  frame->compressed = MEM_mallocN(bound, __func__);
+  frame->compressed_size = ZSTD_compress(frame->compressed,
+                                         bound,
+                                         frame->uncompressed,
+                                         frame->uncompressed_size,
+                                         ZSTD_WRITE_COMPRESSION_LEVEL);
+}
+
+static bool ww_zstd_write_raw(ZstdWriteWrap *zstd, const void *buf, size_t buf_len)
+{
+  if (zstd->write_error) {
+    return false;
+  }
+  if ((size_t)write(zstd->file_handle, buf, buf_len) != buf_len) {
+    zstd->write_error = true;
+    return false;
+  }
+  return true;
+}
+
+static void ww_zstd_seek_table_append(ZstdWriteWrap *zstd,
+                                      uint32_t compressed_size,
+                                      uint32_t uncompressed_size)
+{
+  if (zstd->seek_table_len == zstd->seek_table_alloc) {
+    zstd->seek_table_alloc = zstd->seek_table_alloc ? zstd->seek_table_alloc * 2 : 64;
+    zstd->seek_table = MEM_reallocN(zstd->seek_table,
+                                    sizeof(*zstd->seek_table) * 2 * zstd->seek_table_alloc);
+  }
+  zstd->seek_table[zstd->seek_table_len * 2 + 0] = compressed_size;
+  zstd->seek_table[zstd->seek_table_len * 2 + 1] = uncompressed_size;
+  zstd->seek_table_len++;
+}
+
+/**
+ * Wait for all pending frames to be compressed, then write them in order.
+ */
+static void ww_zstd_frames_flush(ZstdWriteWrap *zstd)
+{
+  BLI_task_pool_work_and_wait(zstd->task_pool);
+
+  LISTBASE_FOREACH_MUTABLE (ZstdWriteFrame *, frame, &zstd->frames_pending) {
+    if (ZSTD_isError(frame->compressed_size)) {
+      zstd->write_error = true;
+    }
+    else if (ww_zstd_write_raw(zstd, frame->compressed, frame->compressed_size)) {
+      ww_zstd_seek_table_append(
+          zstd, (uint32_t)frame->compressed_size, (uint32_t)frame->uncompressed_size);
+    }
+    MEM_freeN(frame->uncompressed);
+    MEM_SAFE_FREE(frame->compressed);
+    MEM_freeN(frame);
+  }
+  BLI_listbase_clear(&zstd->frames_pending);
+  zstd->frames_pending_len = 0;
+}
+
+static void ww_zstd_frame_submit(ZstdWriteWrap *zstd)
+{
+  if (zstd->frame_buf_used == 0) {
+    return;
+  }
+
+  ZstdWriteFrame *frame = MEM_callocN(sizeof(*frame), __func__);
+  frame->uncompressed = zstd->frame_buf;
+  frame->uncompressed_size = zstd->frame_buf_used;
+  BLI_addtail(&zstd->frames_pending, frame);
+  zstd->frames_pending_len++;
+
+  zstd->frame_buf = NULL;
+  zstd->frame_buf_used = 0;
+
+  BLI_task_pool_push(zstd->task_pool, ww_zstd_compress_task, frame, false, TASK_PRIORITY_HIGH);
+
+  /* Bound memory usage, while keeping enough frames in flight to use all threads. */
+  if (zstd->frames_pending_len >= zstd->frames_pending_max) {
+    ww_zstd_frames_flush(zstd);
+  }
+}
+
+static bool ww_open_zstd(WriteWrap *ww, const char *filepath)
+{
+  int file = BLI_open(filepath, O_BINARY + O_WRONLY + O_CREAT + O_TRUNC, 0666);
+
+  if (file == -1) {
+    return false;
+  }
+
+  TaskScheduler *scheduler = BLI_task_scheduler_get();
+  ZstdWriteWrap *zstd = MEM_callocN(sizeof(*zstd), __func__);
+  zstd->file_handle = file;
+  zstd->task_pool = BLI_task_pool_create(scheduler, NULL);
+  zstd->frames_pending_max = MAX2(2, BLI_task_scheduler_num_threads(scheduler) * 2);
+  ZSTD_HANDLE(ww) = zstd;
+  return true;
+}
+
+static bool ww_close_zstd(WriteWrap *ww)
+{
+  ZstdWriteWrap *zstd = ZSTD_HANDLE(ww);
+
+  ww_zstd_frame_submit(zstd);
+  ww_zstd_frames_flush(zstd);
+  BLI_task_pool_free(zstd->task_pool);
+
+  /* Seek table as a skippable frame, stored little-endian:
+   * frame header, (compressed, uncompressed) size pairs, then the footer. */
+  const uint32_t table_size = zstd->seek_table_len * 8 + 9;
+  uint32_t header[2] = {0x184D2A5E, table_size};
+  uint32_t footer_values[2] = {zstd->seek_table_len, 0x8F92EAB1};
+
+  if (ENDIAN_ORDER == B_ENDIAN) {
+    BLI_endian_switch_uint32_array(header, 2);
+    BLI_endian_switch_uint32_array(footer_values, 2);
+    BLI_endian_switch_uint32_array(zstd->seek_table, zstd->seek_table_len * 2);
+  }
+
+  uchar footer[9];
+  memcpy(&footer[0], &footer_values[0], sizeof(uint32_t));
+  footer[4] = 0; /* Descriptor flags, no checksums. */
+  memcpy(&footer[5], &footer_values[1], sizeof(uint32_t));
+
+  ww_zstd_write_raw(zstd, header, sizeof(header));
+  if (zstd->seek_table_len) {
+    ww_zstd_write_raw(zstd, zstd->seek_table, sizeof(uint32_t) * 2 * zstd->seek_table_len);
+  }
+  ww_zstd_write_raw(zstd, footer, sizeof(footer));
+
+  const bool ok = (close(zstd->file_handle) != -1) && !zstd->write_error;
+
+  MEM_SAFE_FREE(zstd->frame_buf);
+  MEM_SAFE_FREE(zstd->seek_table);
+  MEM_freeN(zstd);
+  ZSTD_HANDLE(ww) = NULL;
+
+  return ok;
+}
+
+static size_t ww_write_zstd(WriteWrap *ww, const char *buf, size_t buf_len)
+{
+  ZstdWriteWrap *zstd = ZSTD_HANDLE(ww);
+  size_t buf_done = 0;
+
+  if (zstd->write_error) {
+    return 0;
+  }
+
+  while (buf_done < buf_len) {
+    if (zstd->frame_buf == NULL) {
+      zstd->frame_buf = MEM_mallocN(ZSTD_WRITE_FRAME_SIZE, __func__);
+    }
+    const size_t len = MIN2(buf_len - buf_done, ZSTD_WRITE_FRAME_SIZE - zstd->frame_buf_used);
+    memcpy(zstd->frame_buf + zstd->frame_buf_used, buf + buf_done, len);
+    zstd->frame_buf_used += len;
+    buf_done += len;
+
+    if (zstd->frame_buf_used == ZSTD_WRITE_FRAME_SIZE) {
+      ww_zstd_frame_submit(zstd);
+    }
+  }
+
+  return zstd->write_error ? 0 : buf_len;
+}
+#  undef ZSTD_HANDLE
+#endif /* WITH_ZSTD */
+
 /* --- end compression types --- */
 
 static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
@@ -287,6 +517,16 @@ static void ww_handle_init(eWriteWrapType ww_type, WriteWrap *r_ww)
       r_ww->use_buf = false;
       break;
     }
+#ifdef WITH_ZSTD
+    case WW_WRAP_ZSTD: {
+      r_ww->open = ww_open_zstd;
+      r_ww->close = ww_close_zstd;
+      r_ww->write = ww_write_zstd;
+      /* Output is already buffered into frames. */
+      r_ww->use_buf = false;
+      break;
+    }
+#endif
     default: {
       r_ww->open = ww_open_none;
       r_ww->close = ww_close_none;
@@ -311,10 +551,8 @@ typedef struct {
   /** Number of bytes used in #WriteData.buf (flushed when exceeded). */
   int buf_used_len;
 
-#ifdef USE_WRITE_DATA_LEN
-  /** Total number of bytes written. */
+  /** Total number of bytes written (the offset of the next block in the file). */
   size_t write_len;
-#endif
 
   /** Set on unlikely case of an error (ignores further file writing).  */
   bool error;
@@ -325,10 +563,21 @@ typedef struct {
     MemFile *compare;
     /** Use to de-duplicate chunks when writing. */
     MemFileChunk *compare_chunk;
+    /** The ID being written, chunks are tagged with it. */
+    const ID *id;
   } mem;
   /** When true, write to #WriteData.current, could also call 'is_undo'. */
   bool use_memfile;
 
+  /** Offsets of ID blocks, written as the #INDX block (not used for undo). */
+  struct {
+    BHeadIndexHeader header;
+    BHeadIndexEntry *entries;
+    int64_t entries_alloc;
+    /** Offset of the last written library block, for linked ID placeholders. */
+    int64_t lib_offset;
+  } index;
+
   /**
    * Wrap writing, so we can use zlib or
    * other compression types later, see: G_FILE_COMPRESS
@@ -364,7 +613,7 @@ static void writedata_do_write(WriteData *wd, const void *mem, int memlen)
 
   /* memory based save */
   if (wd->use_memfile) {
-    memfile_chunk_add(wd->mem.current, mem, memlen, &wd->mem.compare_chunk);
+    memfile_chunk_add(wd->mem.current, mem, memlen, wd->mem.id, &wd->mem.compare_chunk);
   }
   else {
     if (wd->ww->write(wd->ww, mem, memlen) != memlen) {
@@ -378,6 +627,7 @@ static void writedata_free(WriteData *wd)
   if (wd->buf) {
     MEM_freeN(wd->buf);
   }
+  MEM_SAFE_FREE(wd->index.entries);
   MEM_freeN(wd);
 }
 
@@ -415,9 +665,7 @@ static void mywrite(WriteData *wd, const void *adr, int len)
     return;
   }
 
-#ifdef USE_WRITE_DATA_LEN
   wd->write_len += len;
-#endif
 
   if (wd->buf == NULL) {
     writedata_do_write(wd, adr, len);
@@ -465,6 +713,7 @@ static WriteData *mywrite_begin(WriteWrap *ww, MemFile *compare, MemFile *curren
   WriteData *wd = writedata_new(ww);
 
   if (current != NULL) {
+    memfile_write_init(current, compare);
     wd->mem.current = current;
     wd->mem.compare = compare;
     wd->mem.compare_chunk = compare ? compare->chunks.first : NULL;
@@ -495,6 +744,98 @@ static bool mywrite_end(WriteData *wd)
 
 /** \} */
 
+/* -------------------------------------------------------------------- */
+/** \name Block Index
+ *
+ * Offsets of ID blocks, so reading can seek directly to the ID's it needs when linking,
+ * instead of scanning the whole file, see #INDX.
+ * \{ */
+
+static void write_bhead_index_add(WriteData *wd, int filecode, const void *adr, const void *data)
+{
+  if (wd->use_memfile) {
+    return;
+  }
+
+  const int64_t offset = (int64_t)wd->write_len;
+
+  switch (filecode) {
+    case DATA:
+      return;
+    case GLOB:
+      wd->index.header.glob_offset = offset;
+      return;
+    case DNA1:
+      wd->index.header.dna_offset = offset;
+      return;
+    case ID_LI:
+      wd->index.lib_offset = offset;
+      break;
+    default:
+      if (!(BKE_idcode_is_valid(filecode) || ELEM(filecode, ID_SCRN, ID_LINK_PLACEHOLDER))) {
+        return;
+      }
+      break;
+  }
+
+  if (wd->index.header.entries_len == wd->index.entries_alloc) {
+    wd->index.entries_alloc = wd->index.entries_alloc ? wd->index.entries_alloc * 2 : 256;
+    wd->index.entries = MEM_reallocN(wd->index.entries,
+                                     sizeof(*wd->index.entries) * wd->index.entries_alloc);
+  }
+
+  BHeadIndexEntry *entry = &wd->index.entries[wd->index.header.entries_len++];
+  memset(entry, 0, sizeof(*entry));
+  entry->offset = offset;
+  entry->lib_offset = (filecode == ID_LINK_PLACEHOLDER) ? wd->index.lib_offset : 0;
+  entry->old = (uint64_t)(uintptr_t)adr;
+  entry->code = filecode;
+  BLI_strncpy(entry->name, ((const ID *)data)->name, sizeof(entry->name));
+}
+
+/**
+ * Write the index, this must be the last block before #ENDB
+ * since reading finds it from the end of the file.
+ */
+static void write_bhead_index(WriteData *wd)
+{
+  if (wd->use_memfile || wd->index.header.dna_offset == 0) {
+    return;
+  }
+
+  /* Older readers must find a zero ID code in the block, see #BHeadIndexHeader._pad.
+   * Checked for both pointer sizes, whatever the pointer size of this build is. */
+  BLI_STATIC_ASSERT(offsetof(ID, name) == 4 * sizeof(void *), "ID name must follow 4 pointers")
+  BLI_STATIC_ASSERT(offsetof(BHeadIndexHeader, _pad) <= 4 * 4 &&
+                        offsetof(BHeadIndexHeader, entries_len) >= 4 * 8 + 2,
+                    "ID name must overlap the index header padding for 32 and 64 bit files")
+  BLI_assert(wd->index.header._pad[0] == 0 && wd->index.header._pad[1] == 0 &&
+             wd->index.header._pad[2] == 0);
+
+  const size_t entries_size = sizeof(BHeadIndexEntry) * wd->index.header.entries_len;
+  const int len = (int)(sizeof(BHeadIndexHeader) + entries_size + sizeof(BHeadIndexFooter));
+
+  BHeadIndexFooter footer;
+  footer.index_offset = (int64_t)wd->write_len;
+  memcpy(footer.magic, BHEAD_INDEX_MAGIC, sizeof(footer.magic));
+
+  BHead bh;
+  bh.code = INDX;
+  bh.old = NULL;
+  bh.nr = 1;
+  bh.SDNAnr = 0;
+  bh.len = len;
+
+  mywrite(wd, &bh, sizeof(BHead));
+  mywrite(wd, &wd->index.header, sizeof(wd->index.header));
+  if (entries_size) {
+    mywrite(wd, wd->index.entries, entries_size);
+  }
+  mywrite(wd, &footer, sizeof(footer));
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Generic DNA File Writing
  * \{ */
@@ -525,6 +866,8 @@ static void writestruct_at_address_nr(
     return;
   }
 
+  write_bhead_index_add(wd, filecode, adr, data);
+
   mywrite(wd, &bh, sizeof(BHead));
   mywrite(wd, data, bh.len);
 }
@@ -576,6 +919,8 @@ static void writedata(WriteData *wd, int filecode, int len, const void *adr)
   bh.SDNAnr = 0;
   bh.len = len;
 
+  write_bhead_index_add(wd, filecode, adr, adr);
+
   mywrite(wd, &bh, sizeof(BHead));
   mywrite(wd, adr, len);
 }
@@ -3810,6 +4155,10 @@ static bool write_file_handle(Main *mainvar,
           BKE_lib_override_library_operations_store_start(bmain, override_storage, id);
         }
 
+        if (wd->use_memfile) {
+          wd->mem.id = id;
+        }
+
         switch ((ID_Type)GS(id->name)) {
           case ID_WM:
             write_windowmanager(wd, (wmWindowManager *)id);
@@ -3929,6 +4278,13 @@ static bool write_file_handle(Main *mainvar,
         if (do_override) {
           BKE_lib_override_library_operations_store_end(override_storage, id);
         }
+
+        if (wd->use_memfile) {
+          /* Undo chunks start at ID boundaries, so an ID's chunks stay identical
+           * when other IDs are added or removed, see #memfile_chunk_add. */
+          mywrite_flush(wd);
+          wd->mem.id = NULL;
+        }
       }
 
       mywrite_flush(wd);
@@ -3956,6 +4312,8 @@ static bool write_file_handle(Main *mainvar,
    * so writing each time uses the same address and doesn't cause unnecessary undo overhead. */
   writedata(wd, DNA1, wd->sdna->data_len, wd->sdna->data);
 
+  write_bhead_index(wd);
+
   /* end of file */
   memset(&bhead, 0, sizeof(BHead));
   bhead.code = ENDB;
@@ -4041,7 +4399,12 @@ bool BLO_write_file(Main *mainvar,
   BLI_snprintf(tempname, sizeof(tempname), "%s@", filepath);
 
   if (write_flags & G_FILE_COMPRESS) {
+    /* Gzip unless asked otherwise, older versions can't read Zstandard compressed files. */
+#ifdef WITH_ZSTD
+    ww_type = (write_flags & G_FILE_COMPRESS_ZSTD) ? WW_WRAP_ZSTD : WW_WRAP_ZLIB;
+#else
     ww_type = WW_WRAP_ZLIB;
+#endif
   }
   else {
     ww_type = WW_WRAP_NONE;
@@ -4091,9 +4454,11 @@ bool BLO_write_file(Main *mainvar,
   }
 
   /* actual file writing */
-  const bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, thumb);
+  bool err = write_file_handle(mainvar, &ww, NULL, NULL, write_flags, thumb);
 
-  ww.close(&ww);
+  if (ww.close(&ww) == false) {
+    err = true;
+  }
 
   if (UNLIKELY(path_list_backup)) {
     BKE_bpath_list_restore(mainvar, path_list_flag, path_list_backup);
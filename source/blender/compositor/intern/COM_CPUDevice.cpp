@@ -30,7 +30,12 @@ void CPUDevice::execute(WorkPackage *work)
 
   executionGroup->determineChunkRect(&rect, chunkNumber);
 
-  executionGroup->getOutputOperation()->executeRegion(&rect, chunkNumber);
+  /* Chunks scheduled before the user canceled are still finalized, so chunks waiting for them
+   * don't keep the WorkScheduler from finishing. */
+  NodeOperation *operation = executionGroup->getOutputOperation();
+  if (!operation->isBraked()) {
+    operation->executeRegion(&rect, chunkNumber);
+  }
 
   executionGroup->finalizeChunkExecution(chunkNumber, NULL);
 }
@@ -49,6 +49,7 @@ DebugInfo::OpNameMap DebugInfo::m_op_names;
 std::string DebugInfo::m_current_node_name;
 std::string DebugInfo::m_current_op_name;
 DebugInfo::GroupStateMap DebugInfo::m_group_states;
+DebugInfo::CacheLookupMap DebugInfo::m_cache_lookups;
 
 std::string DebugInfo::node_name(const Node *node)
 {
@@ -81,6 +82,7 @@ void DebugInfo::execute_started(const ExecutionSystem *system)
 {
   m_file_index = 1;
   m_group_states.clear();
+  m_cache_lookups.clear();
   for (ExecutionSystem::Groups::const_iterator it = system->m_groups.begin();
        it != system->m_groups.end();
        ++it) {
@@ -118,6 +120,27 @@ void DebugInfo::execution_group_finished(const ExecutionGroup *group)
   m_group_states[group] = EG_FINISHED;
 }
 
+void DebugInfo::result_cache_lookup(const NodeOperation *operation, bool hit)
+{
+  m_cache_lookups[operation] = hit;
+}
+
+void DebugInfo::result_cache_stats(size_t num_buffers, size_t memory_in_use)
+{
+  int hits = 0;
+  for (CacheLookupMap::const_iterator it = m_cache_lookups.begin(); it != m_cache_lookups.end();
+       ++it) {
+    if (it->second) {
+      hits++;
+    }
+  }
+  printf("Compositor result cache: %d hits, %d misses, %d buffers using %.2f MB\n",
+         hits,
+         (int)m_cache_lookups.size() - hits,
+         (int)num_buffers,
+         (double)memory_in_use / (1024.0 * 1024.0));
+}
+
 int DebugInfo::graphviz_operation(const ExecutionSystem *system,
                                   const NodeOperation *operation,
                                   const ExecutionGroup *group,
@@ -146,7 +169,13 @@ int DebugInfo::graphviz_operation(const ExecutionSystem *system,
     fillcolor = "darkolivegreen3";
   }
   else if (operation->isWriteBufferOperation()) {
-    fillcolor = "darkorange";
+    CacheLookupMap::const_iterator it = m_cache_lookups.find(operation);
+    if (it != m_cache_lookups.end() && it->second) {
+      fillcolor = "gold";
+    }
+    else {
+      fillcolor = "darkorange";
+    }
   }
 
   len += snprintf(str + len, maxlen > len ? maxlen - len : 0, "// OPERATION: %p\r\n", operation);
@@ -289,6 +318,8 @@ int DebugInfo::graphviz_legend(char *str, int maxlen)
       "Active Viewer", "lightskyblue1", str + len, maxlen > len ? maxlen - len : 0);
   len += graphviz_legend_color(
       "Write Buffer", "darkorange", str + len, maxlen > len ? maxlen - len : 0);
+  len += graphviz_legend_color(
+      "Cached Write Buffer", "gold", str + len, maxlen > len ? maxlen - len : 0);
   len += graphviz_legend_color(
       "Read Buffer", "darkolivegreen3", str + len, maxlen > len ? maxlen - len : 0);
   len += graphviz_legend_color(
@@ -525,6 +556,12 @@ void DebugInfo::execution_group_started(const ExecutionGroup * /*group*/)
 void DebugInfo::execution_group_finished(const ExecutionGroup * /*group*/)
 {
 }
+void DebugInfo::result_cache_lookup(const NodeOperation * /*operation*/, bool /*hit*/)
+{
+}
+void DebugInfo::result_cache_stats(size_t /*num_buffers*/, size_t /*memory_in_use*/)
+{
+}
 void DebugInfo::graphviz(const ExecutionSystem * /*system*/)
 {
 }
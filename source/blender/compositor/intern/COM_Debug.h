@@ -36,6 +36,7 @@ class DebugInfo {
   typedef std::map<const Node *, std::string> NodeNameMap;
   typedef std::map<const NodeOperation *, std::string> OpNameMap;
   typedef std::map<const ExecutionGroup *, GroupState> GroupStateMap;
+  typedef std::map<const NodeOperation *, bool> CacheLookupMap;
 
   static std::string node_name(const Node *node);
   static std::string operation_name(const NodeOperation *op);
@@ -51,6 +52,9 @@ class DebugInfo {
   static void execution_group_started(const ExecutionGroup *group);
   static void execution_group_finished(const ExecutionGroup *group);
 
+  static void result_cache_lookup(const NodeOperation *operation, bool hit);
+  static void result_cache_stats(size_t num_buffers, size_t memory_in_use);
+
   static void graphviz(const ExecutionSystem *system);
 
 #ifdef COM_DEBUG
@@ -75,6 +79,7 @@ class DebugInfo {
   static std::string m_current_node_name; /**< base name for all operations added by a node */
   static std::string m_current_op_name;   /**< base name for automatic sub-operations */
   static GroupStateMap m_group_states;    /**< for visualizing group states */
+  static CacheLookupMap m_cache_lookups;  /**< for visualizing result cache hits */
 #endif
 };
 
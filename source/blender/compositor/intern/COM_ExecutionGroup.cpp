@@ -46,6 +46,7 @@ ExecutionGroup::ExecutionGroup()
   this->m_isOutput = false;
   this->m_complex = false;
   this->m_chunkExecutionStates = NULL;
+  this->m_chunkNumPendingInputs = NULL;
   this->m_bTree = NULL;
   this->m_height = 0;
   this->m_width = 0;
@@ -127,14 +128,23 @@ void ExecutionGroup::initExecution()
   unsigned int index;
   determineNumberOfChunks();
 
+  /* When the output buffer is taken from the ResultCache there is nothing to calculate. */
+  NodeOperation *operation = this->getOutputOperation();
+  const bool isCached = operation->isWriteBufferOperation() &&
+                        ((WriteBufferOperation *)operation)->getMemoryProxy()->isCached();
+
   this->m_chunkExecutionStates = NULL;
   if (this->m_numberOfChunks != 0) {
     this->m_chunkExecutionStates = (ChunkExecutionState *)MEM_mallocN(
         sizeof(ChunkExecutionState) * this->m_numberOfChunks, __func__);
     for (index = 0; index < this->m_numberOfChunks; index++) {
-      this->m_chunkExecutionStates[index] = COM_ES_NOT_SCHEDULED;
+      this->m_chunkExecutionStates[index] = isCached ? COM_ES_EXECUTED : COM_ES_NOT_SCHEDULED;
     }
+    this->m_chunkNumPendingInputs = (unsigned int *)MEM_callocN(
+        sizeof(unsigned int) * this->m_numberOfChunks, __func__);
   }
+  this->m_chunkDependents.resize(this->m_numberOfChunks);
+  BLI_mutex_init(&this->m_chunkMutex);
 
   unsigned int maxNumber = 0;
 
@@ -156,12 +166,32 @@ void ExecutionGroup::deinitExecution()
     MEM_freeN(this->m_chunkExecutionStates);
     this->m_chunkExecutionStates = NULL;
   }
+  if (this->m_chunkNumPendingInputs != NULL) {
+    MEM_freeN(this->m_chunkNumPendingInputs);
+    this->m_chunkNumPendingInputs = NULL;
+  }
+  this->m_chunkDependents.clear();
+  BLI_mutex_end(&this->m_chunkMutex);
   this->m_numberOfChunks = 0;
   this->m_numberOfXChunks = 0;
   this->m_numberOfYChunks = 0;
   this->m_cachedReadOperations.clear();
   this->m_bTree = NULL;
 }
+
+bool ExecutionGroup::isFullyExecuted() const
+{
+  if (this->m_numberOfChunks == 0) {
+    return false;
+  }
+  for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+    if (this->m_chunkExecutionStates[index] != COM_ES_EXECUTED) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void ExecutionGroup::determineResolution(unsigned int resolution[2])
 {
   NodeOperation *operation = this->getOutputOperation();
@@ -322,51 +352,14 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
   DebugInfo::execution_group_started(this);
   DebugInfo::graphviz(graph);
 
-  bool breaked = false;
-  bool finished = false;
-  unsigned int startIndex = 0;
-  const int maxNumberEvaluated = BLI_system_thread_count() * 2;
-
-  while (!finished && !breaked) {
-    bool startEvaluated = false;
-    finished = true;
-    int numberEvaluated = 0;
-
-    for (index = startIndex;
-         index < this->m_numberOfChunks && numberEvaluated < maxNumberEvaluated;
-         index++) {
-      chunkNumber = chunkOrder[index];
-      int yChunk = chunkNumber / this->m_numberOfXChunks;
-      int xChunk = chunkNumber - (yChunk * this->m_numberOfXChunks);
-      const ChunkExecutionState state = this->m_chunkExecutionStates[chunkNumber];
-      if (state == COM_ES_NOT_SCHEDULED) {
-        scheduleChunkWhenPossible(graph, xChunk, yChunk);
-        finished = false;
-        startEvaluated = true;
-        numberEvaluated++;
-
-        if (bTree->update_draw) {
-          bTree->update_draw(bTree->udh);
-        }
-      }
-      else if (state == COM_ES_SCHEDULED) {
-        finished = false;
-        startEvaluated = true;
-        numberEvaluated++;
-      }
-      else if (state == COM_ES_EXECUTED && !startEvaluated) {
-        startIndex = index + 1;
-      }
-    }
-
-    WorkScheduler::finish();
-
+  /* Chunks are handed to the WorkScheduler in this order as soon as the chunks they read from
+   * are executed, there is no need to wait for a batch of chunks to finish. */
+  for (index = 0; index < this->m_numberOfChunks; index++) {
     if (bTree->test_break && bTree->test_break(bTree->tbh)) {
-      breaked = true;
+      break;
     }
+    scheduleChunkWhenPossible(graph, chunkOrder[index]);
   }
-  DebugInfo::execution_group_finished(this);
-  DebugInfo::graphviz(graph);
 
   MEM_freeN(chunkOrder);
 }
@@ -405,9 +398,13 @@ MemoryBuffer *ExecutionGroup::constructConsolidatedMemoryBuffer(MemoryProxy *mem
 
 void ExecutionGroup::finalizeChunkExecution(int chunkNumber, MemoryBuffer **memoryBuffers)
 {
+  vector<ChunkDependent> dependents;
+  BLI_mutex_lock(&this->m_chunkMutex);
   if (this->m_chunkExecutionStates[chunkNumber] == COM_ES_SCHEDULED) {
     this->m_chunkExecutionStates[chunkNumber] = COM_ES_EXECUTED;
   }
+  dependents.swap(this->m_chunkDependents[chunkNumber]);
+  BLI_mutex_unlock(&this->m_chunkMutex);
 
   atomic_add_and_fetch_u(&this->m_chunksFinished, 1);
   if (memoryBuffers) {
@@ -422,6 +419,11 @@ void ExecutionGroup::finalizeChunkExecution(int chunkNumber, MemoryBuffer **memo
     }
     MEM_freeN(memoryBuffers);
   }
+
+  for (unsigned int index = 0; index < dependents.size(); index++) {
+    dependents[index].group->chunkInputExecuted(dependents[index].chunkNumber);
+  }
+
   if (this->m_bTree) {
     // status report is only performed for top level Execution Groups.
     float progress = this->m_chunksFinished;
@@ -435,6 +437,9 @@ void ExecutionGroup::finalizeChunkExecution(int chunkNumber, MemoryBuffer **memo
                  this->m_chunksFinished,
                  this->m_numberOfChunks);
     this->m_bTree->stats_draw(this->m_bTree->sdh, buf);
+    if (this->m_bTree->update_draw) {
+      this->m_bTree->update_draw(this->m_bTree->udh);
+    }
   }
 }
 
@@ -481,10 +486,14 @@ MemoryBuffer *ExecutionGroup::allocateOutputBuffer(int /*chunkNumber*/, rcti *re
   return NULL;
 }
 
-bool ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *area)
+void ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph,
+                                              rcti *area,
+                                              ExecutionGroup *dependent,
+                                              unsigned int dependentChunk)
 {
   if (this->m_singleThreaded) {
-    return scheduleChunkWhenPossible(graph, 0, 0);
+    scheduleChunkForDependent(graph, 0, dependent, dependentChunk);
+    return;
   }
   // find all chunks inside the rect
   // determine minxchunk, minychunk, maxxchunk, maxychunk where x and y are chunknumbers
@@ -503,80 +512,78 @@ bool ExecutionGroup::scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *area
   maxxchunk = min_ii(maxxchunk, (int)m_numberOfXChunks);
   maxychunk = min_ii(maxychunk, (int)m_numberOfYChunks);
 
-  bool result = true;
   for (indexx = minxchunk; indexx < maxxchunk; indexx++) {
     for (indexy = minychunk; indexy < maxychunk; indexy++) {
-      if (!scheduleChunkWhenPossible(graph, indexx, indexy)) {
-        result = false;
-      }
+      const unsigned int chunkNumber = indexy * this->m_numberOfXChunks + indexx;
+      scheduleChunkForDependent(graph, chunkNumber, dependent, dependentChunk);
     }
   }
-
-  return result;
 }
 
-bool ExecutionGroup::scheduleChunk(unsigned int chunkNumber)
+void ExecutionGroup::scheduleChunkForDependent(ExecutionSystem *graph,
+                                               unsigned int chunkNumber,
+                                               ExecutionGroup *dependent,
+                                               unsigned int dependentChunk)
 {
-  if (this->m_chunkExecutionStates[chunkNumber] == COM_ES_NOT_SCHEDULED) {
-    this->m_chunkExecutionStates[chunkNumber] = COM_ES_SCHEDULED;
-    WorkScheduler::schedule(this, chunkNumber);
-    return true;
+  scheduleChunkWhenPossible(graph, chunkNumber);
+
+  /* Count the input before registering, it can be executed right after unlocking. */
+  atomic_add_and_fetch_u(&dependent->m_chunkNumPendingInputs[dependentChunk], 1);
+
+  BLI_mutex_lock(&this->m_chunkMutex);
+  const bool executed = this->m_chunkExecutionStates[chunkNumber] == COM_ES_EXECUTED;
+  if (!executed) {
+    ChunkDependent chunkDependent = {dependent, dependentChunk};
+    this->m_chunkDependents[chunkNumber].push_back(chunkDependent);
+  }
+  BLI_mutex_unlock(&this->m_chunkMutex);
+
+  if (executed) {
+    /* Never the last input, the dependent chunk is still being scheduled. */
+    atomic_sub_and_fetch_u(&dependent->m_chunkNumPendingInputs[dependentChunk], 1);
   }
-  return false;
 }
 
-bool ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, int xChunk, int yChunk)
+void ExecutionGroup::chunkInputExecuted(unsigned int chunkNumber)
 {
-  if (xChunk < 0 || xChunk >= (int)this->m_numberOfXChunks) {
-    return true;
-  }
-  if (yChunk < 0 || yChunk >= (int)this->m_numberOfYChunks) {
-    return true;
-  }
-  int chunkNumber = yChunk * this->m_numberOfXChunks + xChunk;
-  // chunk is already executed
-  if (this->m_chunkExecutionStates[chunkNumber] == COM_ES_EXECUTED) {
-    return true;
+  if (atomic_sub_and_fetch_u(&this->m_chunkNumPendingInputs[chunkNumber], 1) == 0) {
+    WorkScheduler::schedule(this, chunkNumber);
   }
+}
 
-  // chunk is scheduled, but not executed
-  if (this->m_chunkExecutionStates[chunkNumber] == COM_ES_SCHEDULED) {
-    return false;
+void ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, unsigned int chunkNumber)
+{
+  /* Chunks are only scheduled from the thread executing the ExecutionSystem, worker threads
+   * only change the state of scheduled chunks. */
+  if (this->m_chunkExecutionStates[chunkNumber] != COM_ES_NOT_SCHEDULED) {
+    return;
   }
-
-  // chunk is nor executed nor scheduled.
-  vector<MemoryProxy *> memoryProxies;
-  this->determineDependingMemoryProxies(&memoryProxies);
+  this->m_chunkExecutionStates[chunkNumber] = COM_ES_SCHEDULED;
+  /* Hold the chunk back until all chunks it reads from are known. */
+  this->m_chunkNumPendingInputs[chunkNumber] = 1;
 
   rcti rect;
-  determineChunkRect(&rect, xChunk, yChunk);
+  determineChunkRect(&rect, chunkNumber);
   unsigned int index;
-  bool canBeExecuted = true;
   rcti area;
 
   for (index = 0; index < this->m_cachedReadOperations.size(); index++) {
     ReadBufferOperation *readOperation =
         (ReadBufferOperation *)this->m_cachedReadOperations[index];
     BLI_rcti_init(&area, 0, 0, 0, 0);
-    MemoryProxy *memoryProxy = memoryProxies[index];
+    MemoryProxy *memoryProxy = readOperation->getMemoryProxy();
     determineDependingAreaOfInterest(&rect, readOperation, &area);
     ExecutionGroup *group = memoryProxy->getExecutor();
 
     if (group != NULL) {
-      if (!group->scheduleAreaWhenPossible(graph, &area)) {
-        canBeExecuted = false;
-      }
+      group->scheduleAreaWhenPossible(graph, &area, this, chunkNumber);
     }
     else {
       throw "ERROR";
     }
   }
 
-  if (canBeExecuted) {
-    scheduleChunk(chunkNumber);
-  }
-
-  return false;
+  chunkInputExecuted(chunkNumber);
 }
 
 void ExecutionGroup::determineDependingAreaOfInterest(rcti *input,
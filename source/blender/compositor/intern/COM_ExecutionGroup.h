@@ -27,6 +27,10 @@
 #include "COM_Device.h"
 #include "COM_CompositorContext.h"
 
+extern "C" {
+#include "BLI_threads.h"
+}
+
 using std::vector;
 
 class ExecutionSystem;
@@ -45,6 +49,7 @@ typedef enum ChunkExecutionState {
   COM_ES_NOT_SCHEDULED = 0,
   /**
    * \brief chunk is scheduled, but not yet executed
+   * \note the chunk may still be waiting for the chunks it reads from to be executed.
    */
   COM_ES_SCHEDULED = 1,
   /**
@@ -155,6 +160,32 @@ class ExecutionGroup {
    */
   ChunkExecutionState *m_chunkExecutionStates;
 
+  /**
+   * \brief a chunk of another ExecutionGroup that reads from a chunk of this ExecutionGroup
+   */
+  struct ChunkDependent {
+    ExecutionGroup *group;
+    unsigned int chunkNumber;
+  };
+
+  /**
+   * \brief per chunk the number of chunks it reads from that are not executed yet.
+   * \note while the chunks it reads from are being scheduled one extra is counted, so the chunk
+   * isn't handed to the WorkScheduler before all of them are known.
+   */
+  unsigned int *m_chunkNumPendingInputs;
+
+  /**
+   * \brief per chunk the chunks waiting for it to be executed.
+   */
+  vector<vector<ChunkDependent>> m_chunkDependents;
+
+  /**
+   * \brief protects m_chunkDependents and the executed state of chunks.
+   * chunks are executed on other threads while chunks are still being scheduled.
+   */
+  ThreadMutex m_chunkMutex;
+
   /**
    * \brief indicator when this ExecutionGroup has valid Operations in its vector for Execution
    * \note When building the ExecutionGroup Operations are added via recursion.
@@ -207,35 +238,42 @@ class ExecutionGroup {
   void determineNumberOfChunks();
 
   /**
-   * \brief try to schedule a specific chunk.
-   * \note scheduling succeeds when all input requirements are met and the chunks hasn't been
-   * scheduled yet.
+   * \brief schedule a specific chunk and the chunks of other ExecutionGroup's it reads from.
+   * \note the chunk is added to the WorkScheduler as soon as all chunks it reads from are
+   * executed, this can happen on the thread that executed the last of them.
+   * \note does nothing when the chunk has already been scheduled.
    * \param graph:
-   * \param xChunk:
-   * \param yChunk:
-   * \return [true:false]
-   * true: package(s) are scheduled
-   * false: scheduling is deferred (depending workpackages are scheduled)
+   * \param chunkNumber:
    */
-  bool scheduleChunkWhenPossible(ExecutionSystem *graph, int xChunk, int yChunk);
+  void scheduleChunkWhenPossible(ExecutionSystem *graph, unsigned int chunkNumber);
 
   /**
-   * \brief try to schedule a specific area.
-   * \note Check if a certain area is available, when not available this are will be checked.
+   * \brief schedule all chunks of a specific area, that a chunk of another ExecutionGroup
+   * reads from.
    * \note This method is called from other ExecutionGroup's.
    * \param graph:
    * \param rect:
-   * \return [true:false]
-   * true: package(s) are scheduled
-   * false: scheduling is deferred (depending workpackages are scheduled)
+   * \param dependent: the reading ExecutionGroup
+   * \param dependentChunk: the reading chunk, it is scheduled once the area is executed
    */
-  bool scheduleAreaWhenPossible(ExecutionSystem *graph, rcti *rect);
+  void scheduleAreaWhenPossible(ExecutionSystem *graph,
+                                rcti *rect,
+                                ExecutionGroup *dependent,
+                                unsigned int dependentChunk);
 
   /**
-   * \brief add a chunk to the WorkScheduler.
-   * \param chunknumber:
+   * \brief schedule a chunk and let a chunk of another ExecutionGroup wait for it.
+   */
+  void scheduleChunkForDependent(ExecutionSystem *graph,
+                                 unsigned int chunkNumber,
+                                 ExecutionGroup *dependent,
+                                 unsigned int dependentChunk);
+
+  /**
+   * \brief a chunk read by chunkNumber has been executed.
+   * \note when it was the last one the chunk is added to the WorkScheduler.
    */
-  bool scheduleChunk(unsigned int chunkNumber);
+  void chunkInputExecuted(unsigned int chunkNumber);
 
   /**
    * \brief determine the area of interest of a certain input area
@@ -378,10 +416,16 @@ class ExecutionGroup {
    */
   void deinitExecution();
 
+  /**
+   * \brief are all chunks of this ExecutionGroup executed
+   * \note only the chunks needed by other groups are executed when the output is a buffer.
+   */
+  bool isFullyExecuted() const;
+
   /**
    * \brief schedule an ExecutionGroup
-   * \note this method will return when all chunks have been calculated, or the execution has
-   * breaked (by user)
+   * \note this method returns once all chunks are scheduled, chunks of different
+   * ExecutionGroup's are executed at the same time. Use WorkScheduler.finish to wait for them.
    *
    * first the order of the chunks will be determined. This is determined by finding the
    * ViewerOperation and get the relevant information from it.
@@ -32,6 +32,7 @@ extern "C" {
 #include "COM_ExecutionGroup.h"
 #include "COM_WorkScheduler.h"
 #include "COM_ReadBufferOperation.h"
+#include "COM_ResultCache.h"
 #include "COM_Debug.h"
 
 #ifdef WITH_CXX_GUARDEDALLOC
@@ -148,6 +149,9 @@ void ExecutionSystem::execute()
   }
   unsigned int index;
 
+  /* Buffers that didn't change since an earlier execution are not calculated again. */
+  ResultCache::acquireBuffers(this);
+
   // First allocale all write buffer
   for (index = 0; index < this->m_operations.size(); index++) {
     NodeOperation *operation = this->m_operations[index];
@@ -188,6 +192,7 @@ void ExecutionSystem::execute()
 
   WorkScheduler::finish();
   WorkScheduler::stop();
+  ResultCache::storeBuffers(this);
 
   editingtree->stats_draw(editingtree->sdh, TIP_("Compositing | De-initializing execution"));
   for (index = 0; index < this->m_operations.size(); index++) {
@@ -198,6 +203,9 @@ void ExecutionSystem::execute()
     ExecutionGroup *executionGroup = this->m_groups[index];
     executionGroup->deinitExecution();
   }
+
+  ResultCache::releaseBuffers();
+  MemoryBuffer::clearBufferPool();
 }
 
 void ExecutionSystem::executeGroups(CompositorPriority priority)
@@ -210,6 +218,14 @@ void ExecutionSystem::executeGroups(CompositorPriority priority)
     ExecutionGroup *group = executionGroups[index];
     group->execute(this);
   }
+
+  WorkScheduler::finish();
+
+  for (index = 0; index < executionGroups.size(); index++) {
+    ExecutionGroup *group = executionGroups[index];
+    DebugInfo::execution_group_finished(group);
+  }
+  DebugInfo::graphviz(this);
 }
 
 void ExecutionSystem::findOutputExecutionGroup(vector<ExecutionGroup *> *result,
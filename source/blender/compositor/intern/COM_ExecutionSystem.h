@@ -191,6 +191,7 @@ class ExecutionSystem {
 
   /* allow the DebugInfo class to look at internals */
   friend class DebugInfo;
+  friend class ResultCache;
 
 #ifdef WITH_CXX_GUARDEDALLOC
   MEM_CXX_CLASS_ALLOC_FUNCS("COM:ExecutionSystem")
@@ -20,9 +20,75 @@
 
 #include "MEM_guardedalloc.h"
 
+extern "C" {
+#include "BLI_threads.h"
+}
+
 using std::max;
 using std::min;
 
+/* Buffers of deleted MemoryBuffers are kept for new MemoryBuffers of the same size. Most
+ * MemoryBuffers are temporary buffers of a chunk, so the sizes repeat for every chunk of an
+ * ExecutionGroup. Buffers with the size of a whole image are not kept. */
+
+static ThreadMutex g_buffer_pool_mutex = BLI_MUTEX_INITIALIZER;
+static std::vector<float *> g_buffer_pool;
+static size_t g_buffer_pool_size = 0;
+
+static float *buffer_alloc(size_t size)
+{
+  if (size <= COM_BUFFER_POOL_MAX_BUFFER_SIZE) {
+    BLI_mutex_lock(&g_buffer_pool_mutex);
+    for (size_t index = 0; index < g_buffer_pool.size(); index++) {
+      float *buffer = g_buffer_pool[index];
+      if (MEM_allocN_len(buffer) == size) {
+        g_buffer_pool[index] = g_buffer_pool.back();
+        g_buffer_pool.pop_back();
+        g_buffer_pool_size -= size;
+        BLI_mutex_unlock(&g_buffer_pool_mutex);
+        return buffer;
+      }
+    }
+    BLI_mutex_unlock(&g_buffer_pool_mutex);
+  }
+  return (float *)MEM_mallocN_aligned(size, 16, "COM_MemoryBuffer");
+}
+
+static void buffer_free(float *buffer)
+{
+  const size_t size = MEM_allocN_len(buffer);
+  if (size <= COM_BUFFER_POOL_MAX_BUFFER_SIZE) {
+    BLI_mutex_lock(&g_buffer_pool_mutex);
+    if (g_buffer_pool_size + size <= COM_BUFFER_POOL_MAX_SIZE) {
+      g_buffer_pool.push_back(buffer);
+      g_buffer_pool_size += size;
+      BLI_mutex_unlock(&g_buffer_pool_mutex);
+      return;
+    }
+    BLI_mutex_unlock(&g_buffer_pool_mutex);
+  }
+  MEM_freeN(buffer);
+}
+
+void MemoryBuffer::clearBufferPool()
+{
+  BLI_mutex_lock(&g_buffer_pool_mutex);
+  for (size_t index = 0; index < g_buffer_pool.size(); index++) {
+    MEM_freeN(g_buffer_pool[index]);
+  }
+  g_buffer_pool.clear();
+  g_buffer_pool_size = 0;
+  BLI_mutex_unlock(&g_buffer_pool_mutex);
+}
+
+size_t MemoryBuffer::getBufferPoolSize()
+{
+  BLI_mutex_lock(&g_buffer_pool_mutex);
+  const size_t size = g_buffer_pool_size;
+  BLI_mutex_unlock(&g_buffer_pool_mutex);
+  return size;
+}
+
 static unsigned int determine_num_channels(DataType datatype)
 {
   switch (datatype) {
@@ -58,8 +124,7 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, r
   this->m_memoryProxy = memoryProxy;
   this->m_chunkNumber = chunkNumber;
   this->m_num_channels = determine_num_channels(memoryProxy->getDataType());
-  this->m_buffer = (float *)MEM_mallocN_aligned(
-      sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+  this->m_buffer = buffer_alloc(sizeof(float) * determineBufferSize() * this->m_num_channels);
   this->m_state = COM_MB_ALLOCATED;
   this->m_datatype = memoryProxy->getDataType();
 }
@@ -72,8 +137,7 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
   this->m_memoryProxy = memoryProxy;
   this->m_chunkNumber = -1;
   this->m_num_channels = determine_num_channels(memoryProxy->getDataType());
-  this->m_buffer = (float *)MEM_mallocN_aligned(
-      sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+  this->m_buffer = buffer_alloc(sizeof(float) * determineBufferSize() * this->m_num_channels);
   this->m_state = COM_MB_TEMPORARILY;
   this->m_datatype = memoryProxy->getDataType();
 }
@@ -86,8 +150,7 @@ MemoryBuffer::MemoryBuffer(DataType dataType, rcti *rect)
   this->m_memoryProxy = NULL;
   this->m_chunkNumber = -1;
   this->m_num_channels = determine_num_channels(dataType);
-  this->m_buffer = (float *)MEM_mallocN_aligned(
-      sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+  this->m_buffer = buffer_alloc(sizeof(float) * determineBufferSize() * this->m_num_channels);
   this->m_state = COM_MB_TEMPORARILY;
   this->m_datatype = dataType;
 }
@@ -145,7 +208,7 @@ float MemoryBuffer::getMaximumValue(rcti *rect)
 MemoryBuffer::~MemoryBuffer()
 {
   if (this->m_buffer) {
-    MEM_freeN(this->m_buffer);
+    buffer_free(this->m_buffer);
     this->m_buffer = NULL;
   }
 }
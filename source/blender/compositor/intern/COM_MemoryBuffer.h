@@ -52,6 +52,13 @@ typedef enum MemoryBufferExtend {
 
 class MemoryProxy;
 
+/**
+ * \brief limits of the buffers kept for reuse after a MemoryBuffer is deleted, in bytes
+ * \ingroup Memory
+ */
+#define COM_BUFFER_POOL_MAX_BUFFER_SIZE (16 * 1024 * 1024)
+#define COM_BUFFER_POOL_MAX_SIZE (256 * 1024 * 1024)
+
 /**
  * \brief a MemoryBuffer contains access to the data of a chunk
  */
@@ -115,9 +122,20 @@ class MemoryBuffer {
 
   /**
    * \brief destructor
+   * \note the buffer is kept for a MemoryBuffer of the same size constructed later on.
    */
   ~MemoryBuffer();
 
+  /**
+   * \brief free all buffers kept for reuse, called after the execution of an ExecutionSystem.
+   */
+  static void clearBufferPool();
+
+  /**
+   * \brief size in bytes of all buffers kept for reuse
+   */
+  static size_t getBufferPoolSize();
+
   /**
    * \brief read the ChunkNumber of this MemoryBuffer
    */
@@ -140,6 +158,14 @@ class MemoryBuffer {
     return this->m_buffer;
   }
 
+  /**
+   * \brief set the proxy of a buffer that outlives its ExecutionSystem, see ResultCache
+   */
+  void setMemoryProxy(MemoryProxy *memoryProxy)
+  {
+    this->m_memoryProxy = memoryProxy;
+  }
+
   /**
    * \brief after execution the state will be set to available by calling this method
    */
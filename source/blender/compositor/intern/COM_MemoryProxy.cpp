@@ -22,6 +22,8 @@ MemoryProxy::MemoryProxy(DataType datatype)
 {
   this->m_writeBufferOperation = NULL;
   this->m_executor = NULL;
+  this->m_buffer = NULL;
+  this->m_isCached = false;
   this->m_datatype = datatype;
 }
 
@@ -36,9 +38,20 @@ void MemoryProxy::allocate(unsigned int width, unsigned int height)
   this->m_buffer = new MemoryBuffer(this, 1, &result);
 }
 
+void MemoryProxy::setCachedBuffer(MemoryBuffer *buffer)
+{
+  buffer->setMemoryProxy(this);
+  this->m_buffer = buffer;
+  this->m_isCached = true;
+}
+
 void MemoryProxy::free()
 {
-  if (this->m_buffer) {
+  if (this->m_isCached) {
+    this->m_buffer = NULL;
+    this->m_isCached = false;
+  }
+  else if (this->m_buffer) {
     delete this->m_buffer;
     this->m_buffer = NULL;
   }
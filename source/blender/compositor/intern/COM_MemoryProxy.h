@@ -58,6 +58,11 @@ class MemoryProxy {
    */
   MemoryBuffer *m_buffer;
 
+  /**
+   * \brief the memory is owned by the ResultCache and is not freed by this proxy
+   */
+  bool m_isCached;
+
   /**
    * \brief datatype of this MemoryProxy
    */
@@ -106,6 +111,19 @@ class MemoryProxy {
    */
   void allocate(unsigned int width, unsigned int height);
 
+  /**
+   * \brief use a buffer owned by the ResultCache instead of allocated memory
+   */
+  void setCachedBuffer(MemoryBuffer *buffer);
+
+  /**
+   * \brief is the buffer owned by the ResultCache
+   */
+  bool isCached() const
+  {
+    return this->m_isCached;
+  }
+
   /**
    * \brief free the allocated memory
    */
@@ -37,6 +37,8 @@ NodeOperation::NodeOperation()
   this->m_isResolutionSet = false;
   this->m_openCL = false;
   this->m_btree = NULL;
+  this->m_originNode = NULL;
+  this->m_originIndex = 0;
 }
 
 NodeOperation::~NodeOperation()
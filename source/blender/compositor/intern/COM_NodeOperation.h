@@ -126,6 +126,17 @@ class NodeOperation : public SocketReader {
    */
   bool m_isResolutionSet;
 
+  /**
+   * \brief the node this operation was created for
+   * \note the settings of the node are part of the key of the ResultCache
+   */
+  const bNode *m_originNode;
+
+  /**
+   * \brief index of this operation among the operations created for m_originNode
+   */
+  unsigned int m_originIndex;
+
  public:
   virtual ~NodeOperation();
 
@@ -190,6 +201,20 @@ class NodeOperation : public SocketReader {
   {
     this->m_btree = tree;
   }
+
+  void setOrigin(const bNode *node, unsigned int index)
+  {
+    this->m_originNode = node;
+    this->m_originIndex = index;
+  }
+  const bNode *getOriginNode() const
+  {
+    return this->m_originNode;
+  }
+  unsigned int getOriginIndex() const
+  {
+    return this->m_originIndex;
+  }
   virtual void initExecution();
 
   /**
@@ -0,0 +1,483 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <map>
+#include <string>
+#include <string.h>
+#include <typeinfo>
+#include <vector>
+
+#include "COM_ResultCache.h"
+#include "COM_Debug.h"
+#include "COM_ExecutionGroup.h"
+#include "COM_ExecutionSystem.h"
+#include "COM_ReadBufferOperation.h"
+#include "COM_WriteBufferOperation.h"
+
+extern "C" {
+#include "BLI_hash_md5.h"
+#include "BLI_hash_mm2a.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_camera_types.h"
+#include "DNA_color_types.h"
+#include "DNA_image_types.h"
+#include "DNA_node_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_camera.h"
+#include "BKE_image.h"
+#include "BKE_node.h"
+
+#include "IMB_imbuf_types.h"
+}
+
+#include "MEM_CacheLimiterC-Api.h"
+#include "MEM_guardedalloc.h"
+
+/** Raw data a key is made of, the MD5 digest of it is the key of an operation. */
+typedef std::string CacheKey;
+
+struct CacheEntry {
+  CacheKey key;
+  MemoryBuffer *buffer;
+  MEM_CacheLimiterHandleC *handle;
+};
+
+typedef std::map<CacheKey, CacheEntry *> CacheEntries;
+
+static MEM_CacheLimiterC *g_limiter = NULL;
+static CacheEntries g_entries;
+
+/** Entries referenced by the running execution. */
+static std::vector<CacheEntry *> g_used_entries;
+/** Keys of the write buffers of the running execution that can be cached. */
+static std::map<const WriteBufferOperation *, CacheKey> g_write_keys;
+
+/* -------------------------------------------------------------------- */
+/** \name Keys
+ * \{ */
+
+template<typename T> static void key_append(CacheKey &key, const T &value)
+{
+  key.append((const char *)&value, sizeof(value));
+}
+
+static void key_append_data(CacheKey &key, const void *data, size_t size)
+{
+  key.append((const char *)data, size);
+}
+
+static void key_append_string(CacheKey &key, const char *str)
+{
+  key.append(str ? str : "", str ? strlen(str) + 1 : 1);
+}
+
+static CacheKey key_digest(const CacheKey &data)
+{
+  char digest[16];
+  BLI_hash_md5_buffer(data.data(), data.size(), digest);
+  return CacheKey(digest, sizeof(digest));
+}
+
+/** Everything of the context operations read from while being converted or initialized. */
+static CacheKey context_key(const CompositorContext &context)
+{
+  const RenderData *rd = context.getRenderData();
+  CacheKey key;
+  key_append(key, (int)context.getQuality());
+  key_append(key, context.isRendering());
+  key_append_string(key, context.getViewName());
+  key_append(key, rd->xsch);
+  key_append(key, rd->ysch);
+  key_append(key, rd->size);
+  key_append(key, rd->xasp);
+  key_append(key, rd->yasp);
+  key_append(key, rd->mode & (R_BORDER | R_CROP));
+  key_append(key, rd->scemode & R_FULL_SAMPLE);
+  key_append(key, rd->border.xmin);
+  key_append(key, rd->border.xmax);
+  key_append(key, rd->border.ymin);
+  key_append(key, rd->border.ymax);
+  return key;
+}
+
+static void curvemapping_key(const CurveMapping *cumap, CacheKey &key)
+{
+  key_append(key, cumap->flag);
+  key_append(key, cumap->preset);
+  key_append_data(key, &cumap->clipr, sizeof(cumap->clipr));
+  key_append_data(key, cumap->black, sizeof(cumap->black));
+  key_append_data(key, cumap->white, sizeof(cumap->white));
+  for (int a = 0; a < CM_TOT; a++) {
+    const CurveMap *cuma = &cumap->cm[a];
+    key_append(key, cuma->totpoint);
+    key_append_data(key, cuma->ext_in, sizeof(cuma->ext_in));
+    key_append_data(key, cuma->ext_out, sizeof(cuma->ext_out));
+    for (int i = 0; i < cuma->totpoint; i++) {
+      key_append(key, cuma->curve[i].x);
+      key_append(key, cuma->curve[i].y);
+      key_append(key, (short)(cuma->curve[i].flag & ~CUMA_SELECT));
+    }
+  }
+}
+
+/**
+ * Still images are keyed on the content of their buffer, so reloading or painting on them
+ * invalidates the results.
+ */
+static bool image_key(const bNode *node, CacheKey &key)
+{
+  Image *ima = (Image *)node->id;
+  if (ima == NULL) {
+    return true;
+  }
+  if (!ELEM(ima->source, IMA_SRC_FILE, IMA_SRC_GENERATED) ||
+      !ELEM(ima->type, IMA_TYPE_IMAGE, IMA_TYPE_UV_TEST) || BKE_image_is_multiview(ima)) {
+    return false;
+  }
+
+  key_append(key, ima);
+  key_append(key, ima->alpha_mode);
+  key_append_string(key, ima->colorspace_settings.name);
+
+  ImBuf *ibuf = BKE_image_acquire_ibuf(ima, NULL, NULL);
+  key_append(key, ibuf);
+  if (ibuf) {
+    const size_t num_pixels = (size_t)ibuf->x * (size_t)ibuf->y;
+    key_append(key, ibuf->x);
+    key_append(key, ibuf->y);
+    key_append(key, ibuf->channels);
+    key_append(key, ibuf->rect_colorspace);
+    key_append(key, ibuf->float_colorspace);
+    /* The float buffer is created from the byte buffer on first use, prefer the latter. */
+    if (ibuf->rect) {
+      key_append(key, BLI_hash_mm2((const uchar *)ibuf->rect, num_pixels * sizeof(uint), 0));
+    }
+    else if (ibuf->rect_float) {
+      key_append(key,
+                 BLI_hash_mm2((const uchar *)ibuf->rect_float,
+                              num_pixels * ibuf->channels * sizeof(float),
+                              0));
+    }
+    if (ibuf->zbuf_float) {
+      key_append(key,
+                 BLI_hash_mm2((const uchar *)ibuf->zbuf_float, num_pixels * sizeof(float), 0));
+    }
+  }
+  BKE_image_release_ibuf(ima, ibuf, NULL);
+  return true;
+}
+
+static void defocus_key(const CompositorContext &context, const bNode *node, CacheKey &key)
+{
+  const NodeDefocus *data = (const NodeDefocus *)node->storage;
+  if (data->no_zbuf) {
+    return;
+  }
+  Scene *scene = node->id ? (Scene *)node->id : context.getScene();
+  Object *camob = scene ? scene->camera : NULL;
+  key_append(key, camob);
+  if (camob && camob->type == OB_CAMERA) {
+    const Camera *cam = (const Camera *)camob->data;
+    key_append(key, cam->lens);
+    key_append(key, cam->sensor_fit);
+    key_append(key, cam->sensor_x);
+    key_append(key, cam->sensor_y);
+    key_append(key, BKE_camera_object_dof_distance(camob));
+  }
+}
+
+/**
+ * Append the settings of a node to the key.
+ * \return false when the output depends on data that isn't part of the node tree.
+ */
+static bool node_key(const CompositorContext &context, const bNode *node, CacheKey &key)
+{
+  key_append(key, node->type);
+  key_append(key, node->custom1);
+  key_append(key, node->custom2);
+  key_append(key, node->custom3);
+  key_append(key, node->custom4);
+
+  for (const bNodeSocket *sock = (const bNodeSocket *)node->inputs.first; sock;
+       sock = sock->next) {
+    if (sock->default_value &&
+        ELEM(sock->type, SOCK_FLOAT, SOCK_INT, SOCK_BOOLEAN, SOCK_VECTOR, SOCK_RGBA)) {
+      key_append_data(key, sock->default_value, MEM_allocN_len(sock->default_value));
+    }
+  }
+
+  /* The storage is copied with the localized node tree, pointers in it can't be part of the
+   * key. */
+  switch (node->type) {
+    case CMP_NODE_IMAGE:
+      key_append_data(key, node->storage, sizeof(ImageUser));
+      return image_key(node, key);
+    case CMP_NODE_TIME:
+      key_append(key, context.getFramenumber());
+      curvemapping_key((const CurveMapping *)node->storage, key);
+      return true;
+    case CMP_NODE_CURVE_VEC:
+    case CMP_NODE_CURVE_RGB:
+    case CMP_NODE_HUECORRECT:
+      curvemapping_key((const CurveMapping *)node->storage, key);
+      return true;
+    case CMP_NODE_CRYPTOMATTE: {
+      const NodeCryptomatte *data = (const NodeCryptomatte *)node->storage;
+      key_append_data(key, data->add, sizeof(data->add));
+      key_append_data(key, data->remove, sizeof(data->remove));
+      key_append(key, data->num_inputs);
+      key_append_string(key, data->matte_id);
+      return true;
+    }
+    case CMP_NODE_DEFOCUS:
+      key_append_data(key, node->storage, MEM_allocN_len(node->storage));
+      defocus_key(context, node, key);
+      return true;
+    default:
+      if (node->id) {
+        return false;
+      }
+      if (node->storage) {
+        key_append_data(key, node->storage, MEM_allocN_len(node->storage));
+      }
+      return true;
+  }
+}
+
+struct OperationKey {
+  bool cacheable;
+  CacheKey key;
+};
+
+typedef std::map<const bNode *, OperationKey> NodeKeys;
+typedef std::map<const NodeOperation *, OperationKey> OperationKeys;
+
+struct KeyBuilder {
+  const CompositorContext &context;
+  CacheKey context_data;
+  NodeKeys node_keys;
+  OperationKeys operation_keys;
+
+  KeyBuilder(const CompositorContext &context_)
+      : context(context_), context_data(context_key(context_))
+  {
+  }
+
+  const OperationKey &node(const bNode *node)
+  {
+    NodeKeys::iterator it = node_keys.find(node);
+    if (it != node_keys.end()) {
+      return it->second;
+    }
+    OperationKey &result = node_keys[node];
+    result.cacheable = node_key(context, node, result.key);
+    return result;
+  }
+
+  const OperationKey &operation(NodeOperation *operation)
+  {
+    OperationKeys::iterator it = operation_keys.find(operation);
+    if (it != operation_keys.end()) {
+      return it->second;
+    }
+
+    if (operation->isReadBufferOperation()) {
+      MemoryProxy *proxy = ((ReadBufferOperation *)operation)->getMemoryProxy();
+      const OperationKey &result = this->operation(proxy->getWriteBufferOperation());
+      return operation_keys[operation] = result;
+    }
+
+    OperationKey result;
+    result.cacheable = true;
+
+    CacheKey data = context_data;
+    key_append_string(data, typeid(*operation).name());
+    key_append(data, operation->getWidth());
+    key_append(data, operation->getHeight());
+    for (unsigned int index = 0; index < operation->getNumberOfOutputSockets(); index++) {
+      key_append(data, operation->getOutputSocket(index)->getDataType());
+    }
+
+    if (operation->getOriginNode()) {
+      const OperationKey &origin_key = node(operation->getOriginNode());
+      result.cacheable = origin_key.cacheable;
+      data.append(origin_key.key);
+      key_append(data, operation->getOriginIndex());
+    }
+
+    if (result.cacheable && operation->isSetOperation()) {
+      float value[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+      operation->readSampled(value, 0.0f, 0.0f, COM_PS_NEAREST);
+      key_append_data(data, value, sizeof(value));
+    }
+
+    for (unsigned int index = 0; index < operation->getNumberOfInputSockets() && result.cacheable;
+         index++) {
+      NodeOperationInput *input = operation->getInputSocket(index);
+      key_append(data, input->getDataType());
+      key_append(data, input->getResizeMode());
+
+      NodeOperationOutput *link = input->getLink();
+      if (link == NULL) {
+        continue;
+      }
+      NodeOperation &input_operation = link->getOperation();
+      const OperationKey &input_key = this->operation(&input_operation);
+      result.cacheable = input_key.cacheable;
+      data.append(input_key.key);
+      for (unsigned int output = 0; output < input_operation.getNumberOfOutputSockets();
+           output++) {
+        if (input_operation.getOutputSocket(output) == link) {
+          key_append(data, output);
+        }
+      }
+    }
+
+    if (result.cacheable) {
+      result.key = key_digest(data);
+    }
+    return operation_keys[operation] = result;
+  }
+};
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Cache
+ * \{ */
+
+static void cache_entry_free(void *data)
+{
+  CacheEntry *entry = (CacheEntry *)data;
+  g_entries.erase(entry->key);
+  delete entry->buffer;
+  delete entry;
+}
+
+static size_t cache_entry_size(void *data)
+{
+  CacheEntry *entry = (CacheEntry *)data;
+  return sizeof(MemoryBuffer) + MEM_allocN_len(entry->buffer->getBuffer());
+}
+
+void ResultCache::acquireBuffers(ExecutionSystem *system)
+{
+  if (g_limiter == NULL) {
+    g_limiter = new_MEM_CacheLimiter(cache_entry_free, cache_entry_size);
+  }
+
+  KeyBuilder keys(system->getContext());
+  for (unsigned int index = 0; index < system->m_operations.size(); index++) {
+    NodeOperation *operation = system->m_operations[index];
+    if (!operation->isWriteBufferOperation()) {
+      continue;
+    }
+    WriteBufferOperation *writeOperation = (WriteBufferOperation *)operation;
+    const OperationKey &key = keys.operation(writeOperation);
+    if (!key.cacheable) {
+      continue;
+    }
+    g_write_keys[writeOperation] = key.key;
+
+    CacheEntries::iterator it = g_entries.find(key.key);
+    const bool hit = it != g_entries.end();
+    if (hit) {
+      CacheEntry *entry = it->second;
+      MEM_CacheLimiter_ref(entry->handle);
+      MEM_CacheLimiter_touch(entry->handle);
+      g_used_entries.push_back(entry);
+      writeOperation->getMemoryProxy()->setCachedBuffer(entry->buffer);
+    }
+    DebugInfo::result_cache_lookup(writeOperation, hit);
+  }
+}
+
+void ResultCache::storeBuffers(ExecutionSystem *system)
+{
+  /* Buffers of a canceled execution may be incomplete. */
+  const bNodeTree *btree = system->getContext().getbNodeTree();
+  if (btree->test_break && btree->test_break(btree->tbh)) {
+    return;
+  }
+
+  for (unsigned int index = 0; index < system->m_groups.size(); index++) {
+    ExecutionGroup *group = system->m_groups[index];
+    NodeOperation *operation = group->getOutputOperation();
+    if (!operation->isWriteBufferOperation()) {
+      continue;
+    }
+    WriteBufferOperation *writeOperation = (WriteBufferOperation *)operation;
+    MemoryProxy *proxy = writeOperation->getMemoryProxy();
+    if (proxy->isCached() || proxy->getBuffer() == NULL || !group->isFullyExecuted()) {
+      continue;
+    }
+    std::map<const WriteBufferOperation *, CacheKey>::const_iterator key = g_write_keys.find(
+        writeOperation);
+    /* Another group can have calculated the same buffer. */
+    if (key == g_write_keys.end() || g_entries.count(key->second)) {
+      continue;
+    }
+
+    CacheEntry *entry = new CacheEntry();
+    entry->key = key->second;
+    entry->buffer = proxy->getBuffer();
+    entry->handle = MEM_CacheLimiter_insert(g_limiter, entry);
+    MEM_CacheLimiter_ref(entry->handle);
+    g_entries[entry->key] = entry;
+    g_used_entries.push_back(entry);
+    proxy->setCachedBuffer(entry->buffer);
+  }
+}
+
+void ResultCache::releaseBuffers()
+{
+  for (unsigned int index = 0; index < g_used_entries.size(); index++) {
+    MEM_CacheLimiter_unref(g_used_entries[index]->handle);
+  }
+  g_used_entries.clear();
+  g_write_keys.clear();
+
+  if (g_limiter) {
+    MEM_CacheLimiter_enforce_limits(g_limiter);
+    DebugInfo::result_cache_stats(g_entries.size(), MEM_CacheLimiter_get_memory_in_use(g_limiter));
+  }
+}
+
+void ResultCache::clear()
+{
+  BLI_assert(g_used_entries.empty());
+  for (CacheEntries::iterator it = g_entries.begin(); it != g_entries.end(); ++it) {
+    CacheEntry *entry = it->second;
+    MEM_CacheLimiter_unmanage(entry->handle);
+    delete entry->buffer;
+    delete entry;
+  }
+  g_entries.clear();
+}
+
+void ResultCache::deinitialize()
+{
+  clear();
+  if (g_limiter) {
+    delete_MEM_CacheLimiter(g_limiter);
+    g_limiter = NULL;
+  }
+}
+
+/** \} */
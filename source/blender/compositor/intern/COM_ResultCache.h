@@ -0,0 +1,66 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __COM_RESULTCACHE_H__
+#define __COM_RESULTCACHE_H__
+
+class ExecutionSystem;
+
+/**
+ * \brief keeps the buffers calculated by an ExecutionSystem for later executions
+ *
+ * Every NodeOperation gets a key describing everything its output depends on: the settings of
+ * the node it was created for, its resolution and the keys of its inputs. Buffers written by a
+ * WriteBufferOperation are kept between executions, an ExecutionGroup writing a buffer with an
+ * unchanged key is not executed again, neither are the groups it reads from.
+ *
+ * Nodes using data from outside the node tree (render layers, movie clips, masks, image
+ * sequences, ...) are never cached, neither is anything depending on them.
+ *
+ * The memory is limited by a MEM_CacheLimiter, the least recently used buffers are freed first.
+ * \ingroup execution
+ */
+class ResultCache {
+ public:
+  /**
+   * \brief hand the cached buffers to the MemoryProxy's of the system
+   * \note called before the WriteBufferOperation's are initialized
+   */
+  static void acquireBuffers(ExecutionSystem *system);
+
+  /**
+   * \brief add the buffers calculated by the system to the cache
+   * \note called after the execution, before the operations are deinitialized
+   */
+  static void storeBuffers(ExecutionSystem *system);
+
+  /**
+   * \brief release the buffers used by the last execution and enforce the memory limit
+   */
+  static void releaseBuffers();
+
+  /**
+   * \brief free all cached buffers
+   */
+  static void clear();
+
+  /**
+   * \brief free all cached buffers and the cache limiter
+   */
+  static void deinitialize();
+};
+
+#endif /* __COM_RESULTCACHE_H__ */
@@ -29,7 +29,10 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "PIL_time.h"
+#include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "BKE_global.h"
@@ -49,11 +52,14 @@ static vector<CPUDevice *> g_cpudevices;
 static ThreadLocal(CPUDevice *) g_thread_device;
 
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-/// \brief list of all thread for every CPUDevice in cpudevices a thread exists
-static ListBase g_cputhreads;
+/// \brief task scheduler for the cpu, for every thread of it a CPUDevice exists
+static TaskScheduler *g_cpuscheduler = NULL;
+static int g_cpuNumThreads = 0;
 static bool g_cpuInitialized = false;
 /// \brief all scheduled work for the cpu
-static ThreadQueue *g_cpuqueue;
+static TaskPool *g_cpupool = NULL;
+/// \brief number of scheduled work packages that are not yet executed
+static unsigned int g_numScheduledPackages = 0;
 static ThreadQueue *g_gpuqueue;
 #  ifdef COM_OPENCL_ENABLED
 static cl_context g_context;
@@ -72,17 +78,14 @@ static bool g_openclInitialized = false;
 #endif
 
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-void *WorkScheduler::thread_execute_cpu(void *data)
+void WorkScheduler::thread_execute_cpu(TaskPool *__restrict /*pool*/, void *data, int thread_id)
 {
-  CPUDevice *device = (CPUDevice *)data;
-  WorkPackage *work;
+  CPUDevice *device = g_cpudevices[thread_id];
+  WorkPackage *work = (WorkPackage *)data;
   BLI_thread_local_set(g_thread_device, device);
-  while ((work = (WorkPackage *)BLI_thread_queue_pop(g_cpuqueue))) {
-    device->execute(work);
-    delete work;
-  }
-
-  return NULL;
+  device->execute(work);
+  delete work;
+  atomic_sub_and_fetch_u(&g_numScheduledPackages, 1);
 }
 
 void *WorkScheduler::thread_execute_gpu(void *data)
@@ -93,6 +96,7 @@ void *WorkScheduler::thread_execute_gpu(void *data)
   while ((work = (WorkPackage *)BLI_thread_queue_pop(g_gpuqueue))) {
     device->execute(work);
     delete work;
+    atomic_sub_and_fetch_u(&g_numScheduledPackages, 1);
   }
 
   return NULL;
@@ -107,15 +111,16 @@ void WorkScheduler::schedule(ExecutionGroup *group, int chunkNumber)
   device.execute(package);
   delete package;
 #elif COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
+  atomic_add_and_fetch_u(&g_numScheduledPackages, 1);
 #  ifdef COM_OPENCL_ENABLED
   if (group->isOpenCL() && g_openclActive) {
     BLI_thread_queue_push(g_gpuqueue, package);
   }
   else {
-    BLI_thread_queue_push(g_cpuqueue, package);
+    BLI_task_pool_push(g_cpupool, thread_execute_cpu, package, false, TASK_PRIORITY_LOW);
   }
 #  else
-  BLI_thread_queue_push(g_cpuqueue, package);
+  BLI_task_pool_push(g_cpupool, thread_execute_cpu, package, false, TASK_PRIORITY_LOW);
 #  endif
 #endif
 }
@@ -123,14 +128,10 @@ void WorkScheduler::schedule(ExecutionGroup *group, int chunkNumber)
 void WorkScheduler::start(CompositorContext &context)
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-  unsigned int index;
-  g_cpuqueue = BLI_thread_queue_init();
-  BLI_threadpool_init(&g_cputhreads, thread_execute_cpu, g_cpudevices.size());
-  for (index = 0; index < g_cpudevices.size(); index++) {
-    Device *device = g_cpudevices[index];
-    BLI_threadpool_insert(&g_cputhreads, device);
-  }
+  g_cpupool = BLI_task_pool_create(g_cpuscheduler, NULL);
+  g_numScheduledPackages = 0;
 #  ifdef COM_OPENCL_ENABLED
+  unsigned int index;
   if (context.getHasActiveOpenCLDevices()) {
     g_gpuqueue = BLI_thread_queue_init();
     BLI_threadpool_init(&g_gputhreads, thread_execute_gpu, g_gpudevices.size());
@@ -151,24 +152,30 @@ void WorkScheduler::finish()
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
 #  ifdef COM_OPENCL_ENABLED
   if (g_openclActive) {
-    BLI_thread_queue_wait_finish(g_gpuqueue);
-    BLI_thread_queue_wait_finish(g_cpuqueue);
+    /* Finished chunks of one device can schedule chunks on the other one. */
+    while (true) {
+      BLI_task_pool_work_and_wait(g_cpupool);
+      BLI_thread_queue_wait_finish(g_gpuqueue);
+      if (atomic_add_and_fetch_u(&g_numScheduledPackages, 0) == 0) {
+        break;
+      }
+      /* A package is still being executed by a GPU device. */
+      PIL_sleep_ms(1);
+    }
   }
   else {
-    BLI_thread_queue_wait_finish(g_cpuqueue);
+    BLI_task_pool_work_and_wait(g_cpupool);
   }
 #  else
-  BLI_thread_queue_wait_finish(cpuqueue);
+  BLI_task_pool_work_and_wait(g_cpupool);
 #  endif
 #endif
 }
 void WorkScheduler::stop()
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
-  BLI_thread_queue_nowait(g_cpuqueue);
-  BLI_threadpool_end(&g_cputhreads);
-  BLI_thread_queue_free(g_cpuqueue);
-  g_cpuqueue = NULL;
+  BLI_task_pool_free(g_cpupool);
+  g_cpupool = NULL;
 #  ifdef COM_OPENCL_ENABLED
   if (g_openclActive) {
     BLI_thread_queue_nowait(g_gpuqueue);
@@ -207,7 +214,7 @@ void WorkScheduler::initialize(bool use_opencl, int num_cpu_threads)
 {
 #if COM_CURRENT_THREADING_MODEL == COM_TM_QUEUE
   /* deinitialize if number of threads doesn't match */
-  if (g_cpudevices.size() != num_cpu_threads) {
+  if (g_cpuNumThreads != num_cpu_threads) {
     Device *device;
 
     while (g_cpudevices.size() > 0) {
@@ -218,18 +225,24 @@ void WorkScheduler::initialize(bool use_opencl, int num_cpu_threads)
     }
     if (g_cpuInitialized) {
       BLI_thread_local_delete(g_thread_device);
+      BLI_task_scheduler_free(g_cpuscheduler);
+      g_cpuscheduler = NULL;
     }
     g_cpuInitialized = false;
   }
 
   /* initialize CPU threads */
   if (!g_cpuInitialized) {
-    for (int index = 0; index < num_cpu_threads; index++) {
+    g_cpuscheduler = BLI_task_scheduler_create(num_cpu_threads);
+    /* The thread waiting in #WorkScheduler::finish executes work as well, with thread id 0. */
+    const int num_task_threads = BLI_task_scheduler_num_threads(g_cpuscheduler);
+    for (int index = 0; index < num_task_threads; index++) {
       CPUDevice *device = new CPUDevice(index);
       device->initialize();
       g_cpudevices.push_back(device);
     }
     BLI_thread_local_create(g_thread_device);
+    g_cpuNumThreads = num_cpu_threads;
     g_cpuInitialized = true;
   }
 
@@ -338,6 +351,9 @@ void WorkScheduler::deinitialize()
       delete device;
     }
     BLI_thread_local_delete(g_thread_device);
+    BLI_task_scheduler_free(g_cpuscheduler);
+    g_cpuscheduler = NULL;
+    g_cpuNumThreads = 0;
     g_cpuInitialized = false;
   }
 
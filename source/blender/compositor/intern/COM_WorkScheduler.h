@@ -21,6 +21,7 @@
 
 #include "COM_ExecutionGroup.h"
 extern "C" {
+#include "BLI_task.h"
 #include "BLI_threads.h"
 }
 #include "COM_WorkPackage.h"
@@ -39,10 +40,10 @@ class WorkScheduler {
   static bool isStopping();
 
   /**
-   * \brief main thread loop for cpudevices
-   * inside this loop new work is queried and being executed
+   * \brief task run function for cpudevices
+   * executes a single work package on the CPUDevice of the task thread
    */
-  static void *thread_execute_cpu(void *data);
+  static void thread_execute_cpu(TaskPool *__restrict pool, void *data, int thread_id);
 
   /**
    * \brief main thread loop for gpudevices
@@ -53,7 +54,8 @@ class WorkScheduler {
  public:
   /**
    * \brief schedule a chunk of a group to be calculated.
-   * An execution group schedules a chunk in the WorkScheduler
+   * An execution group schedules a chunk in the WorkScheduler once all chunks it reads from
+   * are executed. This can also happen from a thread that just finished one of those chunks.
    * when ExecutionGroup.isOpenCL is set the work will be handled by a OpenCLDevice
    * otherwise the work is scheduled for an CPUDevice
    * \see ExecutionGroup.execute
@@ -68,9 +70,9 @@ class WorkScheduler {
    * during initialization the mutexes are initialized.
    * there are two mutexes (for every device type one)
    * After mutex initialization the system is queried in order to count the number of CPUDevices
-   * and GPUDevices to be created. For every hardware thread a CPUDevice and for every OpenCL GPU
-   * device a OpenCLDevice is created. these devices are stored in a separate list (cpudevices &
-   * gpudevices)
+   * and GPUDevices to be created. A task scheduler with num_cpu_threads threads is created, for
+   * every thread of it a CPUDevice and for every OpenCL GPU device a OpenCLDevice is created.
+   * these devices are stored in a separate list (cpudevices & gpudevices)
    *
    * This function can be called multiple times to lazily initialize OpenCL.
    */
@@ -84,8 +86,8 @@ class WorkScheduler {
 
   /**
    * \brief Start the execution
-   * this methods will start the WorkScheduler. Inside this method all threads are initialized.
-   * for every device a thread is created.
+   * this methods will start the WorkScheduler. Inside this method the task pool for CPU work is
+   * created, for every GPU device a thread is created.
    * \see initialize Initialization and query of the number of devices
    */
   static void start(CompositorContext &context);
@@ -99,6 +101,8 @@ class WorkScheduler {
 
   /**
    * \brief wait for all work to be completed.
+   * The calling thread executes CPU work packages while waiting. This includes chunks that are
+   * scheduled while waiting, because the chunks they depend on got executed.
    */
   static void finish();
 
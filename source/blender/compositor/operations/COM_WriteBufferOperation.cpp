@@ -47,7 +47,10 @@ void WriteBufferOperation::executePixelSampled(float output[4],
 void WriteBufferOperation::initExecution()
 {
   this->m_input = this->getInputOperation(0);
-  this->m_memoryProxy->allocate(this->m_width, this->m_height);
+  /* The buffer can already be taken from the ResultCache. */
+  if (!this->m_memoryProxy->isCached()) {
+    this->m_memoryProxy->allocate(this->m_width, this->m_height);
+  }
 }
 
 void WriteBufferOperation::deinitExecution()
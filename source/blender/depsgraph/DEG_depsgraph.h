@@ -95,6 +95,12 @@ Depsgraph *DEG_graph_new(struct Main *bmain,
 /* Free Depsgraph itself and all its data */
 void DEG_graph_free(Depsgraph *graph);
 
+/* Use the graph for new owners (after undo kept the graph of a scene). */
+void DEG_graph_replace_owners(struct Depsgraph *depsgraph,
+                              struct Main *bmain,
+                              struct Scene *scene,
+                              struct ViewLayer *view_layer);
+
 /* Node Types Registry ---------------------------- */
 
 /* Register all node types */
@@ -53,6 +53,14 @@ void DEG_stats_simple(const struct Depsgraph *graph,
                       size_t *r_operations,
                       size_t *r_relations);
 
+/* Number of relations builds of the graph and total time spent on them in
+ * seconds, for builds from scratch and incremental updates of tagged IDs. */
+void DEG_stats_relations_build(const struct Depsgraph *graph,
+                               int *r_num_full_builds,
+                               double *r_full_build_time,
+                               int *r_num_incremental_builds,
+                               double *r_incremental_build_time);
+
 /* ************************************************ */
 /* Diagram-Based Graph Debugging */
 
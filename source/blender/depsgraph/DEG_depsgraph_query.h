@@ -149,8 +149,11 @@ typedef struct DEGObjectIterData {
   struct Object *dupli_parent;
   /* List of duplicated objects. */
   struct ListBase *dupli_list;
-  /* Next duplicated object to step into. */
-  struct DupliObject *dupli_object_next;
+  /* The items of #dupli_list, stored in one array. */
+  struct DupliObject *dupli_array;
+  int dupli_array_len;
+  /* Index of the next duplicated object to step into. */
+  int dupli_array_index;
   /* Corresponds to current object: current iterator object is evaluated from
    * this duplicated object. */
   struct DupliObject *dupli_object_current;
@@ -0,0 +1,296 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ *
+ * Incremental update of relations of an existing dependency graph.
+ *
+ * Nodes and relations of IDs which were tagged with
+ * DEG_graph_tag_relations_update_id() are freed and built again, and IDs
+ * which depend on them get their relations re-built, since relations to the
+ * freed nodes are gone. All other nodes and relations stay untouched.
+ */
+
+#include "intern/builder/deg_builder_incremental.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_ghash.h"
+#include "BLI_listbase.h"
+
+#include "DNA_layer_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_collision.h"
+#include "BKE_effect.h"
+
+#include "DEG_depsgraph_query.h"
+
+#include "intern/builder/deg_builder_nodes.h"
+#include "intern/builder/deg_builder_relations.h"
+#include "intern/depsgraph.h"
+#include "intern/depsgraph_relation.h"
+#include "intern/node/deg_node_component.h"
+#include "intern/node/deg_node_id.h"
+#include "intern/node/deg_node_operation.h"
+
+namespace DEG {
+
+namespace {
+
+bool physics_relations_use_object(const Depsgraph *graph, const Object *object)
+{
+  for (int i = 0; i < DEG_PHYSICS_RELATIONS_NUM; i++) {
+    GHash *hash = graph->physics_relations[i];
+    if (hash == nullptr) {
+      continue;
+    }
+    GHASH_FOREACH_BEGIN (ListBase *, relations, hash) {
+      if (relations == nullptr) {
+        continue;
+      }
+      if (i == DEG_PHYSICS_EFFECTOR) {
+        LISTBASE_FOREACH (EffectorRelation *, relation, relations) {
+          if (DEG_get_original_object(relation->ob) == object) {
+            return true;
+          }
+        }
+      }
+      else {
+        LISTBASE_FOREACH (CollisionRelation *, relation, relations) {
+          if (DEG_get_original_object(relation->ob) == object) {
+            return true;
+          }
+        }
+      }
+    }
+    GHASH_FOREACH_END();
+  }
+  return false;
+}
+
+/* Objects which have nodes created by builders of other IDs, or which are a
+ * part of cached physics relations, are only handled by a full build. */
+bool object_supports_incremental_build(const Depsgraph *graph, Object *object)
+{
+  if (object->proxy != nullptr || object->proxy_from != nullptr ||
+      object->proxy_group != nullptr) {
+    return false;
+  }
+  if (object->rigidbody_object != nullptr || object->rigidbody_constraint != nullptr) {
+    return false;
+  }
+  if (object->pd != nullptr || object->particlesystem.first != nullptr) {
+    return false;
+  }
+  LISTBASE_FOREACH (ModifierData *, md, &object->modifiers) {
+    if (ELEM(md->type, eModifierType_Collision, eModifierType_Fluid, eModifierType_DynamicPaint)) {
+      return false;
+    }
+  }
+  return !physics_relations_use_object(graph, object);
+}
+
+/* IDs which relations are built by DepsgraphRelationBuilder::build_id()
+ * without involving their owners. */
+bool dependent_id_supports_incremental_build(const Depsgraph *graph, ID *id)
+{
+  switch (GS(id->name)) {
+    case ID_OB:
+      /* Relations of physics are built along with the ones of other objects. */
+      return object_supports_incremental_build(graph, (Object *)id);
+    case ID_GR:
+    case ID_ME:
+    case ID_CU:
+    case ID_MB:
+    case ID_LT:
+    case ID_KE:
+    case ID_CA:
+    case ID_LA:
+    case ID_MA:
+    case ID_NT:
+    case ID_WO:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/* Find base of the object in the view layer, together with its index among
+ * the bases which are pulled into the graph. Matches indexing used by
+ * DepsgraphNodeBuilder::build_view_layer(). */
+Base *find_object_base(DepsgraphBuilder &builder,
+                       ViewLayer *view_layer,
+                       Object *object,
+                       int *r_base_index)
+{
+  int base_index = 0;
+  LISTBASE_FOREACH (Base *, base, &view_layer->object_bases) {
+    if (!builder.need_pull_base_into_graph(base)) {
+      continue;
+    }
+    if (base->object == object) {
+      *r_base_index = base_index;
+      return base;
+    }
+    base_index++;
+  }
+  *r_base_index = -1;
+  return nullptr;
+}
+
+/* Collect IDs which have relations to operations of the given ID. */
+bool collect_dependent_id_nodes(const Depsgraph *graph,
+                                IDNode *id_node,
+                                GSet *rebuild_id_nodes,
+                                vector<IDNode *> *r_dependent_id_nodes)
+{
+  GHASH_FOREACH_BEGIN (ComponentNode *, comp_node, id_node->components) {
+    for (OperationNode *op_node : comp_node->operations) {
+      for (Relation *rel : op_node->outlinks) {
+        if (rel->to->type != NodeType::OPERATION) {
+          continue;
+        }
+        IDNode *dependent_id_node = static_cast<OperationNode *>(rel->to)->owner->owner;
+        if (!BLI_gset_add(rebuild_id_nodes, dependent_id_node)) {
+          continue;
+        }
+        if (!dependent_id_supports_incremental_build(graph, dependent_id_node->id_orig)) {
+          return false;
+        }
+        r_dependent_id_nodes->push_back(dependent_id_node);
+      }
+    }
+  }
+  GHASH_FOREACH_END();
+  return true;
+}
+
+bool id_node_has_new_operations(const IDNode *id_node)
+{
+  GHASH_FOREACH_BEGIN (ComponentNode *, comp_node, id_node->components) {
+    if (comp_node->operations_map != nullptr) {
+      return true;
+    }
+  }
+  GHASH_FOREACH_END();
+  return false;
+}
+
+/* State of the ID node which comes from builders of other IDs. */
+struct SavedIDNodeState {
+  eDepsNode_LinkedState_Type linked_state;
+  bool is_directly_visible;
+  bool has_base;
+};
+
+}  // namespace
+
+bool deg_graph_build_incremental(
+    Main *bmain, Depsgraph *graph, Scene *scene, ViewLayer *view_layer, DepsgraphBuilderCache *cache)
+{
+  /* Check whether all tagged IDs can be handled. */
+  vector<IDNode *> id_nodes;
+  GSet *rebuild_id_nodes = BLI_gset_ptr_new("Depsgraph rebuild id nodes");
+  GSET_FOREACH_BEGIN (ID *, id, graph->relations_update_ids) {
+    IDNode *id_node = graph->find_id_node(id);
+    if (id_node == nullptr || GS(id->name) != ID_OB ||
+        id_node->linked_state == DEG_ID_LINKED_VIA_SET ||
+        !object_supports_incremental_build(graph, (Object *)id)) {
+      BLI_gset_free(rebuild_id_nodes, nullptr);
+      return false;
+    }
+    BLI_gset_add(rebuild_id_nodes, id_node);
+    id_nodes.push_back(id_node);
+  }
+  GSET_FOREACH_END();
+
+  /* Relations to nodes which are about to be freed are built by builders of
+   * the dependent IDs, so they are to be re-built as well. */
+  vector<IDNode *> dependent_id_nodes;
+  for (IDNode *id_node : id_nodes) {
+    if (!collect_dependent_id_nodes(graph, id_node, rebuild_id_nodes, &dependent_id_nodes)) {
+      BLI_gset_free(rebuild_id_nodes, nullptr);
+      return false;
+    }
+  }
+  BLI_gset_free(rebuild_id_nodes, nullptr);
+
+  vector<SavedIDNodeState> saved_states;
+  saved_states.reserve(id_nodes.size());
+  for (IDNode *id_node : id_nodes) {
+    SavedIDNodeState state;
+    state.linked_state = id_node->linked_state;
+    state.is_directly_visible = id_node->is_directly_visible;
+    state.has_base = id_node->has_base;
+    saved_states.push_back(state);
+  }
+
+  /* Re-create nodes of the tagged IDs. */
+  const size_t num_id_nodes = graph->id_nodes.size();
+  DepsgraphNodeBuilder node_builder(bmain, graph, cache);
+  node_builder.begin_build_incremental(scene, view_layer, id_nodes);
+  for (size_t i = 0; i < id_nodes.size(); i++) {
+    IDNode *id_node = id_nodes[i];
+    const SavedIDNodeState &state = saved_states[i];
+    Object *object = (Object *)id_node->id_orig;
+    int base_index;
+    if (find_object_base(node_builder, view_layer, object, &base_index) != nullptr) {
+      node_builder.build_object(base_index, object, DEG_ID_LINKED_DIRECTLY, true);
+    }
+    else {
+      node_builder.build_object(-1, object, state.linked_state, state.is_directly_visible);
+    }
+    id_node->linked_state = max(id_node->linked_state, state.linked_state);
+    id_node->is_directly_visible |= state.is_directly_visible;
+    id_node->has_base |= state.has_base;
+  }
+  node_builder.end_build();
+
+  /* Re-create relations of the tagged IDs, IDs which depend on them and IDs
+   * which were pulled into the graph by the new nodes. */
+  vector<IDNode *> relations_id_nodes = id_nodes;
+  relations_id_nodes.insert(
+      relations_id_nodes.end(), dependent_id_nodes.begin(), dependent_id_nodes.end());
+  relations_id_nodes.insert(
+      relations_id_nodes.end(), graph->id_nodes.begin() + num_id_nodes, graph->id_nodes.end());
+  graph->check_relations_before_add = true;
+  DepsgraphRelationBuilder relation_builder(bmain, graph, cache);
+  relation_builder.begin_build_incremental(scene, relations_id_nodes);
+  for (IDNode *id_node : id_nodes) {
+    Object *object = (Object *)id_node->id_orig;
+    int base_index;
+    Base *base = find_object_base(relation_builder, view_layer, object, &base_index);
+    relation_builder.build_object(base, object);
+  }
+  for (IDNode *id_node : dependent_id_nodes) {
+    relation_builder.build_id(id_node->id_orig);
+  }
+  for (IDNode *id_node : graph->id_nodes) {
+    if (id_node_has_new_operations(id_node)) {
+      relation_builder.build_copy_on_write_relations(id_node);
+    }
+  }
+  graph->check_relations_before_add = false;
+  return true;
+}
+
+}  // namespace DEG
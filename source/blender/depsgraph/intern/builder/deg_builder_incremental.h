@@ -0,0 +1,46 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2020 Blender Foundation.
+ * All rights reserved.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#pragma once
+
+struct Main;
+struct Scene;
+struct ViewLayer;
+
+namespace DEG {
+
+struct Depsgraph;
+class DepsgraphBuilderCache;
+
+/* Re-build nodes and relations of the IDs from Depsgraph::relations_update_ids
+ * in an existing graph, keeping the rest of the graph as-is.
+ *
+ * Returns false when the graph can not be updated incrementally, in this case
+ * the graph is left untouched and is to be re-built from scratch. */
+bool deg_graph_build_incremental(Main *bmain,
+                                 Depsgraph *graph,
+                                 Scene *scene,
+                                 ViewLayer *view_layer,
+                                 DepsgraphBuilderCache *cache);
+
+}  // namespace DEG
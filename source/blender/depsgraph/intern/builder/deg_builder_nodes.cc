@@ -25,6 +25,7 @@
 
 #include "intern/builder/deg_builder_nodes.h"
 
+#include <algorithm>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -158,24 +159,26 @@ DepsgraphNodeBuilder::~DepsgraphNodeBuilder()
 
 IDNode *DepsgraphNodeBuilder::add_id_node(ID *id)
 {
-  IDNode *id_node = nullptr;
-  ID *id_cow = nullptr;
-  IDComponentsMask previously_visible_components_mask = 0;
-  uint32_t previous_eval_flags = 0;
-  DEGCustomDataMeshMasks previous_customdata_masks;
-  IDInfo *id_info = (IDInfo *)BLI_ghash_lookup(id_info_hash_, id);
-  if (id_info != nullptr) {
-    id_cow = id_info->id_cow;
-    previously_visible_components_mask = id_info->previously_visible_components_mask;
-    previous_eval_flags = id_info->previous_eval_flags;
-    previous_customdata_masks = id_info->previous_customdata_masks;
-    /* Tag ID info to not free the CoW ID pointer. */
-    id_info->id_cow = nullptr;
-  }
-  id_node = graph_->add_id_node(id, id_cow);
-  id_node->previously_visible_components_mask = previously_visible_components_mask;
-  id_node->previous_eval_flags = previous_eval_flags;
-  id_node->previous_customdata_masks = previous_customdata_masks;
+  IDNode *id_node = find_id_node(id);
+  if (id_node == nullptr) {
+    ID *id_cow = nullptr;
+    IDComponentsMask previously_visible_components_mask = 0;
+    uint32_t previous_eval_flags = 0;
+    DEGCustomDataMeshMasks previous_customdata_masks;
+    IDInfo *id_info = (IDInfo *)BLI_ghash_lookup(id_info_hash_, id);
+    if (id_info != nullptr) {
+      id_cow = id_info->id_cow;
+      previously_visible_components_mask = id_info->previously_visible_components_mask;
+      previous_eval_flags = id_info->previous_eval_flags;
+      previous_customdata_masks = id_info->previous_customdata_masks;
+      /* Tag ID info to not free the CoW ID pointer. */
+      id_info->id_cow = nullptr;
+    }
+    id_node = graph_->add_id_node(id, id_cow);
+    id_node->previously_visible_components_mask = previously_visible_components_mask;
+    id_node->previous_eval_flags = previous_eval_flags;
+    id_node->previous_customdata_masks = previous_customdata_masks;
+  }
   /* Currently all ID nodes are supposed to have copy-on-write logic.
    *
    * NOTE: Zero number of components indicates that ID node was just created. */
@@ -375,6 +378,71 @@ void DepsgraphNodeBuilder::end_build()
   }
 }
 
+void DepsgraphNodeBuilder::begin_build_incremental(Scene *scene,
+                                                   ViewLayer *view_layer,
+                                                   const vector<IDNode *> &id_nodes_to_rebuild)
+{
+  /* Setup currently building context, same as build_view_layer(). */
+  view_layer_index_ = 0;
+  scene_ = scene;
+  view_layer_ = view_layer;
+  /* Nodes which are not re-built keep their copy-on-write datablocks, so
+   * there is nothing to be re-used. */
+  id_info_hash_ = BLI_ghash_ptr_new("Depsgraph id hash");
+
+  GSet *rebuild_id_nodes = BLI_gset_ptr_new("Depsgraph rebuild id nodes");
+  for (IDNode *id_node : id_nodes_to_rebuild) {
+    BLI_gset_add(rebuild_id_nodes, id_node);
+  }
+  for (IDNode *id_node : graph_->id_nodes) {
+    id_node->previously_visible_components_mask = id_node->visible_components_mask;
+    id_node->previous_eval_flags = id_node->eval_flags;
+    id_node->previous_customdata_masks = id_node->customdata_masks;
+    if (!BLI_gset_haskey(rebuild_id_nodes, id_node)) {
+      built_map_.tagBuild(id_node->id_orig);
+    }
+  }
+
+  /* Entry tags of the operations which are about to be freed. */
+  GSet *removed_entry_tags = BLI_gset_ptr_new("Depsgraph removed entry tags");
+  GSET_FOREACH_BEGIN (OperationNode *, op_node, graph_->entry_tags) {
+    ComponentNode *comp_node = op_node->owner;
+    IDNode *id_node = comp_node->owner;
+    if (!BLI_gset_haskey(rebuild_id_nodes, id_node)) {
+      continue;
+    }
+    SavedEntryTag entry_tag;
+    entry_tag.id_orig = id_node->id_orig;
+    entry_tag.component_type = comp_node->type;
+    entry_tag.opcode = op_node->opcode;
+    entry_tag.name = op_node->name;
+    entry_tag.name_tag = op_node->name_tag;
+    saved_entry_tags_.push_back(entry_tag);
+    BLI_gset_add(removed_entry_tags, op_node);
+  }
+  GSET_FOREACH_END();
+  GSET_FOREACH_BEGIN (OperationNode *, op_node, removed_entry_tags) {
+    BLI_gset_remove(graph_->entry_tags, op_node, nullptr);
+  }
+  GSET_FOREACH_END();
+  BLI_gset_free(removed_entry_tags, nullptr);
+
+  /* Remove all operations of the re-built IDs, the ID nodes themselves stay. */
+  graph_->operations.erase(std::remove_if(graph_->operations.begin(),
+                                          graph_->operations.end(),
+                                          [rebuild_id_nodes](OperationNode *op_node) {
+                                            return BLI_gset_haskey(rebuild_id_nodes,
+                                                                   op_node->owner->owner);
+                                          }),
+                           graph_->operations.end());
+  for (IDNode *id_node : id_nodes_to_rebuild) {
+    id_node->clear_components();
+    id_node->eval_flags = 0;
+    id_node->customdata_masks = DEGCustomDataMeshMasks();
+  }
+  BLI_gset_free(rebuild_id_nodes, nullptr);
+}
+
 void DepsgraphNodeBuilder::build_id(ID *id)
 {
   if (id == nullptr) {
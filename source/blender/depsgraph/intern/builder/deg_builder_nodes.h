@@ -98,6 +98,13 @@ class DepsgraphNodeBuilder : public DepsgraphBuilder {
   virtual void begin_build();
   virtual void end_build();
 
+  /* Prepare existing graph for re-building nodes of the given IDs only.
+   * Components and relations of those IDs are freed, all other IDs are
+   * considered built. */
+  void begin_build_incremental(Scene *scene,
+                               ViewLayer *view_layer,
+                               const vector<IDNode *> &id_nodes_to_rebuild);
+
   IDNode *add_id_node(ID *id);
   IDNode *find_id_node(ID *id);
   TimeSourceNode *add_time_source();
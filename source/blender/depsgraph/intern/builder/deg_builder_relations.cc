@@ -476,6 +476,22 @@ void DepsgraphRelationBuilder::begin_build()
 {
 }
 
+void DepsgraphRelationBuilder::begin_build_incremental(Scene *scene,
+                                                       const vector<IDNode *> &id_nodes_to_rebuild)
+{
+  scene_ = scene;
+  GSet *rebuild_id_nodes = BLI_gset_ptr_new("Depsgraph rebuild id nodes");
+  for (IDNode *id_node : id_nodes_to_rebuild) {
+    BLI_gset_add(rebuild_id_nodes, id_node);
+  }
+  for (IDNode *id_node : graph_->id_nodes) {
+    if (!BLI_gset_haskey(rebuild_id_nodes, id_node)) {
+      built_map_.tagBuild(id_node->id_orig);
+    }
+  }
+  BLI_gset_free(rebuild_id_nodes, nullptr);
+}
+
 void DepsgraphRelationBuilder::build_id(ID *id)
 {
   if (id == nullptr) {
@@ -2631,6 +2647,11 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
       Relation *rel = graph_->add_new_relation(op_cow, op_entry, "CoW Dependency");
       rel->flag |= rel_flag;
     }
+    if (comp_node->operations_map == nullptr) {
+      /* Component was finalized by a previous build, its operations are
+       * already hooked up to the copy-on-write. */
+      continue;
+    }
     /* All dangling operations should also be executed after copy-on-write. */
     GHASH_FOREACH_BEGIN (OperationNode *, op_node, comp_node->operations_map) {
       if (op_node == op_entry) {
@@ -161,6 +161,10 @@ class DepsgraphRelationBuilder : public DepsgraphBuilder {
 
   void begin_build();
 
+  /* Prepare for re-building relations of the given IDs in an existing graph,
+   * all other IDs are considered built. */
+  void begin_build_incremental(Scene *scene, const vector<IDNode *> &id_nodes_to_rebuild);
+
   template<typename KeyFrom, typename KeyTo>
   Relation *add_relation(const KeyFrom &key_from,
                          const KeyTo &key_to,
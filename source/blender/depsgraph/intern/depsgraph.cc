@@ -69,6 +69,7 @@ template<typename T> static void remove_from_vector(vector<T> *vector, const T &
 Depsgraph::Depsgraph(Main *bmain, Scene *scene, ViewLayer *view_layer, eEvaluationMode mode)
     : time_source(nullptr),
       need_update(true),
+      check_relations_before_add(false),
       need_update_time(false),
       bmain(bmain),
       scene(scene),
@@ -83,6 +84,7 @@ Depsgraph::Depsgraph(Main *bmain, Scene *scene, ViewLayer *view_layer, eEvaluati
   BLI_spin_init(&lock);
   id_hash = BLI_ghash_ptr_new("Depsgraph id hash");
   entry_tags = BLI_gset_ptr_new("Depsgraph entry_tags");
+  relations_update_ids = BLI_gset_ptr_new("Depsgraph relations_update_ids");
   memset(id_type_updated, 0, sizeof(id_type_updated));
   memset(id_type_exist, 0, sizeof(id_type_exist));
   memset(physics_relations, 0, sizeof(physics_relations));
@@ -93,6 +95,7 @@ Depsgraph::~Depsgraph()
   clear_id_nodes();
   BLI_ghash_free(id_hash, nullptr, nullptr);
   BLI_gset_free(entry_tags, nullptr);
+  BLI_gset_free(relations_update_ids, nullptr);
   if (time_source != nullptr) {
     OBJECT_GUARDED_DELETE(time_source, TimeSourceNode);
   }
@@ -180,7 +183,7 @@ void Depsgraph::clear_id_nodes()
 Relation *Depsgraph::add_new_relation(Node *from, Node *to, const char *description, int flags)
 {
   Relation *rel = nullptr;
-  if (flags & RELATION_CHECK_BEFORE_ADD) {
+  if ((flags & RELATION_CHECK_BEFORE_ADD) || check_relations_before_add) {
     rel = check_nodes_connected(from, to, description);
   }
   if (rel != nullptr) {
@@ -207,6 +210,21 @@ Relation *Depsgraph::check_nodes_connected(const Node *from,
                                            const Node *to,
                                            const char *description)
 {
+  /* Scan the shorter side, nodes like copy-on-write or time source have
+   * a lot of relations on one side. */
+  if (to->inlinks.size() < from->outlinks.size()) {
+    for (Relation *rel : to->inlinks) {
+      BLI_assert(rel->to == to);
+      if (rel->from != from) {
+        continue;
+      }
+      if (description != nullptr && !STREQ(rel->name, description)) {
+        continue;
+      }
+      return rel;
+    }
+    return nullptr;
+  }
   for (Relation *rel : from->outlinks) {
     BLI_assert(rel->from == from);
     if (rel->to != to) {
@@ -297,6 +315,28 @@ void DEG_graph_free(Depsgraph *graph)
   OBJECT_GUARDED_DELETE(deg_depsgraph, Depsgraph);
 }
 
+void DEG_graph_replace_owners(struct Depsgraph *depsgraph,
+                              Main *bmain,
+                              Scene *scene,
+                              ViewLayer *view_layer)
+{
+  DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(depsgraph);
+
+  /* Graphs are registered by their main database. */
+  const bool do_update_register = deg_graph->bmain != bmain;
+  if (do_update_register) {
+    DEG::unregister_graph(deg_graph);
+  }
+
+  deg_graph->bmain = bmain;
+  deg_graph->scene = scene;
+  deg_graph->view_layer = view_layer;
+
+  if (do_update_register) {
+    DEG::register_graph(deg_graph);
+  }
+}
+
 bool DEG_is_evaluating(struct Depsgraph *depsgraph)
 {
   DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(depsgraph);
@@ -42,6 +42,7 @@
 
 #include "intern/debug/deg_debug.h"
 #include "intern/depsgraph_type.h"
+#include "intern/eval/deg_eval_stats.h"
 
 struct GHash;
 struct GSet;
@@ -110,6 +111,15 @@ struct Depsgraph {
   /* Indicates whether relations needs to be updated. */
   bool need_update;
 
+  /* Original IDs which relations are to be re-built without re-building the
+   * whole graph. Only used when need_update is false. */
+  GSet *relations_update_ids;
+
+  /* Look for an existing relation between nodes before adding a new one.
+   * Is set while an existing graph is being updated incrementally, so that
+   * relations which are already in the graph are not added twice. */
+  bool check_relations_before_add;
+
   /* Indicates which ID types were updated. */
   char id_type_updated[MAX_LIBARRAY];
 
@@ -159,6 +169,8 @@ struct Depsgraph {
 
   DepsgraphDebug debug;
 
+  DepsgraphBuildStats build_stats;
+
   bool is_evaluating;
 
   /* Is set to truth for dependency graph which are used for post-processing (compositor and
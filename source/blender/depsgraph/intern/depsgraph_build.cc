@@ -48,11 +48,13 @@ extern "C" {
 #include "builder/deg_builder.h"
 #include "builder/deg_builder_cache.h"
 #include "builder/deg_builder_cycle.h"
+#include "builder/deg_builder_incremental.h"
 #include "builder/deg_builder_nodes.h"
 #include "builder/deg_builder_relations.h"
 #include "builder/deg_builder_transitive.h"
 
 #include "intern/debug/deg_debug.h"
+#include "intern/eval/deg_eval_stats.h"
 
 #include "intern/node/deg_node.h"
 #include "intern/node/deg_node_component.h"
@@ -223,6 +225,7 @@ static void graph_build_finalize_common(DEG::Depsgraph *deg_graph, Main *bmain)
 #endif
   /* Relations are up to date. */
   deg_graph->need_update = false;
+  BLI_gset_clear(deg_graph->relations_update_ids, nullptr);
 }
 
 /* Build depsgraph for the given scene layer, and dump results in given graph container. */
@@ -231,10 +234,7 @@ void DEG_graph_build_from_view_layer(Depsgraph *graph,
                                      Scene *scene,
                                      ViewLayer *view_layer)
 {
-  double start_time = 0.0;
-  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    start_time = PIL_check_seconds_timer();
-  }
+  const double start_time = PIL_check_seconds_timer();
   DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
   /* Perform sanity checks. */
   BLI_assert(BLI_findindex(&scene->view_layers, view_layer) != -1);
@@ -254,8 +254,10 @@ void DEG_graph_build_from_view_layer(Depsgraph *graph,
   /* Finalize building. */
   graph_build_finalize_common(deg_graph, bmain);
   /* Finish statistics. */
+  const double build_time = PIL_check_seconds_timer() - start_time;
+  DEG::deg_build_stats_add(deg_graph, false, 0, build_time);
   if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    printf("Depsgraph built in %f seconds.\n", PIL_check_seconds_timer() - start_time);
+    printf("Depsgraph built in %f seconds.\n", build_time);
   }
 }
 
@@ -264,10 +266,7 @@ void DEG_graph_build_for_render_pipeline(Depsgraph *graph,
                                          Scene *scene,
                                          ViewLayer *view_layer)
 {
-  double start_time = 0.0;
-  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    start_time = PIL_check_seconds_timer();
-  }
+  const double start_time = PIL_check_seconds_timer();
   DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
   /* Perform sanity checks. */
   BLI_assert(deg_graph->scene == scene);
@@ -287,18 +286,17 @@ void DEG_graph_build_for_render_pipeline(Depsgraph *graph,
   /* Finalize building. */
   graph_build_finalize_common(deg_graph, bmain);
   /* Finish statistics. */
+  const double build_time = PIL_check_seconds_timer() - start_time;
+  DEG::deg_build_stats_add(deg_graph, false, 0, build_time);
   if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    printf("Depsgraph built in %f seconds.\n", PIL_check_seconds_timer() - start_time);
+    printf("Depsgraph built in %f seconds.\n", build_time);
   }
 }
 
 void DEG_graph_build_for_compositor_preview(
     Depsgraph *graph, Main *bmain, Scene *scene, struct ViewLayer *view_layer, bNodeTree *nodetree)
 {
-  double start_time = 0.0;
-  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    start_time = PIL_check_seconds_timer();
-  }
+  const double start_time = PIL_check_seconds_timer();
   DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
   /* Perform sanity checks. */
   BLI_assert(deg_graph->scene == scene);
@@ -320,8 +318,10 @@ void DEG_graph_build_for_compositor_preview(
   /* Finalize building. */
   graph_build_finalize_common(deg_graph, bmain);
   /* Finish statistics. */
+  const double build_time = PIL_check_seconds_timer() - start_time;
+  DEG::deg_build_stats_add(deg_graph, false, 0, build_time);
   if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    printf("Depsgraph built in %f seconds.\n", PIL_check_seconds_timer() - start_time);
+    printf("Depsgraph built in %f seconds.\n", build_time);
   }
 }
 
@@ -431,10 +431,7 @@ void DEG_graph_build_from_ids(Depsgraph *graph,
                               ID **ids,
                               const int num_ids)
 {
-  double start_time = 0.0;
-  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    start_time = PIL_check_seconds_timer();
-  }
+  const double start_time = PIL_check_seconds_timer();
   DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
   /* Perform sanity checks. */
   BLI_assert(BLI_findindex(&scene->view_layers, view_layer) != -1);
@@ -461,8 +458,10 @@ void DEG_graph_build_from_ids(Depsgraph *graph,
   /* Finalize building. */
   graph_build_finalize_common(deg_graph, bmain);
   /* Finish statistics. */
+  const double build_time = PIL_check_seconds_timer() - start_time;
+  DEG::deg_build_stats_add(deg_graph, false, 0, build_time);
   if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    printf("Depsgraph built in %f seconds.\n", PIL_check_seconds_timer() - start_time);
+    printf("Depsgraph built in %f seconds.\n", build_time);
   }
 }
 
@@ -484,13 +483,57 @@ void DEG_graph_tag_relations_update(Depsgraph *graph)
   }
 }
 
+/* Tag relations of the given ID for update. */
+void DEG_graph_tag_relations_update_id(Depsgraph *graph, ID *id)
+{
+  DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
+  if (deg_graph->need_update) {
+    /* Graph is to be re-built from scratch anyway. */
+    return;
+  }
+  if (deg_graph->find_id_node(id) == nullptr) {
+    /* Nothing in this graph depends on the ID. */
+    return;
+  }
+  DEG_DEBUG_PRINTF(graph, TAG, "%s: Tagging relations of %s for update.\n", __func__, id->name);
+  BLI_gset_add(deg_graph->relations_update_ids, id);
+}
+
+/* Re-build relations of IDs tagged by DEG_graph_tag_relations_update_id(),
+ * returns false if the graph is to be re-built from scratch instead. */
+static bool graph_build_incremental(DEG::Depsgraph *deg_graph,
+                                    Main *bmain,
+                                    Scene *scene,
+                                    ViewLayer *view_layer)
+{
+  const double start_time = PIL_check_seconds_timer();
+  const int num_ids = BLI_gset_len(deg_graph->relations_update_ids);
+  DEG::DepsgraphBuilderCache builder_cache;
+  if (!DEG::deg_graph_build_incremental(bmain, deg_graph, scene, view_layer, &builder_cache)) {
+    return false;
+  }
+  graph_build_finalize_common(deg_graph, bmain);
+  /* Finish statistics. */
+  const double build_time = PIL_check_seconds_timer() - start_time;
+  DEG::deg_build_stats_add(deg_graph, true, num_ids, build_time);
+  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
+    printf("Depsgraph relations of %d IDs updated in %f seconds.\n", num_ids, build_time);
+  }
+  return true;
+}
+
 /* Create or update relations in the specified graph. */
 void DEG_graph_relations_update(Depsgraph *graph, Main *bmain, Scene *scene, ViewLayer *view_layer)
 {
   DEG::Depsgraph *deg_graph = (DEG::Depsgraph *)graph;
   if (!deg_graph->need_update) {
-    /* Graph is up to date, nothing to do. */
-    return;
+    if (BLI_gset_len(deg_graph->relations_update_ids) == 0) {
+      /* Graph is up to date, nothing to do. */
+      return;
+    }
+    if (graph_build_incremental(deg_graph, bmain, scene, view_layer)) {
+      return;
+    }
   }
   DEG_graph_build_from_view_layer(graph, bmain, scene, view_layer);
 }
@@ -503,3 +546,11 @@ void DEG_relations_tag_update(Main *bmain)
     DEG_graph_tag_relations_update(reinterpret_cast<Depsgraph *>(depsgraph));
   }
 }
+
+/* Tag relations of the given ID for update in all dependency graphs. */
+void DEG_relations_tag_update_id(Main *bmain, ID *id)
+{
+  for (DEG::Depsgraph *depsgraph : DEG::get_all_registered_graphs(bmain)) {
+    DEG_graph_tag_relations_update_id(reinterpret_cast<Depsgraph *>(depsgraph), id);
+  }
+}
@@ -247,6 +247,28 @@ void DEG_stats_simple(const Depsgraph *graph,
   }
 }
 
+void DEG_stats_relations_build(const Depsgraph *graph,
+                               int *r_num_full_builds,
+                               double *r_full_build_time,
+                               int *r_num_incremental_builds,
+                               double *r_incremental_build_time)
+{
+  const DEG::Depsgraph *deg_graph = reinterpret_cast<const DEG::Depsgraph *>(graph);
+  const DEG::DepsgraphBuildStats &stats = deg_graph->build_stats;
+  if (r_num_full_builds) {
+    *r_num_full_builds = stats.num_full_builds;
+  }
+  if (r_full_build_time) {
+    *r_full_build_time = stats.full_build_time;
+  }
+  if (r_num_incremental_builds) {
+    *r_num_incremental_builds = stats.num_incremental_builds;
+  }
+  if (r_incremental_build_time) {
+    *r_incremental_build_time = stats.incremental_build_time;
+  }
+}
+
 static DEG::string depsgraph_name_for_logging(struct Depsgraph *depsgraph)
 {
   const char *name = DEG_debug_name_get(depsgraph);
@@ -120,11 +120,11 @@ static bool deg_object_hide_original(eEvaluationMode eval_mode, Object *ob, Dupl
 bool deg_objects_dupli_iterator_next(BLI_Iterator *iter)
 {
   DEGObjectIterData *data = (DEGObjectIterData *)iter->data;
-  while (data->dupli_object_next != nullptr) {
-    DupliObject *dob = data->dupli_object_next;
+  while (data->dupli_array_index < data->dupli_array_len) {
+    DupliObject *dob = &data->dupli_array[data->dupli_array_index];
     Object *obd = dob->ob;
 
-    data->dupli_object_next = data->dupli_object_next->next;
+    data->dupli_array_index++;
 
     if (dob->no_draw) {
       continue;
@@ -224,7 +224,8 @@ void deg_iterator_objects_step(BLI_Iterator *iter, DEG::IDNode *id_node)
     if ((data->flag & DEG_ITER_OBJECT_FLAG_DUPLI) && (object->transflag & OB_DUPLI)) {
       data->dupli_parent = object;
       data->dupli_list = object_duplilist(data->graph, data->scene, object);
-      data->dupli_object_next = (DupliObject *)data->dupli_list->first;
+      data->dupli_array = object_duplilist_array(data->dupli_list, &data->dupli_array_len);
+      data->dupli_array_index = 0;
     }
   }
 
@@ -251,7 +252,9 @@ void DEG_iterator_objects_begin(BLI_Iterator *iter, DEGObjectIterData *data)
 
   data->dupli_parent = nullptr;
   data->dupli_list = nullptr;
-  data->dupli_object_next = nullptr;
+  data->dupli_array = nullptr;
+  data->dupli_array_len = 0;
+  data->dupli_array_index = 0;
   data->dupli_object_current = nullptr;
   data->scene = DEG_get_evaluated_scene(depsgraph);
   data->id_node_index = 0;
@@ -283,7 +286,9 @@ void DEG_iterator_objects_next(BLI_Iterator *iter)
         free_object_duplilist(data->dupli_list);
         data->dupli_parent = nullptr;
         data->dupli_list = nullptr;
-        data->dupli_object_next = nullptr;
+        data->dupli_array = nullptr;
+        data->dupli_array_len = 0;
+        data->dupli_array_index = 0;
         data->dupli_object_current = nullptr;
         deg_invalidate_iterator_work_data(data);
       }
@@ -56,4 +56,31 @@ void deg_eval_stats_aggregate(Depsgraph *graph)
   }
 }
 
+DepsgraphBuildStats::DepsgraphBuildStats()
+    : num_full_builds(0),
+      full_build_time(0.0),
+      last_full_build_time(0.0),
+      num_incremental_builds(0),
+      incremental_build_time(0.0),
+      last_incremental_build_time(0.0),
+      num_incremental_ids(0)
+{
+}
+
+void deg_build_stats_add(Depsgraph *graph, bool is_incremental, int num_ids, double time)
+{
+  DepsgraphBuildStats &stats = graph->build_stats;
+  if (is_incremental) {
+    stats.num_incremental_builds++;
+    stats.incremental_build_time += time;
+    stats.last_incremental_build_time = time;
+    stats.num_incremental_ids += num_ids;
+  }
+  else {
+    stats.num_full_builds++;
+    stats.full_build_time += time;
+    stats.last_full_build_time = time;
+  }
+}
+
 }  // namespace DEG
@@ -30,4 +30,24 @@ struct Depsgraph;
 /* Aggregate operation timings to overall component and ID nodes timing. */
 void deg_eval_stats_aggregate(Depsgraph *graph);
 
+/* Timing of relations builds, accumulated over the lifetime of the dependency graph. */
+struct DepsgraphBuildStats {
+  DepsgraphBuildStats();
+
+  /* Builds which re-created the whole graph from scratch. */
+  int num_full_builds;
+  double full_build_time;
+  double last_full_build_time;
+
+  /* Builds which only re-created nodes and relations of tagged IDs. */
+  int num_incremental_builds;
+  double incremental_build_time;
+  double last_incremental_build_time;
+  /* Total number of IDs which were re-built by incremental builds. */
+  int num_incremental_ids;
+};
+
+/* Accumulate timing of a single relations build. */
+void deg_build_stats_add(Depsgraph *graph, bool is_incremental, int num_ids, double time);
+
 }  // namespace DEG
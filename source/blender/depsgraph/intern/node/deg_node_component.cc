@@ -197,6 +197,7 @@ OperationNode *ComponentNode::add_operation(const DepsEvalOperationCb &op,
                                             const char *name,
                                             int name_tag)
 {
+  ensure_operations_map();
   OperationNode *op_node = find_operation(opcode, name, name_tag);
   if (!op_node) {
     DepsNodeFactory *factory = type_get_factory(NodeType::OPERATION);
@@ -314,6 +315,10 @@ OperationNode *ComponentNode::get_exit_operation()
 
 void ComponentNode::finalize_build(Depsgraph * /*graph*/)
 {
+  if (operations_map == nullptr) {
+    /* Component is untouched since previous build. */
+    return;
+  }
   operations.reserve(BLI_ghash_len(operations_map));
   GHASH_FOREACH_BEGIN (OperationNode *, op_node, operations_map) {
     operations.push_back(op_node);
@@ -323,6 +328,20 @@ void ComponentNode::finalize_build(Depsgraph * /*graph*/)
   operations_map = nullptr;
 }
 
+void ComponentNode::ensure_operations_map()
+{
+  if (operations_map != nullptr) {
+    return;
+  }
+  operations_map = BLI_ghash_new(comp_node_hash_key, comp_node_hash_key_cmp, "Depsgraph id hash");
+  for (OperationNode *op_node : operations) {
+    OperationIDKey *key = OBJECT_GUARDED_NEW(
+        OperationIDKey, op_node->opcode, op_node->name.c_str(), op_node->name_tag);
+    BLI_ghash_insert(operations_map, key, op_node);
+  }
+  operations.clear();
+}
+
 /* Bone Component ========================================= */
 
 /* Initialize 'bone component' node - from pointer data given */
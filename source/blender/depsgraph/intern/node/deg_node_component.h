@@ -109,6 +109,10 @@ struct ComponentNode : public Node {
 
   void finalize_build(Depsgraph *graph);
 
+  /* Move operations of a finalized component back to the hash map, so new
+   * operations can be added to it when an existing graph is being updated. */
+  void ensure_operations_map();
+
   IDNode *owner;
 
   /* ** Inner nodes for this component ** */
@@ -24,6 +24,7 @@
 #include "intern/node/deg_node_id.h"
 
 #include <stdio.h>
+#include <algorithm>
 #include <cstring> /* required for STREQ later on. */
 
 #include "BLI_utildefines.h"
@@ -42,7 +43,9 @@ extern "C" {
 
 #include "intern/eval/deg_eval_copy_on_write.h"
 #include "intern/node/deg_node_factory.h"
+#include "intern/depsgraph_relation.h"
 #include "intern/node/deg_node_component.h"
+#include "intern/node/deg_node_operation.h"
 #include "intern/node/deg_node_time.h"
 
 namespace DEG {
@@ -172,6 +175,57 @@ void IDNode::destroy()
   id_orig = nullptr;
 }
 
+/* ID node which owns given component or operation node. */
+static const IDNode *relation_node_owner(const Node *node)
+{
+  switch (node->get_class()) {
+    case NodeClass::OPERATION:
+      return static_cast<const OperationNode *>(node)->owner->owner;
+    case NodeClass::COMPONENT:
+      return static_cast<const ComponentNode *>(node)->owner;
+    default:
+      return nullptr;
+  }
+}
+
+/* Detach relations of the node from nodes of other IDs. Relations to other
+ * IDs are freed here, the rest is freed together with the node. */
+static void id_node_unlink_relations(const IDNode *id_node, Node *node)
+{
+  for (Relation *rel : node->inlinks) {
+    if (relation_node_owner(rel->from) != id_node) {
+      Node::Relations &outlinks = rel->from->outlinks;
+      outlinks.erase(std::remove(outlinks.begin(), outlinks.end(), rel), outlinks.end());
+    }
+  }
+  for (Relation *rel : node->outlinks) {
+    if (relation_node_owner(rel->to) != id_node) {
+      rel->unlink();
+      OBJECT_GUARDED_DELETE(rel, Relation);
+    }
+  }
+  node->outlinks.clear();
+}
+
+void IDNode::clear_components()
+{
+  GHASH_FOREACH_BEGIN (ComponentNode *, comp_node, components) {
+    id_node_unlink_relations(this, comp_node);
+    for (OperationNode *op_node : comp_node->operations) {
+      id_node_unlink_relations(this, op_node);
+    }
+    if (comp_node->operations_map != nullptr) {
+      GHASH_FOREACH_BEGIN (OperationNode *, op_node, comp_node->operations_map) {
+        id_node_unlink_relations(this, op_node);
+      }
+      GHASH_FOREACH_END();
+    }
+  }
+  GHASH_FOREACH_END();
+  BLI_ghash_clear(components, id_deps_node_hash_key_free, id_deps_node_hash_value_free);
+  visible_components_mask = 0;
+}
+
 string IDNode::identifier() const
 {
   char orig_ptr[24], cow_ptr[24];
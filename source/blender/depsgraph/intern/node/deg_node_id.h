@@ -61,6 +61,10 @@ struct IDNode : public Node {
   ~IDNode();
   void destroy();
 
+  /* Free all components and operations of the ID, together with their
+   * relations. The node itself and its copy-on-write datablock are kept. */
+  void clear_components();
+
   virtual string identifier() const override;
 
   ComponentNode *find_component(NodeType type, const char *name = "") const;
@@ -223,6 +223,8 @@ typedef struct MeshBatchCache {
   int vert_len;
   int mat_len;
   bool is_dirty; /* Instantly invalidates cache, skipping mesh check */
+  /* Only vertex positions changed, buffers depending on them are extracted again in place. */
+  bool is_dirty_deform;
   bool is_editmode;
   bool is_uvsyncsel;
 
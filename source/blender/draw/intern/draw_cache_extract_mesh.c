@@ -402,6 +402,8 @@ typedef void(ExtractLoopFn)(
 typedef void(ExtractLedgeFn)(const MeshRenderData *mr, int e, const MEdge *medge, void *data);
 typedef void(ExtractLvertFn)(const MeshRenderData *mr, int v, const MVert *mvert, void *data);
 typedef void(ExtractFinishFn)(const MeshRenderData *mr, void *buffer, void *data);
+typedef void *(ExtractTaskInitFn)(void *data);
+typedef void(ExtractTaskFinishFn)(void *data, void *task_data);
 
 typedef struct MeshExtract {
   /** Executed on main thread and return user data for iter functions. */
@@ -421,6 +423,15 @@ typedef struct MeshExtract {
   const eMRDataType data_flag;
   /** Used to know if the element callbacks are threadsafe and can be parallelized. */
   const bool use_threading;
+  /**
+   * Optional, executed on main thread for each task when the iterations are split between
+   * threads. Returns the data given to the iter functions of that task, usually a copy of the
+   * builder of the buffer, so each task writes in its own range of the same buffer.
+   */
+  ExtractTaskInitFn *task_init;
+  /** Executed on one worker thread once all tasks are done, merges (and frees) the data
+   * returned by task_init, before the finish function. */
+  ExtractTaskFinishFn *task_finish;
 } MeshExtract;
 
 BLI_INLINE eMRIterType mesh_extract_iter_type(const MeshExtract *ext)
@@ -435,12 +446,35 @@ BLI_INLINE eMRIterType mesh_extract_iter_type(const MeshExtract *ext)
 
 /** \} */
 
+/* ---------------------------------------------------------------------- */
+/** \name Extract Index Buffer Tasks
+ *
+ * Index buffers elements are set at their final position, each task uses its own copy of the
+ * builder so the length of the buffer is only updated when they are joined.
+ * \{ */
+
+static void *extract_elb_task_init(void *elb)
+{
+  return MEM_dupallocN(elb);
+}
+
+static void extract_elb_task_finish(void *elb, void *task_elb)
+{
+  GPU_indexbuf_join(elb, task_elb);
+  MEM_freeN(task_elb);
+}
+
+/** \} */
+
 /* ---------------------------------------------------------------------- */
 /** \name Extract Triangles Indices
  * \{ */
 
 typedef struct MeshExtract_Tri_Data {
   GPUIndexBufBuilder elb;
+  /** Index of the first triangle of each polygon in the buffer (sorted by material),
+   * minus the index of its first looptri. */
+  int *poly_tri_ofs;
   int *tri_mat_start;
   int *tri_mat_end;
 } MeshExtract_Tri_Data;
@@ -485,23 +519,50 @@ static void *extract_tris_init(const MeshRenderData *mr, void *UNUSED(ibo))
 
   memcpy(data->tri_mat_end, mat_tri_len, mat_tri_idx_size);
 
+  /* Position of the triangles of each polygon, so they can be set from any thread. */
+  data->poly_tri_ofs = MEM_mallocN(sizeof(int) * mr->poly_len, __func__);
+  int *mat_tri_ofs = data->tri_mat_end;
+  int tri_first = 0;
+  if (mr->extract_type == MR_EXTRACT_BMESH) {
+    BMIter iter;
+    BMFace *efa;
+    BM_ITER_MESH (efa, &iter, mr->bm, BM_FACES_OF_MESH) {
+      if (!BM_elem_flag_test(efa, BM_ELEM_HIDDEN)) {
+        int mat = min_ii(efa->mat_nr, mr->mat_len - 1);
+        data->poly_tri_ofs[BM_elem_index_get(efa)] = mat_tri_ofs[mat] - tri_first;
+        mat_tri_ofs[mat] += efa->len - 2;
+      }
+      tri_first += efa->len - 2;
+    }
+  }
+  else {
+    const MPoly *mpoly = mr->mpoly;
+    for (int p = 0; p < mr->poly_len; p++, mpoly++) {
+      if (!(mr->use_hide && (mpoly->flag & ME_HIDE))) {
+        int mat = min_ii(mpoly->mat_nr, mr->mat_len - 1);
+        data->poly_tri_ofs[p] = mat_tri_ofs[mat] - tri_first;
+        mat_tri_ofs[mat] += mpoly->totloop - 2;
+      }
+      tri_first += mpoly->totloop - 2;
+    }
+  }
+
   int visible_tri_tot = ofs;
   GPU_indexbuf_init(&data->elb, GPU_PRIM_TRIS, visible_tri_tot, mr->loop_len);
 
   return data;
 }
 
-static void extract_tris_looptri_bmesh(const MeshRenderData *mr,
-                                       int UNUSED(t),
+static void extract_tris_looptri_bmesh(const MeshRenderData *UNUSED(mr),
+                                       int t,
                                        BMLoop **elt,
                                        void *_data)
 {
   if (!BM_elem_flag_test(elt[0]->f, BM_ELEM_HIDDEN)) {
     MeshExtract_Tri_Data *data = _data;
-    int *mat_tri_ofs = data->tri_mat_end;
-    int mat = min_ii(elt[0]->f->mat_nr, mr->mat_len - 1);
+    int tri_idx = data->poly_tri_ofs[BM_elem_index_get(elt[0]->f)] + t;
     GPU_indexbuf_set_tri_verts(&data->elb,
-                               mat_tri_ofs[mat]++,
+                               tri_idx,
                                BM_elem_index_get(elt[0]),
                                BM_elem_index_get(elt[1]),
                                BM_elem_index_get(elt[2]));
@@ -509,17 +570,15 @@ static void extract_tris_looptri_bmesh(const MeshRenderData *mr,
 }
 
 static void extract_tris_looptri_mesh(const MeshRenderData *mr,
-                                      int UNUSED(t),
+                                      int t,
                                       const MLoopTri *mlt,
                                       void *_data)
 {
   const MPoly *mpoly = &mr->mpoly[mlt->poly];
   if (!(mr->use_hide && (mpoly->flag & ME_HIDE))) {
     MeshExtract_Tri_Data *data = _data;
-    int *mat_tri_ofs = data->tri_mat_end;
-    int mat = min_ii(mpoly->mat_nr, mr->mat_len - 1);
-    GPU_indexbuf_set_tri_verts(
-        &data->elb, mat_tri_ofs[mat]++, mlt->tri[0], mlt->tri[1], mlt->tri[2]);
+    int tri_idx = data->poly_tri_ofs[mlt->poly] + t;
+    GPU_indexbuf_set_tri_verts(&data->elb, tri_idx, mlt->tri[0], mlt->tri[1], mlt->tri[2]);
   }
 }
 
@@ -539,11 +598,25 @@ static void extract_tris_finish(const MeshRenderData *mr, void *ibo, void *_data
       GPU_batch_elembuf_set(mr->cache->surface_per_mat[i], sub_ibo, true);
     }
   }
+  MEM_freeN(data->poly_tri_ofs);
   MEM_freeN(data->tri_mat_start);
   MEM_freeN(data->tri_mat_end);
   MEM_freeN(data);
 }
 
+static void *extract_tris_task_init(void *data)
+{
+  return MEM_dupallocN(data);
+}
+
+static void extract_tris_task_finish(void *_data, void *_task_data)
+{
+  MeshExtract_Tri_Data *data = _data;
+  MeshExtract_Tri_Data *task_data = _task_data;
+  GPU_indexbuf_join(&data->elb, &task_data->elb);
+  MEM_freeN(task_data);
+}
+
 static const MeshExtract extract_tris = {
     extract_tris_init,
     extract_tris_looptri_bmesh,
@@ -556,7 +629,9 @@ static const MeshExtract extract_tris = {
     NULL,
     extract_tris_finish,
     0,
-    false,
+    true,
+    extract_tris_task_init,
+    extract_tris_task_finish,
 };
 
 /** \} */
@@ -565,25 +640,51 @@ static const MeshExtract extract_tris = {
 /** \name Extract Edges Indices
  * \{ */
 
+typedef struct MeshExtract_Lines_Data {
+  GPUIndexBufBuilder elb;
+  /** The loop setting each edge (Mesh only), see #extract_lines_loop_bmesh. */
+  int *edge_loop_owner;
+} MeshExtract_Lines_Data;
+
 static void *extract_lines_init(const MeshRenderData *mr, void *UNUSED(buf))
 {
-  GPUIndexBufBuilder *elb = MEM_mallocN(sizeof(*elb), __func__);
+  MeshExtract_Lines_Data *data = MEM_callocN(sizeof(*data), __func__);
   /* Put loose edges at the end. */
-  GPU_indexbuf_init(
-      elb, GPU_PRIM_LINES, mr->edge_len + mr->edge_loose_len, mr->loop_len + mr->loop_loose_len);
-  return elb;
+  GPU_indexbuf_init(&data->elb,
+                    GPU_PRIM_LINES,
+                    mr->edge_len + mr->edge_loose_len,
+                    mr->loop_len + mr->loop_loose_len);
+
+  if (mr->extract_type != MR_EXTRACT_BMESH) {
+    /* The last loop of each edge, which used to set it last when extracting serially. */
+    data->edge_loop_owner = MEM_mallocN(sizeof(int) * mr->edge_len, __func__);
+    const MLoop *mloop = mr->mloop;
+    for (int l = 0; l < mr->loop_len; l++, mloop++) {
+      data->edge_loop_owner[mloop->e] = l;
+    }
+  }
+  return data;
 }
 
+/**
+ * Exactly one loop sets each edge, its first vertex is that loop (the edit mode overlay reads
+ * the edge flags of the loop from it). The loops of an edge may run in different threads.
+ */
 static void extract_lines_loop_bmesh(const MeshRenderData *UNUSED(mr),
                                      int l,
                                      BMLoop *loop,
-                                     void *elb)
+                                     void *_data)
 {
+  MeshExtract_Lines_Data *data = _data;
+  if (loop != loop->e->l) {
+    return;
+  }
   if (!BM_elem_flag_test(loop->e, BM_ELEM_HIDDEN)) {
-    GPU_indexbuf_set_line_verts(elb, BM_elem_index_get(loop->e), l, BM_elem_index_get(loop->next));
+    GPU_indexbuf_set_line_verts(
+        &data->elb, BM_elem_index_get(loop->e), l, BM_elem_index_get(loop->next));
   }
   else {
-    GPU_indexbuf_set_line_restart(elb, BM_elem_index_get(loop->e));
+    GPU_indexbuf_set_line_restart(&data->elb, BM_elem_index_get(loop->e));
   }
 }
 
@@ -592,59 +693,80 @@ static void extract_lines_loop_mesh(const MeshRenderData *mr,
                                     const MLoop *mloop,
                                     int UNUSED(p),
                                     const MPoly *mpoly,
-                                    void *elb)
+                                    void *_data)
 {
+  MeshExtract_Lines_Data *data = _data;
+  if (data->edge_loop_owner[mloop->e] != l) {
+    return;
+  }
   const MEdge *medge = &mr->medge[mloop->e];
   if (!((mr->use_hide && (medge->flag & ME_HIDE)) ||
         ((mr->extract_type == MR_EXTRACT_MAPPED) &&
          (mr->e_origindex[mloop->e] == ORIGINDEX_NONE)))) {
     int loopend = mpoly->totloop + mpoly->loopstart - 1;
     int other_loop = (l == loopend) ? mpoly->loopstart : (l + 1);
-    GPU_indexbuf_set_line_verts(elb, mloop->e, l, other_loop);
+    GPU_indexbuf_set_line_verts(&data->elb, mloop->e, l, other_loop);
   }
   else {
-    GPU_indexbuf_set_line_restart(elb, mloop->e);
+    GPU_indexbuf_set_line_restart(&data->elb, mloop->e);
   }
 }
 
-static void extract_lines_ledge_bmesh(const MeshRenderData *mr, int e, BMEdge *eed, void *elb)
+static void extract_lines_ledge_bmesh(const MeshRenderData *mr, int e, BMEdge *eed, void *_data)
 {
+  MeshExtract_Lines_Data *data = _data;
   int ledge_idx = mr->edge_len + e;
   if (!BM_elem_flag_test(eed, BM_ELEM_HIDDEN)) {
     int l = mr->loop_len + e * 2;
-    GPU_indexbuf_set_line_verts(elb, ledge_idx, l, l + 1);
+    GPU_indexbuf_set_line_verts(&data->elb, ledge_idx, l, l + 1);
   }
   else {
-    GPU_indexbuf_set_line_restart(elb, ledge_idx);
+    GPU_indexbuf_set_line_restart(&data->elb, ledge_idx);
   }
   /* Don't render the edge twice. */
-  GPU_indexbuf_set_line_restart(elb, BM_elem_index_get(eed));
+  GPU_indexbuf_set_line_restart(&data->elb, BM_elem_index_get(eed));
 }
 
 static void extract_lines_ledge_mesh(const MeshRenderData *mr,
                                      int e,
                                      const MEdge *medge,
-                                     void *elb)
+                                     void *_data)
 {
+  MeshExtract_Lines_Data *data = _data;
   int ledge_idx = mr->edge_len + e;
   int edge_idx = mr->ledges[e];
   if (!((mr->use_hide && (medge->flag & ME_HIDE)) ||
         ((mr->extract_type == MR_EXTRACT_MAPPED) &&
          (mr->e_origindex[edge_idx] == ORIGINDEX_NONE)))) {
     int l = mr->loop_len + e * 2;
-    GPU_indexbuf_set_line_verts(elb, ledge_idx, l, l + 1);
+    GPU_indexbuf_set_line_verts(&data->elb, ledge_idx, l, l + 1);
   }
   else {
-    GPU_indexbuf_set_line_restart(elb, ledge_idx);
+    GPU_indexbuf_set_line_restart(&data->elb, ledge_idx);
   }
   /* Don't render the edge twice. */
-  GPU_indexbuf_set_line_restart(elb, edge_idx);
+  GPU_indexbuf_set_line_restart(&data->elb, edge_idx);
 }
 
-static void extract_lines_finish(const MeshRenderData *UNUSED(mr), void *ibo, void *elb)
+static void extract_lines_finish(const MeshRenderData *UNUSED(mr), void *ibo, void *_data)
 {
-  GPU_indexbuf_build_in_place(elb, ibo);
-  MEM_freeN(elb);
+  MeshExtract_Lines_Data *data = _data;
+  GPU_indexbuf_build_in_place(&data->elb, ibo);
+  MEM_SAFE_FREE(data->edge_loop_owner);
+  MEM_freeN(data);
+}
+
+static void *extract_lines_task_init(void *data)
+{
+  return MEM_dupallocN(data);
+}
+
+static void extract_lines_task_finish(void *_data, void *_task_data)
+{
+  MeshExtract_Lines_Data *data = _data;
+  MeshExtract_Lines_Data *task_data = _task_data;
+  GPU_indexbuf_join(&data->elb, &task_data->elb);
+  MEM_freeN(task_data);
 }
 
 static const MeshExtract extract_lines = {
@@ -659,7 +781,9 @@ static const MeshExtract extract_lines = {
     NULL,
     extract_lines_finish,
     0,
-    false,
+    true,
+    extract_lines_task_init,
+    extract_lines_task_finish,
 };
 
 /** \} */
@@ -828,7 +952,9 @@ static const MeshExtract extract_points = {
     extract_points_lvert_mesh,
     extract_points_finish,
     0,
-    false,
+    true,
+    extract_elb_task_init,
+    extract_elb_task_finish,
 };
 
 /** \} */
@@ -893,7 +1019,9 @@ static const MeshExtract extract_fdots = {
     NULL,
     extract_fdots_finish,
     0,
-    false,
+    true,
+    extract_elb_task_init,
+    extract_elb_task_finish,
 };
 
 /** \} */
@@ -4226,6 +4354,11 @@ typedef struct ExtractTaskData {
   int32_t *task_counter;
   void *buf;
   void *user_data;
+  /** Given to the iter functions, see #MeshExtract.task_init. */
+  void *task_data;
+  /** All the tasks of an extraction split in ranges, freed by the last one to finish. */
+  struct ExtractTaskData *range_tasks;
+  int range_tasks_len;
 } ExtractTaskData;
 
 BLI_INLINE void mesh_extract_iter(const MeshRenderData *mr,
@@ -4308,24 +4441,46 @@ static void extract_run(TaskPool *__restrict UNUSED(pool), void *taskdata, int U
 {
   ExtractTaskData *data = taskdata;
   mesh_extract_iter(
-      data->mr, data->iter_type, data->start, data->end, data->extract, data->user_data);
+      data->mr, data->iter_type, data->start, data->end, data->extract, data->task_data);
 
   /* If this is the last task, we do the finish function. */
   int remainin_tasks = atomic_sub_and_fetch_int32(data->task_counter, 1);
-  if (remainin_tasks == 0 && data->extract->finish != NULL) {
-    data->extract->finish(data->mr, data->buf, data->user_data);
+  if (remainin_tasks == 0) {
+    const MeshExtract *extract = data->extract;
+    ExtractTaskData *range_tasks = data->range_tasks;
+    if (range_tasks != NULL) {
+      if (extract->task_finish != NULL) {
+        for (int i = 0; i < data->range_tasks_len; i++) {
+          extract->task_finish(data->user_data, range_tasks[i].task_data);
+        }
+      }
+    }
+    if (extract->finish != NULL) {
+      extract->finish(data->mr, data->buf, data->user_data);
+    }
+    /* Other tasks are done, `data` is part of the array too. */
+    MEM_SAFE_FREE(range_tasks);
+  }
+}
+
+static int extract_range_tasks_init(ExtractTaskData *range_tasks,
+                                    const ExtractTaskData *taskdata,
+                                    const eMRIterType type,
+                                    const int len,
+                                    const int chunk_size)
+{
+  int range_tasks_len = 0;
+  for (int start = 0; start < len; start += chunk_size) {
+    ExtractTaskData *range_task = &range_tasks[range_tasks_len++];
+    *range_task = *taskdata;
+    range_task->iter_type = type;
+    range_task->start = start;
+    range_task->end = start + chunk_size;
+    if (taskdata->extract->task_init != NULL) {
+      range_task->task_data = taskdata->extract->task_init(taskdata->user_data);
+    }
   }
-}
-
-static void extract_range_task_create(
-    TaskPool *task_pool, ExtractTaskData *taskdata, const eMRIterType type, int start, int length)
-{
-  taskdata = MEM_dupallocN(taskdata);
-  atomic_add_and_fetch_int32(taskdata->task_counter, 1);
-  taskdata->iter_type = type;
-  taskdata->start = start;
-  taskdata->end = start + length;
-  BLI_task_pool_push(task_pool, extract_run, taskdata, true, TASK_PRIORITY_HIGH);
+  return range_tasks_len;
 }
 
 static void extract_task_create(TaskPool *task_pool,
@@ -4340,37 +4495,67 @@ static void extract_task_create(TaskPool *task_pool,
   taskdata->extract = extract;
   taskdata->buf = buf;
   taskdata->user_data = extract->init(mr, buf);
+  taskdata->task_data = taskdata->user_data;
   taskdata->iter_type = mesh_extract_iter_type(extract);
   taskdata->task_counter = task_counter;
   taskdata->start = 0;
   taskdata->end = INT_MAX;
+  taskdata->range_tasks = NULL;
+  taskdata->range_tasks_len = 0;
 
   /* Simple heuristic. */
   const bool use_thread = (mr->loop_len + mr->loop_loose_len) > 8192;
+  /* Divide task into sensible chunks. */
+  const int chunk_size = 8192;
+  const eMRIterType iter_type = taskdata->iter_type;
+  int range_tasks_len = 0;
   if (use_thread && extract->use_threading) {
-    /* Divide task into sensible chunks. */
-    const int chunk_size = 8192;
-    if (taskdata->iter_type & MR_ITER_LOOPTRI) {
-      for (int i = 0; i < mr->tri_len; i += chunk_size) {
-        extract_range_task_create(task_pool, taskdata, MR_ITER_LOOPTRI, i, chunk_size);
-      }
+    if (iter_type & MR_ITER_LOOPTRI) {
+      range_tasks_len += (mr->tri_len + chunk_size - 1) / chunk_size;
     }
-    if (taskdata->iter_type & MR_ITER_LOOP) {
-      for (int i = 0; i < mr->poly_len; i += chunk_size) {
-        extract_range_task_create(task_pool, taskdata, MR_ITER_LOOP, i, chunk_size);
-      }
+    if (iter_type & MR_ITER_LOOP) {
+      range_tasks_len += (mr->poly_len + chunk_size - 1) / chunk_size;
     }
-    if (taskdata->iter_type & MR_ITER_LEDGE) {
-      for (int i = 0; i < mr->edge_loose_len; i += chunk_size) {
-        extract_range_task_create(task_pool, taskdata, MR_ITER_LEDGE, i, chunk_size);
-      }
+    if (iter_type & MR_ITER_LEDGE) {
+      range_tasks_len += (mr->edge_loose_len + chunk_size - 1) / chunk_size;
     }
-    if (taskdata->iter_type & MR_ITER_LVERT) {
-      for (int i = 0; i < mr->vert_loose_len; i += chunk_size) {
-        extract_range_task_create(task_pool, taskdata, MR_ITER_LVERT, i, chunk_size);
-      }
+    if (iter_type & MR_ITER_LVERT) {
+      range_tasks_len += (mr->vert_loose_len + chunk_size - 1) / chunk_size;
+    }
+  }
+
+  if (range_tasks_len > 1) {
+    /* Tasks are stored in a single array, the last one to finish merges and frees them.
+     * Every range is counted before pushing, so none can finish the buffer too early. */
+    ExtractTaskData *range_tasks = MEM_mallocN(sizeof(*range_tasks) * range_tasks_len,
+                                               "ExtractTaskData");
+    taskdata->range_tasks = range_tasks;
+    taskdata->range_tasks_len = range_tasks_len;
+
+    int i = 0;
+    if (iter_type & MR_ITER_LOOPTRI) {
+      i += extract_range_tasks_init(
+          &range_tasks[i], taskdata, MR_ITER_LOOPTRI, mr->tri_len, chunk_size);
     }
+    if (iter_type & MR_ITER_LOOP) {
+      i += extract_range_tasks_init(
+          &range_tasks[i], taskdata, MR_ITER_LOOP, mr->poly_len, chunk_size);
+    }
+    if (iter_type & MR_ITER_LEDGE) {
+      i += extract_range_tasks_init(
+          &range_tasks[i], taskdata, MR_ITER_LEDGE, mr->edge_loose_len, chunk_size);
+    }
+    if (iter_type & MR_ITER_LVERT) {
+      i += extract_range_tasks_init(
+          &range_tasks[i], taskdata, MR_ITER_LVERT, mr->vert_loose_len, chunk_size);
+    }
+    BLI_assert(i == range_tasks_len);
     MEM_freeN(taskdata);
+
+    atomic_add_and_fetch_int32(task_counter, range_tasks_len);
+    for (i = 0; i < range_tasks_len; i++) {
+      BLI_task_pool_push(task_pool, extract_run, &range_tasks[i], false, TASK_PRIORITY_HIGH);
+    }
   }
   else if (use_thread) {
     /* One task for the whole VBO. */
@@ -68,6 +68,7 @@
 #include "draw_cache_impl.h" /* own include */
 
 static void mesh_batch_cache_clear(Mesh *me);
+static void mesh_batch_cache_discard_deformed(MeshBatchCache *cache);
 
 /* Return true is all layers in _b_ are inside _a_. */
 BLI_INLINE bool mesh_cd_layers_type_overlap(DRW_MeshCDMask a, DRW_MeshCDMask b)
@@ -383,6 +384,9 @@ void DRW_mesh_batch_cache_validate(Mesh *me)
     mesh_batch_cache_clear(me);
     mesh_batch_cache_init(me);
   }
+  else if (((MeshBatchCache *)me->runtime.batch_cache)->is_dirty_deform) {
+    mesh_batch_cache_discard_deformed(me->runtime.batch_cache);
+  }
 }
 
 static MeshBatchCache *mesh_batch_cache_get(Mesh *me)
@@ -494,6 +498,52 @@ static void mesh_batch_cache_discard_uvedit_select(MeshBatchCache *cache)
   cache->batch_ready &= ~MBC_EDITUV;
 }
 
+/* Clear the buffers depending on vertex positions so they are extracted again. This is done in
+ * place, batches keep referencing them and topology buffers are kept. Can be called more than
+ * once before the extraction.
+ *
+ * The triangles index buffer (and the per material batches using it) is kept too: the cache is
+ * only handed over to a deformed mesh which is tessellated the same way, quads and ngons
+ * included (see #mesh_batch_cache_reuse_deformed). */
+static void mesh_batch_cache_discard_deformed(MeshBatchCache *cache)
+{
+  FOREACH_MESH_BUFFER_CACHE(cache, mbufcache)
+  {
+    GPUVertBuf *vbos[] = {
+        mbufcache->vbo.pos_nor,
+        mbufcache->vbo.lnor,
+        mbufcache->vbo.edge_fac,
+        mbufcache->vbo.tan,
+        mbufcache->vbo.stretch_area,
+        mbufcache->vbo.stretch_angle,
+        mbufcache->vbo.mesh_analysis,
+        mbufcache->vbo.fdots_pos,
+        mbufcache->vbo.fdots_nor,
+        mbufcache->vbo.skin_roots,
+    };
+    for (int i = 0; i < ARRAY_SIZE(vbos); i++) {
+      if (vbos[i] != NULL) {
+        GPU_vertbuf_clear(vbos[i]);
+        GPU_vertbuf_init(vbos[i], GPU_USAGE_STATIC);
+      }
+    }
+  }
+  /* The new buffers will be uploaded to new GL buffers. */
+  for (int i = 0; i < sizeof(cache->batch) / sizeof(void *); i++) {
+    GPUBatch *batch = ((GPUBatch **)&cache->batch)[i];
+    if (batch != NULL) {
+      GPU_batch_vao_cache_clear(batch);
+    }
+  }
+  if (cache->surface_per_mat) {
+    for (int i = 0; i < cache->mat_len; i++) {
+      if (cache->surface_per_mat[i] != NULL) {
+        GPU_batch_vao_cache_clear(cache->surface_per_mat[i]);
+      }
+    }
+  }
+}
+
 void DRW_mesh_batch_cache_dirty_tag(Mesh *me, int mode)
 {
   MeshBatchCache *cache = me->runtime.batch_cache;
@@ -545,6 +595,10 @@ void DRW_mesh_batch_cache_dirty_tag(Mesh *me, int mode)
     case BKE_MESH_BATCH_DIRTY_ALL:
       cache->is_dirty = true;
       break;
+    case BKE_MESH_BATCH_DIRTY_DEFORM:
+      /* Buffers are cleared on validation, it needs the GPU context. */
+      cache->is_dirty_deform = true;
+      break;
     case BKE_MESH_BATCH_DIRTY_SHADING:
       mesh_batch_cache_discard_shaded_tri(cache);
       mesh_batch_cache_discard_uvedit(cache);
@@ -1124,7 +1178,7 @@ void DRW_mesh_batch_cache_create_requested(
   }
 
   /* Second chance to early out */
-  if ((batch_requested & ~cache->batch_ready) == 0) {
+  if ((batch_requested & ~cache->batch_ready) == 0 && !cache->is_dirty_deform) {
 #ifdef DEBUG
     goto check;
 #endif
@@ -1370,6 +1424,8 @@ void DRW_mesh_batch_cache_create_requested(
                                      ts,
                                      use_hide);
 
+  cache->is_dirty_deform = false;
+
 #ifdef DEBUG
 check:
   /* Make sure all requested batches have been setup. */
@@ -40,6 +40,7 @@
 #include "DNA_windowmanager_types.h"
 
 #include "BKE_main.h"
+#include "BKE_main_namemap.h"
 #include "BKE_brush.h"
 #include "BKE_deform.h"
 #include "BKE_image.h"
@@ -1297,6 +1298,7 @@ static void gpencil_fill_exit(bContext *C, wmOperator *op)
     if (tgpf->ima) {
       for (Image *ima = bmain->images.first; ima; ima = ima->id.next) {
         if (ima == tgpf->ima) {
+          BKE_main_namemap_remove_name(bmain, &ima->id, ima->id.name + 2);
           BLI_remlink(&bmain->images, ima);
           BKE_image_free(tgpf->ima);
           MEM_SAFE_FREE(tgpf->ima);
@@ -51,6 +51,7 @@
 #include "BKE_lib_id.h"
 #include "BKE_library.h"
 #include "BKE_main.h"
+#include "BKE_main_namemap.h"
 #include "BKE_modifier.h"
 #include "BKE_object.h"
 #include "BKE_report.h"
@@ -674,6 +675,21 @@ static void scenes__collection_set_flag_recursive_cb(bContext *C, void *poin, vo
   outliner_collection_set_flag_recursive_cb(C, NULL, collection, propname);
 }
 
+/* The text button edits the name of the ID directly, update the names used by the Main database
+ * before making the new name unique. */
+static void namebutton_id_ensure_unique_name(Main *bmain,
+                                             TreeElement *te,
+                                             ID *id,
+                                             const char *oldname)
+{
+  /* Library elements show and edit the file path instead. */
+  if (te->name == id->name + 2) {
+    BKE_main_namemap_remove_name(bmain, id, oldname);
+    BKE_main_namemap_add_name(bmain, id, id->name + 2);
+  }
+  BLI_libblock_ensure_unique_name(bmain, id->name);
+}
+
 static void namebutton_cb(bContext *C, void *tsep, char *oldname)
 {
   Main *bmain = CTX_data_main(C);
@@ -686,7 +702,7 @@ static void namebutton_cb(bContext *C, void *tsep, char *oldname)
     TreeElement *te = outliner_find_tree_element(&soops->tree, tselem);
 
     if (tselem->type == 0) {
-      BLI_libblock_ensure_unique_name(bmain, tselem->id->name);
+      namebutton_id_ensure_unique_name(bmain, te, tselem->id, oldname);
 
       switch (GS(tselem->id->name)) {
         case ID_MA:
@@ -744,7 +760,7 @@ static void namebutton_cb(bContext *C, void *tsep, char *oldname)
           defgroup_unique_name(te->directdata, (Object *)tselem->id);  //  id = object
           break;
         case TSE_NLA_ACTION:
-          BLI_libblock_ensure_unique_name(bmain, tselem->id->name);
+          namebutton_id_ensure_unique_name(bmain, te, tselem->id, oldname);
           break;
         case TSE_EBONE: {
           bArmature *arm = (bArmature *)tselem->id;
@@ -842,7 +858,7 @@ static void namebutton_cb(bContext *C, void *tsep, char *oldname)
           break;
         }
         case TSE_LAYER_COLLECTION: {
-          BLI_libblock_ensure_unique_name(bmain, tselem->id->name);
+          namebutton_id_ensure_unique_name(bmain, te, tselem->id, oldname);
           WM_event_add_notifier(C, NC_ID | NA_RENAME, NULL);
           break;
         }
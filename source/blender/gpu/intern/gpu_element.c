@@ -239,6 +239,15 @@ void GPU_indexbuf_set_tri_restart(GPUIndexBufBuilder *builder, uint elem)
   }
 }
 
+void GPU_indexbuf_join(GPUIndexBufBuilder *builder, const GPUIndexBufBuilder *builder_from)
+{
+  BLI_assert(builder->data == builder_from->data);
+  BLI_assert(builder->prim_type == builder_from->prim_type);
+  if (builder->index_len < builder_from->index_len) {
+    builder->index_len = builder_from->index_len;
+  }
+}
+
 GPUIndexBuf *GPU_indexbuf_create_subrange(GPUIndexBuf *elem_src, uint start, uint length)
 {
   GPUIndexBuf *elem = MEM_callocN(sizeof(GPUIndexBuf), "GPUIndexBuf");
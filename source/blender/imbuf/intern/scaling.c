@@ -25,6 +25,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_math_color.h"
 #include "BLI_math_interp.h"
+#include "BLI_task.h"
 #include "MEM_guardedalloc.h"
 
 #include "imbuf.h"
@@ -35,6 +36,14 @@
 
 #include "BLI_sys_types.h"  // for intptr_t support
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+/* Images smaller than this are scaled on the calling thread, the overhead of threading isn't
+ * worth it for them. */
+#define SCALE_THREADING_MIN_PIXELS (256 * 256)
+
 static void imb_half_x_no_alloc(struct ImBuf *ibuf2, struct ImBuf *ibuf1)
 {
   uchar *p1, *_p1, *dest;
@@ -370,12 +379,120 @@ MINLINE void premul_ushort_to_straight_uchar(unsigned char *result, const unsign
   }
 }
 
+static void imb_onehalf_row_byte(const uchar *cp1, const uchar *cp2, uchar *dest, int width)
+{
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  /* Alpha is multiplied by 256 instead of itself, see #straight_uchar_to_premul_ushort. */
+  const __m128i alpha_mask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+  const __m128i alpha_256 = _mm_set_epi16(256, 0, 0, 0, 256, 0, 0, 0);
+#endif
+
+  for (int x = width; x > 0; x--) {
+    unsigned short desti[4];
+
+#ifdef __SSE2__
+    /* Two pixels of each line, premultiplied in 16 bit, summed in 32 bit. */
+    __m128i p1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)cp1), zero);
+    __m128i p2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)cp2), zero);
+    __m128i a1 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p1, _MM_SHUFFLE(3, 3, 3, 3)),
+                                     _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i a2 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p2, _MM_SHUFFLE(3, 3, 3, 3)),
+                                     _MM_SHUFFLE(3, 3, 3, 3));
+    p1 = _mm_mullo_epi16(p1, _mm_or_si128(_mm_andnot_si128(alpha_mask, a1), alpha_256));
+    p2 = _mm_mullo_epi16(p2, _mm_or_si128(_mm_andnot_si128(alpha_mask, a2), alpha_256));
+
+    __m128i sum = _mm_add_epi32(_mm_unpacklo_epi16(p1, zero), _mm_unpackhi_epi16(p1, zero));
+    sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(p2, zero));
+    sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(p2, zero));
+    sum = _mm_srli_epi32(sum, 2);
+
+    unsigned int sumi[4];
+    _mm_storeu_si128((__m128i *)sumi, sum);
+    desti[0] = (unsigned short)sumi[0];
+    desti[1] = (unsigned short)sumi[1];
+    desti[2] = (unsigned short)sumi[2];
+    desti[3] = (unsigned short)sumi[3];
+#else
+    unsigned short p1i[8], p2i[8];
+
+    straight_uchar_to_premul_ushort(p1i, cp1);
+    straight_uchar_to_premul_ushort(p2i, cp2);
+    straight_uchar_to_premul_ushort(p1i + 4, cp1 + 4);
+    straight_uchar_to_premul_ushort(p2i + 4, cp2 + 4);
+
+    desti[0] = ((unsigned int)p1i[0] + p2i[0] + p1i[4] + p2i[4]) >> 2;
+    desti[1] = ((unsigned int)p1i[1] + p2i[1] + p1i[5] + p2i[5]) >> 2;
+    desti[2] = ((unsigned int)p1i[2] + p2i[2] + p1i[6] + p2i[6]) >> 2;
+    desti[3] = ((unsigned int)p1i[3] + p2i[3] + p1i[7] + p2i[7]) >> 2;
+#endif
+
+    premul_ushort_to_straight_uchar(dest, desti);
+
+    cp1 += 8;
+    cp2 += 8;
+    dest += 4;
+  }
+}
+
+static void imb_onehalf_row_float(const float *p1f, const float *p2f, float *destf, int width)
+{
+#ifdef __SSE2__
+  const __m128 quarter = _mm_set1_ps(0.25f);
+#endif
+
+  for (int x = width; x > 0; x--) {
+#ifdef __SSE2__
+    __m128 sum = _mm_add_ps(_mm_loadu_ps(p1f), _mm_loadu_ps(p2f));
+    sum = _mm_add_ps(sum, _mm_loadu_ps(p1f + 4));
+    sum = _mm_add_ps(sum, _mm_loadu_ps(p2f + 4));
+    _mm_storeu_ps(destf, _mm_mul_ps(quarter, sum));
+#else
+    destf[0] = 0.25f * (p1f[0] + p2f[0] + p1f[4] + p2f[4]);
+    destf[1] = 0.25f * (p1f[1] + p2f[1] + p1f[5] + p2f[5]);
+    destf[2] = 0.25f * (p1f[2] + p2f[2] + p1f[6] + p2f[6]);
+    destf[3] = 0.25f * (p1f[3] + p2f[3] + p1f[7] + p2f[7]);
+#endif
+    p1f += 8;
+    p2f += 8;
+    destf += 4;
+  }
+}
+
+typedef struct OneHalfData {
+  const ImBuf *ibuf1;
+  ImBuf *ibuf2;
+  bool do_rect;
+  bool do_float;
+} OneHalfData;
+
+static void imb_onehalf_row_cb(void *__restrict userdata,
+                               const int y,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const OneHalfData *data = userdata;
+  const ImBuf *ibuf1 = data->ibuf1;
+  ImBuf *ibuf2 = data->ibuf2;
+  /* Every line of the result is made from two lines of the source, including the odd pixel at
+   * the end of them. */
+  const size_t offset1 = (size_t)y * 2 * ibuf1->x * 4;
+  const size_t offset2 = (size_t)y * ibuf2->x * 4;
+
+  if (data->do_rect) {
+    const uchar *cp1 = (const uchar *)ibuf1->rect + offset1;
+    imb_onehalf_row_byte(cp1, cp1 + ibuf1->x * 4, (uchar *)ibuf2->rect + offset2, ibuf2->x);
+  }
+  if (data->do_float) {
+    const float *p1f = ibuf1->rect_float + offset1;
+    imb_onehalf_row_float(p1f, p1f + ibuf1->x * 4, ibuf2->rect_float + offset2, ibuf2->x);
+  }
+}
+
 /* result in ibuf2, scaling should be done correctly */
 void imb_onehalf_no_alloc(struct ImBuf *ibuf2, struct ImBuf *ibuf1)
 {
-  int x, y;
-  const short do_rect = (ibuf1->rect != NULL);
-  const short do_float = (ibuf1->rect_float != NULL) && (ibuf2->rect_float != NULL);
+  const bool do_rect = (ibuf1->rect != NULL);
+  const bool do_float = (ibuf1->rect_float != NULL) && (ibuf2->rect_float != NULL);
 
   if (do_rect && (ibuf2->rect == NULL)) {
     imb_addrectImBuf(ibuf2);
@@ -390,62 +507,17 @@ void imb_onehalf_no_alloc(struct ImBuf *ibuf2, struct ImBuf *ibuf1)
     return;
   }
 
-  if (do_rect) {
-    unsigned char *cp1, *cp2, *dest;
-
-    cp1 = (unsigned char *)ibuf1->rect;
-    dest = (unsigned char *)ibuf2->rect;
-
-    for (y = ibuf2->y; y > 0; y--) {
-      cp2 = cp1 + (ibuf1->x << 2);
-      for (x = ibuf2->x; x > 0; x--) {
-        unsigned short p1i[8], p2i[8], desti[4];
-
-        straight_uchar_to_premul_ushort(p1i, cp1);
-        straight_uchar_to_premul_ushort(p2i, cp2);
-        straight_uchar_to_premul_ushort(p1i + 4, cp1 + 4);
-        straight_uchar_to_premul_ushort(p2i + 4, cp2 + 4);
+  OneHalfData data = {
+      .ibuf1 = ibuf1,
+      .ibuf2 = ibuf2,
+      .do_rect = do_rect,
+      .do_float = do_float,
+  };
 
-        desti[0] = ((unsigned int)p1i[0] + p2i[0] + p1i[4] + p2i[4]) >> 2;
-        desti[1] = ((unsigned int)p1i[1] + p2i[1] + p1i[5] + p2i[5]) >> 2;
-        desti[2] = ((unsigned int)p1i[2] + p2i[2] + p1i[6] + p2i[6]) >> 2;
-        desti[3] = ((unsigned int)p1i[3] + p2i[3] + p1i[7] + p2i[7]) >> 2;
-
-        premul_ushort_to_straight_uchar(dest, desti);
-
-        cp1 += 8;
-        cp2 += 8;
-        dest += 4;
-      }
-      cp1 = cp2;
-      if (ibuf1->x & 1) {
-        cp1 += 4;
-      }
-    }
-  }
-
-  if (do_float) {
-    float *p1f, *p2f, *destf;
-
-    p1f = ibuf1->rect_float;
-    destf = ibuf2->rect_float;
-    for (y = ibuf2->y; y > 0; y--) {
-      p2f = p1f + (ibuf1->x << 2);
-      for (x = ibuf2->x; x > 0; x--) {
-        destf[0] = 0.25f * (p1f[0] + p2f[0] + p1f[4] + p2f[4]);
-        destf[1] = 0.25f * (p1f[1] + p2f[1] + p1f[5] + p2f[5]);
-        destf[2] = 0.25f * (p1f[2] + p2f[2] + p1f[6] + p2f[6]);
-        destf[3] = 0.25f * (p1f[3] + p2f[3] + p1f[7] + p2f[7]);
-        p1f += 8;
-        p2f += 8;
-        destf += 4;
-      }
-      p1f = p2f;
-      if (ibuf1->x & 1) {
-        p1f += 4;
-      }
-    }
-  }
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = ((size_t)ibuf2->x * ibuf2->y > SCALE_THREADING_MIN_PIXELS);
+  BLI_task_parallel_range(0, ibuf2->y, &data, imb_onehalf_row_cb, &settings);
 }
 
 ImBuf *IMB_onehalf(struct ImBuf *ibuf1)
@@ -906,21 +978,156 @@ static bool q_scale_linear_interpolation(struct ImBuf *ibuf, int newx, int newy)
   return true;
 }
 
+typedef struct ScaleDownData {
+  const ImBuf *ibuf;
+  uchar *newrect;
+  float *newrectf;
+  /* New width or height. */
+  int newsize;
+  float add;
+} ScaleDownData;
+
+/**
+ * Scale down a line of pixels (a row or a column), \a stride is the distance between the pixels
+ * of the line in both the source and the destination.
+ */
+static void scaledown_line(const ScaleDownData *data,
+                           const uchar *rect,
+                           uchar *newrect,
+                           const float *rectf,
+                           float *newrectf,
+                           const size_t stride,
+                           const size_t line_size)
+{
+  const float add = data->add;
+  const uchar *rect_begin = rect;
+  const float *rectf_begin = rectf;
+  float sample, val[4], nval[4], valf[4], nvalf[4];
+
+  nval[0] = nval[1] = nval[2] = nval[3] = 0.0f;
+  nvalf[0] = nvalf[1] = nvalf[2] = nvalf[3] = 0.0f;
+
+  sample = 0.0f;
+  val[0] = val[1] = val[2] = val[3] = 0.0f;
+  valf[0] = valf[1] = valf[2] = valf[3] = 0.0f;
+
+  for (int i = data->newsize; i > 0; i--) {
+    if (rect) {
+      nval[0] = -val[0] * sample;
+      nval[1] = -val[1] * sample;
+      nval[2] = -val[2] * sample;
+      nval[3] = -val[3] * sample;
+    }
+    if (rectf) {
+      nvalf[0] = -valf[0] * sample;
+      nvalf[1] = -valf[1] * sample;
+      nvalf[2] = -valf[2] * sample;
+      nvalf[3] = -valf[3] * sample;
+    }
+
+    sample += add;
+
+    while (sample >= 1.0f) {
+      sample -= 1.0f;
+
+      if (rect) {
+        nval[0] += rect[0];
+        nval[1] += rect[1];
+        nval[2] += rect[2];
+        nval[3] += rect[3];
+        rect += stride;
+      }
+      if (rectf) {
+        nvalf[0] += rectf[0];
+        nvalf[1] += rectf[1];
+        nvalf[2] += rectf[2];
+        nvalf[3] += rectf[3];
+        rectf += stride;
+      }
+    }
+
+    if (rect) {
+      val[0] = rect[0];
+      val[1] = rect[1];
+      val[2] = rect[2];
+      val[3] = rect[3];
+      rect += stride;
+
+      newrect[0] = ((nval[0] + sample * val[0]) / add + 0.5f);
+      newrect[1] = ((nval[1] + sample * val[1]) / add + 0.5f);
+      newrect[2] = ((nval[2] + sample * val[2]) / add + 0.5f);
+      newrect[3] = ((nval[3] + sample * val[3]) / add + 0.5f);
+
+      newrect += stride;
+    }
+    if (rectf) {
+
+      valf[0] = rectf[0];
+      valf[1] = rectf[1];
+      valf[2] = rectf[2];
+      valf[3] = rectf[3];
+      rectf += stride;
+
+      newrectf[0] = ((nvalf[0] + sample * valf[0]) / add);
+      newrectf[1] = ((nvalf[1] + sample * valf[1]) / add);
+      newrectf[2] = ((nvalf[2] + sample * valf[2]) / add);
+      newrectf[3] = ((nvalf[3] + sample * valf[3]) / add);
+
+      newrectf += stride;
+    }
+
+    sample -= 1.0f;
+  }
+
+  /* Every pixel of the line must have been read exactly once, see bug [#26502]. */
+  BLI_assert(rect == NULL || (size_t)(rect - rect_begin) == line_size);
+  BLI_assert(rectf == NULL || (size_t)(rectf - rectf_begin) == line_size);
+  UNUSED_VARS_NDEBUG(rect_begin, rectf_begin, line_size);
+}
+
+static void scaledownx_row_cb(void *__restrict userdata,
+                              const int y,
+                              const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ScaleDownData *data = userdata;
+  const ImBuf *ibuf = data->ibuf;
+  const size_t offset = (size_t)y * ibuf->x * 4;
+  const size_t newoffset = (size_t)y * data->newsize * 4;
+
+  scaledown_line(data,
+                 data->newrect ? (const uchar *)ibuf->rect + offset : NULL,
+                 data->newrect ? data->newrect + newoffset : NULL,
+                 data->newrectf ? ibuf->rect_float + offset : NULL,
+                 data->newrectf ? data->newrectf + newoffset : NULL,
+                 4,
+                 (size_t)ibuf->x * 4);
+}
+
+static void scaledowny_column_cb(void *__restrict userdata,
+                                 const int x,
+                                 const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ScaleDownData *data = userdata;
+  const ImBuf *ibuf = data->ibuf;
+  const size_t offset = (size_t)x * 4;
+  const size_t skipx = (size_t)ibuf->x * 4;
+
+  scaledown_line(data,
+                 data->newrect ? (const uchar *)ibuf->rect + offset : NULL,
+                 data->newrect ? data->newrect + offset : NULL,
+                 data->newrectf ? ibuf->rect_float + offset : NULL,
+                 data->newrectf ? data->newrectf + offset : NULL,
+                 skipx,
+                 skipx * ibuf->y);
+}
+
 static ImBuf *scaledownx(struct ImBuf *ibuf, int newx)
 {
   const int do_rect = (ibuf->rect != NULL);
   const int do_float = (ibuf->rect_float != NULL);
-  const size_t rect_size = ibuf->x * ibuf->y * 4;
-
-  uchar *rect, *_newrect, *newrect;
-  float *rectf, *_newrectf, *newrectf;
-  float sample, add, val[4], nval[4], valf[4], nvalf[4];
-  int x, y;
 
-  rectf = _newrectf = newrectf = NULL;
-  rect = _newrect = newrect = NULL;
-  nval[0] = nval[1] = nval[2] = nval[3] = 0.0f;
-  nvalf[0] = nvalf[1] = nvalf[2] = nvalf[3] = 0.0f;
+  uchar *_newrect = NULL;
+  float *_newrectf = NULL;
 
   if (!do_rect && !do_float) {
     return (ibuf);
@@ -942,106 +1149,30 @@ static ImBuf *scaledownx(struct ImBuf *ibuf, int newx)
     }
   }
 
-  add = (ibuf->x - 0.01) / newx;
-
-  if (do_rect) {
-    rect = (uchar *)ibuf->rect;
-    newrect = _newrect;
-  }
-  if (do_float) {
-    rectf = ibuf->rect_float;
-    newrectf = _newrectf;
-  }
-
-  for (y = ibuf->y; y > 0; y--) {
-    sample = 0.0f;
-    val[0] = val[1] = val[2] = val[3] = 0.0f;
-    valf[0] = valf[1] = valf[2] = valf[3] = 0.0f;
+  ScaleDownData data = {
+      .ibuf = ibuf,
+      .newrect = _newrect,
+      .newrectf = _newrectf,
+      .newsize = newx,
+      .add = (ibuf->x - 0.01) / newx,
+  };
 
-    for (x = newx; x > 0; x--) {
-      if (do_rect) {
-        nval[0] = -val[0] * sample;
-        nval[1] = -val[1] * sample;
-        nval[2] = -val[2] * sample;
-        nval[3] = -val[3] * sample;
-      }
-      if (do_float) {
-        nvalf[0] = -valf[0] * sample;
-        nvalf[1] = -valf[1] * sample;
-        nvalf[2] = -valf[2] * sample;
-        nvalf[3] = -valf[3] * sample;
-      }
-
-      sample += add;
-
-      while (sample >= 1.0f) {
-        sample -= 1.0f;
-
-        if (do_rect) {
-          nval[0] += rect[0];
-          nval[1] += rect[1];
-          nval[2] += rect[2];
-          nval[3] += rect[3];
-          rect += 4;
-        }
-        if (do_float) {
-          nvalf[0] += rectf[0];
-          nvalf[1] += rectf[1];
-          nvalf[2] += rectf[2];
-          nvalf[3] += rectf[3];
-          rectf += 4;
-        }
-      }
-
-      if (do_rect) {
-        val[0] = rect[0];
-        val[1] = rect[1];
-        val[2] = rect[2];
-        val[3] = rect[3];
-        rect += 4;
-
-        newrect[0] = ((nval[0] + sample * val[0]) / add + 0.5f);
-        newrect[1] = ((nval[1] + sample * val[1]) / add + 0.5f);
-        newrect[2] = ((nval[2] + sample * val[2]) / add + 0.5f);
-        newrect[3] = ((nval[3] + sample * val[3]) / add + 0.5f);
-
-        newrect += 4;
-      }
-      if (do_float) {
-
-        valf[0] = rectf[0];
-        valf[1] = rectf[1];
-        valf[2] = rectf[2];
-        valf[3] = rectf[3];
-        rectf += 4;
-
-        newrectf[0] = ((nvalf[0] + sample * valf[0]) / add);
-        newrectf[1] = ((nvalf[1] + sample * valf[1]) / add);
-        newrectf[2] = ((nvalf[2] + sample * valf[2]) / add);
-        newrectf[3] = ((nvalf[3] + sample * valf[3]) / add);
-
-        newrectf += 4;
-      }
-
-      sample -= 1.0f;
-    }
-  }
+  /* Rows are independent of each other. */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = ((size_t)ibuf->x * ibuf->y > SCALE_THREADING_MIN_PIXELS);
+  BLI_task_parallel_range(0, ibuf->y, &data, scaledownx_row_cb, &settings);
 
   if (do_rect) {
-    // printf("%ld %ld\n", (uchar *)rect - ((uchar *)ibuf->rect), rect_size);
-    BLI_assert((uchar *)rect - ((uchar *)ibuf->rect) == rect_size); /* see bug [#26502] */
     imb_freerectImBuf(ibuf);
     ibuf->mall |= IB_rect;
     ibuf->rect = (unsigned int *)_newrect;
   }
   if (do_float) {
-    // printf("%ld %ld\n", rectf - ibuf->rect_float, rect_size);
-    BLI_assert((rectf - ibuf->rect_float) == rect_size); /* see bug [#26502] */
     imb_freerectfloatImBuf(ibuf);
     ibuf->mall |= IB_rectfloat;
     ibuf->rect_float = _newrectf;
   }
-  (void)rect_size; /* UNUSED in release builds */
 
   ibuf->x = newx;
   return (ibuf);
@@ -1051,17 +1182,9 @@ static ImBuf *scaledowny(struct ImBuf *ibuf, int newy)
 {
   const int do_rect = (ibuf->rect != NULL);
   const int do_float = (ibuf->rect_float != NULL);
-  const size_t rect_size = ibuf->x * ibuf->y * 4;
-
-  uchar *rect, *_newrect, *newrect;
-  float *rectf, *_newrectf, *newrectf;
-  float sample, add, val[4], nval[4], valf[4], nvalf[4];
-  int x, y, skipx;
 
-  rectf = _newrectf = newrectf = NULL;
-  rect = _newrect = newrect = NULL;
-  nval[0] = nval[1] = nval[2] = nval[3] = 0.0f;
-  nvalf[0] = nvalf[1] = nvalf[2] = nvalf[3] = 0.0f;
+  uchar *_newrect = NULL;
+  float *_newrectf = NULL;
 
   if (!do_rect && !do_float) {
     return (ibuf);
@@ -1083,107 +1206,30 @@ static ImBuf *scaledowny(struct ImBuf *ibuf, int newy)
     }
   }
 
-  add = (ibuf->y - 0.01) / newy;
-  skipx = 4 * ibuf->x;
-
-  for (x = skipx - 4; x >= 0; x -= 4) {
-    if (do_rect) {
-      rect = ((uchar *)ibuf->rect) + x;
-      newrect = _newrect + x;
-    }
-    if (do_float) {
-      rectf = ibuf->rect_float + x;
-      newrectf = _newrectf + x;
-    }
-
-    sample = 0.0f;
-    val[0] = val[1] = val[2] = val[3] = 0.0f;
-    valf[0] = valf[1] = valf[2] = valf[3] = 0.0f;
-
-    for (y = newy; y > 0; y--) {
-      if (do_rect) {
-        nval[0] = -val[0] * sample;
-        nval[1] = -val[1] * sample;
-        nval[2] = -val[2] * sample;
-        nval[3] = -val[3] * sample;
-      }
-      if (do_float) {
-        nvalf[0] = -valf[0] * sample;
-        nvalf[1] = -valf[1] * sample;
-        nvalf[2] = -valf[2] * sample;
-        nvalf[3] = -valf[3] * sample;
-      }
-
-      sample += add;
-
-      while (sample >= 1.0f) {
-        sample -= 1.0f;
-
-        if (do_rect) {
-          nval[0] += rect[0];
-          nval[1] += rect[1];
-          nval[2] += rect[2];
-          nval[3] += rect[3];
-          rect += skipx;
-        }
-        if (do_float) {
-          nvalf[0] += rectf[0];
-          nvalf[1] += rectf[1];
-          nvalf[2] += rectf[2];
-          nvalf[3] += rectf[3];
-          rectf += skipx;
-        }
-      }
-
-      if (do_rect) {
-        val[0] = rect[0];
-        val[1] = rect[1];
-        val[2] = rect[2];
-        val[3] = rect[3];
-        rect += skipx;
-
-        newrect[0] = ((nval[0] + sample * val[0]) / add + 0.5f);
-        newrect[1] = ((nval[1] + sample * val[1]) / add + 0.5f);
-        newrect[2] = ((nval[2] + sample * val[2]) / add + 0.5f);
-        newrect[3] = ((nval[3] + sample * val[3]) / add + 0.5f);
-
-        newrect += skipx;
-      }
-      if (do_float) {
-
-        valf[0] = rectf[0];
-        valf[1] = rectf[1];
-        valf[2] = rectf[2];
-        valf[3] = rectf[3];
-        rectf += skipx;
-
-        newrectf[0] = ((nvalf[0] + sample * valf[0]) / add);
-        newrectf[1] = ((nvalf[1] + sample * valf[1]) / add);
-        newrectf[2] = ((nvalf[2] + sample * valf[2]) / add);
-        newrectf[3] = ((nvalf[3] + sample * valf[3]) / add);
-
-        newrectf += skipx;
-      }
+  ScaleDownData data = {
+      .ibuf = ibuf,
+      .newrect = _newrect,
+      .newrectf = _newrectf,
+      .newsize = newy,
+      .add = (ibuf->y - 0.01) / newy,
+  };
 
-      sample -= 1.0f;
-    }
-  }
+  /* Columns are independent of each other. */
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = ((size_t)ibuf->x * ibuf->y > SCALE_THREADING_MIN_PIXELS);
+  BLI_task_parallel_range(0, ibuf->x, &data, scaledowny_column_cb, &settings);
 
   if (do_rect) {
-    // printf("%ld %ld\n", (uchar *)rect - ((uchar *)ibuf->rect), rect_size);
-    BLI_assert((uchar *)rect - ((uchar *)ibuf->rect) == rect_size); /* see bug [#26502] */
     imb_freerectImBuf(ibuf);
     ibuf->mall |= IB_rect;
     ibuf->rect = (unsigned int *)_newrect;
   }
   if (do_float) {
-    // printf("%ld %ld\n", rectf - ibuf->rect_float, rect_size);
-    BLI_assert((rectf - ibuf->rect_float) == rect_size); /* see bug [#26502] */
     imb_freerectfloatImBuf(ibuf);
     ibuf->mall |= IB_rectfloat;
     ibuf->rect_float = (float *)_newrectf;
   }
-  (void)rect_size; /* UNUSED in release builds */
 
   ibuf->y = newy;
   return (ibuf);
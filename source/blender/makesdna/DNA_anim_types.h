@@ -1079,6 +1079,8 @@ typedef struct AnimData {
 
   /** Runtime data, for depsgraph evaluation. */
   FCurve **driver_array;
+  /** Runtime data, resolved RNA paths of the active action's F-Curves, see anim_sys.c. */
+  struct AnimFCurveBindings *fcurve_bindings;
 
   /* settings for animation evaluation */
   /** User-defined settings. */
@@ -500,6 +500,8 @@ typedef struct SoftBody {
 #define PTCACHE_IGNORE_CLEAR (1 << 13)
 
 #define PTCACHE_FLAG_INFO_DIRTY (1 << 14)
+/** Store all frames of the disk cache in one memory-mapped file. */
+#define PTCACHE_SINGLE_FILE (1 << 15)
 
 /* PTCACHE_OUTDATED + PTCACHE_FRAMES_SKIPPED */
 #define PTCACHE_REDO_NEEDED 258
@@ -507,6 +509,7 @@ typedef struct SoftBody {
 #define PTCACHE_COMPRESS_NO 0
 #define PTCACHE_COMPRESS_LZO 1
 #define PTCACHE_COMPRESS_LZMA 2
+#define PTCACHE_COMPRESS_ZSTD 3
 
 /* ob->softflag */
 #define OB_SB_ENABLE 1 /* deprecated, use modifier */
@@ -131,7 +131,13 @@ typedef struct Object_Runtime {
   /** Did last modifier stack generation need mapping support? */
   char last_need_mapping;
 
-  char _pad0[3];
+  /**
+   * The GPU batch cache of the previous evaluated mesh was handed over to the current one,
+   * only vertex positions changed (set by the modifier stack evaluation).
+   */
+  char is_mesh_batch_cache_deformed;
+
+  char _pad0[2];
 
   /** Only used for drawing the parent/child help-line. */
   float parent_display_origin[3];
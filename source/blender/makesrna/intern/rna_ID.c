@@ -94,6 +94,7 @@ const EnumPropertyItem rna_enum_id_type_items[] = {
 #  include "BKE_lib_override.h"
 #  include "BKE_lib_remap.h"
 #  include "BKE_library.h"
+#  include "BKE_main_namemap.h"
 #  include "BKE_animsys.h"
 #  include "BKE_material.h"
 #  include "BKE_global.h" /* XXX, remove me */
@@ -144,8 +145,10 @@ int rna_ID_name_length(PointerRNA *ptr)
 void rna_ID_name_set(PointerRNA *ptr, const char *value)
 {
   ID *id = (ID *)ptr->data;
-  BLI_strncpy_utf8(id->name + 2, value, sizeof(id->name) - 2);
   BLI_assert(BKE_id_is_in_global_main(id));
+  BKE_main_namemap_remove_name(G_MAIN, id, id->name + 2);
+  BLI_strncpy_utf8(id->name + 2, value, sizeof(id->name) - 2);
+  BKE_main_namemap_add_name(G_MAIN, id, id->name + 2);
   BLI_libblock_ensure_unique_name(G_MAIN, id->name);
 
   if (GS(id->name) == ID_OB) {
@@ -766,7 +766,7 @@ static void rna_Modifier_update(Main *UNUSED(bmain), Scene *UNUSED(scene), Point
 static void rna_Modifier_dependency_update(Main *bmain, Scene *scene, PointerRNA *ptr)
 {
   rna_Modifier_update(bmain, scene, ptr);
-  DEG_relations_tag_update(bmain);
+  DEG_relations_tag_update_id(bmain, ptr->owner_id);
 }
 
 /* Vertex Groups */
@@ -1206,7 +1206,7 @@ static void rna_CurveModifier_dependency_update(Main *bmain, Scene *scene, Point
 {
   CurveModifierData *cmd = (CurveModifierData *)ptr->data;
   rna_Modifier_update(bmain, scene, ptr);
-  DEG_relations_tag_update(bmain);
+  DEG_relations_tag_update_id(bmain, ptr->owner_id);
   if (cmd->object != NULL) {
     Curve *curve = cmd->object->data;
     if ((curve->flag & CU_PATH) == 0) {
@@ -1219,7 +1219,7 @@ static void rna_ArrayModifier_dependency_update(Main *bmain, Scene *scene, Point
 {
   ArrayModifierData *amd = (ArrayModifierData *)ptr->data;
   rna_Modifier_update(bmain, scene, ptr);
-  DEG_relations_tag_update(bmain);
+  DEG_relations_tag_update_id(bmain, ptr->owner_id);
   if (amd->curve_ob != NULL) {
     Curve *curve = amd->curve_ob->data;
     if ((curve->flag & CU_PATH) == 0) {
@@ -99,12 +99,7 @@ static void deformVerts(ModifierData *md,
   SurfaceModifierData *surmd = (SurfaceModifierData *)md;
   const int cfra = (int)DEG_get_ctime(ctx->depsgraph);
 
-  /* Free mesh and BVH cache. */
-  if (surmd->bvhtree) {
-    free_bvhtree_from_mesh(surmd->bvhtree);
-    MEM_SAFE_FREE(surmd->bvhtree);
-  }
-
+  /* Free mesh, the BVH tree is kept to be updated when the topology did not change. */
   if (surmd->mesh) {
     BKE_id_free(NULL, surmd->mesh);
     surmd->mesh = NULL;
@@ -119,6 +114,14 @@ static void deformVerts(ModifierData *md,
     surmd->mesh = MOD_deform_mesh_eval_get(ctx->object, NULL, NULL, NULL, numVerts, false, false);
   }
 
+  if (!ctx->object->pd || !surmd->mesh) {
+    /* The tree references the mesh which was just freed. */
+    if (surmd->bvhtree) {
+      free_bvhtree_from_mesh(surmd->bvhtree);
+      MEM_SAFE_FREE(surmd->bvhtree);
+    }
+  }
+
   if (!ctx->object->pd) {
     printf("SurfaceModifier deformVerts: Should not happen!\n");
     return;
@@ -171,13 +174,16 @@ static void deformVerts(ModifierData *md,
 
     surmd->cfra = cfra;
 
-    surmd->bvhtree = MEM_callocN(sizeof(BVHTreeFromMesh), "BVHTreeFromMesh");
+    if (surmd->bvhtree == NULL) {
+      surmd->bvhtree = MEM_callocN(sizeof(BVHTreeFromMesh), "BVHTreeFromMesh");
+    }
 
+    /* The mesh is only deformed from frame to frame, refit the tree when possible. */
     if (surmd->mesh->totpoly) {
-      BKE_bvhtree_from_mesh_get(surmd->bvhtree, surmd->mesh, BVHTREE_FROM_LOOPTRI, 2);
+      BKE_bvhtree_from_mesh_get_deformed(surmd->bvhtree, surmd->mesh, BVHTREE_FROM_LOOPTRI, 2);
     }
     else {
-      BKE_bvhtree_from_mesh_get(surmd->bvhtree, surmd->mesh, BVHTREE_FROM_EDGES, 2);
+      BKE_bvhtree_from_mesh_get_deformed(surmd->bvhtree, surmd->mesh, BVHTREE_FROM_EDGES, 2);
     }
   }
 }
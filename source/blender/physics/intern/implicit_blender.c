@@ -34,6 +34,7 @@
 #  include "DNA_texture_types.h"
 
 #  include "BLI_math.h"
+#  include "BLI_task.h"
 #  include "BLI_utildefines.h"
 
 #  include "BKE_cloth.h"
@@ -652,6 +653,167 @@ DO_INLINE void subadd_bfmatrixS_bfmatrixS(
   }
 }
 
+///////////////////////////////////////////////////////////////////
+// block compressed sparse row matrix
+///////////////////////////////////////////////////////////////////
+
+/* Minimum number of vertices before the solver loops are multi-threaded. */
+#  define CLOTH_SOLVER_THREAD_LIMIT 1024
+/* Vertices per chunk for reductions. The chunking is fixed so that dot products sum in the
+ * same order regardless of the thread count, keeping the simulation deterministic. */
+#  define CLOTH_SOLVER_CHUNK_SIZE 256
+
+/* Solver copy of a symmetric big matrix. Both triangles are stored, so every block row can
+ * be multiplied on its own without writing to other rows. The diagonal block comes first in
+ * each row, blocks are contiguous in memory to keep the multiplication cache friendly. */
+typedef struct BSRMatrix {
+  unsigned int vcount;
+  unsigned int *row_start; /* vcount + 1 entries */
+  unsigned int *col;       /* column of each block */
+  float (*m)[3][3];        /* blocks */
+  unsigned int len_alloc;  /* allocated number of blocks */
+} BSRMatrix;
+
+static void bsr_matrix_free(BSRMatrix *bsr)
+{
+  MEM_SAFE_FREE(bsr->row_start);
+  MEM_SAFE_FREE(bsr->col);
+  MEM_SAFE_FREE(bsr->m);
+  bsr->len_alloc = 0;
+}
+
+/* Rebuild the BSR layout from a big matrix, the block structure changes every step. */
+static void bsr_matrix_from_bfmatrix(BSRMatrix *bsr, fmatrix3x3 *from)
+{
+  const unsigned int vcount = from[0].vcount;
+  const unsigned int total = from[0].vcount + from[0].scount;
+  unsigned int *fill;
+  unsigned int i, len = vcount;
+
+  if (bsr->row_start == NULL || bsr->vcount != vcount) {
+    MEM_SAFE_FREE(bsr->row_start);
+    bsr->row_start = MEM_mallocN(sizeof(*bsr->row_start) * (vcount + 1), __func__);
+    bsr->vcount = vcount;
+  }
+
+  /* Count blocks per row: the diagonal plus both triangles of every off-diagonal block. */
+  for (i = 0; i < vcount; i++) {
+    bsr->row_start[i] = 1;
+  }
+  for (i = vcount; i < total; i++) {
+    if (from[i].r != from[i].c) {
+      bsr->row_start[from[i].r]++;
+      bsr->row_start[from[i].c]++;
+      len += 2;
+    }
+  }
+
+  if (len > bsr->len_alloc) {
+    MEM_SAFE_FREE(bsr->col);
+    MEM_SAFE_FREE(bsr->m);
+    bsr->col = MEM_mallocN(sizeof(*bsr->col) * len, __func__);
+    bsr->m = MEM_mallocN(sizeof(*bsr->m) * len, __func__);
+    bsr->len_alloc = len;
+  }
+
+  /* Prefix sum, leaving the fill position of each row just behind its diagonal block. */
+  fill = MEM_mallocN(sizeof(*fill) * vcount, __func__);
+  {
+    unsigned int start = 0;
+    for (i = 0; i < vcount; i++) {
+      const unsigned int row_len = bsr->row_start[i];
+      bsr->row_start[i] = start;
+      bsr->col[start] = i;
+      copy_m3_m3(bsr->m[start], from[i].m);
+      fill[i] = start + 1;
+      start += row_len;
+    }
+    bsr->row_start[vcount] = start;
+  }
+
+  for (i = vcount; i < total; i++) {
+    const unsigned int r = from[i].r, c = from[i].c;
+
+    if (r == c) {
+      /* Degenerate (unused) block, the sparse multiply applies it with both orientations. */
+      float mt[3][3];
+      transpose_m3_m3(mt, from[i].m);
+      add_m3_m3m3(bsr->m[bsr->row_start[r]], bsr->m[bsr->row_start[r]], from[i].m);
+      add_m3_m3m3(bsr->m[bsr->row_start[r]], bsr->m[bsr->row_start[r]], mt);
+    }
+    else {
+      /* Lower triangle block, its transpose is the matching upper triangle block. */
+      bsr->col[fill[r]] = c;
+      copy_m3_m3(bsr->m[fill[r]], from[i].m);
+      fill[r]++;
+
+      bsr->col[fill[c]] = r;
+      transpose_m3_m3(bsr->m[fill[c]], from[i].m);
+      fill[c]++;
+    }
+  }
+
+  MEM_freeN(fill);
+}
+
+BLI_INLINE void bsr_row_mul(float r_to[3],
+                            const BSRMatrix *bsr,
+                            unsigned int row,
+                            const float (*vec)[3])
+{
+  float x = 0.0f, y = 0.0f, z = 0.0f;
+
+  /* Plain loop over contiguous blocks with independent accumulators,
+   * which the compiler can vectorize. */
+  for (unsigned int j = bsr->row_start[row]; j < bsr->row_start[row + 1]; j++) {
+    const float(*m)[3] = bsr->m[j];
+    const float *v = vec[bsr->col[j]];
+    x += m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2];
+    y += m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2];
+    z += m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2];
+  }
+
+  r_to[0] = x;
+  r_to[1] = y;
+  r_to[2] = z;
+}
+
+typedef struct BSRMulData {
+  const BSRMatrix *bsr;
+  const float (*vec)[3];
+  float (*to)[3];
+  fmatrix3x3 *S; /* optional constraint filter */
+} BSRMulData;
+
+static void bsr_mul_lfvector_cb(void *__restrict userdata,
+                                const int i,
+                                const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  BSRMulData *data = userdata;
+
+  bsr_row_mul(data->to[i], data->bsr, i, data->vec);
+  if (data->S) {
+    mul_m3_v3(data->S[i].m, data->to[i]);
+  }
+}
+
+/* to = A * vec, optionally filtered by S. */
+static void bsr_mul_lfvector(float (*to)[3], const BSRMatrix *bsr, lfVector *vec, fmatrix3x3 *S)
+{
+  BSRMulData data = {
+      .bsr = bsr,
+      .vec = (const float(*)[3])vec,
+      .to = to,
+      .S = S,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (bsr->vcount > CLOTH_SOLVER_THREAD_LIMIT);
+  settings.min_iter_per_thread = CLOTH_SOLVER_CHUNK_SIZE;
+  BLI_task_parallel_range(0, (int)bsr->vcount, &data, bsr_mul_lfvector_cb, &settings);
+}
+
 ///////////////////////////////////////////////////////////////////
 // simulator start
 ///////////////////////////////////////////////////////////////////
@@ -677,6 +839,8 @@ typedef struct Implicit_Data {
   lfVector *z;          /* target velocity in constrained directions */
   fmatrix3x3 *S;        /* filtering matrix for constraints */
   fmatrix3x3 *P, *Pinv; /* pre-conditioning matrix */
+
+  BSRMatrix bsrA; /* solver layout of A */
 } Implicit_Data;
 
 Implicit_Data *BPH_mass_spring_solver_create(int numverts, int numsprings)
@@ -728,6 +892,8 @@ void BPH_mass_spring_solver_free(Implicit_Data *id)
   del_lfvector(id->dV);
   del_lfvector(id->z);
 
+  bsr_matrix_free(&id->bsrA);
+
   MEM_freeN(id);
 }
 
@@ -838,8 +1004,175 @@ static int cg_filtered(lfVector *ldV, fmatrix3x3 *lA, lfVector *lB, lfVector *z,
 }
 #  endif
 
+/* Shared state of the solver loops, which run over fixed size chunks of vertices. */
+typedef struct CGChunkData {
+  unsigned int numverts;
+  fmatrix3x3 *S;
+  float (*Pinv)[3][3];
+  const BSRMatrix *A;
+  lfVector *lB, *AdV, *ldV, *r, *c, *q, *s;
+  float alpha, beta;
+  /* per chunk partial sums */
+  float *partial_a, *partial_b;
+} CGChunkData;
+
+BLI_INLINE unsigned int cg_num_chunks(unsigned int numverts)
+{
+  return (numverts + CLOTH_SOLVER_CHUNK_SIZE - 1) / CLOTH_SOLVER_CHUNK_SIZE;
+}
+
+BLI_INLINE void cg_chunk_range(const CGChunkData *data,
+                               int chunk,
+                               unsigned int *r_start,
+                               unsigned int *r_end)
+{
+  *r_start = (unsigned int)chunk * CLOTH_SOLVER_CHUNK_SIZE;
+  *r_end = min_ii(*r_start + CLOTH_SOLVER_CHUNK_SIZE, data->numverts);
+}
+
+BLI_INLINE bool cg_block_is_positive_definite(const float m[3][3])
+{
+  return (m[0][0] > 0.0f) && (m[0][0] * m[1][1] - m[0][1] * m[1][0] > 0.0f) &&
+         (determinant_m3_array(m) > 0.0f);
+}
+
+/* Block Jacobi pre-conditioner: inverse of the symmetric part of the diagonal blocks of A.
+ * Vertices where that is not positive definite fall back to the identity. */
+static void cg_precond_cb(void *__restrict userdata,
+                          const int chunk,
+                          const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  CGChunkData *data = userdata;
+  unsigned int i, start, end;
+
+  cg_chunk_range(data, chunk, &start, &end);
+  for (i = start; i < end; i++) {
+    const float(*diag)[3] = data->A->m[data->A->row_start[i]];
+    float sym[3][3];
+
+    transpose_m3_m3(sym, diag);
+    add_m3_m3m3(sym, sym, diag);
+    mul_m3_fl(sym, 0.5f);
+
+    if (!cg_block_is_positive_definite(sym) || !invert_m3_m3(data->Pinv[i], sym)) {
+      unit_m3(data->Pinv[i]);
+    }
+  }
+}
+
+/* r = filter(B - A * dV), c = filter(P^-1 * r),
+ * sums r^T * c and filter(B)^T * P^-1 * filter(B). */
+static void cg_init_cb(void *__restrict userdata,
+                       const int chunk,
+                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  CGChunkData *data = userdata;
+  float delta = 0.0f, bnorm2 = 0.0f;
+  unsigned int i, start, end;
+
+  cg_chunk_range(data, chunk, &start, &end);
+  for (i = start; i < end; i++) {
+    float fB[3], tmp[3];
+
+    mul_v3_m3v3(fB, data->S[i].m, data->lB[i]);
+    mul_v3_m3v3(tmp, data->Pinv[i], fB);
+    bnorm2 += dot_v3v3(fB, tmp);
+
+    sub_v3_v3v3(tmp, data->lB[i], data->AdV[i]);
+    mul_v3_m3v3(data->r[i], data->S[i].m, tmp);
+
+    mul_v3_m3v3(tmp, data->Pinv[i], data->r[i]);
+    mul_v3_m3v3(data->c[i], data->S[i].m, tmp);
+
+    delta += dot_v3v3(data->r[i], data->c[i]);
+  }
+
+  data->partial_a[chunk] = delta;
+  data->partial_b[chunk] = bnorm2;
+}
+
+/* Sums c^T * q. */
+static void cg_dot_cq_cb(void *__restrict userdata,
+                         const int chunk,
+                         const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  CGChunkData *data = userdata;
+  float sum = 0.0f;
+  unsigned int i, start, end;
+
+  cg_chunk_range(data, chunk, &start, &end);
+  for (i = start; i < end; i++) {
+    sum += dot_v3v3(data->c[i], data->q[i]);
+  }
+
+  data->partial_a[chunk] = sum;
+}
+
+/* dV += alpha * c, r -= alpha * q, s = P^-1 * r, sums r^T * s. */
+static void cg_step_cb(void *__restrict userdata,
+                       const int chunk,
+                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  CGChunkData *data = userdata;
+  const float alpha = data->alpha;
+  float sum = 0.0f;
+  unsigned int i, start, end;
+
+  cg_chunk_range(data, chunk, &start, &end);
+  for (i = start; i < end; i++) {
+    madd_v3_v3fl(data->ldV[i], data->c[i], alpha);
+    madd_v3_v3fl(data->r[i], data->q[i], -alpha);
+    mul_v3_m3v3(data->s[i], data->Pinv[i], data->r[i]);
+    sum += dot_v3v3(data->r[i], data->s[i]);
+  }
+
+  data->partial_a[chunk] = sum;
+}
+
+/* c = filter(s + beta * c) */
+static void cg_direction_cb(void *__restrict userdata,
+                            const int chunk,
+                            const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  CGChunkData *data = userdata;
+  const float beta = data->beta;
+  unsigned int i, start, end;
+
+  cg_chunk_range(data, chunk, &start, &end);
+  for (i = start; i < end; i++) {
+    float tmp[3];
+    VECADDS(tmp, data->s[i], data->c[i], beta);
+    mul_v3_m3v3(data->c[i], data->S[i].m, tmp);
+  }
+}
+
+static void cg_run_chunks(CGChunkData *data, TaskParallelRangeFunc func)
+{
+  const int num_chunks = (int)cg_num_chunks(data->numverts);
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.use_threading = (data->numverts > CLOTH_SOLVER_THREAD_LIMIT);
+  settings.min_iter_per_thread = 1;
+  BLI_task_parallel_range(0, num_chunks, data, func, &settings);
+}
+
+/* Partial sums are added in chunk order, independent of how the chunks were scheduled. */
+static float cg_sum_chunks(const CGChunkData *data, const float *partial)
+{
+  const unsigned int num_chunks = cg_num_chunks(data->numverts);
+  float sum = 0.0f;
+
+  for (unsigned int i = 0; i < num_chunks; i++) {
+    sum += partial[i];
+  }
+  return sum;
+}
+
+/* Modified pre-conditioned conjugate gradient (Baraff & Witkin), with a block Jacobi
+ * pre-conditioner. The multiplication and vector updates are multi-threaded. */
 static int cg_filtered(lfVector *ldV,
-                       fmatrix3x3 *lA,
+                       const BSRMatrix *lA,
                        lfVector *lB,
                        lfVector *z,
                        fmatrix3x3 *S,
@@ -849,38 +1182,39 @@ static int cg_filtered(lfVector *ldV,
   unsigned int conjgrad_loopcount = 0, conjgrad_looplimit = 100;
   float conjgrad_epsilon = 0.01f;
 
-  unsigned int numverts = lA[0].vcount;
-  lfVector *fB = create_lfvector(numverts);
-  lfVector *AdV = create_lfvector(numverts);
-  lfVector *r = create_lfvector(numverts);
-  lfVector *c = create_lfvector(numverts);
-  lfVector *q = create_lfvector(numverts);
-  lfVector *s = create_lfvector(numverts);
-  float bnorm2, delta_new, delta_old, delta_target, alpha;
+  unsigned int numverts = lA->vcount;
+  const unsigned int num_chunks = cg_num_chunks(numverts);
+  float bnorm2, delta_new, delta_old, delta_target;
+
+  CGChunkData data = {
+      .numverts = numverts,
+      .S = S,
+      .A = lA,
+      .lB = lB,
+      .ldV = ldV,
+  };
+  data.Pinv = MEM_mallocN(sizeof(*data.Pinv) * numverts, "cloth_implicit_alloc_precond");
+  data.AdV = create_lfvector(numverts);
+  data.r = create_lfvector(numverts);
+  data.c = create_lfvector(numverts);
+  data.q = create_lfvector(numverts);
+  data.s = create_lfvector(numverts);
+  data.partial_a = MEM_mallocN(sizeof(float) * max_ii(num_chunks, 1), __func__);
+  data.partial_b = MEM_mallocN(sizeof(float) * max_ii(num_chunks, 1), __func__);
 
   cp_lfvector(ldV, z, numverts);
 
-  /* d0 = filter(B)^T * P * filter(B) */
-  cp_lfvector(fB, lB, numverts);
-  filter(fB, S);
-  bnorm2 = dot_lfvector(fB, fB, numverts);
-  delta_target = conjgrad_epsilon * conjgrad_epsilon * bnorm2;
+  cg_run_chunks(&data, cg_precond_cb);
 
-  /* r = filter(B - A * dV) */
-  mul_bfmatrix_lfvector(AdV, lA, ldV);
-  sub_lfvector_lfvector(r, lB, AdV, numverts);
-  filter(r, S);
-
-  /* c = filter(P^-1 * r) */
-  cp_lfvector(c, r, numverts);
-  filter(c, S);
-
-  /* delta = r^T * c */
-  delta_new = dot_lfvector(r, c, numverts);
+  /* r = filter(B - A * dV), c = filter(P^-1 * r), delta = r^T * c,
+   * d0 = filter(B)^T * P^-1 * filter(B) */
+  bsr_mul_lfvector(data.AdV, lA, ldV, NULL);
+  cg_run_chunks(&data, cg_init_cb);
+  delta_new = cg_sum_chunks(&data, data.partial_a);
+  bnorm2 = cg_sum_chunks(&data, data.partial_b);
+  delta_target = conjgrad_epsilon * conjgrad_epsilon * bnorm2;
 
 #  ifdef IMPLICIT_PRINT_SOLVER_INPUT_OUTPUT
-  printf("==== A ====\n");
-  print_bfmatrix(lA);
   printf("==== z ====\n");
   print_lvector(z, numverts);
   printf("==== B ====\n");
@@ -890,22 +1224,18 @@ static int cg_filtered(lfVector *ldV,
 #  endif
 
   while (delta_new > delta_target && conjgrad_loopcount < conjgrad_looplimit) {
-    mul_bfmatrix_lfvector(q, lA, c);
-    filter(q, S);
-
-    alpha = delta_new / dot_lfvector(c, q, numverts);
-
-    add_lfvector_lfvectorS(ldV, ldV, c, alpha, numverts);
+    /* q = filter(A * c) */
+    bsr_mul_lfvector(data.q, lA, data.c, S);
 
-    add_lfvector_lfvectorS(r, r, q, -alpha, numverts);
+    cg_run_chunks(&data, cg_dot_cq_cb);
+    data.alpha = delta_new / cg_sum_chunks(&data, data.partial_a);
 
-    /* s = P^-1 * r */
-    cp_lfvector(s, r, numverts);
+    cg_run_chunks(&data, cg_step_cb);
     delta_old = delta_new;
-    delta_new = dot_lfvector(r, s, numverts);
+    delta_new = cg_sum_chunks(&data, data.partial_a);
 
-    add_lfvector_lfvectorS(c, s, c, delta_new / delta_old, numverts);
-    filter(c, S);
+    data.beta = delta_new / delta_old;
+    cg_run_chunks(&data, cg_direction_cb);
 
     conjgrad_loopcount++;
   }
@@ -916,12 +1246,14 @@ static int cg_filtered(lfVector *ldV,
   printf("========\n");
 #  endif
 
-  del_lfvector(fB);
-  del_lfvector(AdV);
-  del_lfvector(r);
-  del_lfvector(c);
-  del_lfvector(q);
-  del_lfvector(s);
+  MEM_freeN(data.Pinv);
+  del_lfvector(data.AdV);
+  del_lfvector(data.r);
+  del_lfvector(data.c);
+  del_lfvector(data.q);
+  del_lfvector(data.s);
+  MEM_freeN(data.partial_a);
+  MEM_freeN(data.partial_b);
   // printf("W/O conjgrad_loopcount: %d\n", conjgrad_loopcount);
 
   result->status = conjgrad_loopcount < conjgrad_looplimit ? BPH_SOLVER_SUCCESS :
@@ -1159,7 +1491,8 @@ bool BPH_mass_spring_solve_velocities(Implicit_Data *data, float dt, ImplicitSol
 #  endif
 
   /* Conjugate gradient algorithm to solve Ax=b. */
-  cg_filtered(data->dV, data->A, data->B, data->z, data->S, result);
+  bsr_matrix_from_bfmatrix(&data->bsrA, data->A);
+  cg_filtered(data->dV, &data->bsrA, data->B, data->z, data->S, result);
 
   // cg_filtered_pre(id->dV, id->A, id->B, id->z, id->S, id->P, id->Pinv, id->bigI);
 
@@ -121,6 +121,10 @@
 #  include "BPY_extern.h"
 #endif
 
+#ifdef WITH_COMPOSITOR
+#  include "COM_compositor.h"
+#endif
+
 #include "DEG_depsgraph.h"
 
 #include "WM_api.h"
@@ -408,6 +412,11 @@ static int wm_read_exotic(const char *name)
       if (len == sizeof(header) && STREQLEN(header, "BLENDER", 7)) {
         retval = BKE_READ_EXOTIC_OK_BLEND;
       }
+      else if (len == sizeof(header) && (uchar)header[0] == 0x28 && (uchar)header[1] == 0xb5 &&
+               (uchar)header[2] == 0x2f && (uchar)header[3] == 0xfd) {
+        /* Zstd compressed, the header is checked when reading. */
+        retval = BKE_READ_EXOTIC_OK_BLEND;
+      }
       else {
         /* We may want to support loading other file formats
          * from their header bytes or file extension.
@@ -550,6 +559,11 @@ static void wm_file_read_post(bContext *C,
   if (use_data) {
     WM_operatortype_last_properties_clear_all();
 
+#ifdef WITH_COMPOSITOR
+    /* Results cached for the previous file are of no use anymore. */
+    COM_clearCaches();
+#endif
+
     /* After load post, so for example the driver namespace can be filled
      * before evaluating the depsgraph. */
     wm_event_do_depsgraph(C, true);
@@ -2600,6 +2614,7 @@ static int wm_save_as_mainfile_exec(bContext *C, wmOperator *op)
 
   /* set compression flag */
   SET_FLAG_FROM_TEST(fileflags, RNA_boolean_get(op->ptr, "compress"), G_FILE_COMPRESS);
+  SET_FLAG_FROM_TEST(fileflags, (U.flag & USER_FILECOMPRESS_ZSTD) != 0, G_FILE_COMPRESS_ZSTD);
   SET_FLAG_FROM_TEST(fileflags, RNA_boolean_get(op->ptr, "relative_remap"), G_FILE_RELATIVE_REMAP);
   SET_FLAG_FROM_TEST(
       fileflags,
@@ -54,6 +54,7 @@
 #include "BKE_lib_id.h"
 #include "BKE_lib_remap.h"
 #include "BKE_main.h"
+#include "BKE_main_namemap.h"
 #include "BKE_report.h"
 
 #include "BKE_idcode.h"
@@ -717,6 +718,7 @@ static void lib_relocate_do(Main *bmain,
 
         /* We remove it from current Main, and add it to items to link... */
         /* Note that non-linkable IDs (like e.g. shapekeys) are also explicitly linked here... */
+        BKE_main_namemap_remove_name(bmain, id, id->name + 2);
         BLI_remlink(lbarray[lba_idx], id);
         item = wm_link_append_data_item_add(lapp_data, id->name + 2, idcode, id);
         BLI_bitmap_set_all(item->libraries, true, lapp_data->num_libraries);
@@ -750,6 +752,7 @@ static void lib_relocate_do(Main *bmain,
 
     BLI_assert(old_id);
     BLI_addtail(which_libbase(bmain, GS(old_id->name)), old_id);
+    BKE_main_namemap_add_name(bmain, old_id, old_id->name + 2);
   }
 
   /* Note that in reload case, we also want to replace indirect usages. */
@@ -808,6 +811,8 @@ static void lib_relocate_do(Main *bmain,
       size_t dot_pos;
       bool has_num = false;
 
+      BKE_main_namemap_remove_name(bmain, old_id, old_id->name + 2);
+
       for (dot_pos = len; dot_pos--;) {
         char c = old_id->name[dot_pos];
         if (c == '.') {
@@ -829,6 +834,7 @@ static void lib_relocate_do(Main *bmain,
       }
 
       id_sort_by_name(which_libbase(bmain, GS(old_id->name)), old_id, NULL);
+      BKE_main_namemap_add_name(bmain, old_id, old_id->name + 2);
 
       BKE_reportf(
           reports,
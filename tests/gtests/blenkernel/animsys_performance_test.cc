@@ -0,0 +1,169 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "blenkernel_base_test.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BKE_action.h"
+#include "BKE_animsys.h"
+#include "BKE_armature.h"
+#include "BKE_fcurve.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_object.h"
+
+#include "BLI_listbase.h"
+#include "BLI_math_base.h"
+#include "BLI_string.h"
+
+#include "DNA_action_types.h"
+#include "DNA_anim_types.h"
+#include "DNA_armature_types.h"
+#include "DNA_curve_types.h"
+#include "DNA_object_types.h"
+
+#include "PIL_time.h"
+}
+
+#define NUM_RUN_AVERAGED 10
+
+/* Location and quaternion rotation of each bone. */
+static const struct {
+  const char *prop;
+  int array_len;
+} mocap_channels[] = {{"location", 3}, {"rotation_quaternion", 4}};
+
+class AnimsysPerformanceTest : public BlenkernelBaseTest {
+ protected:
+  Object *ob = nullptr;
+
+  /* An armature animated like motion capture data: every channel of every bone has a key on each
+   * frame, interpolated as Bezier curves. */
+  void mocap_create(const int num_bones, const int num_frames)
+  {
+    bmain = BKE_main_new();
+    bArmature *arm = BKE_armature_add(bmain, "ARMocap");
+    for (int i = 0; i < num_bones; i++) {
+      Bone *bone = static_cast<Bone *>(MEM_callocN(sizeof(Bone), __func__));
+      BLI_snprintf(bone->name, sizeof(bone->name), "Bone%d", i);
+      bone->tail[1] = 1.0f;
+      BLI_addtail(&arm->bonebase, bone);
+    }
+    ob = BKE_object_add_only_object(bmain, OB_ARMATURE, "OBMocap");
+    ob->data = arm;
+    BKE_pose_rebuild(bmain, ob, arm, false);
+
+    bAction *act = BKE_action_add(bmain, "ACMocap");
+    for (int i = 0; i < num_bones; i++) {
+      for (const auto &channel : mocap_channels) {
+        char rna_path[128];
+        BLI_snprintf(
+            rna_path, sizeof(rna_path), "pose.bones[\"Bone%d\"].%s", i, channel.prop);
+        for (int index = 0; index < channel.array_len; index++) {
+          FCurve *fcu = static_cast<FCurve *>(MEM_callocN(sizeof(FCurve), __func__));
+          fcu->rna_path = BLI_strdup(rna_path);
+          fcu->array_index = index;
+          fcu->totvert = num_frames;
+          fcu->bezt = static_cast<BezTriple *>(
+              MEM_callocN(sizeof(BezTriple) * num_frames, __func__));
+          for (int frame = 0; frame < num_frames; frame++) {
+            BezTriple *bezt = &fcu->bezt[frame];
+            bezt->vec[1][0] = (float)frame;
+            bezt->vec[1][1] = sinf((float)(frame + i * 7 + index) * 0.1f);
+            bezt->ipo = BEZT_IPO_BEZ;
+            bezt->h1 = bezt->h2 = HD_AUTO_ANIM;
+          }
+          calchandles_fcurve(fcu);
+          BLI_addtail(&act->curves, fcu);
+        }
+      }
+    }
+
+    AnimData *adt = BKE_animdata_add_id(&ob->id);
+    adt->action = act;
+  }
+
+  void evaluate_test_do(const char *id, const int num_bones, const int num_frames)
+  {
+    mocap_create(num_bones, num_frames);
+    bAction *act = ob->adt->action;
+    const int totfcurve = BLI_listbase_count(&act->curves);
+
+    FCurve **fcurves = static_cast<FCurve **>(
+        MEM_mallocN(sizeof(*fcurves) * totfcurve, __func__));
+    float *values = static_cast<float *>(MEM_mallocN(sizeof(*values) * totfcurve, __func__));
+    int i = 0;
+    LISTBASE_FOREACH (FCurve *, fcu, &act->curves) {
+      fcurves[i++] = fcu;
+    }
+
+    /* Sub-frames, so all curves are interpolated. */
+    const int num_steps = 100;
+    const float frame_step = (float)(num_frames - 1) / (float)num_steps;
+
+    double averaged_timing = 0.0;
+    for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+      const double init_time = PIL_check_seconds_timer();
+      for (int step = 0; step < num_steps; step++) {
+        for (i = 0; i < totfcurve; i++) {
+          values[i] = evaluate_fcurve(fcurves[i], (float)step * frame_step);
+        }
+      }
+      averaged_timing += PIL_check_seconds_timer() - init_time;
+    }
+    averaged_timing /= NUM_RUN_AVERAGED;
+    printf("\t%s: one by one: %.0f curves/s\n", id, totfcurve * num_steps / averaged_timing);
+
+    averaged_timing = 0.0;
+    for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+      const double init_time = PIL_check_seconds_timer();
+      for (int step = 0; step < num_steps; step++) {
+        evaluate_fcurves(fcurves, totfcurve, (float)step * frame_step, values);
+      }
+      averaged_timing += PIL_check_seconds_timer() - init_time;
+    }
+    averaged_timing /= NUM_RUN_AVERAGED;
+    printf("\t%s: batched: %.0f curves/s\n", id, totfcurve * num_steps / averaged_timing);
+
+    averaged_timing = 0.0;
+    for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+      const double init_time = PIL_check_seconds_timer();
+      for (int step = 0; step < num_steps; step++) {
+        BKE_animsys_evaluate_animdata(
+            nullptr, &ob->id, ob->adt, (float)step * frame_step, ADT_RECALC_ANIM, false);
+      }
+      averaged_timing += PIL_check_seconds_timer() - init_time;
+    }
+    averaged_timing /= NUM_RUN_AVERAGED;
+    printf("\t%s: action evaluation: %.0f curves/s\n",
+           id,
+           totfcurve * num_steps / averaged_timing);
+
+    MEM_freeN(values);
+    MEM_freeN(fcurves);
+  }
+};
+
+TEST_F(AnimsysPerformanceTest, Mocap100Bones)
+{
+  evaluate_test_do("Mocap - 100 bones - 700 curves", 100, 250);
+}
+
+TEST_F(AnimsysPerformanceTest, Mocap1000Bones)
+{
+  evaluate_test_do("Mocap - 1000 bones - 7000 curves", 1000, 250);
+}
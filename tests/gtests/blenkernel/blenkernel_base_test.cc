@@ -0,0 +1,184 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "blenkernel_base_test.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BKE_appdir.h"
+#include "BKE_blender.h"
+#include "BKE_collection.h"
+#include "BKE_customdata.h"
+#include "BKE_global.h"
+#include "BKE_image.h"
+#include "BKE_main.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+#include "BKE_node.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "BLI_threads.h"
+
+#include "DEG_depsgraph_build.h"
+
+#include "DNA_genfile.h" /* for DNA_sdna_current_init() */
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "IMB_imbuf.h"
+
+#include "RNA_define.h"
+}
+
+BlenkernelBaseTest::~BlenkernelBaseTest()
+{
+}
+
+void BlenkernelBaseTest::SetUpTestCase()
+{
+  testing::Test::SetUpTestCase();
+
+  /* Same as #BlendfileLoadingBaseTest, without a window manager: nothing is read from files. */
+  BLI_threadapi_init();
+
+  DNA_sdna_current_init();
+  BKE_blender_globals_init();
+  IMB_init();
+  BKE_images_init();
+  BKE_modifier_init();
+  DEG_register_node_types();
+  RNA_init();
+  init_nodesystem();
+
+  G.background = true;
+  G.factory_startup = true;
+}
+
+void BlenkernelBaseTest::TearDownTestCase()
+{
+  BKE_blender_free();
+  RNA_exit();
+
+  DEG_free_node_types();
+  DNA_sdna_current_free();
+  BLI_threadapi_exit();
+
+  BKE_blender_atexit();
+
+  if (MEM_get_memory_blocks_in_use() != 0) {
+    size_t mem_in_use = MEM_get_memory_in_use() + MEM_get_memory_in_use();
+    printf("Error: Not freed memory blocks: %u, total unfreed memory %f MB\n",
+           MEM_get_memory_blocks_in_use(),
+           (double)mem_in_use / 1024 / 1024);
+    MEM_printmemlist();
+  }
+
+  BKE_tempdir_session_purge();
+
+  testing::Test::TearDownTestCase();
+}
+
+void BlenkernelBaseTest::TearDown()
+{
+  depsgraph_free();
+  if (bmain != nullptr) {
+    BKE_main_free(bmain);
+    bmain = nullptr;
+    scene = nullptr;
+  }
+
+  testing::Test::TearDown();
+}
+
+void BlenkernelBaseTest::scene_create()
+{
+  bmain = BKE_main_new();
+  scene = BKE_scene_add(bmain, "SCTest");
+}
+
+Mesh *BlenkernelBaseTest::mesh_grid_add(const char *name, const int verts_x, const int verts_y)
+{
+  Mesh *me = BKE_mesh_add(bmain, name);
+  me->totvert = verts_x * verts_y;
+  me->totpoly = (verts_x - 1) * (verts_y - 1);
+  me->totloop = me->totpoly * 4;
+  CustomData_add_layer(&me->vdata, CD_MVERT, CD_CALLOC, NULL, me->totvert);
+  CustomData_add_layer(&me->ldata, CD_MLOOP, CD_CALLOC, NULL, me->totloop);
+  CustomData_add_layer(&me->pdata, CD_MPOLY, CD_CALLOC, NULL, me->totpoly);
+  BKE_mesh_update_customdata_pointers(me, false);
+
+  for (int y = 0; y < verts_y; y++) {
+    for (int x = 0; x < verts_x; x++) {
+      MVert *mv = &me->mvert[y * verts_x + x];
+      mv->co[0] = (float)x;
+      mv->co[1] = (float)y;
+    }
+  }
+
+  int poly_index = 0;
+  for (int y = 0; y < verts_y - 1; y++) {
+    for (int x = 0; x < verts_x - 1; x++) {
+      MPoly *mp = &me->mpoly[poly_index];
+      MLoop *ml = &me->mloop[poly_index * 4];
+      mp->loopstart = poly_index * 4;
+      mp->totloop = 4;
+      ml[0].v = (unsigned int)(y * verts_x + x);
+      ml[1].v = (unsigned int)(y * verts_x + x + 1);
+      ml[2].v = (unsigned int)((y + 1) * verts_x + x + 1);
+      ml[3].v = (unsigned int)((y + 1) * verts_x + x);
+      poly_index++;
+    }
+  }
+
+  BKE_mesh_calc_edges(me, false, false);
+  BKE_mesh_calc_normals(me);
+  return me;
+}
+
+Object *BlenkernelBaseTest::object_add(const int type, const char *name, void *data)
+{
+  Object *ob = BKE_object_add_only_object(bmain, type, name);
+  ob->data = data;
+  BKE_collection_object_add(bmain, scene->master_collection, ob);
+  return ob;
+}
+
+void BlenkernelBaseTest::depsgraph_create(eEvaluationMode depsgraph_evaluation_mode)
+{
+  ViewLayer *view_layer = static_cast<ViewLayer *>(scene->view_layers.first);
+  depsgraph = DEG_graph_new(bmain, scene, view_layer, depsgraph_evaluation_mode);
+  /* Tags of inactive graphs are ignored, #depsgraph_update would do nothing. */
+  DEG_make_active(depsgraph);
+  DEG_graph_build_from_view_layer(depsgraph, bmain, scene, view_layer);
+  BKE_scene_graph_update_tagged(depsgraph, bmain);
+}
+
+void BlenkernelBaseTest::depsgraph_update()
+{
+  BKE_scene_graph_update_tagged(depsgraph, bmain);
+}
+
+void BlenkernelBaseTest::depsgraph_free()
+{
+  if (depsgraph == nullptr) {
+    return;
+  }
+  DEG_graph_free(depsgraph);
+  depsgraph = nullptr;
+}
@@ -0,0 +1,64 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef __BLENKERNEL_BASE_TEST_H__
+#define __BLENKERNEL_BASE_TEST_H__
+
+#include "testing/testing.h"
+#include "DEG_depsgraph.h"
+
+struct Depsgraph;
+struct Main;
+struct Mesh;
+struct Object;
+struct Scene;
+
+/* Tests of blenkernel functionality on data created by the test itself. */
+class BlenkernelBaseTest : public testing::Test {
+ protected:
+  struct Main *bmain = nullptr;
+  struct Scene *scene = nullptr;
+  struct Depsgraph *depsgraph = nullptr;
+
+ public:
+  virtual ~BlenkernelBaseTest();
+
+  /* Sets up Blender just enough to not crash on constructing and evaluating a depsgraph. */
+  static void SetUpTestCase();
+  static void TearDownTestCase();
+
+ protected:
+  /* Frees the depsgraph & main database. */
+  virtual void TearDown();
+
+  /* Creates this->bmain with an empty scene. */
+  void scene_create();
+
+  /* Adds a grid of (verts_x - 1) * (verts_y - 1) quads to this->bmain, with the vertex at
+   * (x, y, 0) for every x < verts_x and y < verts_y. A single row of vertices has no faces. */
+  struct Mesh *mesh_grid_add(const char *name, const int verts_x, const int verts_y);
+
+  /* Adds an object using data (may be nullptr) to the scene. */
+  struct Object *object_add(const int type, const char *name, void *data);
+
+  /* Create a depsgraph of the scene and evaluate it. */
+  void depsgraph_create(eEvaluationMode depsgraph_evaluation_mode);
+  /* Evaluate the changes tagged since the last evaluation. */
+  void depsgraph_update();
+  /* Free the depsgraph if it's not nullptr. */
+  void depsgraph_free();
+};
+
+#endif /* __BLENKERNEL_BASE_TEST_H__ */
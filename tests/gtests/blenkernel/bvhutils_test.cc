@@ -0,0 +1,182 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "blenkernel_base_test.h"
+
+#include <math.h>
+
+extern "C" {
+#include "BKE_bvhutils.h"
+#include "BKE_mesh_runtime.h"
+
+#include "BLI_kdopbvh.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+}
+
+/* The tree of BKE_bvhtree_from_mesh_get_deformed() is refitted to the deformed mesh while its
+ * topology stays the same and its bounds don't overlap too much more than after the build,
+ * and built again otherwise. Either way nearest point queries have to find the elements at
+ * their new positions. Refitting leaves the area ratio of the build, a build updates it. */
+
+class BvhutilsDeformedTest : public BlenkernelBaseTest {
+ protected:
+  Mesh *mesh = nullptr;
+  BVHTreeFromMesh data = {nullptr};
+
+  virtual void SetUp()
+  {
+    BlenkernelBaseTest::SetUp();
+    scene_create();
+    mesh = mesh_grid_add("MEGrid", 32, 32);
+  }
+
+  virtual void TearDown()
+  {
+    free_bvhtree_from_mesh(&data);
+    BlenkernelBaseTest::TearDown();
+  }
+
+  BVHTree *tree_get(const int bvh_cache_type)
+  {
+    return BKE_bvhtree_from_mesh_get_deformed(&data, mesh, bvh_cache_type, 4);
+  }
+
+  void mesh_wave(const float amplitude)
+  {
+    for (int i = 0; i < mesh->totvert; i++) {
+      float *co = mesh->mvert[i].co;
+      co[2] = amplitude * sinf(co[0] * 0.5f) * cosf(co[1] * 0.25f);
+    }
+  }
+
+  /* The center of an element of the tree, on the element. */
+  void elem_center(const int bvh_cache_type, const int index, float r_co[3])
+  {
+    switch (bvh_cache_type) {
+      case BVHTREE_FROM_VERTS:
+        copy_v3_v3(r_co, mesh->mvert[index].co);
+        break;
+      case BVHTREE_FROM_EDGES: {
+        const MEdge *edge = &mesh->medge[index];
+        mid_v3_v3v3(r_co, mesh->mvert[edge->v1].co, mesh->mvert[edge->v2].co);
+        break;
+      }
+      case BVHTREE_FROM_LOOPTRI: {
+        const MLoopTri *lt = &BKE_mesh_runtime_looptri_ensure(mesh)[index];
+        mid_v3_v3v3v3(r_co,
+                      mesh->mvert[mesh->mloop[lt->tri[0]].v].co,
+                      mesh->mvert[mesh->mloop[lt->tri[1]].v].co,
+                      mesh->mvert[mesh->mloop[lt->tri[2]].v].co);
+        break;
+      }
+    }
+  }
+
+  void nearest_expect(BVHTree *tree, const int bvh_cache_type)
+  {
+    ASSERT_NE(tree, nullptr);
+    const int elem_num = BLI_bvhtree_get_len(tree);
+    for (int i = 0; i < elem_num; i++) {
+      float co[3];
+      elem_center(bvh_cache_type, i, co);
+
+      BVHTreeNearest nearest;
+      nearest.index = -1;
+      nearest.dist_sq = FLT_MAX;
+      BLI_bvhtree_find_nearest(tree, co, &nearest, data.nearest_callback, &data);
+      ASSERT_NE(nearest.index, -1);
+      EXPECT_LE(nearest.dist_sq, 1e-5f) << "element " << i;
+    }
+  }
+
+  /* The tree is refitted when the mesh deforms a little. */
+  void refit_test(const int bvh_cache_type)
+  {
+    BVHTree *tree = tree_get(bvh_cache_type);
+    nearest_expect(tree, bvh_cache_type);
+    const float area_ratio = data.deformed_area_ratio;
+    EXPECT_FLOAT_EQ(area_ratio, BLI_bvhtree_get_area_ratio(tree));
+
+    for (int step = 1; step <= 4; step++) {
+      mesh_wave(0.1f * step);
+      EXPECT_EQ(tree_get(bvh_cache_type), tree);
+      EXPECT_EQ(data.deformed_area_ratio, area_ratio);
+      EXPECT_NE(BLI_bvhtree_get_area_ratio(tree), area_ratio);
+      nearest_expect(tree, bvh_cache_type);
+    }
+  }
+};
+
+TEST_F(BvhutilsDeformedTest, RefitVerts)
+{
+  refit_test(BVHTREE_FROM_VERTS);
+}
+
+TEST_F(BvhutilsDeformedTest, RefitEdges)
+{
+  refit_test(BVHTREE_FROM_EDGES);
+}
+
+TEST_F(BvhutilsDeformedTest, RefitLooptri)
+{
+  refit_test(BVHTREE_FROM_LOOPTRI);
+}
+
+TEST_F(BvhutilsDeformedTest, RebuildTopologyChange)
+{
+  tree_get(BVHTREE_FROM_LOOPTRI);
+  const uint topology_hash = data.deformed_topology_hash;
+
+  /* Same number of elements, the winding of one face is flipped. */
+  mesh_wave(0.2f);
+  MLoop *mloop = &mesh->mloop[mesh->mpoly[0].loopstart];
+  SWAP(unsigned int, mloop[1].v, mloop[3].v);
+  BKE_mesh_runtime_clear_geometry(mesh);
+
+  BVHTree *tree = tree_get(BVHTREE_FROM_LOOPTRI);
+  EXPECT_NE(data.deformed_topology_hash, topology_hash);
+  EXPECT_FLOAT_EQ(data.deformed_area_ratio, BLI_bvhtree_get_area_ratio(tree));
+  nearest_expect(tree, BVHTREE_FROM_LOOPTRI);
+
+  /* Fewer elements. */
+  mesh = mesh_grid_add("MEGridSmall", 16, 8);
+  mesh_wave(0.2f);
+  tree = tree_get(BVHTREE_FROM_LOOPTRI);
+  EXPECT_EQ(BLI_bvhtree_get_len(tree), BKE_mesh_runtime_looptri_len(mesh));
+  EXPECT_FLOAT_EQ(data.deformed_area_ratio, BLI_bvhtree_get_area_ratio(tree));
+  nearest_expect(tree, BVHTREE_FROM_LOOPTRI);
+}
+
+TEST_F(BvhutilsDeformedTest, RebuildAreaRatio)
+{
+  tree_get(BVHTREE_FROM_LOOPTRI);
+  const uint topology_hash = data.deformed_topology_hash;
+  const float area_ratio = data.deformed_area_ratio;
+
+  /* Shuffling the vertices keeps the topology, but faces now span the whole grid. */
+  BLI_array_randomize(mesh->mvert, sizeof(*mesh->mvert), mesh->totvert, 1);
+  mesh_wave(0.2f);
+
+  BVHTree *tree = tree_get(BVHTREE_FROM_LOOPTRI);
+  EXPECT_EQ(data.deformed_topology_hash, topology_hash);
+  EXPECT_NE(data.deformed_area_ratio, area_ratio);
+  EXPECT_FLOAT_EQ(data.deformed_area_ratio, BLI_bvhtree_get_area_ratio(tree));
+  nearest_expect(tree, BVHTREE_FROM_LOOPTRI);
+}
@@ -0,0 +1,226 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "blenkernel_base_test.h"
+
+#include <atomic>
+
+extern "C" {
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_main_namemap.h"
+
+#include "BLI_listbase.h"
+#include "BLI_string.h"
+#include "BLI_task.h"
+
+#include "DNA_ID.h"
+#include "DNA_mesh_types.h"
+}
+
+/* The name map of a Main database has to give the same unique names and lookup results as
+ * searching the Main lists, however data-blocks are added, renamed, removed or linked. */
+class MainNamemapTest : public BlenkernelBaseTest {
+ protected:
+  virtual void SetUp()
+  {
+    BlenkernelBaseTest::SetUp();
+    bmain = BKE_main_new();
+  }
+
+  const char *mesh_add(const char *name)
+  {
+    ID *id = static_cast<ID *>(BKE_id_new(bmain, ID_ME, name));
+    return id->name + 2;
+  }
+
+  ID *mesh_find(const char *name)
+  {
+    return BKE_libblock_find_name(bmain, ID_ME, name);
+  }
+
+  /* A mesh of the library, like file reading adds them: the Main lists are changed directly and
+   * the name map is cleared. */
+  ID *mesh_linked_add(Library *lib, const char *name)
+  {
+    ID *id = static_cast<ID *>(BKE_id_new(bmain, ID_ME, "MELinking"));
+    id->lib = lib;
+    id->tag |= LIB_TAG_INDIRECT;
+    BLI_strncpy(id->name + 2, name, sizeof(id->name) - 2);
+    BKE_main_namemap_clear(bmain);
+    return id;
+  }
+};
+
+TEST_F(MainNamemapTest, SuffixAllocation)
+{
+  EXPECT_STREQ(mesh_add("Mesh"), "Mesh");
+  EXPECT_STREQ(mesh_add("Mesh"), "Mesh.001");
+  EXPECT_STREQ(mesh_add("Mesh"), "Mesh.002");
+  EXPECT_STREQ(mesh_add("Mesh.001"), "Mesh.003");
+
+  /* Free numbers below the largest one are used first. */
+  EXPECT_STREQ(mesh_add("Mesh.005"), "Mesh.005");
+  EXPECT_STREQ(mesh_add("Mesh.005"), "Mesh.004");
+  EXPECT_STREQ(mesh_add("Mesh"), "Mesh.006");
+
+  /* Another spelling of a number counts as using it. */
+  EXPECT_STREQ(mesh_add("Other.1"), "Other.1");
+  EXPECT_STREQ(mesh_add("Other"), "Other");
+  EXPECT_STREQ(mesh_add("Other"), "Other.002");
+}
+
+TEST_F(MainNamemapTest, SuffixAllocationLongName)
+{
+  char name[MAX_ID_NAME - 2];
+  memset(name, 'a', sizeof(name) - 1);
+  name[sizeof(name) - 1] = '\0';
+
+  EXPECT_STREQ(mesh_add(name), name);
+  /* Truncated to make room for a suffix, which isn't needed as long as that name is free. */
+  const size_t truncated_len = sizeof(name) - 1 - strlen(".001");
+  const char *name_new = mesh_add(name);
+  EXPECT_EQ(strlen(name_new), truncated_len);
+  EXPECT_EQ(strncmp(name_new, name, truncated_len), 0);
+
+  name_new = mesh_add(name);
+  EXPECT_EQ(strlen(name_new), sizeof(name) - 1);
+  EXPECT_EQ(strncmp(name_new, name, truncated_len), 0);
+  EXPECT_STREQ(name_new + truncated_len, ".001");
+}
+
+TEST_F(MainNamemapTest, Rename)
+{
+  mesh_add("Mesh");
+  mesh_add("Mesh");
+  ID *id = mesh_find("Mesh.001");
+  ASSERT_NE(id, nullptr);
+
+  BKE_libblock_rename(bmain, id, "Other");
+  EXPECT_STREQ(id->name + 2, "Other");
+  EXPECT_EQ(mesh_find("Other"), id);
+  EXPECT_EQ(mesh_find("Mesh.001"), nullptr);
+  /* The previous name is free again. */
+  EXPECT_STREQ(mesh_add("Mesh"), "Mesh.001");
+
+  /* Renaming to a used name adds a suffix. */
+  BKE_libblock_rename(bmain, id, "Mesh");
+  EXPECT_STREQ(id->name + 2, "Mesh.002");
+  EXPECT_EQ(mesh_find("Mesh.002"), id);
+  EXPECT_EQ(mesh_find("Other"), nullptr);
+
+  /* Renaming to its own name keeps it. */
+  BKE_libblock_rename(bmain, id, "Mesh.002");
+  EXPECT_STREQ(id->name + 2, "Mesh.002");
+  EXPECT_EQ(mesh_find("Mesh.002"), id);
+}
+
+TEST_F(MainNamemapTest, Delete)
+{
+  mesh_add("Mesh");
+  mesh_add("Mesh");
+  mesh_add("Mesh");
+
+  BKE_id_delete(bmain, mesh_find("Mesh.001"));
+  EXPECT_EQ(mesh_find("Mesh.001"), nullptr);
+  EXPECT_NE(mesh_find("Mesh.002"), nullptr);
+  EXPECT_STREQ(mesh_add("Mesh"), "Mesh.001");
+
+  BKE_id_delete(bmain, mesh_find("Mesh"));
+  EXPECT_EQ(mesh_find("Mesh"), nullptr);
+  EXPECT_STREQ(mesh_add("Mesh"), "Mesh");
+  EXPECT_STREQ(mesh_add("Mesh"), "Mesh.003");
+}
+
+TEST_F(MainNamemapTest, Linked)
+{
+  Library *lib_a = static_cast<Library *>(BKE_id_new(bmain, ID_LI, "LIA"));
+  Library *lib_b = static_cast<Library *>(BKE_id_new(bmain, ID_LI, "LIB"));
+  ID *linked_a = mesh_linked_add(lib_a, "Mesh");
+  ID *linked_b = mesh_linked_add(lib_b, "Mesh");
+
+  /* Linked data-blocks don't take local names. */
+  EXPECT_STREQ(mesh_add("Mesh"), "Mesh");
+  EXPECT_STREQ(mesh_add("Mesh"), "Mesh.001");
+
+  /* The first data-block using the name in the list is found, as by a list search. */
+  ID *id_first;
+  while ((id_first = static_cast<ID *>(
+              BLI_findstring(&bmain->meshes, "Mesh", offsetof(ID, name) + 2))) != nullptr) {
+    EXPECT_EQ(mesh_find("Mesh"), id_first);
+    BKE_id_delete(bmain, id_first);
+  }
+  EXPECT_EQ(mesh_find("Mesh"), nullptr);
+  EXPECT_NE(mesh_find("Mesh.001"), nullptr);
+  EXPECT_NE(linked_a, linked_b);
+}
+
+/* Linked data-blocks can't be renamed, their name stays registered. */
+TEST_F(MainNamemapTest, LinkedRename)
+{
+  Library *lib = static_cast<Library *>(BKE_id_new(bmain, ID_LI, "LIA"));
+  ID *linked = mesh_linked_add(lib, "Linked");
+  EXPECT_EQ(mesh_find("Linked"), linked);
+
+  BKE_libblock_rename(bmain, linked, "Other");
+  EXPECT_STREQ(linked->name + 2, "Linked");
+  EXPECT_EQ(mesh_find("Linked"), linked);
+  EXPECT_EQ(mesh_find("Other"), nullptr);
+
+  BLI_libblock_ensure_unique_name(bmain, linked->name);
+  EXPECT_STREQ(linked->name + 2, "Linked");
+  EXPECT_EQ(mesh_find("Linked"), linked);
+
+  /* Still free for local data-blocks. */
+  EXPECT_STREQ(mesh_add("Linked"), "Linked");
+}
+
+struct LookupThreadedData {
+  Main *bmain;
+  std::atomic<int> failed;
+};
+
+static void lookup_threaded_cb(void *__restrict userdata,
+                               const int index,
+                               const TaskParallelTLS *__restrict /*tls*/)
+{
+  LookupThreadedData *data = static_cast<LookupThreadedData *>(userdata);
+  char name[MAX_ID_NAME - 2];
+  BLI_snprintf(name, sizeof(name), "Mesh.%.3d", index % 256 + 1);
+  ID *id = BKE_libblock_find_name(data->bmain, ID_ME, name);
+  if (id == NULL || !STREQ(id->name + 2, name)) {
+    data->failed++;
+  }
+}
+
+/* The map of all names is built by whichever lookup comes first. */
+TEST_F(MainNamemapTest, LookupThreaded)
+{
+  for (int i = 0; i < 257; i++) {
+    mesh_add("Mesh");
+  }
+
+  LookupThreadedData data;
+  data.bmain = bmain;
+  data.failed = 0;
+  for (int pass = 0; pass < 8; pass++) {
+    BKE_main_namemap_clear(bmain);
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    settings.min_iter_per_thread = 1;
+    BLI_task_parallel_range(0, 4096, &data, lookup_threaded_cb, &settings);
+  }
+  EXPECT_EQ(data.failed, 0);
+}
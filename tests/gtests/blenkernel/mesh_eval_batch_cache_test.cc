@@ -0,0 +1,135 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "blenkernel_base_test.h"
+
+#include <vector>
+
+extern "C" {
+#include "BKE_mesh.h"
+#include "BKE_mesh_runtime.h"
+#include "BKE_modifier.h"
+#include "BKE_scene.h"
+
+#include "BLI_listbase.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_query.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+}
+
+/* Stands in for the draw manager, which owns the batch cache of evaluated meshes. */
+static int batch_cache_dummy;
+static std::vector<int> batch_cache_dirty_tags;
+static int batch_cache_free_len;
+
+static void batch_cache_dirty_tag_cb(Mesh *UNUSED(me), int mode)
+{
+  batch_cache_dirty_tags.push_back(mode);
+}
+
+static void batch_cache_free_cb(Mesh *me)
+{
+  if (me->runtime.batch_cache == &batch_cache_dummy) {
+    batch_cache_free_len++;
+  }
+  me->runtime.batch_cache = nullptr;
+}
+
+/* The batch cache of an evaluated mesh which is only deformed is handed over to the next
+ * evaluated mesh, instead of being rebuilt from scratch (index buffers included). */
+class MeshEvalBatchCacheTest : public BlenkernelBaseTest {
+ protected:
+  Object *object = nullptr;
+
+  void SetUp() override
+  {
+    BKE_mesh_batch_cache_dirty_tag_cb = batch_cache_dirty_tag_cb;
+    BKE_mesh_batch_cache_free_cb = batch_cache_free_cb;
+    batch_cache_dirty_tags.clear();
+    batch_cache_free_len = 0;
+  }
+
+  void TearDown() override
+  {
+    BlenkernelBaseTest::TearDown();
+    BKE_mesh_batch_cache_dirty_tag_cb = nullptr;
+    BKE_mesh_batch_cache_free_cb = nullptr;
+  }
+
+  /* A grid of quads, deformed over time by a wave modifier (as if animated). */
+  void deformed_grid_create()
+  {
+    scene_create();
+    object = object_add(OB_MESH, "OBDeform", mesh_grid_add("MEDeform", 4, 4));
+    BLI_addtail(&object->modifiers, modifier_new(eModifierType_Wave));
+    depsgraph_create(DAG_EVAL_VIEWPORT);
+
+    /* As if it was drawn. */
+    Mesh *mesh_eval = mesh_eval_get();
+    BKE_mesh_runtime_looptri_ensure(mesh_eval);
+    mesh_eval->runtime.batch_cache = &batch_cache_dummy;
+    batch_cache_dirty_tags.clear();
+  }
+
+  /* Same as #BKE_scene_graph_update_for_newframe, without the window manager. */
+  void frame_set(const int frame)
+  {
+    scene->r.cfra = frame;
+    DEG_evaluate_on_framechange(bmain, depsgraph, BKE_scene_frame_get(scene));
+    DEG_ids_clear_recalc(bmain, depsgraph);
+  }
+
+  Mesh *mesh_eval_get()
+  {
+    return DEG_get_evaluated_object(depsgraph, object)->runtime.mesh_eval;
+  }
+};
+
+TEST_F(MeshEvalBatchCacheTest, DeformKeepsCache)
+{
+  deformed_grid_create();
+  const float z_prev = mesh_eval_get()->mvert[5].co[2];
+
+  frame_set(10);
+
+  Mesh *mesh_eval = mesh_eval_get();
+  EXPECT_NE(z_prev, mesh_eval->mvert[5].co[2]);
+  EXPECT_EQ(&batch_cache_dummy, mesh_eval->runtime.batch_cache);
+  EXPECT_EQ(0, batch_cache_free_len);
+  /* Only the buffers depending on vertex positions are to be extracted again. */
+  ASSERT_EQ(1, (int)batch_cache_dirty_tags.size());
+  EXPECT_EQ(BKE_MESH_BATCH_DIRTY_DEFORM, batch_cache_dirty_tags[0]);
+}
+
+TEST_F(MeshEvalBatchCacheTest, MeshEditFreesCache)
+{
+  deformed_grid_create();
+
+  /* The mesh itself is copied again, its topology may have changed. */
+  DEG_id_tag_update_ex(bmain, static_cast<ID *>(object->data), ID_RECALC_GEOMETRY);
+  depsgraph_update();
+
+  EXPECT_EQ(nullptr, mesh_eval_get()->runtime.batch_cache);
+  EXPECT_EQ(1, batch_cache_free_len);
+  for (const int mode : batch_cache_dirty_tags) {
+    EXPECT_NE(BKE_MESH_BATCH_DIRTY_DEFORM, mode);
+  }
+}
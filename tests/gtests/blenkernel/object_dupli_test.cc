@@ -0,0 +1,231 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "blenkernel_base_test.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BKE_anim.h"
+#include "BKE_particle.h"
+
+#include "BLI_listbase.h"
+
+#include "DEG_depsgraph_query.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+#include "DNA_particle_types.h"
+}
+
+/* Duplis are generated serially below #DUPLI_PARALLEL_GRAINSIZE instances and in parallel above
+ * it. Either way they have to come out in the order of the vertices, faces or particles they are
+ * instanced on, like the ListBase they used to be generated into. Skipped faces or particles
+ * leave no gaps. */
+class ObjectDupliTest : public BlenkernelBaseTest {
+ protected:
+  Object *parent = nullptr;
+  Object *child = nullptr;
+
+  /* The parent uses me, and instances the child object (an empty) as set up by the caller. */
+  void instancing_create(Mesh *me)
+  {
+    parent = object_add(OB_MESH, "OBParent", me);
+    child = object_add(OB_EMPTY, "OBChild", nullptr);
+  }
+
+  /* A mesh with totvert vertices along the X axis, instancing the child on each vertex. */
+  void verts_instancing_create(const int totvert)
+  {
+    scene_create();
+    instancing_create(mesh_grid_add("MEDupli", totvert, 1));
+    parent->transflag |= OB_DUPLIVERTS;
+    child->parent = parent;
+    depsgraph_create(DAG_EVAL_VIEWPORT);
+  }
+
+  /* A row of totface quads along the X axis, instancing the child on each face.
+   * Every third face is degenerate, and skipped. */
+  void faces_instancing_create(const int totface)
+  {
+    scene_create();
+    Mesh *me = mesh_grid_add("MEDupli", totface + 1, 2);
+    for (int i = 0; i < totface; i += 3) {
+      me->mpoly[i].totloop = 2;
+    }
+    instancing_create(me);
+    parent->transflag |= OB_DUPLIFACES;
+    child->parent = parent;
+    depsgraph_create(DAG_EVAL_VIEWPORT);
+  }
+
+  /* A particle system emitting totpart particles from a grid, instancing the child on each.
+   * Unborn particles are shown, so all of them are instanced without simulating any frames. */
+  ParticleSystem *particles_instancing_create(const int totpart)
+  {
+    scene_create();
+    instancing_create(mesh_grid_add("MEDupli", 33, 33));
+    object_add_particle_system(bmain, scene, parent, "PSDupli");
+    ParticleSystem *psys = static_cast<ParticleSystem *>(parent->particlesystem.first);
+    ParticleSettings *part = psys->part;
+    part->totpart = totpart;
+    part->flag |= PART_UNBORN | PART_DIED;
+    part->draw_as = PART_DRAW_REND;
+    part->ren_as = PART_DRAW_OB;
+    part->instance_object = child;
+    depsgraph_create(DAG_EVAL_VIEWPORT);
+    return psys;
+  }
+
+  /* Duplis of the parent, to be freed with #free_object_duplilist. */
+  ListBase *duplilist_get(DupliObject **r_duplis, int *r_duplis_len)
+  {
+    Scene *scene_eval = DEG_get_evaluated_scene(depsgraph);
+    Object *parent_eval = DEG_get_evaluated_object(depsgraph, parent);
+    ListBase *duplilist = object_duplilist(depsgraph, scene_eval, parent_eval);
+    *r_duplis = object_duplilist_array(duplilist, r_duplis_len);
+    return duplilist;
+  }
+
+  void verts_test_do(const int totvert)
+  {
+    verts_instancing_create(totvert);
+
+    DupliObject *duplis;
+    int duplis_len;
+    ListBase *duplilist = duplilist_get(&duplis, &duplis_len);
+    ASSERT_EQ(totvert, duplis_len);
+
+    Object *child_eval = DEG_get_evaluated_object(depsgraph, child);
+    int index = 0;
+    LISTBASE_FOREACH (DupliObject *, dob, duplilist) {
+      ASSERT_LT(index, totvert);
+      EXPECT_EQ(&duplis[index], dob);
+      EXPECT_EQ(child_eval, dob->ob);
+      EXPECT_EQ(index, dob->persistent_id[0]);
+      EXPECT_FLOAT_EQ((float)index, dob->mat[3][0]);
+      index++;
+    }
+    EXPECT_EQ(totvert, index);
+
+    free_object_duplilist(duplilist);
+  }
+
+  void faces_test_do(const int totface)
+  {
+    faces_instancing_create(totface);
+
+    DupliObject *duplis;
+    int duplis_len;
+    ListBase *duplilist = duplilist_get(&duplis, &duplis_len);
+    ASSERT_EQ(totface - (totface + 2) / 3, duplis_len);
+
+    Object *child_eval = DEG_get_evaluated_object(depsgraph, child);
+    int face_index = 1;
+    for (int i = 0; i < duplis_len; i++) {
+      const DupliObject *dob = &duplis[i];
+      EXPECT_EQ(child_eval, dob->ob);
+      EXPECT_EQ(face_index, dob->persistent_id[0]);
+      /* At the center of the face. */
+      EXPECT_FLOAT_EQ((float)face_index + 0.5f, dob->mat[3][0]);
+      EXPECT_FLOAT_EQ(0.5f, dob->mat[3][1]);
+      face_index += (face_index % 3 == 2) ? 2 : 1;
+    }
+    /* No skipped face is left at the end. */
+    EXPECT_EQ(duplis_len, BLI_listbase_count(duplilist));
+
+    free_object_duplilist(duplilist);
+  }
+
+  void particles_test_do(const int totpart)
+  {
+    ParticleSystem *psys = particles_instancing_create(totpart);
+
+    DupliObject *duplis;
+    int duplis_len;
+    ListBase *duplilist = duplilist_get(&duplis, &duplis_len);
+    ASSERT_EQ(totpart, duplis_len);
+
+    Object *child_eval = DEG_get_evaluated_object(depsgraph, child);
+    ParticleSystem *psys_eval = psys_eval_get(depsgraph, parent, psys);
+    ASSERT_NE(nullptr, psys_eval);
+    for (int i = 0; i < duplis_len; i++) {
+      const DupliObject *dob = &duplis[i];
+      EXPECT_EQ(child_eval, dob->ob);
+      EXPECT_EQ(i, dob->persistent_id[0]);
+      EXPECT_EQ(psys_eval, dob->particle_system);
+      /* Unborn particles are at their emission location on the grid. */
+      EXPECT_GE(dob->mat[3][0], 0.0f);
+      EXPECT_LE(dob->mat[3][0], 32.0f);
+      EXPECT_FLOAT_EQ(0.0f, dob->mat[3][2]);
+    }
+    EXPECT_EQ(duplis_len, BLI_listbase_count(duplilist));
+
+    free_object_duplilist(duplilist);
+  }
+};
+
+TEST_F(ObjectDupliTest, VertsSerial)
+{
+  verts_test_do(100);
+}
+
+TEST_F(ObjectDupliTest, VertsParallel)
+{
+  verts_test_do(10000);
+}
+
+TEST_F(ObjectDupliTest, FacesSerial)
+{
+  faces_test_do(100);
+}
+
+TEST_F(ObjectDupliTest, FacesParallel)
+{
+  faces_test_do(10000);
+}
+
+TEST_F(ObjectDupliTest, ParticlesSerial)
+{
+  particles_test_do(100);
+}
+
+TEST_F(ObjectDupliTest, ParticlesParallel)
+{
+  particles_test_do(5000);
+}
+
+TEST_F(ObjectDupliTest, DepsgraphIterator)
+{
+  const int totvert = 5000;
+  verts_instancing_create(totvert);
+
+  int index = 0;
+  DEG_OBJECT_ITER_BEGIN (depsgraph,
+                         ob,
+                         DEG_ITER_OBJECT_FLAG_LINKED_DIRECTLY | DEG_ITER_OBJECT_FLAG_VISIBLE |
+                             DEG_ITER_OBJECT_FLAG_DUPLI) {
+    if (data_.dupli_object_current == nullptr) {
+      continue;
+    }
+    EXPECT_EQ(index, data_.dupli_object_current->persistent_id[0]);
+    EXPECT_FLOAT_EQ((float)index, ob->obmat[3][0]);
+    index++;
+  }
+  DEG_OBJECT_ITER_END;
+
+  EXPECT_EQ(totvert, index);
+}
@@ -0,0 +1,499 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "blenkernel_base_test.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BKE_appdir.h"
+#include "BKE_global.h"
+#include "BKE_main.h"
+#include "BKE_pointcache.h"
+#include "BKE_softbody.h"
+
+#include "BLI_fileops.h"
+#include "BLI_fileops_types.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+
+#include "DNA_object_force_types.h"
+#include "DNA_object_types.h"
+}
+
+#define POINTS_LEN 4096
+#define FRAMES_LEN 40
+
+/* Frames of the disk cache are written by background threads, reading a frame or flushing right
+ * after writing it has to give the data that was just written, also when the frame replaces
+ * another one that is already on disk. The cache is of a soft body, in a directory next to a
+ * blend file in the temporary directory. */
+class PointcacheTest : public BlenkernelBaseTest {
+ protected:
+  Object *ob = nullptr;
+  PTCacheID pid;
+  char dirpath[FILE_MAX];
+
+  Main *main_global_prev = nullptr;
+  bool relbase_valid_prev = false;
+
+  static void SetUpTestCase()
+  {
+    BlenkernelBaseTest::SetUpTestCase();
+    BKE_tempdir_init(NULL);
+  }
+
+  virtual void SetUp()
+  {
+    BlenkernelBaseTest::SetUp();
+    scene_create();
+
+    BLI_join_dirfile(bmain->name, sizeof(bmain->name), BKE_tempdir_session(), "ptcache.blend");
+    BLI_join_dirfile(dirpath, sizeof(dirpath), BKE_tempdir_session(), "blendcache_ptcache");
+    main_global_prev = G_MAIN;
+    relbase_valid_prev = G.relbase_valid;
+    G_MAIN = bmain;
+    G.relbase_valid = true;
+
+    ob = object_add(OB_MESH, "OBSoft", nullptr);
+    ob->soft = sbNew(scene);
+    ob->soft->totpoint = POINTS_LEN;
+    ob->soft->bpoint = static_cast<BodyPoint *>(
+        MEM_callocN(sizeof(BodyPoint) * POINTS_LEN, __func__));
+
+    BKE_ptcache_id_from_softbody(&pid, ob, ob->soft);
+    pid.cache->flag |= PTCACHE_DISK_CACHE;
+    pid.cache->compression = PTCACHE_COMPRESS_ZSTD;
+  }
+
+  virtual void TearDown()
+  {
+    BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_ALL, 0);
+    BKE_ptcache_disk_write_flush();
+    BLI_delete(dirpath, true, true);
+
+    G_MAIN = main_global_prev;
+    G.relbase_valid = relbase_valid_prev;
+
+    BlenkernelBaseTest::TearDown();
+  }
+
+  /* Values depending on the frame and on the bake, so a stale frame doesn't pass for a new one. */
+  void points_set(const int frame, const int bake)
+  {
+    for (int i = 0; i < POINTS_LEN; i++) {
+      BodyPoint *bp = &ob->soft->bpoint[i];
+      bp->pos[0] = (float)frame;
+      bp->pos[1] = (float)i;
+      bp->pos[2] = (float)bake;
+      bp->vec[0] = (float)(frame * bake);
+      bp->vec[1] = (float)(i % 7);
+      bp->vec[2] = 1.0f;
+    }
+  }
+
+  void points_expect(const int frame, const int bake)
+  {
+    for (int i = 0; i < POINTS_LEN; i++) {
+      const BodyPoint *bp = &ob->soft->bpoint[i];
+      if (bp->pos[0] != (float)frame || bp->pos[1] != (float)i || bp->pos[2] != (float)bake ||
+          bp->vec[0] != (float)(frame * bake) || bp->vec[1] != (float)(i % 7) ||
+          bp->vec[2] != 1.0f) {
+        ADD_FAILURE() << "point " << i << " of frame " << frame << " bake " << bake;
+        return;
+      }
+    }
+  }
+
+  void frame_write(const int frame, const int bake)
+  {
+    points_set(frame, bake);
+    BKE_ptcache_write(&pid, (unsigned int)frame);
+  }
+
+  void frame_read_expect(const int frame, const int bake)
+  {
+    points_set(0, 0);
+    EXPECT_EQ(BKE_ptcache_read(&pid, (float)frame, false), PTCACHE_READ_EXACT);
+    points_expect(frame, bake);
+  }
+
+  /* Bakes all frames, reading each one right after writing it. */
+  void bake_read_each(const int bake)
+  {
+    for (int frame = 1; frame <= FRAMES_LEN; frame++) {
+      frame_write(frame, bake);
+      frame_read_expect(frame, bake);
+    }
+  }
+
+  /* Number and size of the files in the cache directory. */
+  void files_stat(int *r_len, uint64_t *r_size)
+  {
+    struct direntry *files;
+    const unsigned int files_len = BLI_filelist_dir_contents(dirpath, &files);
+    *r_len = 0;
+    *r_size = 0;
+    for (unsigned int i = 0; i < files_len; i++) {
+      if (!FILENAME_IS_CURRPAR(files[i].relname)) {
+        (*r_len)++;
+        *r_size += (uint64_t)files[i].s.st_size;
+      }
+    }
+    BLI_filelist_free(files, files_len);
+  }
+
+  /* Bakes all frames and checks they're written completely by the flush. */
+  void bake_flush(const int bake, const int files_len_expect)
+  {
+    for (int frame = 1; frame <= FRAMES_LEN; frame++) {
+      frame_write(frame, bake);
+    }
+    BKE_ptcache_disk_write_flush();
+
+    int files_len;
+    uint64_t files_size;
+    files_stat(&files_len, &files_size);
+    EXPECT_EQ(files_len, files_len_expect);
+
+    for (int frame = 1; frame <= FRAMES_LEN; frame++) {
+      frame_read_expect(frame, bake);
+    }
+
+    /* Reading waits for frames still being written, nothing may be left to wait for. */
+    int files_len_read;
+    uint64_t files_size_read;
+    files_stat(&files_len_read, &files_size_read);
+    EXPECT_EQ(files_len_read, files_len);
+    EXPECT_EQ(files_size_read, files_size);
+  }
+};
+
+TEST_F(PointcacheTest, ReadAfterWrite)
+{
+  bake_read_each(1);
+}
+
+TEST_F(PointcacheTest, ReadAfterWriteSingleFile)
+{
+  pid.cache->flag |= PTCACHE_SINGLE_FILE;
+  bake_read_each(1);
+}
+
+/* Baking again from the start frame replaces the frames on disk. */
+TEST_F(PointcacheTest, ReadAfterRebake)
+{
+  bake_read_each(1);
+  bake_read_each(2);
+}
+
+TEST_F(PointcacheTest, ReadAfterRebakeSingleFile)
+{
+  pid.cache->flag |= PTCACHE_SINGLE_FILE;
+  bake_read_each(1);
+  bake_read_each(2);
+}
+
+/* All frames are on disk after a flush. Uncompressed frames take longer to write, so files still
+ * being written when the flush returns are more likely to be noticed. */
+TEST_F(PointcacheTest, Flush)
+{
+  pid.cache->compression = PTCACHE_COMPRESS_NO;
+  bake_flush(1, FRAMES_LEN);
+  bake_flush(2, FRAMES_LEN);
+}
+
+TEST_F(PointcacheTest, FlushSingleFile)
+{
+  pid.cache->flag |= PTCACHE_SINGLE_FILE;
+  pid.cache->compression = PTCACHE_COMPRESS_NO;
+  bake_flush(1, 1);
+  bake_flush(2, 1);
+}
+
+/* -------------------------------------------------------------------- */
+/* Single file format */
+
+/* Layout of the file with all frames, as written by pointcache.c. */
+struct PackHeader {
+  char id[8];
+  int version;
+  int frame_start;
+  int frames_len;
+  int _pad;
+};
+
+struct PackFrame {
+  uint64_t offset;
+  uint64_t size;
+};
+
+class PointcachePackTest : public PointcacheTest {
+ protected:
+  char filepath[FILE_MAX];
+
+  virtual void SetUp()
+  {
+    PointcacheTest::SetUp();
+    pid.cache->flag |= PTCACHE_SINGLE_FILE;
+    pid.cache->compression = PTCACHE_COMPRESS_NO;
+  }
+
+  /* Bakes frames from the start frame and finds the file they're written to. */
+  void bake(const int frame_end)
+  {
+    for (int frame = pid.cache->startframe; frame <= frame_end; frame++) {
+      frame_write(frame, 1);
+    }
+    BKE_ptcache_disk_write_flush();
+
+    struct direntry *files;
+    const unsigned int files_len = BLI_filelist_dir_contents(dirpath, &files);
+    filepath[0] = '\0';
+    for (unsigned int i = 0; i < files_len; i++) {
+      if (!FILENAME_IS_CURRPAR(files[i].relname)) {
+        EXPECT_EQ(filepath[0], '\0');
+        BLI_join_dirfile(filepath, sizeof(filepath), dirpath, files[i].relname);
+      }
+    }
+    BLI_filelist_free(files, files_len);
+    ASSERT_NE(filepath[0], '\0');
+  }
+
+  /* Reads the header and the table of frames, to be freed with #MEM_freeN. */
+  PackFrame *table_read(PackHeader *r_header)
+  {
+    FILE *fp = BLI_fopen(filepath, "rb");
+    PackFrame *frames = nullptr;
+    if (fp == nullptr) {
+      ADD_FAILURE() << "can't open " << filepath;
+      return nullptr;
+    }
+    if (fread(r_header, sizeof(*r_header), 1, fp) == 1) {
+      frames = static_cast<PackFrame *>(
+          MEM_mallocN(sizeof(PackFrame) * (size_t)r_header->frames_len, __func__));
+      EXPECT_EQ(fread(frames, sizeof(PackFrame), (size_t)r_header->frames_len, fp),
+                (size_t)r_header->frames_len);
+    }
+    fclose(fp);
+    return frames;
+  }
+
+  /* Reading maps the file once for all frames, files changed by the tests are mapped again
+   * after this. */
+  void maps_free()
+  {
+    BKE_ptcache_disk_write_exit();
+  }
+};
+
+TEST_F(PointcachePackTest, RoundTrip)
+{
+  bake(FRAMES_LEN);
+
+  PackHeader header;
+  PackFrame *frames = table_read(&header);
+  ASSERT_NE(frames, nullptr);
+  EXPECT_EQ(memcmp(header.id, "BPHYSPAK", sizeof(header.id)), 0);
+  EXPECT_EQ(header.version, 1);
+  /* Frame 0 holds the info of baked caches. */
+  EXPECT_EQ(header.frame_start, 0);
+  EXPECT_EQ(header.frames_len, pid.cache->endframe + 1);
+
+  uint64_t offset = sizeof(header) + sizeof(PackFrame) * (size_t)header.frames_len;
+  for (int i = 0; i < header.frames_len; i++) {
+    const int frame = header.frame_start + i;
+    if (frame >= 1 && frame <= FRAMES_LEN) {
+      /* Appended in the order of the frames, they're written by one thread at a time. */
+      EXPECT_EQ(frames[i].offset, offset);
+      EXPECT_GT(frames[i].size, (uint64_t)POINTS_LEN * sizeof(float[6]));
+      offset += frames[i].size;
+    }
+    else {
+      EXPECT_EQ(frames[i].size, 0);
+    }
+  }
+  EXPECT_EQ(BLI_file_size(filepath), offset);
+  MEM_freeN(frames);
+
+  for (int frame = 1; frame <= FRAMES_LEN; frame++) {
+    frame_read_expect(frame, 1);
+  }
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, FRAMES_LEN + 1));
+}
+
+/* The space of cleared frames is given back once they take up most of the file. */
+TEST_F(PointcachePackTest, Compact)
+{
+  bake(FRAMES_LEN);
+  const size_t file_size = BLI_file_size(filepath);
+
+  /* Clearing a single frame leaves the file as is. */
+  BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_FRAME, FRAMES_LEN);
+  EXPECT_EQ(BLI_file_size(filepath), file_size);
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, FRAMES_LEN));
+
+  BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_AFTER, 4);
+
+  PackHeader header;
+  PackFrame *frames = table_read(&header);
+  ASSERT_NE(frames, nullptr);
+  uint64_t offset = sizeof(header) + sizeof(PackFrame) * (size_t)header.frames_len;
+  for (int i = 0; i < header.frames_len; i++) {
+    const int frame = header.frame_start + i;
+    if (frame >= 1 && frame <= 4) {
+      EXPECT_EQ(frames[i].offset, offset);
+      offset += frames[i].size;
+    }
+    else {
+      EXPECT_EQ(frames[i].size, 0);
+    }
+  }
+  EXPECT_EQ(BLI_file_size(filepath), offset);
+  EXPECT_LT(BLI_file_size(filepath), file_size / 4);
+  MEM_freeN(frames);
+
+  for (int frame = 1; frame <= 4; frame++) {
+    frame_read_expect(frame, 1);
+  }
+  for (int frame = 5; frame <= FRAMES_LEN; frame++) {
+    EXPECT_FALSE(BKE_ptcache_id_exist(&pid, frame));
+  }
+}
+
+/* Changing the frame range of the cache keeps the frames that are in the file. */
+TEST_F(PointcachePackTest, FrameRangeChange)
+{
+  pid.cache->endframe = FRAMES_LEN;
+  bake(FRAMES_LEN);
+
+  pid.cache->endframe = FRAMES_LEN * 2;
+  frame_write(FRAMES_LEN + 1, 1);
+  BKE_ptcache_disk_write_flush();
+
+  PackHeader header;
+  MEM_freeN(table_read(&header));
+  EXPECT_EQ(header.frame_start, 0);
+  EXPECT_EQ(header.frames_len, FRAMES_LEN * 2 + 1);
+  for (int frame = 1; frame <= FRAMES_LEN + 1; frame++) {
+    frame_read_expect(frame, 1);
+  }
+
+  /* Frames outside of the range are kept too, as with a file for each frame. */
+  pid.cache->startframe = -4;
+  pid.cache->endframe = FRAMES_LEN / 2;
+  BKE_ptcache_id_clear(&pid, PTCACHE_CLEAR_FRAME, FRAMES_LEN / 2);
+  frame_write(FRAMES_LEN / 2, 2);
+  BKE_ptcache_disk_write_flush();
+
+  MEM_freeN(table_read(&header));
+  EXPECT_EQ(header.frame_start, -4);
+  EXPECT_EQ(header.frames_len, FRAMES_LEN * 2 + 5);
+  EXPECT_FALSE(BKE_ptcache_id_exist(&pid, FRAMES_LEN / 2 + 1));
+
+  pid.cache->startframe = 1;
+  pid.cache->endframe = FRAMES_LEN * 2;
+  for (int frame = 1; frame <= FRAMES_LEN + 1; frame++) {
+    frame_read_expect(frame, frame == FRAMES_LEN / 2 ? 2 : 1);
+  }
+}
+
+/* Frames are found past 4 GB, the data of the file is sparse. */
+TEST_F(PointcachePackTest, Offset64)
+{
+  const uint64_t offset_large = ((uint64_t)1 << 32) + 7;
+
+  bake(2);
+  PackHeader header;
+  PackFrame *frames = table_read(&header);
+  ASSERT_NE(frames, nullptr);
+  size_t file_size;
+  char *file_mem = static_cast<char *>(BLI_file_read_binary_as_mem(filepath, 0, &file_size));
+  ASSERT_NE(file_mem, nullptr);
+
+  maps_free();
+  FILE *fp = BLI_fopen(filepath, "wb");
+  ASSERT_NE(fp, nullptr);
+  uint64_t offset = offset_large;
+  for (int frame = 1; frame <= 2; frame++) {
+    PackFrame *entry = &frames[frame - header.frame_start];
+    ASSERT_EQ(BLI_fseek(fp, (int64_t)offset, SEEK_SET), 0);
+    ASSERT_EQ(fwrite(file_mem + entry->offset, 1, entry->size, fp), entry->size);
+    entry->offset = offset;
+    offset += entry->size;
+  }
+  ASSERT_EQ(BLI_fseek(fp, 0, SEEK_SET), 0);
+  fwrite(&header, sizeof(header), 1, fp);
+  fwrite(frames, sizeof(PackFrame), (size_t)header.frames_len, fp);
+  ASSERT_EQ(fclose(fp), 0);
+  MEM_freeN(file_mem);
+
+  frame_read_expect(1, 1);
+  frame_read_expect(2, 1);
+
+  /* Appending a frame stores its offset past 4 GB. */
+  frame_write(3, 1);
+  BKE_ptcache_disk_write_flush();
+  MEM_freeN(frames);
+  frames = table_read(&header);
+  ASSERT_NE(frames, nullptr);
+  EXPECT_EQ(frames[3 - header.frame_start].offset, offset);
+  MEM_freeN(frames);
+
+  for (int frame = 1; frame <= 3; frame++) {
+    frame_read_expect(frame, 1);
+  }
+}
+
+/* A file cut short isn't read past its end, the frames before the cut are still read. */
+TEST_F(PointcachePackTest, Truncated)
+{
+  bake(4);
+  PackHeader header;
+  PackFrame *frames = table_read(&header);
+  ASSERT_NE(frames, nullptr);
+  const PackFrame entry_last = frames[4 - header.frame_start];
+  const size_t table_end = sizeof(header) + sizeof(PackFrame) * (size_t)header.frames_len;
+  MEM_freeN(frames);
+
+  size_t file_size;
+  char *file_mem = static_cast<char *>(BLI_file_read_binary_as_mem(filepath, 0, &file_size));
+  ASSERT_NE(file_mem, nullptr);
+  const size_t sizes[] = {(size_t)(entry_last.offset + entry_last.size / 2), table_end / 2, 4};
+
+  for (const size_t size : sizes) {
+    maps_free();
+    FILE *fp = BLI_fopen(filepath, "wb");
+    ASSERT_NE(fp, nullptr);
+    ASSERT_EQ(fwrite(file_mem, 1, size, fp), size);
+    ASSERT_EQ(fclose(fp), 0);
+
+    if (size > table_end) {
+      for (int frame = 1; frame <= 3; frame++) {
+        frame_read_expect(frame, 1);
+      }
+    }
+    else {
+      for (int frame = 1; frame <= 3; frame++) {
+        EXPECT_FALSE(BKE_ptcache_id_exist(&pid, frame));
+      }
+    }
+    EXPECT_FALSE(BKE_ptcache_id_exist(&pid, 4));
+    points_set(0, 0);
+    EXPECT_EQ(BKE_ptcache_read(&pid, 4.0f, false), size > table_end ? PTCACHE_READ_OLD : 0);
+  }
+  MEM_freeN(file_mem);
+}
@@ -0,0 +1,238 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+
+#include "BLI_kdopbvh.h"
+#include "BLI_math_base.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "PIL_time.h"
+}
+
+#include "BLI_kdopbvh_test_util.h"
+#include "stubs/bf_intern_eigen_stubs.h"
+
+#define NUM_RUN_AVERAGED 5
+
+/* *** Per point queries, as done by modifiers (shrinkwrap, data transfer...). *** */
+
+static void kdopbvh_queries_test_do(const char *id, const int points_len, const int queries_len)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+
+  struct RNG *rng = BLI_rng_new(1234);
+  float(*points)[3] = kdopbvh_test_points_random(rng, points_len);
+  BVHTree *tree = kdopbvh_test_tree_from_points(
+      points, points_len, 0.01f, 8, 8, BVH_BUILD_MEDIAN);
+
+  /* Queries follow a path around the points, like the vertices of a mesh would. */
+  float(*cos)[3], (*dirs)[3];
+  kdopbvh_test_queries_path(queries_len, 32.0f, 1.5f, &cos, &dirs);
+
+  BVHTreeNearest *nearest = (BVHTreeNearest *)MEM_mallocN(sizeof(*nearest) * queries_len,
+                                                          __func__);
+  BVHTreeNearest *nearest_single = (BVHTreeNearest *)MEM_mallocN(
+      sizeof(*nearest_single) * queries_len, __func__);
+  BVHTreeRayHit *hit = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hit) * queries_len, __func__);
+  BVHTreeRayHit *hit_single = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hit_single) * queries_len,
+                                                           __func__);
+
+  double averaged_timing = 0.0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    const double init_time = PIL_check_seconds_timer();
+    for (int i = 0; i < queries_len; i++) {
+      nearest_single[i].index = -1;
+      nearest_single[i].dist_sq = FLT_MAX;
+      BLI_bvhtree_find_nearest(
+          tree, cos[i], &nearest_single[i], kdopbvh_test_nearest_callback, points);
+    }
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+  }
+  printf("\tFind nearest: single queries done in %fs on average over %d runs\n",
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  averaged_timing = 0.0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    const double init_time = PIL_check_seconds_timer();
+    kdopbvh_test_nearest_clear(nearest, queries_len);
+    BLI_bvhtree_find_nearest_batch(
+        tree, cos, queries_len, nearest, kdopbvh_test_nearest_callback, points, 0);
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+  }
+  printf("\tFind nearest: batched queries done in %fs on average over %d runs\n",
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  /* Being faster is no use if the results differ. */
+  kdopbvh_test_nearest_expect_eq(nearest_single, nearest, queries_len);
+
+  averaged_timing = 0.0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    const double init_time = PIL_check_seconds_timer();
+    for (int i = 0; i < queries_len; i++) {
+      hit_single[i].index = -1;
+      hit_single[i].dist = BVH_RAYCAST_DIST_MAX;
+      BLI_bvhtree_ray_cast(
+          tree, cos[i], dirs[i], 0.0f, &hit_single[i], kdopbvh_test_raycast_callback, points);
+    }
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+  }
+  printf("\tRay cast: single queries done in %fs on average over %d runs\n",
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  averaged_timing = 0.0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    const double init_time = PIL_check_seconds_timer();
+    kdopbvh_test_hit_clear(hit, queries_len);
+    BLI_bvhtree_ray_cast_batch(tree,
+                               cos,
+                               dirs,
+                               queries_len,
+                               0.0f,
+                               hit,
+                               kdopbvh_test_raycast_callback,
+                               points,
+                               BVH_RAYCAST_DEFAULT);
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+  }
+  printf("\tRay cast: batched queries done in %fs on average over %d runs\n",
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  kdopbvh_test_hit_expect_eq(hit_single, hit, queries_len);
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(cos);
+  MEM_freeN(dirs);
+  MEM_freeN(nearest);
+  MEM_freeN(nearest_single);
+  MEM_freeN(hit);
+  MEM_freeN(hit_single);
+
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(kdopbvh, Queries100k)
+{
+  kdopbvh_queries_test_do("BVH tree queries - 10K points - 100K queries", 10000, 100000);
+}
+
+TEST(kdopbvh, Queries1000k)
+{
+  kdopbvh_queries_test_do("BVH tree queries - 100K points - 1000K queries", 100000, 1000000);
+}
+
+/* *** Tree build modes, on non-uniformly distributed leafs. *** */
+
+static int perf_insert_bulk_callback(void *userdata,
+                                     int index,
+                                     float r_co[BVH_BULK_INSERT_POINTS_MAX][3])
+{
+  float(*points)[3] = (float(*)[3])userdata;
+  copy_v3_v3(r_co[0], points[index]);
+  return 1;
+}
+
+static void kdopbvh_build_mode_test_do(const char *id,
+                                       const int points_len,
+                                       const int queries_len,
+                                       const eBVHTreeBuildMode build_mode)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+
+  struct RNG *rng = BLI_rng_new(1234);
+
+  /* Most points in a small cluster, the others spread around it,
+   * like a detailed model next to a low poly ground. */
+  float(*points)[3] = kdopbvh_test_points_random(rng, points_len);
+  for (int i = 0; i < points_len; i++) {
+    mul_v3_fl(points[i], (i % 8) ? 0.01f : 1.0f);
+  }
+
+  float(*cos)[3] = kdopbvh_test_points_random(rng, queries_len);
+  float(*dirs)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * queries_len, __func__);
+  BVHTreeRayHit *hit = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hit) * queries_len, __func__);
+  for (int i = 0; i < queries_len; i++) {
+    negate_v3_v3(dirs[i], cos[i]);
+    mul_v3_fl(cos[i], 2.0f);
+    /* Aim around the cluster. */
+    dirs[i][0] += (BLI_rng_get_float(rng) - 0.5f) * 0.01f;
+    normalize_v3(dirs[i]);
+  }
+
+  BVHTree *tree = NULL;
+  double averaged_timing = 0.0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    if (tree) {
+      BLI_bvhtree_free(tree);
+    }
+    const double init_time = PIL_check_seconds_timer();
+    tree = BLI_bvhtree_new_ex(points_len, 0.001f, 4, 6, build_mode);
+    BLI_bvhtree_insert_bulk(tree, NULL, points_len, perf_insert_bulk_callback, points);
+    BLI_bvhtree_balance(tree);
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+  }
+  printf("\tBuild: done in %fs on average over %d runs\n",
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  averaged_timing = 0.0;
+  for (int run = 0; run < NUM_RUN_AVERAGED; run++) {
+    const double init_time = PIL_check_seconds_timer();
+    kdopbvh_test_hit_clear(hit, queries_len);
+    BLI_bvhtree_ray_cast_batch(tree,
+                               cos,
+                               dirs,
+                               queries_len,
+                               0.0f,
+                               hit,
+                               kdopbvh_test_raycast_callback,
+                               points,
+                               BVH_RAYCAST_DEFAULT);
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+  }
+  printf("\tRay cast: done in %fs on average over %d runs\n",
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED);
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(cos);
+  MEM_freeN(dirs);
+  MEM_freeN(hit);
+
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(kdopbvh, BuildMedian1000k)
+{
+  kdopbvh_build_mode_test_do(
+      "BVH tree median build - 1000K points - 100K queries", 1000000, 100000, BVH_BUILD_MEDIAN);
+}
+
+TEST(kdopbvh, BuildSAH1000k)
+{
+  kdopbvh_build_mode_test_do(
+      "BVH tree SAH build - 1000K points - 100K queries", 1000000, 100000, BVH_BUILD_SAH);
+}
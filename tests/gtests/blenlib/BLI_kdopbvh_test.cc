@@ -10,9 +10,11 @@ extern "C" {
 #include "BLI_compiler_attrs.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_rand.h"
+#include "BLI_math_base.h"
 #include "BLI_math_vector.h"
 }
 
+#include "BLI_kdopbvh_test_util.h"
 #include "stubs/bf_intern_eigen_stubs.h"
 
 /* -------------------------------------------------------------------- */
@@ -70,11 +72,16 @@ static void optimal_check_callback(void *userdata,
  * Note that a small epsilon is added to the BVH nodes bounds, even if we pass in zero.
  * Use rounding to ensure very close nodes don't cause the wrong node to be found as nearest.
  */
-static void find_nearest_points_test(
-    int points_len, float scale, int round, int random_seed, bool optimal = false)
+static void find_nearest_points_test(int points_len,
+                                     float scale,
+                                     int round,
+                                     int random_seed,
+                                     bool optimal = false,
+                                     eBVHTreeBuildMode build_mode = BVH_BUILD_MEDIAN,
+                                     int tree_type = 8)
 {
   struct RNG *rng = BLI_rng_new(random_seed);
-  BVHTree *tree = BLI_bvhtree_new(points_len, 0.0, 8, 8);
+  BVHTree *tree = BLI_bvhtree_new_ex(points_len, 0.0, tree_type, 8, build_mode);
 
   void *mem = MEM_mallocN(sizeof(float[3]) * points_len, __func__);
   float(*points)[3] = (float(*)[3])mem;
@@ -136,3 +143,354 @@ TEST(kdopbvh, OptimalFindNearest_500)
 {
   find_nearest_points_test(500, 1.0, 1000, 12, true);
 }
+
+TEST(kdopbvh, SAHFindNearest_1)
+{
+  find_nearest_points_test(1, 1.0, 1000, 1234, false, BVH_BUILD_SAH);
+}
+TEST(kdopbvh, SAHFindNearest_2)
+{
+  find_nearest_points_test(2, 1.0, 1000, 123, false, BVH_BUILD_SAH);
+}
+TEST(kdopbvh, SAHFindNearest_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, false, BVH_BUILD_SAH);
+}
+TEST(kdopbvh, SAHFindNearestBinary_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, false, BVH_BUILD_SAH, 2);
+}
+TEST(kdopbvh, SAHOptimalFindNearest_500)
+{
+  find_nearest_points_test(500, 1.0, 1000, 12, true, BVH_BUILD_SAH);
+}
+/* Enough points for the tree to be built by multiple threads. */
+TEST(kdopbvh, SAHFindNearest_10000)
+{
+  find_nearest_points_test(10000, 1.0, 100000, 12, false, BVH_BUILD_SAH, 4);
+}
+
+/* -------------------------------------------------------------------- */
+/* Batched Queries */
+
+/**
+ * Check batched queries give the same results as doing each query on its own.
+ */
+static void batch_queries_test(int points_len,
+                               int queries_len,
+                               int random_seed,
+                               eBVHTreeBuildMode build_mode = BVH_BUILD_MEDIAN)
+{
+  struct RNG *rng = BLI_rng_new(random_seed);
+  float(*points)[3] = kdopbvh_test_points_random(rng, points_len);
+  BVHTree *tree = kdopbvh_test_tree_from_points(points, points_len, 0.01f, 8, 8, build_mode);
+
+  float(*cos)[3], (*dirs)[3];
+  kdopbvh_test_queries_path(queries_len, 4.0f, 2.0f, &cos, &dirs);
+
+  BVHTreeNearest *nearest = (BVHTreeNearest *)MEM_mallocN(sizeof(*nearest) * queries_len,
+                                                          __func__);
+  BVHTreeNearest *nearest_single = (BVHTreeNearest *)MEM_mallocN(
+      sizeof(*nearest_single) * queries_len, __func__);
+  BVHTreeRayHit *hit = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hit) * queries_len, __func__);
+  BVHTreeRayHit *hit_single = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hit_single) * queries_len,
+                                                           __func__);
+  kdopbvh_test_nearest_clear(nearest, queries_len);
+  kdopbvh_test_nearest_clear(nearest_single, queries_len);
+  kdopbvh_test_hit_clear(hit, queries_len);
+  kdopbvh_test_hit_clear(hit_single, queries_len);
+
+  BLI_bvhtree_find_nearest_batch(
+      tree, cos, queries_len, nearest, kdopbvh_test_nearest_callback, points, 0);
+  BLI_bvhtree_ray_cast_batch(tree,
+                             cos,
+                             dirs,
+                             queries_len,
+                             0.0f,
+                             hit,
+                             kdopbvh_test_raycast_callback,
+                             points,
+                             BVH_RAYCAST_DEFAULT);
+
+  for (int i = 0; i < queries_len; i++) {
+    BLI_bvhtree_find_nearest(
+        tree, cos[i], &nearest_single[i], kdopbvh_test_nearest_callback, points);
+    BLI_bvhtree_ray_cast(
+        tree, cos[i], dirs[i], 0.0f, &hit_single[i], kdopbvh_test_raycast_callback, points);
+
+    EXPECT_NE(nearest[i].index, -1);
+  }
+
+  kdopbvh_test_nearest_expect_eq(nearest_single, nearest, queries_len);
+  kdopbvh_test_hit_expect_eq(hit_single, hit, queries_len);
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(cos);
+  MEM_freeN(dirs);
+  MEM_freeN(nearest);
+  MEM_freeN(nearest_single);
+  MEM_freeN(hit);
+  MEM_freeN(hit_single);
+}
+
+TEST(kdopbvh, BatchQueries_1)
+{
+  batch_queries_test(1, 100, 1234);
+}
+TEST(kdopbvh, BatchQueries_500)
+{
+  batch_queries_test(500, 10000, 12);
+}
+TEST(kdopbvh, SAHBatchQueries_500)
+{
+  batch_queries_test(500, 10000, 12, BVH_BUILD_SAH);
+}
+
+struct RayCastCountData {
+  float (*points)[3];
+  int points_len;
+  /* Calls of the callback per leaf, for the ray being cast. */
+  int *calls;
+  int calls_max;
+  float ray_origin[3];
+};
+
+static void raycast_count_callback(void *userdata,
+                                   int index,
+                                   const BVHTreeRay *ray,
+                                   BVHTreeRayHit *hit)
+{
+  RayCastCountData *data = (RayCastCountData *)userdata;
+  /* Rays of a single chunk are cast one after the other, each has its own origin. */
+  if (!equals_v3v3(data->ray_origin, ray->origin)) {
+    copy_v3_v3(data->ray_origin, ray->origin);
+    memset(data->calls, 0, sizeof(int) * data->points_len);
+  }
+  data->calls[index]++;
+  data->calls_max = max_ii(data->calls_max, data->calls[index]);
+  kdopbvh_test_raycast_callback(data->points, index, ray, hit);
+}
+
+/**
+ * The previous hit of a batch is tested before traversing the tree,
+ * the traversal must not run the callback on it a second time.
+ */
+TEST(kdopbvh, BatchRayCastCallbackOnce)
+{
+  /* A single chunk, so the rays are cast in order on one thread. */
+  const int points_len = 500, queries_len = 64;
+  struct RNG *rng = BLI_rng_new(12);
+  RayCastCountData data;
+  data.points = kdopbvh_test_points_random(rng, points_len);
+  data.points_len = points_len;
+  data.calls = (int *)MEM_callocN(sizeof(int) * points_len, __func__);
+  data.calls_max = 0;
+  copy_v3_fl(data.ray_origin, FLT_MAX);
+  BVHTree *tree = kdopbvh_test_tree_from_points(
+      data.points, points_len, 0.01f, 8, 8, BVH_BUILD_MEDIAN);
+
+  /* Nearly identical rays aimed at the first point, each hits it again. */
+  float(*cos)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * queries_len, __func__);
+  float(*dirs)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * queries_len, __func__);
+  for (int i = 0; i < queries_len; i++) {
+    mul_v3_v3fl(cos[i], data.points[0], 2.0f);
+    cos[i][0] += (float)i * 0.0001f;
+    negate_v3_v3(dirs[i], data.points[0]);
+    normalize_v3(dirs[i]);
+  }
+  BVHTreeRayHit *hit = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hit) * queries_len, __func__);
+  kdopbvh_test_hit_clear(hit, queries_len);
+
+  BLI_bvhtree_ray_cast_batch(tree,
+                             cos,
+                             dirs,
+                             queries_len,
+                             0.0f,
+                             hit,
+                             raycast_count_callback,
+                             &data,
+                             BVH_RAYCAST_DEFAULT);
+  EXPECT_EQ(1, data.calls_max);
+
+  for (int i = 0; i < queries_len; i++) {
+    EXPECT_EQ(0, hit[i].index);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(data.points);
+  MEM_freeN(data.calls);
+  MEM_freeN(cos);
+  MEM_freeN(dirs);
+  MEM_freeN(hit);
+}
+
+/* -------------------------------------------------------------------- */
+/* Bulk Insert */
+
+static int bulk_insert_callback(void *userdata,
+                                int index,
+                                float r_co[BVH_BULK_INSERT_POINTS_MAX][3])
+{
+  float(*points)[3] = (float(*)[3])userdata;
+  copy_v3_v3(r_co[0], points[index]);
+  add_v3_v3v3(r_co[1], points[index], points[index]);
+  return 2;
+}
+
+static bool bulk_insert_walk_leaf_callback(const BVHTreeAxisRange *bounds,
+                                           int index,
+                                           void *userdata)
+{
+  float(*points)[3] = (float(*)[3])userdata;
+  for (int axis = 0; axis < 3; axis++) {
+    const float co_min = min_ff(points[index][axis], points[index][axis] * 2.0f);
+    const float co_max = max_ff(points[index][axis], points[index][axis] * 2.0f);
+    EXPECT_LE(bounds[axis].min, co_min);
+    EXPECT_GE(bounds[axis].max, co_max);
+  }
+  /* Tag the visited leafs. */
+  points[index][0] = FLT_MAX;
+  return true;
+}
+
+static bool bulk_insert_walk_parent_callback(const BVHTreeAxisRange *UNUSED(bounds),
+                                             void *UNUSED(userdata))
+{
+  return true;
+}
+
+static bool bulk_insert_walk_order_callback(const BVHTreeAxisRange *UNUSED(bounds),
+                                            char UNUSED(axis),
+                                            void *UNUSED(userdata))
+{
+  return true;
+}
+
+/**
+ * Check bulk insert creates the same leafs as inserting them one by one,
+ * with every second index and all leafs reachable from the root.
+ */
+static void bulk_insert_test(int points_len, eBVHTreeBuildMode build_mode)
+{
+  struct RNG *rng = BLI_rng_new(points_len);
+  const int indices_len = points_len / 2;
+
+  float(*points)[3] = kdopbvh_test_points_random(rng, points_len);
+  int *indices = (int *)MEM_mallocN(sizeof(int) * indices_len, __func__);
+
+  for (int i = 0; i < indices_len; i++) {
+    indices[i] = i * 2;
+  }
+
+  BVHTree *tree = BLI_bvhtree_new_ex(indices_len, 0.0f, 4, 6, build_mode);
+  BLI_bvhtree_insert_bulk(tree, indices, indices_len, bulk_insert_callback, points);
+  EXPECT_EQ(BLI_bvhtree_get_len(tree), indices_len);
+  BLI_bvhtree_balance(tree);
+
+  BLI_bvhtree_walk_dfs(tree,
+                       bulk_insert_walk_parent_callback,
+                       bulk_insert_walk_leaf_callback,
+                       bulk_insert_walk_order_callback,
+                       points);
+
+  for (int i = 0; i < points_len; i++) {
+    EXPECT_EQ(points[i][0] == FLT_MAX, (i % 2) == 0);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+  MEM_freeN(indices);
+}
+
+TEST(kdopbvh, InsertBulk_500)
+{
+  bulk_insert_test(500, BVH_BUILD_MEDIAN);
+}
+TEST(kdopbvh, SAHInsertBulk_500)
+{
+  bulk_insert_test(500, BVH_BUILD_SAH);
+}
+TEST(kdopbvh, SAHInsertBulk_10000)
+{
+  bulk_insert_test(10000, BVH_BUILD_SAH);
+}
+
+/* -------------------------------------------------------------------- */
+/* Update */
+
+/**
+ * Move all the leafs after the tree is built, nearest queries should still find them.
+ */
+static void update_tree_test(int points_len, eBVHTreeBuildMode build_mode, int tree_type)
+{
+  struct RNG *rng = BLI_rng_new(points_len);
+  const float offset[3] = {10.0f, -5.0f, 1.0f};
+  BVHTree *tree = BLI_bvhtree_new_ex(points_len, 0.0f, tree_type, 6, build_mode);
+
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  for (int i = 0; i < points_len; i++) {
+    rng_v3_round(points[i], 3, rng, 1000, 1.0f);
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+  const float area_ratio = BLI_bvhtree_get_area_ratio(tree);
+
+  for (int i = 0; i < points_len; i++) {
+    add_v3_v3(points[i], offset);
+    BLI_bvhtree_update_node(tree, i, points[i], NULL, 1);
+  }
+  BLI_bvhtree_update_tree(tree);
+
+  /* Moving all the points together keeps the quality of the tree. */
+  EXPECT_NEAR(area_ratio, BLI_bvhtree_get_area_ratio(tree), area_ratio * 1e-4f);
+
+  for (int i = 0; i < points_len; i++) {
+    const int j = BLI_bvhtree_find_nearest(tree, points[i], NULL, NULL, NULL);
+    EXPECT_GE(j, 0);
+    EXPECT_LT(j, points_len);
+    EXPECT_EQ_ARRAY(points[i], points[j], 3);
+  }
+
+  /* Shuffling the points keeps the tree valid, but makes it degrade. */
+  BLI_array_randomize(points, sizeof(*points), points_len, 1);
+  for (int i = 0; i < points_len; i++) {
+    BLI_bvhtree_update_node(tree, i, points[i], NULL, 1);
+  }
+  BLI_bvhtree_update_tree(tree);
+
+  EXPECT_GT(BLI_bvhtree_get_area_ratio(tree), area_ratio * 2.0f);
+
+  for (int i = 0; i < points_len; i++) {
+    const int j = BLI_bvhtree_find_nearest(tree, points[i], NULL, NULL, NULL);
+    EXPECT_EQ_ARRAY(points[i], points[j], 3);
+  }
+
+  BLI_bvhtree_free(tree);
+  BLI_rng_free(rng);
+  MEM_freeN(points);
+}
+
+TEST(kdopbvh, UpdateTree_500)
+{
+  update_tree_test(500, BVH_BUILD_MEDIAN, 4);
+}
+TEST(kdopbvh, SAHUpdateTree_500)
+{
+  update_tree_test(500, BVH_BUILD_SAH, 4);
+}
+TEST(kdopbvh, SAHUpdateTreeBinary_500)
+{
+  update_tree_test(500, BVH_BUILD_SAH, 2);
+}
+TEST(kdopbvh, UpdateTree_10000)
+{
+  update_tree_test(10000, BVH_BUILD_MEDIAN, 8);
+}
+TEST(kdopbvh, SAHUpdateTree_10000)
+{
+  update_tree_test(10000, BVH_BUILD_SAH, 4);
+}
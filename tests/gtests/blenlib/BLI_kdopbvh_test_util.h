@@ -0,0 +1,152 @@
+/* Apache License, Version 2.0 */
+
+#ifndef __BLENDER_TESTING_BLI_KDOPBVH_TEST_UTIL_H__
+#define __BLENDER_TESTING_BLI_KDOPBVH_TEST_UTIL_H__
+
+/* Helpers shared by the BVH tree tests and performance tests.
+ * Leafs are points, the array of points is the user-data of the callbacks. */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_kdopbvh.h"
+#include "BLI_math_base.h"
+#include "BLI_math_vector.h"
+#include "BLI_rand.h"
+}
+
+inline void kdopbvh_test_nearest_callback(void *userdata,
+                                          int index,
+                                          const float co[3],
+                                          BVHTreeNearest *nearest)
+{
+  float(*points)[3] = (float(*)[3])userdata;
+  const float dist_sq = len_squared_v3v3(co, points[index]);
+
+  if (dist_sq < nearest->dist_sq) {
+    nearest->index = index;
+    nearest->dist_sq = dist_sq;
+    copy_v3_v3(nearest->co, points[index]);
+  }
+}
+
+inline void kdopbvh_test_raycast_callback(void *userdata,
+                                          int index,
+                                          const BVHTreeRay *ray,
+                                          BVHTreeRayHit *hit)
+{
+  float(*points)[3] = (float(*)[3])userdata;
+  float offset[3];
+
+  /* Treat each point as a small sphere (the ray direction is normalized). */
+  sub_v3_v3v3(offset, ray->origin, points[index]);
+  const float b = dot_v3v3(offset, ray->direction);
+  const float h = b * b - (len_squared_v3(offset) - 0.01f * 0.01f);
+  if (h < 0.0f) {
+    return;
+  }
+  const float dist = -b - sqrtf(h);
+  if (dist >= 0.0f && dist < hit->dist) {
+    hit->index = index;
+    hit->dist = dist;
+  }
+}
+
+/**
+ * Random points on the unit sphere, to be freed with #MEM_freeN.
+ */
+inline float (*kdopbvh_test_points_random(struct RNG *rng, const int points_len))[3]
+{
+  float(*points)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * points_len, __func__);
+  for (int i = 0; i < points_len; i++) {
+    BLI_rng_get_float_unit_v3(rng, points[i]);
+  }
+  return points;
+}
+
+inline BVHTree *kdopbvh_test_tree_from_points(const float (*points)[3],
+                                              const int points_len,
+                                              const float epsilon,
+                                              const char tree_type,
+                                              const char axis,
+                                              const eBVHTreeBuildMode build_mode)
+{
+  BVHTree *tree = BLI_bvhtree_new_ex(points_len, epsilon, tree_type, axis, build_mode);
+  for (int i = 0; i < points_len; i++) {
+    BLI_bvhtree_insert(tree, i, points[i], 1);
+  }
+  BLI_bvhtree_balance(tree);
+  return tree;
+}
+
+/**
+ * Queries following a helix around the unit sphere, aimed at its center.
+ * Consecutive queries are coherent (as is the case for mesh vertices),
+ * which is what the batched queries are optimized for.
+ */
+inline void kdopbvh_test_queries_path(const int queries_len,
+                                      const float turns,
+                                      const float scale,
+                                      float (**r_cos)[3],
+                                      float (**r_dirs)[3])
+{
+  float(*cos)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * queries_len, __func__);
+  float(*dirs)[3] = (float(*)[3])MEM_mallocN(sizeof(float[3]) * queries_len, __func__);
+
+  for (int i = 0; i < queries_len; i++) {
+    const float fac = (float)i / (float)queries_len;
+    cos[i][0] = sinf(fac * (float)M_PI * 2.0f * turns);
+    cos[i][1] = cosf(fac * (float)M_PI * 2.0f * turns);
+    cos[i][2] = fac * 2.0f - 1.0f;
+    negate_v3_v3(dirs[i], cos[i]);
+    normalize_v3(dirs[i]);
+    mul_v3_fl(cos[i], scale);
+  }
+
+  *r_cos = cos;
+  *r_dirs = dirs;
+}
+
+inline void kdopbvh_test_nearest_clear(BVHTreeNearest *nearest, const int nearest_len)
+{
+  for (int i = 0; i < nearest_len; i++) {
+    nearest[i].index = -1;
+    nearest[i].dist_sq = FLT_MAX;
+  }
+}
+
+inline void kdopbvh_test_hit_clear(BVHTreeRayHit *hit, const int hit_len)
+{
+  for (int i = 0; i < hit_len; i++) {
+    hit[i].index = -1;
+    hit[i].dist = BVH_RAYCAST_DIST_MAX;
+  }
+}
+
+/* Compare distances only, equally near leafs may be found in a different order. */
+
+inline void kdopbvh_test_nearest_expect_eq(const BVHTreeNearest *nearest_a,
+                                           const BVHTreeNearest *nearest_b,
+                                           const int nearest_len)
+{
+  for (int i = 0; i < nearest_len; i++) {
+    EXPECT_EQ(nearest_a[i].index != -1, nearest_b[i].index != -1);
+    EXPECT_FLOAT_EQ(nearest_a[i].dist_sq, nearest_b[i].dist_sq);
+  }
+}
+
+inline void kdopbvh_test_hit_expect_eq(const BVHTreeRayHit *hit_a,
+                                       const BVHTreeRayHit *hit_b,
+                                       const int hit_len)
+{
+  for (int i = 0; i < hit_len; i++) {
+    EXPECT_EQ(hit_a[i].index != -1, hit_b[i].index != -1);
+    if (hit_a[i].index != -1) {
+      EXPECT_FLOAT_EQ(hit_a[i].dist, hit_b[i].dist);
+    }
+  }
+}
+
+#endif /* __BLENDER_TESTING_BLI_KDOPBVH_TEST_UTIL_H__ */
@@ -296,3 +296,80 @@ TEST(task, ListBaseIter100k)
 {
   task_listbase_test("ListBase parallel iteration - Threaded - 100000 items", 100000, true);
 }
+
+/* *** Task pool contention: many tiny tasks, pushed from the main thread or spawned by tasks. *** */
+
+static void task_pool_tiny_func(TaskPool *__restrict pool,
+                                void *UNUSED(taskdata),
+                                int UNUSED(threadid))
+{
+  int *count = (int *)BLI_task_pool_userdata(pool);
+  atomic_sub_and_fetch_uint32((uint32_t *)count, 1);
+}
+
+static void task_pool_spawn_func(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+  const int num_children = POINTER_AS_INT(taskdata);
+  for (int i = 0; i < num_children; i++) {
+    BLI_task_pool_push_from_thread(
+        pool, task_pool_tiny_func, NULL, false, TASK_PRIORITY_HIGH, threadid);
+  }
+  task_pool_tiny_func(pool, NULL, threadid);
+}
+
+static void task_pool_contention_test_do(const char *id,
+                                         const int num_tasks,
+                                         const int num_children)
+{
+  printf("\n========== STARTING %s ==========\n", id);
+
+  BLI_threadapi_init();
+  TaskScheduler *scheduler = BLI_task_scheduler_get();
+
+  double averaged_timing = 0.0;
+  for (int i = 0; i < NUM_RUN_AVERAGED; i++) {
+    int count = num_tasks * (num_children + 1);
+    const double init_time = PIL_check_seconds_timer();
+
+    TaskPool *pool = BLI_task_pool_create(scheduler, &count);
+    for (int j = 0; j < num_tasks; j++) {
+      if (num_children == 0) {
+        BLI_task_pool_push(pool, task_pool_tiny_func, NULL, false, TASK_PRIORITY_LOW);
+      }
+      else {
+        BLI_task_pool_push(
+            pool, task_pool_spawn_func, POINTER_FROM_INT(num_children), false, TASK_PRIORITY_LOW);
+      }
+    }
+    BLI_task_pool_work_and_wait(pool);
+    BLI_task_pool_free(pool);
+
+    averaged_timing += PIL_check_seconds_timer() - init_time;
+
+    /* Every task must have been executed once, and only once. */
+    EXPECT_EQ(count, 0);
+  }
+
+  printf("\t%s: done in %fs on average over %d runs (%d threads)\n",
+         id,
+         averaged_timing / NUM_RUN_AVERAGED,
+         NUM_RUN_AVERAGED,
+         BLI_task_scheduler_num_threads(scheduler));
+
+  BLI_threadapi_exit();
+
+  printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(task, PoolContentionFlat100k)
+{
+  task_pool_contention_test_do("Task pool contention - Pushed from main thread - 100K tasks",
+                               100000,
+                               0);
+}
+
+TEST(task, PoolContentionSpawn100k)
+{
+  task_pool_contention_test_do(
+      "Task pool contention - Spawned from worker threads - 1K tasks x 100 children", 1000, 99);
+}
@@ -253,3 +253,48 @@ TEST(task, ListBaseIter)
   MEM_freeN(items_buffer);
   BLI_threadapi_exit();
 }
+
+/* *** Nested task pools. *** */
+
+#define NUM_NESTED_TASKS 64
+
+static void task_pool_nested_leaf_func(TaskPool *__restrict pool,
+                                       void *UNUSED(taskdata),
+                                       int UNUSED(threadid))
+{
+  int *count = (int *)BLI_task_pool_userdata(pool);
+  atomic_add_and_fetch_uint32((uint32_t *)count, 1);
+}
+
+static void task_pool_nested_func(TaskPool *__restrict pool, void *UNUSED(taskdata), int threadid)
+{
+  TaskScheduler *scheduler = (TaskScheduler *)BLI_task_pool_userdata(pool);
+  int count = 0;
+
+  /* Tasks of the nested pool go to the queue of this thread, idle threads steal them. */
+  TaskPool *nested_pool = BLI_task_pool_create(scheduler, &count);
+  for (int i = 0; i < NUM_NESTED_TASKS; i++) {
+    BLI_task_pool_push_from_thread(
+        nested_pool, task_pool_nested_leaf_func, NULL, false, TASK_PRIORITY_HIGH, threadid);
+  }
+  BLI_task_pool_work_and_wait(nested_pool);
+  BLI_task_pool_free(nested_pool);
+
+  EXPECT_EQ(count, NUM_NESTED_TASKS);
+}
+
+TEST(task, PoolNested)
+{
+  BLI_threadapi_init();
+  TaskScheduler *scheduler = BLI_task_scheduler_create(4);
+
+  TaskPool *pool = BLI_task_pool_create(scheduler, scheduler);
+  for (int i = 0; i < NUM_NESTED_TASKS; i++) {
+    BLI_task_pool_push(pool, task_pool_nested_func, NULL, false, TASK_PRIORITY_LOW);
+  }
+  BLI_task_pool_work_and_wait(pool);
+  BLI_task_pool_free(pool);
+
+  BLI_task_scheduler_free(scheduler);
+  BLI_threadapi_exit();
+}
@@ -17,7 +17,97 @@
  */
 #include "blendfile_loading_base_test.h"
 
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BKE_appdir.h"
+#include "BKE_context.h"
+#include "BKE_customdata.h"
+#include "BKE_global.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_material.h"
+#include "BKE_mesh.h"
+#include "BKE_node.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "BLI_ghash.h"
+#include "BLI_listbase.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+
+#include "BLO_blend_defs.h"
+#include "BLO_readfile.h"
+#include "BLO_undofile.h"
+#include "BLO_writefile.h"
+
+#include "DNA_material_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_node_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+#include "DNA_sdna_types.h"
+}
+
 class BlendfileLoadingTest : public BlendfileLoadingBaseTest {
+ protected:
+  /* Add a mesh with `totvert` vertices, located at (x, vertex index, 0). */
+  static Mesh *mesh_add_with_verts(Main *bmain, const char *name, const int totvert, const float x)
+  {
+    Mesh *me = BKE_mesh_add(bmain, name);
+    me->totvert = totvert;
+    CustomData_add_layer(&me->vdata, CD_MVERT, CD_CALLOC, NULL, totvert);
+    BKE_mesh_update_customdata_pointers(me, false);
+    for (int v = 0; v < totvert; v++) {
+      me->mvert[v].co[0] = x;
+      me->mvert[v].co[1] = (float)v;
+    }
+    return me;
+  }
+
+  static void temp_filepath_get(char *r_filepath, const char *filename)
+  {
+    BKE_tempdir_init(NULL);
+    BLI_join_dirfile(r_filepath, FILE_MAX, BKE_tempdir_session(), filename);
+  }
+
+  static std::vector<char> file_read(const char *filepath)
+  {
+    std::ifstream stream(filepath, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(stream),
+                             std::istreambuf_iterator<char>());
+  }
+
+  static void file_write(const char *filepath, const std::vector<char> &file_data)
+  {
+    std::ofstream stream(filepath, std::ios::binary | std::ios::trunc);
+    stream.write(file_data.data(), (std::streamsize)file_data.size());
+  }
+
+  /* Walk the blocks of an uncompressed file written by this build. */
+  static char *bhead_find_by_id_name(std::vector<char> &file_data, const char *id_name)
+  {
+    size_t offset = 12; /* Size of the file header. */
+    while (offset + sizeof(BHead) <= file_data.size()) {
+      BHead *bhead = (BHead *)&file_data[offset];
+      if (bhead->code == ENDB) {
+        break;
+      }
+      const char *data = (const char *)(bhead + 1);
+      if (bhead->len >= (int)sizeof(ID) && bhead->code != DATA &&
+          STREQ(data + offsetof(ID, name), id_name)) {
+        return (char *)bhead;
+      }
+      offset += sizeof(BHead) + (size_t)bhead->len;
+    }
+    return nullptr;
+  }
 };
 
 TEST_F(BlendfileLoadingTest, CanaryTest)
@@ -29,3 +119,329 @@ TEST_F(BlendfileLoadingTest, CanaryTest)
   depsgraph_create(DAG_EVAL_RENDER);
   EXPECT_NE(nullptr, this->depsgraph);
 }
+
+TEST_F(BlendfileLoadingTest, WriteReadRoundTrip)
+{
+  /* Large enough to be split into multiple compressed frames,
+   * reading mesh data exercises seeking within the file. */
+  const int totvert = 1 << 18;
+
+  Main *bmain = BKE_main_new();
+  mesh_add_with_verts(bmain, "MERoundTrip", totvert, 7.0f);
+
+  char filepath[FILE_MAX];
+  temp_filepath_get(filepath, "round_trip_test.blend");
+
+  const int write_flags[] = {0, G_FILE_COMPRESS, G_FILE_COMPRESS | G_FILE_COMPRESS_ZSTD};
+  for (const int flag : write_flags) {
+    SCOPED_TRACE(flag ? ((flag & G_FILE_COMPRESS_ZSTD) ? "zstd" : "gzip") : "uncompressed");
+
+    EXPECT_TRUE(BLO_write_file(bmain, filepath, flag, NULL, NULL));
+
+    bfile = BLO_read_from_file(filepath, BLO_READ_SKIP_NONE, NULL);
+    ASSERT_NE(nullptr, bfile);
+
+    Mesh *me_read = static_cast<Mesh *>(bfile->main->meshes.first);
+    ASSERT_NE(nullptr, me_read);
+    EXPECT_STREQ("MERoundTrip", me_read->id.name + 2);
+    ASSERT_EQ(totvert, me_read->totvert);
+    for (int i = 0; i < totvert; i++) {
+      if (me_read->mvert[i].co[0] != 7.0f || me_read->mvert[i].co[1] != (float)i) {
+        ADD_FAILURE() << "Vertex " << i << " differs after reading";
+        break;
+      }
+    }
+
+    blendfile_free();
+  }
+
+  BKE_main_free(bmain);
+}
+
+TEST_F(BlendfileLoadingTest, ReadMeshesInTasks)
+{
+  /* Mesh data is read in tasks and meshes are lib-linked in parallel,
+   * user counts of the shared material must still be exact. */
+  const int tot_meshes = 256;
+
+  Main *bmain = BKE_main_new();
+  Material *ma = BKE_material_add(bmain, "MAShared");
+  for (int i = 0; i < tot_meshes; i++) {
+    char name[MAX_ID_NAME - 2];
+    BLI_snprintf(name, sizeof(name), "METask%03d", i);
+    Mesh *me = mesh_add_with_verts(bmain, name, i + 1, (float)i);
+    me->mat = static_cast<Material **>(MEM_callocN(sizeof(*me->mat), __func__));
+    me->mat[0] = ma;
+    me->totcol = 1;
+    id_us_plus(&ma->id);
+  }
+
+  char filepath[FILE_MAX];
+  temp_filepath_get(filepath, "tasks_test.blend");
+
+  EXPECT_TRUE(BLO_write_file(bmain, filepath, 0, NULL, NULL));
+  BKE_main_free(bmain);
+
+  bfile = BLO_read_from_file(filepath, BLO_READ_SKIP_NONE, NULL);
+  ASSERT_NE(nullptr, bfile);
+  ASSERT_EQ(tot_meshes, BLI_listbase_count(&bfile->main->meshes));
+
+  Material *ma_read = static_cast<Material *>(bfile->main->materials.first);
+  ASSERT_NE(nullptr, ma_read);
+  EXPECT_EQ(tot_meshes, ma_read->id.us);
+
+  int i = 0;
+  LISTBASE_FOREACH (Mesh *, me, &bfile->main->meshes) {
+    char name[MAX_ID_NAME - 2];
+    BLI_snprintf(name, sizeof(name), "METask%03d", i);
+    EXPECT_STREQ(name, me->id.name + 2);
+    ASSERT_EQ(i + 1, me->totvert);
+    ASSERT_EQ(1, me->totcol);
+    EXPECT_EQ(ma_read, me->mat[0]);
+    EXPECT_EQ((float)i, me->mvert[i].co[0]);
+    EXPECT_EQ((float)i, me->mvert[i].co[1]);
+    EXPECT_EQ(0, me->id.tag & LIB_TAG_NEED_LINK);
+    i++;
+  }
+
+  blendfile_free();
+}
+
+TEST_F(BlendfileLoadingTest, MemfileUndoSharesChunks)
+{
+  /* Adding an ID in front of all others moves the data of every other ID,
+   * their chunks must still be shared with the previous step. */
+  const int tot_meshes = 16;
+  const int totvert = 4096;
+
+  Main *bmain = BKE_main_new();
+  for (int i = 0; i < tot_meshes; i++) {
+    char name[MAX_ID_NAME - 2];
+    BLI_snprintf(name, sizeof(name), "MEUndo%02d", i);
+    Mesh *me = mesh_add_with_verts(bmain, name, totvert, (float)i);
+    id_fake_user_set(&me->id);
+  }
+
+  MemFile memfile_a = {{NULL}};
+  MemFile memfile_b = {{NULL}};
+  EXPECT_TRUE(BLO_write_file_mem(bmain, NULL, &memfile_a, 0));
+  EXPECT_EQ(0, memfile_a.size_shared);
+
+  Mesh *me_first = BKE_mesh_add(bmain, "MEFirst");
+  id_fake_user_set(&me_first->id);
+  EXPECT_TRUE(BLO_write_file_mem(bmain, &memfile_a, &memfile_b, 0));
+
+  EXPECT_LT(memfile_b.size * 4, memfile_a.size);
+  EXPECT_LT(memfile_a.size, memfile_b.size + memfile_b.size_shared);
+
+  /* Freeing the first step leaves all data to the second one. */
+  const size_t size_total = memfile_b.size + memfile_b.size_shared;
+  BLO_memfile_merge(&memfile_a, &memfile_b);
+  EXPECT_EQ(size_total, memfile_b.size + memfile_b.size_shared);
+  EXPECT_LT(memfile_b.size_shared * 4, memfile_b.size);
+  BLO_memfile_free(&memfile_b);
+
+  BKE_main_free(bmain);
+}
+
+TEST_F(BlendfileLoadingTest, MemfileUndoIdenticalIDs)
+{
+  /* Only the modified mesh must be detected as changed between two undo steps. */
+  const int tot_meshes = 8;
+  const int totvert = 1024;
+
+  Main *bmain = BKE_main_new();
+  Mesh *me_changed = NULL;
+  for (int i = 0; i < tot_meshes; i++) {
+    char name[MAX_ID_NAME - 2];
+    BLI_snprintf(name, sizeof(name), "MEIdentical%d", i);
+    Mesh *me = mesh_add_with_verts(bmain, name, totvert, 0.0f);
+    id_fake_user_set(&me->id);
+    if (i == tot_meshes / 2) {
+      me_changed = me;
+    }
+  }
+
+  MemFile memfile_a = {{NULL}};
+  MemFile memfile_b = {{NULL}};
+  EXPECT_TRUE(BLO_write_file_mem(bmain, NULL, &memfile_a, 0));
+  me_changed->mvert[totvert / 2].co[2] = 1.0f;
+  EXPECT_TRUE(BLO_write_file_mem(bmain, &memfile_a, &memfile_b, 0));
+
+  bool ids_removed = true;
+  GSet *identical_ids = BLO_memfile_identical_ids(&memfile_b, &memfile_a, &ids_removed);
+  ASSERT_NE(nullptr, identical_ids);
+  EXPECT_FALSE(ids_removed);
+  LISTBASE_FOREACH (Mesh *, me, &bmain->meshes) {
+    EXPECT_EQ(me != me_changed, BLI_gset_haskey(identical_ids, me));
+  }
+  BLI_gset_free(identical_ids, NULL);
+
+  BLO_memfile_free(&memfile_b);
+  BLO_memfile_free(&memfile_a);
+
+  BKE_main_free(bmain);
+}
+
+TEST_F(BlendfileLoadingTest, MemfileUndoReusesUnchangedIDs)
+{
+  /* Undoing a change of one mesh must keep the other meshes as they are in memory,
+   * and read the changed mesh again at its current address. */
+  const int tot_meshes = 8;
+  const int totvert = 1024;
+
+  Main *bmain = BKE_main_new();
+  Mesh *meshes[tot_meshes];
+  for (int i = 0; i < tot_meshes; i++) {
+    char name[MAX_ID_NAME - 2];
+    BLI_snprintf(name, sizeof(name), "MEReuse%d", i);
+    meshes[i] = mesh_add_with_verts(bmain, name, totvert, (float)i);
+    id_fake_user_set(&meshes[i]->id);
+  }
+  Mesh *me_changed = meshes[tot_meshes / 2];
+  const MVert *mvert_unchanged = meshes[0]->mvert;
+  /* Runtime tags of reused IDs are kept. */
+  meshes[0]->id.tag |= LIB_TAG_DOIT;
+
+  MemFile memfile_undo = {{NULL}};
+  MemFile memfile_current = {{NULL}};
+  EXPECT_TRUE(BLO_write_file_mem(bmain, NULL, &memfile_undo, 0));
+  me_changed->mvert[0].co[2] = 1.0f;
+  EXPECT_TRUE(BLO_write_file_mem(bmain, &memfile_undo, &memfile_current, 0));
+
+  BlendFileData *bfd = BLO_read_from_memfile(
+      bmain, "", &memfile_undo, &memfile_current, BLO_READ_SKIP_NONE, NULL);
+  ASSERT_NE(nullptr, bfd);
+  ASSERT_EQ(tot_meshes, BLI_listbase_count(&bfd->main->meshes));
+
+  int i = 0;
+  LISTBASE_FOREACH (Mesh *, me, &bfd->main->meshes) {
+    EXPECT_EQ(meshes[i], me);
+    EXPECT_EQ(me != me_changed, (me->id.tag & LIB_TAG_UNDO_OLD_ID_REUSED) != 0);
+    ASSERT_EQ(totvert, me->totvert);
+    EXPECT_EQ((float)i, me->mvert[0].co[0]);
+    EXPECT_EQ(0.0f, me->mvert[0].co[2]);
+    i++;
+  }
+  EXPECT_EQ(mvert_unchanged, meshes[0]->mvert);
+  EXPECT_TRUE(meshes[0]->id.tag & LIB_TAG_DOIT);
+
+  BLO_blendfiledata_free(bfd);
+  BLO_memfile_free(&memfile_current);
+  BLO_memfile_free(&memfile_undo);
+  BKE_main_free(bmain);
+}
+
+TEST_F(BlendfileLoadingTest, MemfileUndoRestoresSelfReferences)
+{
+  /* A changed scene is read again at its address, references of the scene to itself
+   * (from its embedded compositing node tree) must follow the contents being swapped. */
+  Main *bmain = BKE_main_new();
+  Scene *scene = BKE_scene_add(bmain, "SCUndo");
+  scene->nodetree = ntreeAddTree(NULL, "Compositing Nodetree", "CompositorNodeTree");
+  /* The render layers node uses the scene of the context. Added by name, its poll only accepts
+   * node trees of scenes in G.main. */
+  bContext *C = CTX_create();
+  CTX_data_main_set(C, bmain);
+  CTX_data_scene_set(C, scene);
+  bNode *node = nodeAddNode(C, scene->nodetree, "CompositorNodeRLayers");
+  CTX_free(C);
+  ASSERT_EQ(&scene->id, node->id);
+
+  MemFile memfile_undo = {{NULL}};
+  MemFile memfile_current = {{NULL}};
+  EXPECT_TRUE(BLO_write_file_mem(bmain, NULL, &memfile_undo, 0));
+  scene->r.cfra = 42;
+  EXPECT_TRUE(BLO_write_file_mem(bmain, &memfile_undo, &memfile_current, 0));
+
+  BlendFileData *bfd = BLO_read_from_memfile(
+      bmain, "", &memfile_undo, &memfile_current, BLO_READ_SKIP_NONE, NULL);
+  ASSERT_NE(nullptr, bfd);
+
+  Scene *scene_read = static_cast<Scene *>(bfd->main->scenes.first);
+  EXPECT_EQ(scene, scene_read);
+  EXPECT_EQ(1, scene_read->r.cfra);
+  ASSERT_NE(nullptr, scene_read->nodetree);
+  bNode *node_read = static_cast<bNode *>(scene_read->nodetree->nodes.first);
+  ASSERT_NE(nullptr, node_read);
+  EXPECT_EQ(&scene_read->id, node_read->id);
+
+  /* The old contents are left in the old main, to be freed. */
+  Scene *scene_old = static_cast<Scene *>(bmain->scenes.first);
+  ASSERT_NE(nullptr, scene_old);
+  EXPECT_NE(scene_read, scene_old);
+  EXPECT_EQ(42, scene_old->r.cfra);
+  bNode *node_old = static_cast<bNode *>(scene_old->nodetree->nodes.first);
+  EXPECT_EQ(&scene_old->id, node_old->id);
+
+  BLO_blendfiledata_free(bfd);
+  BLO_memfile_free(&memfile_current);
+  BLO_memfile_free(&memfile_undo);
+  BKE_main_free(bmain);
+}
+
+TEST_F(BlendfileLoadingTest, LinkNamedPart)
+{
+  /* Linking a single object should only read that object and its dependencies,
+   * using the block index of the library when available. */
+  const int tot_objects = 64;
+  const int totvert = 1024;
+
+  Main *bmain = BKE_main_new();
+  for (int i = 0; i < tot_objects; i++) {
+    char name[MAX_ID_NAME - 2];
+    BLI_snprintf(name, sizeof(name), "MELink%d", i);
+    Mesh *me = mesh_add_with_verts(bmain, name, totvert, (float)i);
+
+    BLI_snprintf(name, sizeof(name), "OBLink%d", i);
+    Object *ob = BKE_object_add_only_object(bmain, OB_MESH, name);
+    ob->data = me;
+    id_us_plus(&me->id);
+    /* Objects without users are not written. */
+    id_fake_user_set(&ob->id);
+  }
+
+  char filepath[FILE_MAX];
+  temp_filepath_get(filepath, "link_test.blend");
+
+  EXPECT_TRUE(BLO_write_file(bmain, filepath, 0, NULL, NULL));
+  BKE_main_free(bmain);
+
+  /* Skipping over the first object runs into the end of the file when scanning the file,
+   * so the object can only be found using the index. */
+  std::vector<char> file_data = file_read(filepath);
+  char *bhead_first = bhead_find_by_id_name(file_data, "OBOBLink0");
+  ASSERT_NE(nullptr, bhead_first);
+  ((BHead *)bhead_first)->len = (int)file_data.size();
+  file_write(filepath, file_data);
+
+  Main *bmain_dst = BKE_main_new();
+  BlendHandle *bh = BLO_blendhandle_from_file(filepath, NULL);
+  ASSERT_NE(nullptr, bh);
+  Main *mainl = BLO_library_link_begin(bmain_dst, &bh, filepath);
+  ID *id = BLO_library_link_named_part(mainl, &bh, ID_OB, "OBLink42");
+  EXPECT_EQ(nullptr, BLO_library_link_named_part(mainl, &bh, ID_OB, "OBMissing"));
+  BLO_library_link_end(mainl, &bh, 0, bmain_dst, NULL, NULL, NULL);
+  BLO_blendhandle_close(bh);
+
+  ASSERT_NE(nullptr, id);
+  EXPECT_EQ(1, BLI_listbase_count(&bmain_dst->objects));
+  EXPECT_EQ(1, BLI_listbase_count(&bmain_dst->meshes));
+
+  Object *ob = (Object *)id;
+  Mesh *me = static_cast<Mesh *>(ob->data);
+  ASSERT_NE(nullptr, me);
+  EXPECT_STREQ("MELink42", me->id.name + 2);
+  ASSERT_EQ(totvert, me->totvert);
+  EXPECT_EQ(42.0f, me->mvert[0].co[0]);
+  EXPECT_EQ((float)(totvert - 1), me->mvert[totvert - 1].co[1]);
+
+  BKE_main_free(bmain_dst);
+
+  /* Without the index (its footer is the last thing before #ENDB) the file can't be read. */
+  const size_t magic_offset = file_data.size() - sizeof(BHead) - 8;
+  ASSERT_EQ(0, memcmp(&file_data[magic_offset], "BLENIDX1", 8));
+  file_data[magic_offset] = 'X';
+  file_write(filepath, file_data);
+  EXPECT_EQ(nullptr, BLO_blendhandle_from_file(filepath, NULL));
+}
@@ -0,0 +1,176 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "blenkernel_base_test.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "COM_compositor.h"
+
+extern "C" {
+#include "BKE_global.h"
+#include "BKE_image.h"
+#include "BKE_node.h"
+
+#include "DNA_image_types.h"
+#include "DNA_node_types.h"
+#include "DNA_scene_types.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+}
+
+/* Chunks of an execution group are scheduled as soon as the chunks of the groups they read
+ * are done. However the image is split into chunks and however many threads execute them, the
+ * result has to be the same.
+ *
+ * The tree is image -> blur -> glare -> viewer. The glare is a single threaded operation, so its
+ * only chunk waits for all chunks of the blur, and all chunks of the viewer wait for it. */
+class ExecutionSystemTest : public BlenkernelBaseTest {
+ protected:
+  bNodeTree *ntree = nullptr;
+  bNode *viewer = nullptr;
+
+  static void TearDownTestCase()
+  {
+    COM_deinitialize();
+    BlenkernelBaseTest::TearDownTestCase();
+  }
+
+  static int test_break(void * /*handle*/)
+  {
+    return 0;
+  }
+  static void progress(void * /*handle*/, float /*progress*/)
+  {
+  }
+  static void stats_draw(void * /*handle*/, const char * /*str*/)
+  {
+  }
+
+  bNode *node_add(const int type, bNode *from_node)
+  {
+    bNode *node = nodeAddStaticNode(nullptr, ntree, type);
+    if (from_node != nullptr) {
+      nodeAddLink(ntree,
+                  from_node,
+                  static_cast<bNodeSocket *>(from_node->outputs.first),
+                  node,
+                  static_cast<bNodeSocket *>(node->inputs.first));
+    }
+    return node;
+  }
+
+  /* Image sizes that don't divide into chunks evenly. */
+  void tree_create()
+  {
+    scene_create();
+    ntree = ntreeAddTree(nullptr, "Compositing Nodetree", "CompositorNodeTree");
+    scene->nodetree = ntree;
+    scene->use_nodes = true;
+
+    const float color[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+    bNode *image = node_add(CMP_NODE_IMAGE, nullptr);
+    Image *ima = BKE_image_add_generated(
+        bmain, 301, 203, "IMGrid", 32, true, IMA_GENTYPE_GRID_COLOR, color, false, false, false);
+    image->id = &ima->id;
+
+    bNode *blur = node_add(CMP_NODE_BLUR, image);
+    NodeBlurData *blur_data = static_cast<NodeBlurData *>(blur->storage);
+    blur_data->sizex = 10;
+    blur_data->sizey = 10;
+
+    bNode *glare = node_add(CMP_NODE_GLARE, blur);
+    static_cast<NodeGlare *>(glare->storage)->threshold = 0.5f;
+
+    viewer = node_add(CMP_NODE_VIEWER, glare);
+    viewer->flag |= NODE_DO_OUTPUT | NODE_DO_OUTPUT_RECALC;
+    /* As set by the node editor showing the top level of the tree. */
+    ntree->active_viewer_key = NODE_INSTANCE_KEY_BASE;
+
+    ntree->test_break = test_break;
+    ntree->progress = progress;
+    ntree->stats_draw = stats_draw;
+    ntreeUpdateTree(bmain, ntree);
+  }
+
+  /* Executes the tree and returns a copy of the viewer image, to be freed with #MEM_freeN. */
+  float *execute(const int chunksize, const int threads, size_t *r_len)
+  {
+    ntree->chunksize = chunksize;
+    scene->r.mode |= R_FIXED_THREADS;
+    scene->r.threads = threads;
+
+    /* Nothing may be read from the results of the previous execution. */
+    COM_clearCaches();
+    /* Viewers have no output in background mode. */
+    G.background = false;
+    COM_execute(&scene->r,
+                scene,
+                ntree,
+                false,
+                &scene->view_settings,
+                &scene->display_settings,
+                "");
+    G.background = true;
+
+    void *lock;
+    ImBuf *ibuf = BKE_image_acquire_ibuf(
+        reinterpret_cast<Image *>(viewer->id), static_cast<ImageUser *>(viewer->storage), &lock);
+    EXPECT_NE(ibuf, nullptr);
+    EXPECT_NE(ibuf->rect_float, nullptr);
+    EXPECT_EQ(ibuf->x, 301);
+    EXPECT_EQ(ibuf->y, 203);
+    *r_len = sizeof(float[4]) * (size_t)ibuf->x * (size_t)ibuf->y;
+    float *result = static_cast<float *>(MEM_dupallocN(ibuf->rect_float));
+    BKE_image_release_ibuf(reinterpret_cast<Image *>(viewer->id), ibuf, lock);
+    return result;
+  }
+
+  void expect_same_result(const int chunksize, const int threads)
+  {
+    size_t expected_len, result_len;
+    /* A single chunk executed on a single thread. */
+    float *expected = execute(512, 1, &expected_len);
+    float *result = execute(chunksize, threads, &result_len);
+
+    ASSERT_EQ(result_len, expected_len);
+    /* The grid was blurred into the viewer, not left black. */
+    const float *pixel = &expected[4 * (101 * 301 + 150)];
+    EXPECT_GT(pixel[0] + pixel[1] + pixel[2], 0.0f);
+    EXPECT_EQ(memcmp(result, expected, result_len), 0);
+
+    MEM_freeN(expected);
+    MEM_freeN(result);
+  }
+};
+
+TEST_F(ExecutionSystemTest, SingleThreadChunks)
+{
+  tree_create();
+  expect_same_result(32, 1);
+}
+
+TEST_F(ExecutionSystemTest, MultiThreadChunks)
+{
+  tree_create();
+  expect_same_result(32, 4);
+}
+
+TEST_F(ExecutionSystemTest, MultiThreadLargeChunks)
+{
+  tree_create();
+  expect_same_result(256, 4);
+}
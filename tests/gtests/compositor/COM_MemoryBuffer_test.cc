@@ -0,0 +1,113 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include "COM_MemoryBuffer.h"
+
+/* Buffers of deleted MemoryBuffers are pooled for MemoryBuffers of the same size, up to
+ * #COM_BUFFER_POOL_MAX_BUFFER_SIZE per buffer and #COM_BUFFER_POOL_MAX_SIZE in total. */
+class MemoryBufferPoolTest : public testing::Test {
+ protected:
+  virtual void SetUp()
+  {
+    MemoryBuffer::clearBufferPool();
+  }
+
+  virtual void TearDown()
+  {
+    MemoryBuffer::clearBufferPool();
+  }
+
+  /* A temporary color buffer of width * height pixels. */
+  static MemoryBuffer *buffer_create(const int width, const int height)
+  {
+    rcti rect;
+    BLI_rcti_init(&rect, 0, width, 0, height);
+    return new MemoryBuffer(COM_DT_COLOR, &rect);
+  }
+
+  /* Width of a row of color pixels of size bytes. */
+  static int buffer_width(const size_t size)
+  {
+    return (int)(size / (sizeof(float) * COM_NUM_CHANNELS_COLOR));
+  }
+};
+
+TEST_F(MemoryBufferPoolTest, ReuseSameSize)
+{
+  MemoryBuffer *buffer = buffer_create(64, 64);
+  float *data = buffer->getBuffer();
+  delete buffer;
+  EXPECT_EQ(MemoryBuffer::getBufferPoolSize(), sizeof(float[4]) * 64 * 64);
+
+  /* Other dimensions, same number of pixels. */
+  buffer = buffer_create(32, 128);
+  EXPECT_EQ(buffer->getBuffer(), data);
+  EXPECT_EQ(MemoryBuffer::getBufferPoolSize(), 0);
+  delete buffer;
+}
+
+TEST_F(MemoryBufferPoolTest, OtherSizeNotReused)
+{
+  MemoryBuffer *buffer = buffer_create(64, 64);
+  delete buffer;
+
+  buffer = buffer_create(64, 63);
+  EXPECT_EQ(MemoryBuffer::getBufferPoolSize(), sizeof(float[4]) * 64 * 64);
+  delete buffer;
+  EXPECT_EQ(MemoryBuffer::getBufferPoolSize(), sizeof(float[4]) * 64 * (64 + 63));
+}
+
+TEST_F(MemoryBufferPoolTest, MaxBufferSize)
+{
+  const int width = buffer_width(COM_BUFFER_POOL_MAX_BUFFER_SIZE);
+
+  /* One row more is too large to keep. */
+  delete buffer_create(width, 2);
+  EXPECT_EQ(MemoryBuffer::getBufferPoolSize(), 0);
+
+  delete buffer_create(width, 1);
+  EXPECT_EQ(MemoryBuffer::getBufferPoolSize(), COM_BUFFER_POOL_MAX_BUFFER_SIZE);
+}
+
+TEST_F(MemoryBufferPoolTest, MaxSize)
+{
+  const int width = buffer_width(COM_BUFFER_POOL_MAX_BUFFER_SIZE);
+  const int buffers_len = COM_BUFFER_POOL_MAX_SIZE / COM_BUFFER_POOL_MAX_BUFFER_SIZE + 1;
+  MemoryBuffer *buffers[buffers_len];
+
+  for (int i = 0; i < buffers_len; i++) {
+    buffers[i] = buffer_create(width, 1);
+  }
+  for (int i = 0; i < buffers_len; i++) {
+    delete buffers[i];
+  }
+  EXPECT_EQ(MemoryBuffer::getBufferPoolSize(), COM_BUFFER_POOL_MAX_SIZE);
+
+  /* A full pool doesn't take small buffers either. */
+  delete buffer_create(1, 1);
+  EXPECT_EQ(MemoryBuffer::getBufferPoolSize(), COM_BUFFER_POOL_MAX_SIZE);
+}
+
+TEST_F(MemoryBufferPoolTest, Clear)
+{
+  delete buffer_create(64, 64);
+  delete buffer_create(32, 32);
+  EXPECT_GT(MemoryBuffer::getBufferPoolSize(), 0);
+
+  MemoryBuffer::clearBufferPool();
+  EXPECT_EQ(MemoryBuffer::getBufferPoolSize(), 0);
+}
@@ -0,0 +1,320 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "blenkernel_base_test.h"
+
+#include <set>
+#include <string>
+
+#include "intern/depsgraph.h"
+#include "intern/depsgraph_relation.h"
+#include "intern/node/deg_node_component.h"
+#include "intern/node/deg_node_id.h"
+#include "intern/node/deg_node_operation.h"
+#include "intern/node/deg_node_time.h"
+
+extern "C" {
+#include "BKE_collection.h"
+#include "BKE_constraint.h"
+#include "BKE_effect.h"
+#include "BKE_modifier.h"
+#include "BKE_object.h"
+#include "BKE_particle.h"
+#include "BKE_scene.h"
+
+#include "BLI_listbase.h"
+
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_debug.h"
+#include "DEG_depsgraph_query.h"
+
+#include "DNA_constraint_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_force_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+}
+
+/* Relations of objects tagged with DEG_relations_tag_update_id() are updated in the existing
+ * graph, which then has to be the same as a graph built from scratch: the same ID nodes,
+ * components, operations and relations. Objects which can't be updated that way are to make
+ * the graph be built from scratch. */
+
+typedef std::set<std::string> DepsgraphDescription;
+
+static std::string operation_describe(const DEG::OperationNode *op_node)
+{
+  return op_node->full_identifier() + "#" + std::to_string(op_node->name_tag);
+}
+
+static std::string node_describe(const DEG::Node *node)
+{
+  if (node->type == DEG::NodeType::OPERATION) {
+    return operation_describe(static_cast<const DEG::OperationNode *>(node));
+  }
+  return node->identifier();
+}
+
+/* All nodes and relations of the graph. A relation may be added more than once by a build from
+ * scratch (e.g. to the final transform of a constraint target), updates add it once. */
+static void depsgraph_describe(const Depsgraph *graph,
+                               DepsgraphDescription *r_nodes,
+                               DepsgraphDescription *r_relations)
+{
+  const DEG::Depsgraph *deg_graph = reinterpret_cast<const DEG::Depsgraph *>(graph);
+
+  for (const DEG::IDNode *id_node : deg_graph->id_nodes) {
+    r_nodes->insert(std::string(id_node->id_orig->name) +
+                    " linked_state: " + std::to_string(id_node->linked_state) +
+                    " is_directly_visible: " + std::to_string(id_node->is_directly_visible) +
+                    " has_base: " + std::to_string(id_node->has_base));
+
+    GHASH_FOREACH_BEGIN (const DEG::ComponentNode *, comp_node, id_node->components) {
+      r_nodes->insert(comp_node->identifier());
+      for (const DEG::OperationNode *op_node : comp_node->operations) {
+        r_nodes->insert(operation_describe(op_node));
+        for (const DEG::Relation *rel : op_node->inlinks) {
+          r_relations->insert(node_describe(rel->from) + " -> " + node_describe(rel->to) + " (" +
+                              rel->name + ") flag: " + std::to_string(rel->flag));
+        }
+      }
+    }
+    GHASH_FOREACH_END();
+  }
+}
+
+static void description_expect_eq(const DepsgraphDescription &description,
+                                  const DepsgraphDescription &description_full,
+                                  const char *what)
+{
+  DepsgraphDescription::const_iterator it = description.begin();
+  DepsgraphDescription::const_iterator it_full = description_full.begin();
+
+  while (it != description.end() || it_full != description_full.end()) {
+    if (it_full == description_full.end() || (it != description.end() && *it < *it_full)) {
+      ADD_FAILURE() << "Not in the graph built from scratch: " << what << " " << *it;
+      ++it;
+    }
+    else if (it == description.end() || *it_full < *it) {
+      ADD_FAILURE() << "Missing: " << what << " " << *it_full;
+      ++it_full;
+    }
+    else {
+      ++it;
+      ++it_full;
+    }
+  }
+}
+
+class DepsgraphBuildIncrementalTest : public BlenkernelBaseTest {
+ protected:
+  Object *ob_mesh = nullptr;
+  Object *ob_a = nullptr;
+  Object *ob_b = nullptr;
+
+  virtual void SetUp()
+  {
+    BlenkernelBaseTest::SetUp();
+    scene_create();
+    ob_mesh = object_add(OB_MESH, "OBMesh", mesh_grid_add("MEGrid", 4, 4));
+    ob_a = object_add(OB_EMPTY, "OBA", nullptr);
+    ob_b = object_add(OB_EMPTY, "OBB", nullptr);
+  }
+
+  void builds_len(int *r_full_len, int *r_incremental_len)
+  {
+    DEG_stats_relations_build(depsgraph, r_full_len, nullptr, r_incremental_len, nullptr);
+  }
+
+  void expect_eq_full_build()
+  {
+    ViewLayer *view_layer = static_cast<ViewLayer *>(scene->view_layers.first);
+    Depsgraph *depsgraph_full = DEG_graph_new(
+        bmain, scene, view_layer, DEG_get_mode(depsgraph));
+    DEG_graph_build_from_view_layer(depsgraph_full, bmain, scene, view_layer);
+
+    DepsgraphDescription nodes, relations, nodes_full, relations_full;
+    depsgraph_describe(depsgraph, &nodes, &relations);
+    depsgraph_describe(depsgraph_full, &nodes_full, &relations_full);
+    description_expect_eq(nodes, nodes_full, "node");
+    description_expect_eq(relations, relations_full, "relation");
+
+    DEG_graph_free(depsgraph_full);
+  }
+
+  /* Tags relations of the ID for update and evaluates the graph, which is updated in place
+   * when \a expect_incremental and built from scratch otherwise. */
+  void relations_update(ID *id, const bool expect_incremental)
+  {
+    int full_len, incremental_len;
+    builds_len(&full_len, &incremental_len);
+
+    DEG_relations_tag_update_id(bmain, id);
+    depsgraph_update();
+
+    int full_len_new, incremental_len_new;
+    builds_len(&full_len_new, &incremental_len_new);
+    EXPECT_EQ(full_len_new, expect_incremental ? full_len : full_len + 1) << id->name;
+    EXPECT_EQ(incremental_len_new, expect_incremental ? incremental_len + 1 : incremental_len)
+        << id->name;
+
+    expect_eq_full_build();
+  }
+
+  bConstraint *constraint_copy_location_add(Object *ob, Object *target)
+  {
+    bConstraint *con = BKE_constraint_add_for_object(ob, "Copy Location", CONSTRAINT_TYPE_LOCLIKE);
+    static_cast<bLocateLikeConstraint *>(con->data)->tar = target;
+    return con;
+  }
+};
+
+TEST_F(DepsgraphBuildIncrementalTest, ModifierAddRemove)
+{
+  depsgraph_create(DAG_EVAL_VIEWPORT);
+
+  ArrayModifierData *amd = reinterpret_cast<ArrayModifierData *>(
+      modifier_new(eModifierType_Array));
+  amd->offset_type |= MOD_ARR_OFF_OBJ;
+  amd->offset_ob = ob_a;
+  BLI_addtail(&ob_mesh->modifiers, amd);
+  relations_update(&ob_mesh->id, true);
+
+  ModifierData *md = modifier_new(eModifierType_Subsurf);
+  BLI_addtail(&ob_mesh->modifiers, md);
+  relations_update(&ob_mesh->id, true);
+
+  BLI_remlink(&ob_mesh->modifiers, amd);
+  modifier_free(&amd->modifier);
+  relations_update(&ob_mesh->id, true);
+
+  BLI_remlink(&ob_mesh->modifiers, md);
+  modifier_free(md);
+  relations_update(&ob_mesh->id, true);
+}
+
+TEST_F(DepsgraphBuildIncrementalTest, ConstraintAddRemove)
+{
+  depsgraph_create(DAG_EVAL_VIEWPORT);
+
+  bConstraint *con_mesh = constraint_copy_location_add(ob_mesh, ob_a);
+  relations_update(&ob_mesh->id, true);
+
+  /* The relations of the mesh object to OBA are built again along with the ones of OBA. */
+  bConstraint *con_a = constraint_copy_location_add(ob_a, ob_b);
+  relations_update(&ob_a->id, true);
+
+  BKE_constraint_remove(&ob_a->constraints, con_a);
+  relations_update(&ob_a->id, true);
+
+  BKE_constraint_remove(&ob_mesh->constraints, con_mesh);
+  relations_update(&ob_mesh->id, true);
+}
+
+TEST_F(DepsgraphBuildIncrementalTest, ParentRelink)
+{
+  depsgraph_create(DAG_EVAL_VIEWPORT);
+
+  ob_mesh->parent = ob_a;
+  relations_update(&ob_mesh->id, true);
+
+  ob_mesh->parent = ob_b;
+  relations_update(&ob_mesh->id, true);
+
+  /* The child's relations to its parent are built again along with the parent's. */
+  ob_b->parent = ob_a;
+  relations_update(&ob_b->id, true);
+
+  ob_mesh->parent = nullptr;
+  relations_update(&ob_mesh->id, true);
+
+  ob_b->parent = nullptr;
+  relations_update(&ob_b->id, true);
+}
+
+TEST_F(DepsgraphBuildIncrementalTest, FallbackPhysics)
+{
+  /* A collider and a force field, set up as when adding them in the interface. */
+  BLI_addtail(&ob_mesh->modifiers, modifier_new(eModifierType_Collision));
+  ob_mesh->pd = BKE_partdeflect_new(0);
+  ob_mesh->pd->deflect = 1;
+  ob_a->pd = BKE_partdeflect_new(PFIELD_FORCE);
+  Object *ob_c = object_add(OB_EMPTY, "OBC", nullptr);
+  depsgraph_create(DAG_EVAL_VIEWPORT);
+
+  constraint_copy_location_add(ob_mesh, ob_b);
+  relations_update(&ob_mesh->id, false);
+
+  constraint_copy_location_add(ob_a, ob_b);
+  relations_update(&ob_a->id, false);
+
+  /* The relations of the collider and the force field would be built again along with the ones
+   * of their constraint target. */
+  constraint_copy_location_add(ob_b, nullptr);
+  relations_update(&ob_b->id, false);
+
+  /* Other objects are still updated in place. */
+  constraint_copy_location_add(ob_c, ob_b);
+  relations_update(&ob_c->id, true);
+}
+
+TEST_F(DepsgraphBuildIncrementalTest, FallbackParticles)
+{
+  object_add_particle_system(bmain, scene, ob_mesh, nullptr);
+  depsgraph_create(DAG_EVAL_VIEWPORT);
+
+  constraint_copy_location_add(ob_mesh, ob_a);
+  relations_update(&ob_mesh->id, false);
+}
+
+TEST_F(DepsgraphBuildIncrementalTest, FallbackProxy)
+{
+  ob_a->proxy = ob_b;
+  ob_b->proxy_from = ob_a;
+  depsgraph_create(DAG_EVAL_VIEWPORT);
+
+  constraint_copy_location_add(ob_a, ob_mesh);
+  relations_update(&ob_a->id, false);
+
+  constraint_copy_location_add(ob_b, ob_mesh);
+  relations_update(&ob_b->id, false);
+
+  ob_a->proxy = nullptr;
+  ob_b->proxy_from = nullptr;
+}
+
+TEST_F(DepsgraphBuildIncrementalTest, FallbackSetScene)
+{
+  Scene *scene_set = BKE_scene_add(bmain, "SCSet");
+  Object *ob_set = BKE_object_add_only_object(bmain, OB_EMPTY, "OBSet");
+  BKE_collection_object_add(bmain, scene_set->master_collection, ob_set);
+  scene->set = scene_set;
+  depsgraph_create(DAG_EVAL_VIEWPORT);
+
+  constraint_copy_location_add(ob_set, nullptr);
+  relations_update(&ob_set->id, false);
+
+  /* Objects of the scene itself are still updated in place. */
+  constraint_copy_location_add(ob_a, ob_set);
+  relations_update(&ob_a->id, true);
+}
+
+/* Only objects are updated in place. */
+TEST_F(DepsgraphBuildIncrementalTest, FallbackNotObject)
+{
+  depsgraph_create(DAG_EVAL_VIEWPORT);
+
+  relations_update(static_cast<ID *>(ob_mesh->data), false);
+}
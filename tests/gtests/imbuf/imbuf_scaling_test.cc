@@ -0,0 +1,273 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_math_base.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+}
+
+/* The SSE2 and threaded code paths of the scaling functions have to give the same results as
+ * the scalar code they replace, which is repeated here, processing the image on one thread.
+ * Odd sizes leave a pixel at the end of rows and columns, sizes above 256 * 256 pixels are
+ * scaled on multiple threads. */
+
+class ImbufScalingTest : public testing::Test {
+ protected:
+  static void SetUpTestCase()
+  {
+    testing::Test::SetUpTestCase();
+    BLI_threadapi_init();
+    IMB_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    IMB_exit();
+    BLI_threadapi_exit();
+    testing::Test::TearDownTestCase();
+  }
+};
+
+/* Random colors, with alpha fully transparent, fully opaque or anything in between. */
+static ImBuf *imbuf_random(const int x, const int y)
+{
+  ImBuf *ibuf = IMB_allocImBuf(x, y, 32, IB_rect | IB_rectfloat);
+  RNG *rng = BLI_rng_new(x * y);
+  unsigned char *rect = (unsigned char *)ibuf->rect;
+  float *rect_float = ibuf->rect_float;
+
+  for (size_t i = 0; i < (size_t)x * y; i++) {
+    for (int c = 0; c < 4; c++) {
+      rect[i * 4 + c] = (unsigned char)(BLI_rng_get_uint(rng) & 0xff);
+      rect_float[i * 4 + c] = BLI_rng_get_float(rng);
+    }
+    switch (BLI_rng_get_uint(rng) % 3) {
+      case 0:
+        rect[i * 4 + 3] = 0;
+        rect_float[i * 4 + 3] = 0.0f;
+        break;
+      case 1:
+        rect[i * 4 + 3] = 255;
+        rect_float[i * 4 + 3] = 1.0f;
+        break;
+    }
+  }
+
+  BLI_rng_free(rng);
+  return ibuf;
+}
+
+static void imbuf_expect_eq(const ImBuf *ibuf,
+                            const unsigned char *rect,
+                            const float *rect_float,
+                            const int x,
+                            const int y)
+{
+  ASSERT_EQ(ibuf->x, x);
+  ASSERT_EQ(ibuf->y, y);
+
+  const unsigned char *ibuf_rect = (const unsigned char *)ibuf->rect;
+  for (size_t i = 0; i < (size_t)x * y * 4; i++) {
+    if (ibuf_rect[i] != rect[i]) {
+      EXPECT_EQ(ibuf_rect[i], rect[i]) << "byte pixel " << i / 4 << " channel " << i % 4;
+      break;
+    }
+  }
+  for (size_t i = 0; i < (size_t)x * y * 4; i++) {
+    if (ibuf->rect_float[i] != rect_float[i]) {
+      EXPECT_FLOAT_EQ(ibuf->rect_float[i], rect_float[i])
+          << "float pixel " << i / 4 << " channel " << i % 4;
+      break;
+    }
+  }
+}
+
+/* -------------------------------------------------------------------- */
+/* imb_onehalf */
+
+static void onehalf_byte_ref(const unsigned char *cp1,
+                             const unsigned char *cp2,
+                             unsigned char *dest)
+{
+  unsigned int desti[4] = {0, 0, 0, 0};
+  const unsigned char *pixels[4] = {cp1, cp1 + 4, cp2, cp2 + 4};
+
+  /* Premultiplied in the range of 255 * 255, see #straight_uchar_to_premul_ushort. */
+  for (int i = 0; i < 4; i++) {
+    const unsigned short alpha = pixels[i][3];
+    desti[0] += (unsigned short)(pixels[i][0] * alpha);
+    desti[1] += (unsigned short)(pixels[i][1] * alpha);
+    desti[2] += (unsigned short)(pixels[i][2] * alpha);
+    desti[3] += (unsigned short)(alpha * 256);
+  }
+
+  unsigned short color[4];
+  for (int c = 0; c < 4; c++) {
+    color[c] = (unsigned short)(desti[c] >> 2);
+  }
+
+  if (color[3] <= 255) {
+    for (int c = 0; c < 4; c++) {
+      dest[c] = unit_ushort_to_uchar(color[c]);
+    }
+  }
+  else {
+    const unsigned short alpha = color[3] / 256;
+    dest[0] = unit_ushort_to_uchar((unsigned short)(color[0] / alpha * 256));
+    dest[1] = unit_ushort_to_uchar((unsigned short)(color[1] / alpha * 256));
+    dest[2] = unit_ushort_to_uchar((unsigned short)(color[2] / alpha * 256));
+    dest[3] = unit_ushort_to_uchar(color[3]);
+  }
+}
+
+static void onehalf_expect_ref(const int x, const int y)
+{
+  ImBuf *ibuf1 = imbuf_random(x, y);
+  const int newx = x / 2, newy = y / 2;
+  unsigned char *rect = (unsigned char *)MEM_mallocN(sizeof(char[4]) * newx * newy, __func__);
+  float *rect_float = (float *)MEM_mallocN(sizeof(float[4]) * newx * newy, __func__);
+
+  for (int j = 0; j < newy; j++) {
+    for (int i = 0; i < newx; i++) {
+      const size_t index1 = ((size_t)j * 2 * x + i * 2) * 4;
+      const size_t index2 = ((size_t)j * newx + i) * 4;
+
+      const unsigned char *cp1 = (const unsigned char *)ibuf1->rect + index1;
+      onehalf_byte_ref(cp1, cp1 + x * 4, rect + index2);
+
+      const float *p1f = ibuf1->rect_float + index1;
+      const float *p2f = p1f + x * 4;
+      for (int c = 0; c < 4; c++) {
+        rect_float[index2 + c] = 0.25f * (p1f[c] + p2f[c] + p1f[c + 4] + p2f[c + 4]);
+      }
+    }
+  }
+
+  ImBuf *ibuf2 = IMB_onehalf(ibuf1);
+  imbuf_expect_eq(ibuf2, rect, rect_float, newx, newy);
+
+  IMB_freeImBuf(ibuf2);
+  IMB_freeImBuf(ibuf1);
+  MEM_freeN(rect);
+  MEM_freeN(rect_float);
+}
+
+TEST_F(ImbufScalingTest, OneHalfOddSize)
+{
+  onehalf_expect_ref(7, 5);
+  onehalf_expect_ref(3, 2);
+}
+
+TEST_F(ImbufScalingTest, OneHalfOddSizeThreaded)
+{
+  onehalf_expect_ref(1001, 401);
+}
+
+/* -------------------------------------------------------------------- */
+/* scaledownx & scaledowny */
+
+/* Scales down one line of pixels at a time. \a stride is the distance between the pixels of a
+ * line in both the source and the destination, \a line_stride and \a newline_stride the
+ * distance between lines in the source and the destination. */
+static void scaledown_ref(const ImBuf *ibuf,
+                          unsigned char *newrect,
+                          float *newrectf,
+                          const int size,
+                          const int newsize,
+                          const int lines_len,
+                          const size_t stride,
+                          const size_t line_stride,
+                          const size_t newline_stride)
+{
+  const float add = (size - 0.01) / newsize;
+
+  for (int line = 0; line < lines_len; line++) {
+    const unsigned char *rect = (const unsigned char *)ibuf->rect + line * line_stride;
+    const float *rectf = ibuf->rect_float + line * line_stride;
+    unsigned char *dest = newrect + line * newline_stride;
+    float *destf = newrectf + line * newline_stride;
+    float sample = 0.0f, val[4] = {0.0f}, nval[4], valf[4] = {0.0f}, nvalf[4];
+
+    for (int i = newsize; i > 0; i--) {
+      for (int c = 0; c < 4; c++) {
+        nval[c] = -val[c] * sample;
+        nvalf[c] = -valf[c] * sample;
+      }
+
+      sample += add;
+      while (sample >= 1.0f) {
+        sample -= 1.0f;
+        for (int c = 0; c < 4; c++) {
+          nval[c] += rect[c];
+          nvalf[c] += rectf[c];
+        }
+        rect += stride;
+        rectf += stride;
+      }
+
+      for (int c = 0; c < 4; c++) {
+        val[c] = rect[c];
+        valf[c] = rectf[c];
+        dest[c] = (unsigned char)((nval[c] + sample * val[c]) / add + 0.5f);
+        destf[c] = (nvalf[c] + sample * valf[c]) / add;
+      }
+      rect += stride;
+      rectf += stride;
+      dest += stride;
+      destf += stride;
+
+      sample -= 1.0f;
+    }
+  }
+}
+
+/* Scales a random image of x * y pixels to newx * newy pixels, only one of the sizes is
+ * smaller, so only one of scaledownx and scaledowny is used. */
+static void scaledown_expect_ref(const int x, const int y, const int newx, const int newy)
+{
+  ImBuf *ibuf = imbuf_random(x, y);
+  unsigned char *rect = (unsigned char *)MEM_mallocN(sizeof(char[4]) * newx * newy, __func__);
+  float *rect_float = (float *)MEM_mallocN(sizeof(float[4]) * newx * newy, __func__);
+
+  if (newx < x) {
+    scaledown_ref(ibuf, rect, rect_float, x, newx, y, 4, (size_t)x * 4, (size_t)newx * 4);
+  }
+  else {
+    scaledown_ref(ibuf, rect, rect_float, y, newy, x, (size_t)x * 4, 4, 4);
+  }
+
+  IMB_scaleImBuf(ibuf, newx, newy);
+  imbuf_expect_eq(ibuf, rect, rect_float, newx, newy);
+
+  IMB_freeImBuf(ibuf);
+  MEM_freeN(rect);
+  MEM_freeN(rect_float);
+}
+
+TEST_F(ImbufScalingTest, ScaleDownXOddSize)
+{
+  scaledown_expect_ref(31, 7, 9, 7);
+}
+
+TEST_F(ImbufScalingTest, ScaleDownXOddSizeThreaded)
+{
+  scaledown_expect_ref(1001, 401, 333, 401);
+}
+
+TEST_F(ImbufScalingTest, ScaleDownYOddSize)
+{
+  scaledown_expect_ref(7, 31, 7, 9);
+}
+
+TEST_F(ImbufScalingTest, ScaleDownYOddSizeThreaded)
+{
+  scaledown_expect_ref(401, 1001, 401, 333);
+}
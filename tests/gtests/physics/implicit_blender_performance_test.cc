@@ -0,0 +1,187 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#include "BLI_math_vector.h"
+#include "BLI_threads.h"
+
+#include "BPH_mass_spring.h"
+#include "implicit.h"
+
+#include "PIL_time.h"
+}
+
+#define NUM_STEPS 10
+
+/* Only the public solver API is used, so the same test can time older revisions of the
+ * solver. */
+class ImplicitSolverPerformanceTest : public testing::Test {
+ protected:
+  Implicit_Data *data = nullptr;
+  int res = 0;
+  float spacing = 0.0f;
+
+  static void SetUpTestCase()
+  {
+    BLI_threadapi_init();
+  }
+
+  static void TearDownTestCase()
+  {
+    BLI_threadapi_exit();
+  }
+
+  void TearDown() override
+  {
+    if (data) {
+      BPH_mass_spring_solver_free(data);
+    }
+  }
+
+  int vert_index(int x, int y) const
+  {
+    return y * res + x;
+  }
+
+  /* A square piece of cloth of res x res vertices hanging from its first row, with structural
+   * and shear springs. Every vertex but the pinned ones has a small random velocity so the
+   * springs are stretched from the first step. */
+  void cloth_create(const int resolution)
+  {
+    res = resolution;
+    spacing = 1.0f / res;
+
+    const int num_verts = res * res;
+    const int num_springs = 2 * res * (res - 1) + 2 * (res - 1) * (res - 1);
+    data = BPH_mass_spring_solver_create(num_verts, num_springs);
+
+    unsigned int seed = 1;
+    for (int y = 0; y < res; y++) {
+      for (int x = 0; x < res; x++) {
+        const float co[3] = {x * spacing, 0.0f, -y * spacing};
+        float vel[3] = {0.0f, 0.0f, 0.0f};
+        if (y != 0) {
+          for (int i = 0; i < 3; i++) {
+            seed = seed * 1103515245u + 12345u;
+            vel[i] = ((seed >> 16) & 0x7fff) / 32767.0f - 0.5f;
+          }
+        }
+        float rot[3][3];
+        unit_m3(rot);
+
+        const int index = vert_index(x, y);
+        BPH_mass_spring_set_vertex_mass(data, index, 1.0f);
+        BPH_mass_spring_set_rest_transform(data, index, rot);
+        BPH_mass_spring_set_motion_state(data, index, co, vel);
+      }
+    }
+  }
+
+  void spring_apply(int i, int j, float restlen)
+  {
+    BPH_mass_spring_force_spring_linear(
+        data, i, j, restlen, 15.0f * res, 5.0f, 15.0f * res, 5.0f, false, true, 0.0f);
+  }
+
+  /* One simulation step like the cloth solver does it, only the velocity solve is timed. */
+  double step(const float dt, ImplicitSolverResult *result)
+  {
+    const float gravity[3] = {0.0f, 0.0f, -9.81f};
+    const float zero[3] = {0.0f, 0.0f, 0.0f};
+    const float diagonal = spacing * (float)M_SQRT2;
+
+    BPH_mass_spring_clear_constraints(data);
+    for (int x = 0; x < res; x++) {
+      BPH_mass_spring_add_constraint_ndof0(data, vert_index(x, 0), zero);
+    }
+
+    BPH_mass_spring_clear_forces(data);
+    for (int i = 0; i < res * res; i++) {
+      BPH_mass_spring_force_gravity(data, i, 1.0f, gravity);
+    }
+    BPH_mass_spring_force_drag(data, 0.1f);
+
+    for (int y = 0; y < res; y++) {
+      for (int x = 0; x < res; x++) {
+        if (x + 1 < res) {
+          spring_apply(vert_index(x, y), vert_index(x + 1, y), spacing);
+        }
+        if (y + 1 < res) {
+          spring_apply(vert_index(x, y), vert_index(x, y + 1), spacing);
+        }
+        if (x + 1 < res && y + 1 < res) {
+          spring_apply(vert_index(x, y), vert_index(x + 1, y + 1), diagonal);
+          spring_apply(vert_index(x + 1, y), vert_index(x, y + 1), diagonal);
+        }
+      }
+    }
+
+    const double start_time = PIL_check_seconds_timer();
+    BPH_mass_spring_solve_velocities(data, dt, result);
+    const double solve_time = PIL_check_seconds_timer() - start_time;
+
+    BPH_mass_spring_solve_positions(data, dt);
+    BPH_mass_spring_apply_result(data);
+
+    return solve_time;
+  }
+
+  void solve_test_do(const int resolution)
+  {
+    cloth_create(resolution);
+
+    double solve_time = 0.0;
+    int iterations = 0;
+    for (int i = 0; i < NUM_STEPS; i++) {
+      ImplicitSolverResult result = {0};
+      solve_time += step(1.0f / 25.0f, &result);
+      iterations += result.iterations;
+
+      EXPECT_EQ(result.status, BPH_SOLVER_SUCCESS);
+    }
+
+    /* The cloth mustn't explode. */
+    for (int i = 0; i < res * res; i++) {
+      float co[3];
+      BPH_mass_spring_get_position(data, i, co);
+      EXPECT_TRUE(isfinite(co[0]) && isfinite(co[1]) && isfinite(co[2]));
+      EXPECT_LT(len_v3(co), 10.0f);
+    }
+
+    printf("%d vertices: solved velocities in %fs per step, %.1f iterations on average\n",
+           res * res,
+           solve_time / NUM_STEPS,
+           (float)iterations / NUM_STEPS);
+  }
+};
+
+TEST_F(ImplicitSolverPerformanceTest, Grid64)
+{
+  solve_test_do(64);
+}
+
+TEST_F(ImplicitSolverPerformanceTest, Grid128)
+{
+  solve_test_do(128);
+}
+
+TEST_F(ImplicitSolverPerformanceTest, Grid256)
+{
+  solve_test_do(256);
+}